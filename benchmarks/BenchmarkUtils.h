@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+struct BenchmarkSettings
+{
+  size_t warmupCount = 3;
+  size_t repetitionsCount = 15;
+  size_t elementsPerRepetition = 1 << 16; //small lists are batched until a repetition touches about this many elements so that timer overhead does not dominate
+};
+
+//all times are per element
+struct BenchmarkStats
+{
+  double minNs;
+  double medianNs;
+  double meanNs;
+  double stdDevNs;
+  double p95Ns;
+};
+
+BenchmarkStats ComputeStats(std::vector<double> samples)
+{
+  BenchmarkStats stats = {};
+  if (samples.empty())
+    return stats;
+  std::sort(samples.begin(), samples.end());
+  auto getPercentile = [&](double percentile)
+  {
+    double pos = percentile * double(samples.size() - 1);
+    size_t index = size_t(pos);
+    double ratio = pos - double(index);
+    return (index + 1 < samples.size()) ? samples[index] * (1.0 - ratio) + samples[index + 1] * ratio : samples[index];
+  };
+  stats.minNs = samples.front();
+  stats.medianNs = getPercentile(0.5);
+  stats.p95Ns = getPercentile(0.95);
+  stats.meanNs = std::accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size());
+  double variance = 0.0;
+  for (double sample : samples)
+    variance += (sample - stats.meanNs) * (sample - stats.meanNs);
+  stats.stdDevNs = std::sqrt(variance / double(std::max<size_t>(samples.size() - 1, 1)));
+  return stats;
+}
+
+//prepareFunc restores the input and is not timed, runFunc is. both get called warmupCount + repetitionsCount times
+template<typename PrepareFunc, typename RunFunc>
+BenchmarkStats Measure(const BenchmarkSettings &settings, size_t elementsCount, PrepareFunc prepareFunc, RunFunc runFunc)
+{
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> samples;
+  for (size_t repetition = 0; repetition < settings.warmupCount + settings.repetitionsCount; repetition++)
+  {
+    prepareFunc();
+    Clock::time_point startTime = Clock::now();
+    runFunc();
+    Clock::time_point endTime = Clock::now();
+    if (repetition >= settings.warmupCount)
+      samples.push_back(std::chrono::duration<double, std::nano>(endTime - startTime).count() / double(std::max<size_t>(elementsCount, 1)));
+  }
+  return ComputeStats(samples);
+}
+
+enum struct Distributions
+{
+  Uniform,
+  Sorted,
+  Reversed,
+  NearlySorted, //sorted with a few percent of random swaps, what a bucket looks like when the camera barely moved
+  FewUnique, //lots of equal keys, like points of a flat surface facing the camera
+  Count
+};
+
+const char *GetDistributionName(Distributions distribution)
+{
+  switch (distribution)
+  {
+    case Distributions::Uniform: return "uniform";
+    case Distributions::Sorted: return "sorted";
+    case Distributions::Reversed: return "reversed";
+    case Distributions::NearlySorted: return "nearly_sorted";
+    case Distributions::FewUnique: return "few_unique";
+    default: return "unknown";
+  }
+}
+
+std::vector<float> GenerateKeys(Distributions distribution, size_t count, std::default_random_engine &eng)
+{
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  std::vector<float> keys(count);
+  for (auto &key : keys)
+    key = dis(eng);
+
+  switch (distribution)
+  {
+    case Distributions::Sorted:
+    {
+      std::sort(keys.begin(), keys.end());
+    }break;
+    case Distributions::Reversed:
+    {
+      std::sort(keys.begin(), keys.end(), [](float left, float right) { return left > right; });
+    }break;
+    case Distributions::NearlySorted:
+    {
+      std::sort(keys.begin(), keys.end());
+      std::uniform_int_distribution<size_t> indexDis(0, count > 0 ? count - 1 : 0);
+      size_t swapsCount = std::max<size_t>(count / 32, 1);
+      for (size_t swapNumber = 0; swapNumber < swapsCount && count > 1; swapNumber++)
+        std::swap(keys[indexDis(eng)], keys[indexDis(eng)]);
+    }break;
+    case Distributions::FewUnique:
+    {
+      for (auto &key : keys)
+        key = std::floor(key * 8.0f) / 8.0f;
+    }break;
+    default: break;
+  }
+  return keys;
+}
@@ -0,0 +1,199 @@
+//standalone benchmark and validation of the cpu 3d fft against a naive dft, does not need vulkan.
+//usage: FFTBenchmark [--reps N] [--warmup N] [--max-size N] [--max-dft-size N] [--threads N] [--csv path]
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <cstdlib>
+
+#include "BenchmarkUtils.h"
+#include "../src/Render/Common/FFT/FFT.h"
+
+struct BenchmarkResult
+{
+  std::string group;
+  std::string algorithm;
+  std::string shape;
+  size_t size;
+  BenchmarkStats stats;
+};
+
+std::vector<glm::vec4> GenerateVolume(glm::ivec3 size, std::default_random_engine &eng)
+{
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<glm::vec4> volume(size_t(size.x) * size.y * size.z);
+  for (auto &voxel : volume)
+    voxel = glm::vec4(dis(eng), dis(eng), dis(eng), dis(eng));
+  return volume;
+}
+
+std::string GetShapeName(glm::ivec3 size)
+{
+  return std::to_string(size.x) + "x" + std::to_string(size.y) + "x" + std::to_string(size.z);
+}
+
+//max abs difference relative to the largest magnitude of the reference
+float GetRelativeError(const std::vector<glm::vec4> &values, const std::vector<glm::vec4> &reference)
+{
+  float maxDiff = 0.0f;
+  float maxValue = 1e-7f;
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    glm::vec4 diff = glm::abs(values[i] - reference[i]);
+    maxDiff = std::max(maxDiff, std::max(std::max(diff.x, diff.y), std::max(diff.z, diff.w)));
+    glm::vec4 value = glm::abs(reference[i]);
+    maxValue = std::max(maxValue, std::max(std::max(value.x, value.y), std::max(value.z, value.w)));
+  }
+  return maxDiff / maxValue;
+}
+
+std::vector<std::pair<std::string, CpuFFT::Settings>> GetFFTVariants(size_t threadsCount)
+{
+  CpuFFT::Settings scalar;
+  scalar.threadsCount = 1;
+  scalar.useSimd = false;
+  CpuFFT::Settings simd;
+  simd.threadsCount = 1;
+  simd.useSimd = true;
+  CpuFFT::Settings simdThreaded;
+  simdThreaded.threadsCount = threadsCount;
+  simdThreaded.useSimd = true;
+
+  std::vector<std::pair<std::string, CpuFFT::Settings>> variants = { { "fft_scalar", scalar } };
+  #if defined(__AVX__)
+  variants.push_back({ "fft_avx", simd });
+  variants.push_back({ "fft_avx_threads", simdThreaded });
+  #else
+  scalar.threadsCount = threadsCount;
+  variants.push_back({ "fft_scalar_threads", scalar });
+  #endif
+  return variants;
+}
+
+//every variant has to match the naive dft forward and get the input back after the inverse transform
+bool Validate(size_t threadsCount)
+{
+  std::default_random_engine eng(1);
+  glm::ivec3 sizes[] = { glm::ivec3(4, 4, 4), glm::ivec3(8, 8, 8), glm::ivec3(16, 16, 16), glm::ivec3(32, 8, 2), glm::ivec3(2, 64, 16), glm::ivec3(1, 128, 1) };
+  const float maxError = 1e-4f;
+  bool isValid = true;
+  for (auto size : sizes)
+  {
+    auto source = GenerateVolume(size, eng);
+    auto reference = source;
+    CpuFFT::NaiveDFT3d(reference.data(), size, true);
+    for (auto &variant : GetFFTVariants(threadsCount))
+    {
+      auto forward = source;
+      CpuFFT::FFT3d(forward.data(), size, true, variant.second);
+      auto roundtrip = forward;
+      CpuFFT::FFT3d(roundtrip.data(), size, false, variant.second);
+      float forwardError = GetRelativeError(forward, reference);
+      float roundtripError = GetRelativeError(roundtrip, source);
+      if (forwardError > maxError || roundtripError > maxError)
+      {
+        std::cerr << variant.first << " failed on " << GetShapeName(size) << ": forward error " << forwardError << ", roundtrip error " << roundtripError << "\n";
+        isValid = false;
+      }
+    }
+  }
+  return isValid;
+}
+
+void RunBenchmarks(const BenchmarkSettings &settings, size_t maxSize, size_t maxDftSize, size_t threadsCount, std::vector<BenchmarkResult> &results)
+{
+  std::default_random_engine eng(2);
+  for (size_t size = 8; size <= maxSize; size *= 2)
+  {
+    glm::ivec3 volumeSize = glm::ivec3(int(size));
+    auto source = GenerateVolume(volumeSize, eng);
+    std::vector<glm::vec4> volume;
+    size_t voxelsCount = source.size();
+
+    if (size <= maxDftSize)
+    {
+      BenchmarkStats stats = Measure(settings, voxelsCount,
+        [&]() { volume = source; },
+        [&]() { CpuFFT::NaiveDFT3d(volume.data(), volumeSize, true); });
+      results.push_back({ "dft", "dft_naive", GetShapeName(volumeSize), size, stats });
+    }
+    for (auto &variant : GetFFTVariants(threadsCount))
+    {
+      BenchmarkStats stats = Measure(settings, voxelsCount,
+        [&]() { volume = source; },
+        [&]() { CpuFFT::FFT3d(volume.data(), volumeSize, true, variant.second); });
+      results.push_back({ "fft", variant.first, GetShapeName(volumeSize), size, stats });
+    }
+  }
+}
+
+void PrintResults(const std::vector<BenchmarkResult> &results)
+{
+  char line[256];
+  snprintf(line, sizeof(line), "%-6s %-18s %-12s %10s %10s %10s %10s %10s\n", "group", "algorithm", "shape", "median", "mean", "stddev", "min", "p95");
+  std::cout << line;
+  for (auto &result : results)
+  {
+    snprintf(line, sizeof(line), "%-6s %-18s %-12s %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+      result.group.c_str(), result.algorithm.c_str(), result.shape.c_str(),
+      result.stats.medianNs, result.stats.meanNs, result.stats.stdDevNs, result.stats.minNs, result.stats.p95Ns);
+    std::cout << line;
+  }
+  std::cout << "(ns per voxel, a voxel holds 2 complex numbers)\n";
+}
+
+void WriteCsv(const std::vector<BenchmarkResult> &results, const std::string &path)
+{
+  std::ofstream file(path);
+  file << "group,algorithm,shape,size,median_ns,mean_ns,stddev_ns,min_ns,p95_ns\n";
+  for (auto &result : results)
+  {
+    file << result.group << "," << result.algorithm << "," << result.shape << "," << result.size << ","
+      << result.stats.medianNs << "," << result.stats.meanNs << "," << result.stats.stdDevNs << "," << result.stats.minNs << "," << result.stats.p95Ns << "\n";
+  }
+}
+
+int main(int argc, char **argv)
+{
+  BenchmarkSettings settings;
+  settings.warmupCount = 1;
+  settings.repetitionsCount = 5;
+  size_t maxSize = 128;
+  size_t maxDftSize = 32;
+  size_t threadsCount = 0;
+  std::string csvPath;
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--reps" && hasValue)
+      settings.repetitionsCount = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--warmup" && hasValue)
+      settings.warmupCount = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--max-size" && hasValue)
+      maxSize = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--max-dft-size" && hasValue)
+      maxDftSize = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--threads" && hasValue)
+      threadsCount = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--csv" && hasValue)
+      csvPath = argv[++argIndex];
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--reps N] [--warmup N] [--max-size N] [--max-dft-size N] [--threads N] [--csv path]\n";
+      return 1;
+    }
+  }
+  settings.repetitionsCount = std::max<size_t>(settings.repetitionsCount, 1);
+
+  if (!Validate(threadsCount))
+    return 1;
+  std::cout << "all fft variants match the naive dft\n";
+
+  std::vector<BenchmarkResult> results;
+  RunBenchmarks(settings, maxSize, maxDftSize, threadsCount, results);
+  PrintResults(results);
+  if (!csvPath.empty())
+    WriteCsv(results, csvPath);
+  return 0;
+}
@@ -0,0 +1,169 @@
+//standalone round trip check of FieldCompression, does not need vulkan. compresses synthetic rgba32f volumes the way recordings
+//store them, decompresses them back and fails if any component is further from the original than half a quantization step of
+//its brick, or if a truncated stream is not rejected. reports the compression ratio and throughput of both directions.
+//usage: FieldCompressionBenchmark [--resolution N] [--repetitions N] [--threads N]
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cfloat>
+
+#include "BenchmarkUtils.h"
+#include "../src/Render/Renderers/WaterRenderer/FieldCompression.h"
+
+enum struct Fields
+{
+  Smooth, //velocity-like, what the solver mostly produces
+  Noisy, //worst case for the predictor
+  Constant, //bricks with a zero range
+  Mixed, //large magnitudes next to tiny ones in the same volume
+  Count
+};
+
+const char *GetFieldName(Fields fieldType)
+{
+  switch (fieldType)
+  {
+    case Fields::Smooth: return "smooth";
+    case Fields::Noisy: return "noisy";
+    case Fields::Constant: return "constant";
+    case Fields::Mixed: return "mixed";
+    default: return "unknown";
+  }
+}
+
+std::vector<glm::vec4> GenerateField(Fields fieldType, glm::uvec3 volumeResolution, std::default_random_engine &eng)
+{
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<glm::vec4> field(size_t(volumeResolution.x) * volumeResolution.y * volumeResolution.z);
+  for (glm::uint z = 0; z < volumeResolution.z; z++)
+  {
+    for (glm::uint y = 0; y < volumeResolution.y; y++)
+    {
+      for (glm::uint x = 0; x < volumeResolution.x; x++)
+      {
+        glm::vec3 pos = glm::vec3(x, y, z) / glm::vec3(volumeResolution) * 6.2831853f;
+        glm::vec4 &value = field[FieldCompression::GetNodeOffset(volumeResolution, glm::ivec3(x, y, z))];
+        switch (fieldType)
+        {
+          case Fields::Smooth: value = glm::vec4(std::sin(pos.x + pos.y), std::cos(pos.y * 2.0f + pos.z), std::sin(pos.z) * std::cos(pos.x), 0.0f); break;
+          case Fields::Noisy: value = glm::vec4(dis(eng), dis(eng), dis(eng), dis(eng)); break;
+          case Fields::Constant: value = glm::vec4(float(z / FieldCompression::BrickSize), -1.0f, 0.5f, 0.0f); break;
+          case Fields::Mixed: value = glm::vec4(std::sin(pos.x) * 1e4f, std::cos(pos.y) * 1e-4f, dis(eng), x < volumeResolution.x / 2 ? 0.0f : 1e3f); break;
+          default: break;
+        }
+      }
+    }
+  }
+  return field;
+}
+
+//largest error of any component relative to what quantization of its brick allows
+double GetMaxRelativeError(const std::vector<glm::vec4> &field, const std::vector<glm::vec4> &decompressedField, glm::uvec3 volumeResolution)
+{
+  glm::ivec3 bricksCount = FieldCompression::GetBricksCount(volumeResolution);
+  size_t totalBricksCount = size_t(bricksCount.x) * size_t(bricksCount.y) * size_t(bricksCount.z);
+  double maxRelativeError = 0.0;
+  for (size_t brickIndex = 0; brickIndex < totalBricksCount; brickIndex++)
+  {
+    glm::ivec3 brickOrigin = FieldCompression::GetBrickOrigin(bricksCount, brickIndex);
+    glm::vec4 mins = glm::vec4(FLT_MAX);
+    glm::vec4 maxs = glm::vec4(-FLT_MAX);
+    for (size_t nodeIndex = 0; nodeIndex < FieldCompression::BrickNodesCount; nodeIndex++)
+    {
+      glm::vec4 value = field[FieldCompression::GetNodeOffset(volumeResolution, FieldCompression::GetBrickNode(brickOrigin, nodeIndex))];
+      mins = glm::min(mins, value);
+      maxs = glm::max(maxs, value);
+    }
+    //half a step, plus float rounding of min + quantized * step
+    glm::vec4 tolerances = (maxs - mins) / 65535.0f * 0.5f + glm::max(glm::abs(mins), glm::abs(maxs)) * (4.0f * FLT_EPSILON) + glm::vec4(FLT_MIN);
+    for (size_t nodeIndex = 0; nodeIndex < FieldCompression::BrickNodesCount; nodeIndex++)
+    {
+      size_t offset = FieldCompression::GetNodeOffset(volumeResolution, FieldCompression::GetBrickNode(brickOrigin, nodeIndex));
+      glm::vec4 errors = glm::abs(decompressedField[offset] - field[offset]);
+      for (int component = 0; component < 4; component++)
+        maxRelativeError = std::max(maxRelativeError, double(errors[component]) / double(tolerances[component]));
+    }
+  }
+  return maxRelativeError;
+}
+
+int main(int argc, char **argv)
+{
+  glm::uvec3 volumeResolution = glm::uvec3(64);
+  BenchmarkSettings benchmarkSettings;
+  benchmarkSettings.warmupCount = 1;
+  benchmarkSettings.repetitionsCount = 5;
+  CpuFFT::Settings parallelSettings;
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--resolution" && hasValue)
+      volumeResolution = glm::uvec3(glm::uint(atoi(argv[++argIndex])));
+    else if (arg == "--repetitions" && hasValue)
+      benchmarkSettings.repetitionsCount = size_t(std::max(atoi(argv[++argIndex]), 1));
+    else if (arg == "--threads" && hasValue)
+      parallelSettings.threadsCount = size_t(atoi(argv[++argIndex]));
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--resolution N] [--repetitions N] [--threads N]\n";
+      return 1;
+    }
+  }
+  if (volumeResolution.x == 0 || volumeResolution.x % FieldCompression::BrickSize != 0)
+  {
+    std::cerr << "resolution has to be a multiple of " << FieldCompression::BrickSize << "\n";
+    return 1;
+  }
+
+  size_t nodesCount = size_t(volumeResolution.x) * volumeResolution.y * volumeResolution.z;
+  std::cout << "resolution " << volumeResolution.x << ", " << nodesCount * sizeof(glm::vec4) / 1024 << " KiB per field\n";
+  char line[256];
+  snprintf(line, sizeof(line), "%-10s %10s %12s %16s %16s %10s\n", "field", "ratio", "max error", "compress MB/s", "decompress MB/s", "result");
+  std::cout << line;
+
+  std::default_random_engine eng(1);
+  bool isPassed = true;
+  for (int fieldIndex = 0; fieldIndex < int(Fields::Count); fieldIndex++)
+  {
+    Fields fieldType = Fields(fieldIndex);
+    std::vector<glm::vec4> field = GenerateField(fieldType, volumeResolution, eng);
+    std::vector<glm::vec4> decompressedField(nodesCount);
+
+    std::vector<uint8_t> compressed;
+    BenchmarkStats compressStats = Measure(benchmarkSettings, nodesCount, [&]() {}, [&]()
+    {
+      compressed = FieldCompression::Compress(field.data(), volumeResolution, parallelSettings);
+    });
+    bool isDecompressed = true;
+    BenchmarkStats decompressStats = Measure(benchmarkSettings, nodesCount, [&]()
+    {
+      std::fill(decompressedField.begin(), decompressedField.end(), glm::vec4(std::nanf("")));
+    }, [&]()
+    {
+      isDecompressed = FieldCompression::Decompress(compressed.data(), compressed.size(), volumeResolution, decompressedField.data(), parallelSettings) && isDecompressed;
+    });
+
+    double maxRelativeError = isDecompressed ? GetMaxRelativeError(field, decompressedField, volumeResolution) : 0.0;
+    //every brick ends with its own rANS stream, so dropping the last byte can't go unnoticed
+    bool isTruncationRejected = !FieldCompression::Decompress(compressed.data(), compressed.size() - 1, volumeResolution, decompressedField.data(), parallelSettings);
+    //nan compares false, so it is checked separately from the error bound
+    bool isFinite = true;
+    for (auto &value : decompressedField)
+      isFinite = isFinite && !glm::any(glm::isnan(value));
+    bool isFieldPassed = isDecompressed && isFinite && maxRelativeError <= 1.0 && isTruncationRejected;
+    isPassed = isPassed && isFieldPassed;
+
+    double ratio = double(nodesCount * sizeof(glm::vec4)) / double(compressed.size());
+    auto getThroughput = [](const BenchmarkStats &stats) { return double(sizeof(glm::vec4)) / stats.medianNs * 1e3; };
+    snprintf(line, sizeof(line), "%-10s %10.2f %12.3f %16.1f %16.1f %10s\n", GetFieldName(fieldType), ratio, maxRelativeError, getThroughput(compressStats), getThroughput(decompressStats), isFieldPassed ? "ok" : "FAIL");
+    std::cout << line;
+  }
+  std::cout << "(max error is in half quantization steps of the brick, has to stay <= 1)\n";
+  if (!isPassed)
+  {
+    std::cerr << "field compression round trip failed\n";
+    return 1;
+  }
+  return 0;
+}
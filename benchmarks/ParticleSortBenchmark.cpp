@@ -0,0 +1,94 @@
+//standalone check and benchmark of CpuParticleSort, does not need vulkan. fails if the radix sort gives a different order than
+//a stable sort by the same keys. then advects well mixed particles through a solver volume before and after sorting them
+//to show what ParticleSorter buys particlesAdvect.comp, on the cpu it's the same trilinear gather.
+//usage: ParticleSortBenchmark [--particles N] [--resolution N] [--threads N]
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "BenchmarkUtils.h"
+#include "../src/Render/Renderers/WaterRenderer/CpuParticleSort.h"
+#include "../src/Render/Renderers/WaterRenderer/CpuShrodingerSolver.h"
+
+int main(int argc, char **argv)
+{
+  size_t particlesCount = size_t(1) << 20;
+  CpuShrodingerSolver::Settings solverSettings;
+  solverSettings.volumeMin = glm::vec3(-2.5f);
+  solverSettings.volumeMax = glm::vec3(2.5f);
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--particles" && hasValue)
+      particlesCount = size_t(atoll(argv[++argIndex]));
+    else if (arg == "--resolution" && hasValue)
+      solverSettings.volumeResolution = glm::uvec3(glm::uint(atoi(argv[++argIndex])));
+    else if (arg == "--threads" && hasValue)
+      solverSettings.parallelSettings.threadsCount = size_t(atoi(argv[++argIndex]));
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--particles N] [--resolution N] [--threads N]\n";
+      return 1;
+    }
+  }
+
+  //a fully mixed flow: positions have nothing to do with indices
+  std::default_random_engine eng(1);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  std::vector<glm::vec3> positions(particlesCount);
+  for (auto &position : positions)
+    position = solverSettings.volumeMin + glm::vec3(dis(eng), dis(eng), dis(eng)) * (solverSettings.volumeMax - solverSettings.volumeMin);
+
+  CpuParticleSort::Grid grid;
+  grid.resolution = solverSettings.volumeResolution;
+  grid.volumeMin = solverSettings.volumeMin;
+  grid.volumeMax = solverSettings.volumeMax;
+
+  bool isValid = true;
+  using Clock = std::chrono::steady_clock;
+  auto sortStart = Clock::now();
+  std::vector<uint32_t> sortedIndices = CpuParticleSort::GetSortedIndices(grid, particlesCount, [&](size_t particleIndex) { return positions[particleIndex]; });
+  double sortMs = std::chrono::duration<double, std::milli>(Clock::now() - sortStart).count();
+
+  std::vector<uint32_t> referenceIndices(particlesCount);
+  std::iota(referenceIndices.begin(), referenceIndices.end(), 0);
+  std::stable_sort(referenceIndices.begin(), referenceIndices.end(), [&](uint32_t left, uint32_t right)
+  {
+    return CpuParticleSort::GetCellKey(grid, positions[left]) < CpuParticleSort::GetCellKey(grid, positions[right]);
+  });
+  if (sortedIndices != referenceIndices)
+  {
+    std::cerr << "radix sort order differs from std::stable_sort\n";
+    isValid = false;
+  }
+  std::cout << "sorted " << particlesCount << " particles by " << CpuParticleSort::GetKeyBitsCount(grid.resolution) << " bit keys in " << CpuParticleSort::GetPassesCount(CpuParticleSort::GetKeyBitsCount(grid.resolution)) << " passes, " << sortMs << "ms\n";
+
+  std::vector<glm::vec3> sortedPositions = positions;
+  CpuParticleSort::Permute(sortedPositions, sortedIndices);
+
+  CpuShrodingerSolver solver(solverSettings);
+  solver.Init();
+  solver.Step();
+
+  BenchmarkSettings benchmarkSettings;
+  benchmarkSettings.repetitionsCount = 5;
+  std::vector<glm::vec3> advectedPositions;
+  char line[256];
+  snprintf(line, sizeof(line), "%-10s %12s %12s\n", "order", "median ns", "min ns");
+  std::cout << line;
+  double mixedMedianNs = 0.0;
+  for (int orderIndex = 0; orderIndex < 2; orderIndex++)
+  {
+    const std::vector<glm::vec3> &srcPositions = orderIndex == 0 ? positions : sortedPositions;
+    BenchmarkStats stats = Measure(benchmarkSettings, particlesCount, [&]() { advectedPositions = srcPositions; }, [&]() { solver.AdvectParticles(advectedPositions.data(), advectedPositions.size()); });
+    snprintf(line, sizeof(line), "%-10s %12.2f %12.2f\n", orderIndex == 0 ? "mixed" : "sorted", stats.medianNs, stats.minNs);
+    std::cout << line;
+    if (orderIndex == 0)
+      mixedMedianNs = stats.medianNs;
+    else
+      std::cout << "advection speedup " << mixedMedianNs / stats.medianNs << "x\n";
+  }
+  std::cout << "(times are per particle)\n";
+  return isValid ? 0 : 1;
+}
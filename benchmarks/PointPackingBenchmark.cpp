@@ -0,0 +1,199 @@
+//standalone round trip check of the PointPacking encodings, does not need vulkan. packs synthetic point clouds into hot chunks the
+//way pointsPack.comp does, decodes them back and fails if any position is further from the original than half a 16 bit step of
+//its chunk box plus float rounding, or if a radius is off by more than half a float16 ulp. octahedral normals have to stay within
+//MaxNormalErrorRadians and rgb9e5 channels within half a mantissa step of the shared exponent. reports the throughput of the hot packing.
+//usage: PointPackingBenchmark [--points N] [--repetitions N]
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cfloat>
+
+#include "BenchmarkUtils.h"
+#include "../src/Render/Common/PointPacking.h"
+
+enum struct Clouds
+{
+  Coherent, //consecutive points close to each other, what chunked meshes and sorted particles look like
+  Scattered, //every chunk spans the whole scene, worst case for the quantization
+  Degenerate, //all points of a chunk at the same spot, zero box size
+  FarAway, //small chunks far from the origin where float rounding of the box corner matters
+  Count
+};
+
+const char *GetCloudName(Clouds cloudType)
+{
+  switch (cloudType)
+  {
+    case Clouds::Coherent: return "coherent";
+    case Clouds::Scattered: return "scattered";
+    case Clouds::Degenerate: return "degenerate";
+    case Clouds::FarAway: return "far_away";
+    default: return "unknown";
+  }
+}
+
+//xyz - position, w - radius
+std::vector<glm::vec4> GenerateCloud(Clouds cloudType, size_t pointsCount, std::default_random_engine &eng)
+{
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> radiusPowDis(-4.0f, 1.0f);
+  std::vector<glm::vec4> cloud(pointsCount);
+  glm::vec3 walkPos = glm::vec3(0.0f);
+  for (size_t pointIndex = 0; pointIndex < pointsCount; pointIndex++)
+  {
+    glm::vec3 pos = glm::vec3(0.0f);
+    switch (cloudType)
+    {
+      case Clouds::Coherent: walkPos += glm::vec3(dis(eng), dis(eng), dis(eng)) * 1e-2f; pos = walkPos; break;
+      case Clouds::Scattered: pos = glm::vec3(dis(eng), dis(eng), dis(eng)) * 100.0f; break;
+      case Clouds::Degenerate: pos = glm::vec3(float(pointIndex / PointPacking::ChunkPointsCount), -3.0f, 0.25f); break;
+      case Clouds::FarAway: pos = glm::vec3(1e4f, -2e4f, 5e3f) + glm::vec3(dis(eng), dis(eng), dis(eng)) * 0.5f; break;
+      default: break;
+    }
+    cloud[pointIndex] = glm::vec4(pos, std::pow(10.0f, radiusPowDis(eng)));
+  }
+  return cloud;
+}
+
+//largest position and radius errors of a decoded cloud relative to what the encoding allows
+glm::dvec2 GetMaxRelativeErrors(const std::vector<glm::vec4> &cloud, const std::vector<PointPacking::HotChunk> &chunks)
+{
+  glm::dvec2 maxRelativeErrors = glm::dvec2(0.0);
+  for (size_t pointIndex = 0; pointIndex < cloud.size(); pointIndex++)
+  {
+    const PointPacking::HotChunk &chunk = chunks[pointIndex / PointPacking::ChunkPointsCount];
+    glm::vec3 boxMin = glm::vec3(chunk.boxMin);
+    glm::vec3 boxSize = glm::vec3(chunk.boxSize);
+    glm::vec4 decoded = PointPacking::DecodeHotPoint(chunk.points[pointIndex % PointPacking::ChunkPointsCount], boxMin, boxSize);
+
+    //half a step, plus float rounding of the offset from the box corner and of boxMin + quantized * step
+    glm::vec3 posTolerances = boxSize / PointPacking::PosQuantizationMax * 0.5f + (glm::abs(boxMin) + boxSize) * (4.0f * FLT_EPSILON) + glm::vec3(FLT_MIN);
+    glm::vec3 posErrors = glm::abs(glm::vec3(decoded) - glm::vec3(cloud[pointIndex]));
+    for (int axis = 0; axis < 3; axis++)
+      maxRelativeErrors.x = std::max(maxRelativeErrors.x, double(posErrors[axis]) / double(posTolerances[axis]));
+    //half an ulp of a float16 with its 10 bit mantissa, absolute below the smallest normal float16
+    float radiusTolerance = std::max(cloud[pointIndex].w * std::exp2(-11.0f), std::exp2(-25.0f));
+    maxRelativeErrors.y = std::max(maxRelativeErrors.y, double(std::abs(decoded.w - cloud[pointIndex].w)) / double(radiusTolerance));
+  }
+  return maxRelativeErrors;
+}
+
+//16 bits per octahedral coordinate, the measured maximum is about 6.5e-5
+const double MaxNormalErrorRadians = 1e-4;
+
+bool CheckNormals(size_t normalsCount, std::default_random_engine &eng, double &maxAngle)
+{
+  std::normal_distribution<float> dis(0.0f, 1.0f);
+  std::vector<glm::vec3> normals = {
+    glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+    glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+  while (normals.size() < normalsCount)
+  {
+    glm::vec3 normal = glm::vec3(dis(eng), dis(eng), dis(eng));
+    if (glm::length(normal) > 1e-3f)
+      normals.push_back(glm::normalize(normal));
+  }
+  maxAngle = 0.0;
+  for (auto &normal : normals)
+  {
+    glm::vec3 decoded = PointPacking::DecodeOctNormal(PointPacking::EncodeOctNormal(normal));
+    //acos of a dot this close to 1 would be all rounding
+    glm::dvec3 srcNormal = glm::dvec3(normal);
+    glm::dvec3 dstNormal = glm::dvec3(decoded);
+    maxAngle = std::max(maxAngle, std::atan2(glm::length(glm::cross(srcNormal, dstNormal)), glm::dot(srcNormal, dstNormal)));
+  }
+  return maxAngle <= MaxNormalErrorRadians;
+}
+
+//max error in half mantissa steps of the shared exponent, has to stay <= 1
+double GetMaxLightRelativeError(size_t colorsCount, std::default_random_engine &eng)
+{
+  std::uniform_real_distribution<float> powDis(-30.0f, 15.9f);
+  std::uniform_real_distribution<float> ratioDis(0.0f, 1.0f);
+  double maxRelativeError = 0.0;
+  for (size_t colorNumber = 0; colorNumber < colorsCount; colorNumber++)
+  {
+    float maxChannel = std::exp2(powDis(eng));
+    glm::vec3 color = glm::vec3(maxChannel, maxChannel * ratioDis(eng), maxChannel * ratioDis(eng) * ratioDis(eng));
+    if (colorNumber % 3 == 1)
+      color = glm::vec3(color.y, color.x, color.z);
+    if (colorNumber % 3 == 2)
+      color = glm::vec3(color.z, color.y, color.x);
+    glm::vec3 decoded = PointPacking::DecodeRgb9e5(PointPacking::EncodeRgb9e5(color));
+    //the largest channel keeps a mantissa of at least 255.75 after rounding, exponents below the bias floor at a step of 2^-24
+    float tolerance = std::max(maxChannel / 511.5f, std::exp2(-25.0f));
+    for (int channel = 0; channel < 3; channel++)
+      maxRelativeError = std::max(maxRelativeError, double(std::abs(decoded[channel] - color[channel])) / double(tolerance));
+  }
+  return maxRelativeError;
+}
+
+int main(int argc, char **argv)
+{
+  size_t pointsCount = size_t(1) << 20;
+  BenchmarkSettings benchmarkSettings;
+  benchmarkSettings.warmupCount = 1;
+  benchmarkSettings.repetitionsCount = 5;
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--points" && hasValue)
+      pointsCount = size_t(std::max(atoll(argv[++argIndex]), 1ll));
+    else if (arg == "--repetitions" && hasValue)
+      benchmarkSettings.repetitionsCount = size_t(std::max(atoi(argv[++argIndex]), 1));
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--points N] [--repetitions N]\n";
+      return 1;
+    }
+  }
+
+  size_t chunksCount = (pointsCount + PointPacking::ChunkPointsCount - 1) / PointPacking::ChunkPointsCount;
+  std::cout << pointsCount << " points, " << double(sizeof(PointPacking::HotChunk)) / PointPacking::ChunkPointsCount << " hot bytes per point\n";
+  char line[256];
+  snprintf(line, sizeof(line), "%-12s %12s %12s %12s %10s\n", "cloud", "pos error", "radius error", "pack ns", "result");
+  std::cout << line;
+
+  std::default_random_engine eng(1);
+  bool isPassed = true;
+  for (int cloudIndex = 0; cloudIndex < int(Clouds::Count); cloudIndex++)
+  {
+    Clouds cloudType = Clouds(cloudIndex);
+    std::vector<glm::vec4> cloud = GenerateCloud(cloudType, pointsCount, eng);
+    std::vector<PointPacking::HotChunk> chunks(chunksCount);
+    BenchmarkStats packStats = Measure(benchmarkSettings, pointsCount, [&]() {}, [&]()
+    {
+      for (size_t chunkIndex = 0; chunkIndex < chunksCount; chunkIndex++)
+      {
+        size_t firstPointIndex = chunkIndex * PointPacking::ChunkPointsCount;
+        PointPacking::PackHotChunk(cloud.data() + firstPointIndex, std::min<size_t>(PointPacking::ChunkPointsCount, pointsCount - firstPointIndex), chunks[chunkIndex]);
+      }
+    });
+
+    glm::dvec2 maxRelativeErrors = GetMaxRelativeErrors(cloud, chunks);
+    bool isCloudPassed = maxRelativeErrors.x <= 1.0 && maxRelativeErrors.y <= 1.0;
+    isPassed = isPassed && isCloudPassed;
+    snprintf(line, sizeof(line), "%-12s %12.3f %12.3f %12.2f %10s\n", GetCloudName(cloudType), maxRelativeErrors.x, maxRelativeErrors.y, packStats.medianNs, isCloudPassed ? "ok" : "FAIL");
+    std::cout << line;
+  }
+  std::cout << "(errors are in their tolerances: half a 16 bit step of the chunk box, half a float16 ulp of the radius; have to stay <= 1)\n";
+
+  double maxNormalAngle = 0.0;
+  bool isNormalPassed = CheckNormals(1 << 20, eng, maxNormalAngle);
+  double maxLightRelativeError = GetMaxLightRelativeError(1 << 20, eng);
+  bool isLightPassed = maxLightRelativeError <= 1.0;
+  isPassed = isPassed && isNormalPassed && isLightPassed;
+  snprintf(line, sizeof(line), "octahedral normal max error %.3e rad (bound %.0e) %s\n", maxNormalAngle, MaxNormalErrorRadians, isNormalPassed ? "ok" : "FAIL");
+  std::cout << line;
+  snprintf(line, sizeof(line), "rgb9e5 light max error %.3f half mantissa steps %s\n", maxLightRelativeError, isLightPassed ? "ok" : "FAIL");
+  std::cout << line;
+
+  if (!isPassed)
+  {
+    std::cerr << "point packing round trip failed\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,126 @@
+//standalone check and benchmark of the cpu multigrid and spectral poisson solvers against plain red-black gauss-seidel, does
+//not need vulkan. fails when multigrid does not reach the tolerance within the cycles limit or the spectral solve misses it.
+//usage: PoissonBenchmark [--max-size N] [--tolerance X] [--max-cycles N] [--max-sweeps N] [--threads N]
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "BenchmarkUtils.h"
+#include "../src/Render/Renderers/WaterRenderer/CpuPoissonMultigrid.h"
+#include "../src/Render/Renderers/WaterRenderer/CpuSpectralPoisson.h"
+
+//smooth large scale modes plus per-node noise with the mean removed: periodic poisson only has a solution for a zero-mean
+//right hand side. the smooth part is what gauss-seidel alone barely reduces
+std::vector<float> GenerateRhs(glm::ivec3 size, std::default_random_engine &eng)
+{
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<float> rhs(size_t(size.x) * size.y * size.z);
+  const float pi = 3.1415926f;
+  double sum = 0.0;
+  for (int z = 0; z < size.z; z++)
+  {
+    for (int y = 0; y < size.y; y++)
+    {
+      for (int x = 0; x < size.x; x++)
+      {
+        glm::vec3 normPos = (glm::vec3(x, y, z) + glm::vec3(0.5f)) / glm::vec3(size);
+        float value = std::sin(2.0f * pi * normPos.x) * std::cos(2.0f * pi * normPos.y) + 0.5f * std::sin(4.0f * pi * normPos.z) + 0.1f * dis(eng);
+        rhs[x + size_t(size.x) * (y + size_t(size.y) * z)] = value;
+        sum += value;
+      }
+    }
+  }
+  float mean = float(sum / double(rhs.size()));
+  for (auto &value : rhs)
+    value -= mean;
+  return rhs;
+}
+
+double GetElapsedMs(std::chrono::steady_clock::time_point startTime)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+int main(int argc, char **argv)
+{
+  int maxSize = 128;
+  float tolerance = 1e-3f;
+  int maxCyclesCount = 30;
+  int maxSweepsCount = 1000;
+  CpuPoissonMultigrid::Settings settings;
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--max-size" && hasValue)
+      maxSize = atoi(argv[++argIndex]);
+    else if (arg == "--tolerance" && hasValue)
+      tolerance = float(atof(argv[++argIndex]));
+    else if (arg == "--max-cycles" && hasValue)
+      maxCyclesCount = atoi(argv[++argIndex]);
+    else if (arg == "--max-sweeps" && hasValue)
+      maxSweepsCount = atoi(argv[++argIndex]);
+    else if (arg == "--threads" && hasValue)
+      settings.parallelSettings.threadsCount = size_t(atoi(argv[++argIndex]));
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--max-size N] [--tolerance X] [--max-cycles N] [--max-sweeps N] [--threads N]\n";
+      return 1;
+    }
+  }
+
+  using Clock = std::chrono::steady_clock;
+  std::default_random_engine eng(1);
+  bool isValid = true;
+  char line[256];
+  snprintf(line, sizeof(line), "%-6s %-8s %10s %12s %10s\n", "size", "solver", "iterations", "rel residual", "ms");
+  std::cout << line;
+  for (int size = 16; size <= maxSize; size *= 2)
+  {
+    glm::ivec3 volumeSize = glm::ivec3(size);
+    float stepSize = 5.0f / float(size);
+    auto rhs = GenerateRhs(volumeSize, eng);
+    CpuPoissonMultigrid multigrid(volumeSize, stepSize, settings);
+    CpuSpectralPoisson spectral(volumeSize, glm::vec3(stepSize), settings.parallelSettings);
+
+    //gauss-seidel in chunks of sweeps so the residual check does not dominate
+    std::vector<float> pressure(rhs.size(), 0.0f);
+    auto startTime = Clock::now();
+    int sweepsCount = 0;
+    float residual = multigrid.ComputeRelativeResidual(pressure.data(), rhs.data());
+    while (sweepsCount < maxSweepsCount && residual > tolerance)
+    {
+      multigrid.Smooth(pressure.data(), rhs.data(), 10);
+      sweepsCount += 10;
+      residual = multigrid.ComputeRelativeResidual(pressure.data(), rhs.data());
+    }
+    snprintf(line, sizeof(line), "%-6d %-8s %10d %12.3e %10.1f\n", size, "gs", sweepsCount, residual, GetElapsedMs(startTime));
+    std::cout << line;
+
+    std::fill(pressure.begin(), pressure.end(), 0.0f);
+    startTime = Clock::now();
+    int cyclesCount = multigrid.Solve(pressure.data(), rhs.data(), tolerance, maxCyclesCount);
+    residual = multigrid.ComputeRelativeResidual(pressure.data(), rhs.data());
+    snprintf(line, sizeof(line), "%-6d %-8s %10d %12.3e %10.1f\n", size, "mg", cyclesCount, residual, GetElapsedMs(startTime));
+    std::cout << line;
+    if (residual > tolerance)
+    {
+      std::cerr << "multigrid did not converge on " << size << "^3 with " << multigrid.GetLevelsCount() << " levels\n";
+      isValid = false;
+    }
+
+    startTime = Clock::now();
+    spectral.Solve(pressure.data(), rhs.data());
+    residual = multigrid.ComputeRelativeResidual(pressure.data(), rhs.data());
+    snprintf(line, sizeof(line), "%-6d %-8s %10d %12.3e %10.1f\n", size, "fft", 1, residual, GetElapsedMs(startTime));
+    std::cout << line;
+    //exact up to float rounding, which grows with resolution because the residual divides by step^2
+    if (residual > tolerance)
+    {
+      std::cerr << "spectral solve is off by " << residual << " on " << size << "^3\n";
+      isValid = false;
+    }
+  }
+  std::cout << "(gs iterations are red-black sweeps, mg iterations are v-cycles, fft is a direct solve)\n";
+  return isValid ? 0 : 1;
+}
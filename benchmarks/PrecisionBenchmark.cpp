@@ -0,0 +1,183 @@
+//standalone drift check of half precision solver volumes, does not need vulkan. runs a full precision CpuShrodingerSolver and
+//one solver per storage precision side by side from the same initial field, advects the same particles through each of them
+//and reports how far velocities and particles get from the full precision run over the steps. fails if half velocity, the
+//mode ShrodingerSolver offers, moves particles further than --max-drift cells on average.
+//usage: PrecisionBenchmark [--resolution N] [--steps N] [--report-every N] [--particles N] [--max-drift X] [--threads N]
+#include <iostream>
+#include <string>
+#include <memory>
+#include <cstdlib>
+
+#include "BenchmarkUtils.h"
+#include "../src/Render/Renderers/WaterRenderer/CpuShrodingerSolver.h"
+
+struct PrecisionRun
+{
+  std::string name;
+  std::unique_ptr<CpuShrodingerSolver> solver;
+  std::unique_ptr<CpuShrodingerSolver> stepSolver; //same settings, restarted from the full precision state for one step
+  std::vector<glm::vec3> positions;
+};
+
+struct VelocityError
+{
+  double l2; //l2 norm of the difference relative to the l2 norm of the reference velocity
+  double max; //relative to the largest reference speed
+};
+
+VelocityError ComputeVelocityError(const CpuShrodingerSolver &reference, const CpuShrodingerSolver &solver)
+{
+  VelocityError velocityError = {};
+  const std::vector<glm::vec4> &referenceVelocity = reference.GetVelocity();
+  const std::vector<glm::vec4> &velocity = solver.GetVelocity();
+  double errorSum = 0.0;
+  double normSum = 0.0;
+  double maxSpeed = 0.0;
+  for (size_t offset = 0; offset < velocity.size(); offset++)
+  {
+    double error = glm::length(glm::vec3(velocity[offset] - referenceVelocity[offset]));
+    double speed = glm::length(glm::vec3(referenceVelocity[offset]));
+    errorSum += error * error;
+    normSum += speed * speed;
+    velocityError.max = std::max(velocityError.max, error);
+    maxSpeed = std::max(maxSpeed, speed);
+  }
+  velocityError.l2 = normSum > 0.0 ? std::sqrt(errorSum / normSum) : 0.0;
+  velocityError.max = maxSpeed > 0.0 ? velocityError.max / maxSpeed : 0.0;
+  return velocityError;
+}
+
+struct ParticleDrift
+{
+  double mean; //in cells
+  double max;
+};
+
+ParticleDrift ComputeParticleDrift(const std::vector<glm::vec3> &referencePositions, const std::vector<glm::vec3> &positions, glm::vec3 cellSize)
+{
+  ParticleDrift particleDrift = {};
+  for (size_t particleIndex = 0; particleIndex < positions.size(); particleIndex++)
+  {
+    double drift = glm::length((positions[particleIndex] - referencePositions[particleIndex]) / cellSize);
+    particleDrift.mean += drift;
+    particleDrift.max = std::max(particleDrift.max, drift);
+  }
+  particleDrift.mean /= double(std::max<size_t>(positions.size(), 1));
+  return particleDrift;
+}
+
+int main(int argc, char **argv)
+{
+  int stepsCount = 200;
+  int reportPeriod = 25;
+  size_t particlesCount = size_t(1) << 16;
+  double maxDrift = 0.5;
+  CpuShrodingerSolver::Settings solverSettings;
+  solverSettings.volumeResolution = glm::uvec3(64);
+  solverSettings.volumeMin = glm::vec3(-2.5f);
+  solverSettings.volumeMax = glm::vec3(2.5f);
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--resolution" && hasValue)
+      solverSettings.volumeResolution = glm::uvec3(glm::uint(atoi(argv[++argIndex])));
+    else if (arg == "--steps" && hasValue)
+      stepsCount = atoi(argv[++argIndex]);
+    else if (arg == "--report-every" && hasValue)
+      reportPeriod = std::max(atoi(argv[++argIndex]), 1);
+    else if (arg == "--particles" && hasValue)
+      particlesCount = size_t(atoll(argv[++argIndex]));
+    else if (arg == "--max-drift" && hasValue)
+      maxDrift = atof(argv[++argIndex]);
+    else if (arg == "--threads" && hasValue)
+      solverSettings.parallelSettings.threadsCount = size_t(atoi(argv[++argIndex]));
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--resolution N] [--steps N] [--report-every N] [--particles N] [--max-drift X] [--threads N]\n";
+      return 1;
+    }
+  }
+
+  std::default_random_engine eng(1);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  std::vector<glm::vec3> positions(particlesCount);
+  for (auto &position : positions)
+    position = solverSettings.volumeMin + glm::vec3(dis(eng), dis(eng), dis(eng)) * (solverSettings.volumeMax - solverSettings.volumeMin);
+
+  //the first run is the full precision reference, the second one is ShrodingerSolver's half precision mode
+  std::vector<PrecisionRun> runs;
+  auto addRun = [&](std::string name, CpuShrodingerSolver::StoragePrecision storagePrecision, float timeStep)
+  {
+    CpuShrodingerSolver::Settings runSettings = solverSettings;
+    runSettings.storagePrecision = storagePrecision;
+    runSettings.timeStep = timeStep;
+    PrecisionRun run;
+    run.name = name;
+    run.solver.reset(new CpuShrodingerSolver(runSettings));
+    run.stepSolver.reset(new CpuShrodingerSolver(runSettings));
+    run.positions = positions;
+    runs.push_back(std::move(run));
+  };
+  CpuShrodingerSolver::StoragePrecision storagePrecision;
+  addRun("full", storagePrecision, solverSettings.timeStep);
+  storagePrecision.halfVelocity = true;
+  addRun("half vel", storagePrecision, solverSettings.timeStep);
+  storagePrecision = CpuShrodingerSolver::StoragePrecision();
+  storagePrecision.halfDivergence = true;
+  addRun("half div", storagePrecision, solverSettings.timeStep);
+  storagePrecision = CpuShrodingerSolver::StoragePrecision();
+  storagePrecision.halfPressure = true;
+  addRun("half press", storagePrecision, solverSettings.timeStep);
+  storagePrecision = CpuShrodingerSolver::StoragePrecision();
+  storagePrecision.halfWaveFunc = true;
+  addRun("half wave", storagePrecision, solverSettings.timeStep);
+  //a time step one float ulp off: how far full precision runs get from each other
+  addRun("full dt+1ulp", CpuShrodingerSolver::StoragePrecision(), std::nextafter(solverSettings.timeStep, 1.0f));
+
+  for (auto &run : runs)
+    run.solver->Init();
+  //vortex cores make the flow chaotic, so every run decorrelates from the reference sooner or later. the one step error is
+  //what a storage format adds by itself before the flow amplifies it
+  CpuShrodingerSolver stepStart(solverSettings);
+
+  glm::vec3 cellSize = (solverSettings.volumeMax - solverSettings.volumeMin) / glm::vec3(solverSettings.volumeResolution);
+  std::cout << "resolution " << solverSettings.volumeResolution.x << ", " << particlesCount << " particles, errors against the full precision run\n";
+  char line[256];
+  snprintf(line, sizeof(line), "%-6s %-14s %12s %12s %12s %12s %12s\n", "step", "storage", "1 step err", "vel l2 err", "vel max err", "mean drift", "max drift");
+  std::cout << line;
+  ParticleDrift modeDrift = {};
+  for (int stepIndex = 1; stepIndex <= stepsCount; stepIndex++)
+  {
+    bool isReportStep = (stepIndex % reportPeriod == 0) || (stepIndex == stepsCount);
+    if (isReportStep)
+      stepStart.CopyFields(*runs[0].solver);
+    for (auto &run : runs)
+    {
+      run.solver->Step();
+      run.solver->AdvectParticles(run.positions.data(), run.positions.size());
+    }
+    if (!isReportStep)
+      continue;
+    for (size_t runIndex = 1; runIndex < runs.size(); runIndex++)
+    {
+      PrecisionRun &run = runs[runIndex];
+      run.stepSolver->CopyFields(stepStart);
+      run.stepSolver->Step();
+      VelocityError stepError = ComputeVelocityError(*runs[0].solver, *run.stepSolver);
+      VelocityError velocityError = ComputeVelocityError(*runs[0].solver, *run.solver);
+      ParticleDrift particleDrift = ComputeParticleDrift(runs[0].positions, run.positions, cellSize);
+      if (runIndex == 1)
+        modeDrift = particleDrift;
+      snprintf(line, sizeof(line), "%-6d %-14s %12.2e %12.2e %12.2e %12.4f %12.4f\n", stepIndex, run.name.c_str(), stepError.l2, velocityError.l2, velocityError.max, particleDrift.mean, particleDrift.max);
+      std::cout << line;
+    }
+  }
+  std::cout << "(errors are relative, drifts are in cells)\n";
+  if (modeDrift.mean > maxDrift)
+  {
+    std::cerr << "half precision mode drifted " << modeDrift.mean << " cells on average, more than " << maxDrift << "\n";
+    return 1;
+  }
+  return 0;
+}
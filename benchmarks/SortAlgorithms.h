@@ -0,0 +1,368 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+//cpu ports of per-bucket sorts: list sorts are the ones that were tried on bucket lists in PointBucketeer.h,
+//array sorts match ArrayBucketeer's bucketSort.comp (heap) and BitonicSort2 plus a few alternatives to compare them against
+namespace ListSorts
+{
+  using PointIndex = uint32_t;
+  const PointIndex NullIndex = PointIndex(-1);
+
+  //same as PointNode in ListBucketeer
+  struct Node
+  {
+    float dist;
+    PointIndex next;
+  };
+
+  size_t GetListSize(const Node *nodes, PointIndex head)
+  {
+    size_t count = 0;
+    for (PointIndex curr = head; curr != NullIndex; curr = nodes[curr].next)
+      count++;
+    return count;
+  }
+
+  bool IsSorted(const Node *nodes, PointIndex head)
+  {
+    for (PointIndex curr = head; curr != NullIndex && nodes[curr].next != NullIndex; curr = nodes[curr].next)
+    {
+      if (nodes[nodes[curr].next].dist < nodes[curr].dist)
+        return false;
+    }
+    return true;
+  }
+
+  PointIndex BubbleSort(Node *nodes, PointIndex head)
+  {
+    if (head == NullIndex)
+      return head;
+    bool wasChanged;
+    do
+    {
+      PointIndex curr = head;
+      PointIndex prev = NullIndex;
+      PointIndex next = nodes[head].next;
+      wasChanged = false;
+      while (next != NullIndex)
+      {
+        if (nodes[curr].dist > nodes[next].dist)
+        {
+          wasChanged = true;
+          PointIndex tmp = nodes[next].next;
+          if (prev != NullIndex)
+            nodes[prev].next = next;
+          else
+            head = next;
+          nodes[next].next = curr;
+          nodes[curr].next = tmp;
+
+          prev = next;
+          next = nodes[curr].next;
+        }
+        else
+        {
+          prev = curr;
+          curr = next;
+          next = nodes[next].next;
+        }
+      }
+    } while (wasChanged);
+    return head;
+  }
+
+  PointIndex SortedInsert(Node *nodes, PointIndex head, PointIndex newNode)
+  {
+    if (head == NullIndex || nodes[head].dist >= nodes[newNode].dist)
+    {
+      nodes[newNode].next = head;
+      return newNode;
+    }
+    PointIndex curr = head;
+    for (; nodes[curr].next != NullIndex && nodes[nodes[curr].next].dist < nodes[newNode].dist; curr = nodes[curr].next);
+    nodes[newNode].next = nodes[curr].next;
+    nodes[curr].next = newNode;
+    return head;
+  }
+
+  PointIndex InsertionSort(Node *nodes, PointIndex head)
+  {
+    PointIndex newHead = NullIndex;
+    PointIndex curr = head;
+    while (curr != NullIndex)
+    {
+      PointIndex next = nodes[curr].next;
+      newHead = SortedInsert(nodes, newHead, curr);
+      curr = next;
+    }
+    return newHead;
+  }
+
+  struct MergeResult
+  {
+    PointIndex head;
+    PointIndex tail;
+  };
+
+  MergeResult MergeLists(Node *nodes, PointIndex leftHead, PointIndex rightHead)
+  {
+    assert(leftHead != NullIndex && rightHead != NullIndex);
+    PointIndex currLeft = leftHead;
+    PointIndex currRight = rightHead;
+    MergeResult res;
+    if (nodes[currLeft].dist < nodes[currRight].dist)
+    {
+      res.head = currLeft;
+      currLeft = nodes[currLeft].next;
+    }
+    else
+    {
+      res.head = currRight;
+      currRight = nodes[currRight].next;
+    }
+    PointIndex currMerged = res.head;
+    while (currLeft != NullIndex || currRight != NullIndex)
+    {
+      if (currRight == NullIndex || (currLeft != NullIndex && nodes[currLeft].dist < nodes[currRight].dist))
+      {
+        nodes[currMerged].next = currLeft;
+        currMerged = currLeft;
+        currLeft = nodes[currLeft].next;
+      }
+      else
+      {
+        nodes[currMerged].next = currRight;
+        currMerged = currRight;
+        currRight = nodes[currRight].next;
+      }
+    }
+    nodes[currMerged].next = NullIndex;
+    res.tail = currMerged;
+    return res;
+  }
+
+  PointIndex SeparateList(Node *nodes, PointIndex head, size_t count)
+  {
+    PointIndex curr = head;
+    for (size_t i = 0; i < count - 1 && nodes[curr].next != NullIndex; i++)
+      curr = nodes[curr].next;
+    PointIndex nextHead = nodes[curr].next;
+    nodes[curr].next = NullIndex;
+    return nextHead;
+  }
+
+  //bottom-up, no recursion and no scratch memory, that's what makes it usable in a shader
+  PointIndex MergeSort(Node *nodes, PointIndex head)
+  {
+    size_t count = GetListSize(nodes, head);
+    for (size_t gap = 1; gap < count; gap *= 2)
+    {
+      PointIndex lastTail = NullIndex;
+      PointIndex curr = head;
+      while (curr != NullIndex)
+      {
+        PointIndex leftHead = curr;
+        PointIndex rightHead = SeparateList(nodes, leftHead, gap);
+        if (rightHead == NullIndex)
+          break;
+        PointIndex nextHead = SeparateList(nodes, rightHead, gap);
+
+        MergeResult mergeResult = MergeLists(nodes, leftHead, rightHead);
+        if (lastTail != NullIndex)
+          nodes[lastTail].next = mergeResult.head;
+        else
+          head = mergeResult.head;
+        nodes[mergeResult.tail].next = nextHead;
+        lastTail = mergeResult.tail;
+        curr = nextHead;
+      }
+    }
+    return head;
+  }
+
+  //gathers the list into a contiguous scratch array, sorts it there and relinks the nodes. that's what compacting buckets does on gpu
+  template<typename Entry, typename ArraySortFunc>
+  PointIndex GatherSort(Node *nodes, PointIndex head, std::vector<Entry> &scratch, ArraySortFunc arraySortFunc)
+  {
+    scratch.clear();
+    for (PointIndex curr = head; curr != NullIndex; curr = nodes[curr].next)
+      scratch.push_back({ nodes[curr].dist, curr });
+    if (scratch.empty())
+      return NullIndex;
+    arraySortFunc(scratch.data(), scratch.size());
+    for (size_t i = 0; i + 1 < scratch.size(); i++)
+      nodes[scratch[i].pointIndex].next = scratch[i + 1].pointIndex;
+    nodes[scratch.back().pointIndex].next = NullIndex;
+    return scratch[0].pointIndex;
+  }
+}
+
+namespace ArraySorts
+{
+  //same as BucketEntry in ArrayBucketeer
+  struct Entry
+  {
+    float dist;
+    uint32_t pointIndex;
+  };
+
+  inline bool Less(const Entry &left, const Entry &right)
+  {
+    return left.dist < right.dist;
+  }
+
+  bool IsSorted(const Entry *entries, size_t count)
+  {
+    for (size_t i = 1; i < count; i++)
+    {
+      if (entries[i].dist < entries[i - 1].dist)
+        return false;
+    }
+    return true;
+  }
+
+  void InsertionSort(Entry *entries, size_t count)
+  {
+    for (size_t i = 1; i < count; i++)
+    {
+      Entry entry = entries[i];
+      size_t j = i;
+      for (; j > 0 && Less(entry, entries[j - 1]); j--)
+        entries[j] = entries[j - 1];
+      entries[j] = entry;
+    }
+  }
+
+  void SiftDown(Entry *entries, size_t begin, size_t end)
+  {
+    size_t root = begin;
+    while (root * 2 + 1 < end)
+    {
+      size_t child = root * 2 + 1;
+      if (child + 1 < end && Less(entries[child], entries[child + 1]))
+        child = child + 1;
+      if (Less(entries[root], entries[child]))
+      {
+        std::swap(entries[root], entries[child]);
+        root = child;
+      }
+      else
+      {
+        return;
+      }
+    }
+  }
+
+  void HeapSort(Entry *entries, size_t count)
+  {
+    for (size_t begin = count / 2; begin > 0; begin--)
+      SiftDown(entries, begin - 1, count);
+    for (size_t end = count; end > 1; end--)
+    {
+      std::swap(entries[end - 1], entries[0]);
+      SiftDown(entries, 0, end - 1);
+    }
+  }
+
+  //flip-based network from ArrayBucketeer's BitonicSort2, pairs past the end are skipped so any size works
+  void BitonicSort(Entry *entries, size_t count)
+  {
+    size_t maxSizePow = 0;
+    for (; (size_t(1) << maxSizePow) < count; maxSizePow++);
+    size_t paddedCount = size_t(1) << maxSizePow;
+
+    for (size_t sizePow = 1; sizePow <= maxSizePow; sizePow++)
+    {
+      for (size_t blockSizePow = sizePow; blockSizePow > 0; blockSizePow--)
+      {
+        bool isFirstBlock = (blockSizePow == sizePow);
+        size_t blockSize = size_t(1) << blockSizePow;
+        for (size_t pairIndex = 0; pairIndex < paddedCount / 2; pairIndex++)
+        {
+          size_t blockOffset = blockSize * (pairIndex >> (blockSizePow - 1));
+          size_t localIndex0 = pairIndex & ((blockSize >> 1) - 1);
+          size_t localIndex1 = isFirstBlock ? (blockSize - 1 - localIndex0) : (localIndex0 + blockSize / 2);
+          size_t i = blockOffset + localIndex0;
+          size_t j = blockOffset + localIndex1;
+          if (j < count && Less(entries[j], entries[i]))
+            std::swap(entries[i], entries[j]);
+        }
+      }
+    }
+  }
+
+  void StdSort(Entry *entries, size_t count)
+  {
+    std::sort(entries, entries + count, Less);
+  }
+
+  //lsd radix sort over the float bits flipped to an order-preserving uint, 8 bits per pass
+  void RadixSort(Entry *entries, size_t count, std::vector<Entry> &scratch)
+  {
+    scratch.resize(count);
+    Entry *src = entries;
+    Entry *dst = scratch.data();
+    auto getKey = [](float dist)
+    {
+      uint32_t bits;
+      memcpy(&bits, &dist, sizeof(bits));
+      return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    };
+    for (uint32_t shift = 0; shift < 32; shift += 8)
+    {
+      size_t offsets[257] = {};
+      for (size_t i = 0; i < count; i++)
+        offsets[((getKey(src[i].dist) >> shift) & 0xff) + 1]++;
+      for (size_t digit = 0; digit < 256; digit++)
+        offsets[digit + 1] += offsets[digit];
+      for (size_t i = 0; i < count; i++)
+        dst[offsets[(getKey(src[i].dist) >> shift) & 0xff]++] = src[i];
+      std::swap(src, dst);
+    }
+    //even number of passes, so the result is back in entries
+  }
+}
+
+namespace Scans
+{
+  //exclusive prefix sum of bucket sizes into bucket offsets, what allocating bucket ranges boils down to
+  void SequentialScan(const uint32_t *sizes, uint32_t *offsets, size_t count)
+  {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+      offsets[i] = sum;
+      sum += sizes[i];
+    }
+  }
+
+  //work-efficient up-sweep/down-sweep scan from PointBucketeer's TestSum, over a tree padded to a power of two
+  void BlellochScan(const uint32_t *sizes, uint32_t *offsets, size_t count, std::vector<uint32_t> &tree)
+  {
+    size_t paddedCount = 1;
+    for (; paddedCount < count; paddedCount *= 2);
+    tree.assign(paddedCount, 0);
+    std::copy(sizes, sizes + count, tree.begin());
+
+    for (size_t stepSize = 1; stepSize < paddedCount; stepSize *= 2)
+    {
+      for (size_t i = stepSize * 2 - 1; i < paddedCount; i += stepSize * 2)
+        tree[i] += tree[i - stepSize];
+    }
+    tree[paddedCount - 1] = 0;
+    for (size_t stepSize = paddedCount / 2; stepSize > 0; stepSize /= 2)
+    {
+      for (size_t i = stepSize * 2 - 1; i < paddedCount; i += stepSize * 2)
+      {
+        uint32_t left = tree[i - stepSize];
+        tree[i - stepSize] = tree[i];
+        tree[i] += left;
+      }
+    }
+    std::copy(tree.begin(), tree.begin() + count, offsets);
+  }
+}
@@ -0,0 +1,285 @@
+//standalone cpu benchmark of per-bucket sort strategies and bucket offset scans, does not need vulkan.
+//usage: SortBenchmark [--reps N] [--warmup N] [--max-size N] [--csv path]
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <cstdlib>
+
+#include "BenchmarkUtils.h"
+#include "SortAlgorithms.h"
+
+struct BenchmarkResult
+{
+  std::string group;
+  std::string algorithm;
+  std::string distribution;
+  size_t size;
+  BenchmarkStats stats;
+};
+
+volatile uint32_t checksumSink = 0; //keeps results observable so that sorting does not get optimized out
+
+//bucket lists are interleaved in memory on gpu, so each list gets linked in random node order
+struct ListBatch
+{
+  std::vector<ListSorts::Node> sourceNodes;
+  std::vector<ListSorts::Node> nodes;
+  std::vector<ListSorts::PointIndex> sourceHeads;
+  std::vector<ListSorts::PointIndex> heads;
+};
+
+ListBatch CreateListBatch(Distributions distribution, size_t listSize, size_t listsCount, std::default_random_engine &eng)
+{
+  ListBatch batch;
+  batch.sourceNodes.resize(listSize * listsCount);
+  std::vector<ListSorts::PointIndex> order(listSize);
+  for (size_t listIndex = 0; listIndex < listsCount; listIndex++)
+  {
+    auto keys = GenerateKeys(distribution, listSize, eng);
+    ListSorts::PointIndex offset = ListSorts::PointIndex(listIndex * listSize);
+    std::iota(order.begin(), order.end(), offset);
+    std::shuffle(order.begin(), order.end(), eng);
+    for (size_t i = 0; i < listSize; i++)
+    {
+      batch.sourceNodes[order[i]].dist = keys[i];
+      batch.sourceNodes[order[i]].next = (i + 1 < listSize) ? order[i + 1] : ListSorts::NullIndex;
+    }
+    batch.sourceHeads.push_back(listSize > 0 ? order[0] : ListSorts::NullIndex);
+  }
+  batch.nodes = batch.sourceNodes;
+  batch.heads = batch.sourceHeads;
+  return batch;
+}
+
+struct ArrayBatch
+{
+  std::vector<ArraySorts::Entry> sourceEntries;
+  std::vector<ArraySorts::Entry> entries;
+};
+
+ArrayBatch CreateArrayBatch(Distributions distribution, size_t arraySize, size_t arraysCount, std::default_random_engine &eng)
+{
+  ArrayBatch batch;
+  for (size_t arrayIndex = 0; arrayIndex < arraysCount; arrayIndex++)
+  {
+    auto keys = GenerateKeys(distribution, arraySize, eng);
+    for (size_t i = 0; i < arraySize; i++)
+      batch.sourceEntries.push_back({ keys[i], uint32_t(batch.sourceEntries.size()) });
+  }
+  batch.entries = batch.sourceEntries;
+  return batch;
+}
+
+using ListSortFunc = std::function<ListSorts::PointIndex(ListSorts::Node *, ListSorts::PointIndex)>;
+using ArraySortFunc = std::function<void(ArraySorts::Entry *, size_t)>;
+
+void RunListBenchmarks(const BenchmarkSettings &settings, size_t maxSize, std::vector<BenchmarkResult> &results)
+{
+  std::vector<ArraySorts::Entry> gatherScratch;
+  std::vector<std::pair<std::string, ListSortFunc>> sorts = {
+    { "list_bubble", ListSorts::BubbleSort },
+    { "list_insertion", ListSorts::InsertionSort },
+    { "list_merge", ListSorts::MergeSort },
+    { "list_gather_insertion", [&](ListSorts::Node *nodes, ListSorts::PointIndex head) { return ListSorts::GatherSort(nodes, head, gatherScratch, ArraySorts::InsertionSort); } },
+    { "list_gather_std", [&](ListSorts::Node *nodes, ListSorts::PointIndex head) { return ListSorts::GatherSort(nodes, head, gatherScratch, ArraySorts::StdSort); } }
+  };
+
+  std::default_random_engine eng;
+  for (int distributionIndex = 0; distributionIndex < int(Distributions::Count); distributionIndex++)
+  {
+    Distributions distribution = Distributions(distributionIndex);
+    for (size_t size = 2; size <= maxSize; size *= 2)
+    {
+      size_t listsCount = std::max<size_t>(settings.elementsPerRepetition / size, 1);
+      ListBatch batch = CreateListBatch(distribution, size, listsCount, eng);
+      for (auto &sort : sorts)
+      {
+        //quadratic list sorts get really slow on big lists and are not worth waiting for
+        if (sort.first == "list_bubble" && size > 512)
+          continue;
+        BenchmarkStats stats = Measure(settings, size * listsCount,
+          [&]() { batch.nodes = batch.sourceNodes; batch.heads = batch.sourceHeads; },
+          [&]()
+          {
+            for (auto &head : batch.heads)
+              head = sort.second(batch.nodes.data(), head);
+          });
+
+        for (auto head : batch.heads)
+        {
+          if (!ListSorts::IsSorted(batch.nodes.data(), head) || ListSorts::GetListSize(batch.nodes.data(), head) != size)
+          {
+            std::cerr << sort.first << " failed on " << GetDistributionName(distribution) << " list of size " << size << "\n";
+            exit(1);
+          }
+          checksumSink += head;
+        }
+        results.push_back({ "list", sort.first, GetDistributionName(distribution), size, stats });
+      }
+    }
+  }
+}
+
+void RunArrayBenchmarks(const BenchmarkSettings &settings, size_t maxSize, std::vector<BenchmarkResult> &results)
+{
+  std::vector<ArraySorts::Entry> radixScratch;
+  std::vector<std::pair<std::string, ArraySortFunc>> sorts = {
+    { "array_insertion", ArraySorts::InsertionSort },
+    { "array_heap", ArraySorts::HeapSort },
+    { "array_bitonic", ArraySorts::BitonicSort },
+    { "array_std", ArraySorts::StdSort },
+    { "array_radix", [&](ArraySorts::Entry *entries, size_t count) { ArraySorts::RadixSort(entries, count, radixScratch); } }
+  };
+
+  std::default_random_engine eng;
+  for (int distributionIndex = 0; distributionIndex < int(Distributions::Count); distributionIndex++)
+  {
+    Distributions distribution = Distributions(distributionIndex);
+    for (size_t size = 2; size <= maxSize; size *= 2)
+    {
+      size_t arraysCount = std::max<size_t>(settings.elementsPerRepetition / size, 1);
+      ArrayBatch batch = CreateArrayBatch(distribution, size, arraysCount, eng);
+      for (auto &sort : sorts)
+      {
+        if (sort.first == "array_insertion" && size > 1024)
+          continue;
+        BenchmarkStats stats = Measure(settings, size * arraysCount,
+          [&]() { batch.entries = batch.sourceEntries; },
+          [&]()
+          {
+            for (size_t arrayIndex = 0; arrayIndex < arraysCount; arrayIndex++)
+              sort.second(batch.entries.data() + arrayIndex * size, size);
+          });
+
+        for (size_t arrayIndex = 0; arrayIndex < arraysCount; arrayIndex++)
+        {
+          if (!ArraySorts::IsSorted(batch.entries.data() + arrayIndex * size, size))
+          {
+            std::cerr << sort.first << " failed on " << GetDistributionName(distribution) << " array of size " << size << "\n";
+            exit(1);
+          }
+        }
+        checksumSink += batch.entries[0].pointIndex;
+        results.push_back({ "array", sort.first, GetDistributionName(distribution), size, stats });
+      }
+    }
+  }
+}
+
+void RunScanBenchmarks(const BenchmarkSettings &settings, std::vector<BenchmarkResult> &results)
+{
+  std::default_random_engine eng;
+  std::uniform_int_distribution<uint32_t> sizeDis(0, 10);
+  std::vector<uint32_t> tree;
+  for (size_t bucketsCount = 1 << 10; bucketsCount <= (1 << 22); bucketsCount *= 4)
+  {
+    std::vector<uint32_t> sizes(bucketsCount);
+    for (auto &size : sizes)
+      size = sizeDis(eng);
+    std::vector<uint32_t> referenceOffsets(bucketsCount);
+    Scans::SequentialScan(sizes.data(), referenceOffsets.data(), bucketsCount);
+
+    std::vector<std::pair<std::string, std::function<void(uint32_t *)>>> scans = {
+      { "scan_sequential", [&](uint32_t *offsets) { Scans::SequentialScan(sizes.data(), offsets, bucketsCount); } },
+      { "scan_blelloch", [&](uint32_t *offsets) { Scans::BlellochScan(sizes.data(), offsets, bucketsCount, tree); } }
+    };
+    std::vector<uint32_t> offsets(bucketsCount);
+    for (auto &scan : scans)
+    {
+      BenchmarkStats stats = Measure(settings, bucketsCount,
+        [&]() { std::fill(offsets.begin(), offsets.end(), 0); },
+        [&]() { scan.second(offsets.data()); });
+      if (offsets != referenceOffsets)
+      {
+        std::cerr << scan.first << " failed on " << bucketsCount << " buckets\n";
+        exit(1);
+      }
+      checksumSink += offsets.back();
+      results.push_back({ "scan", scan.first, "uniform", bucketsCount, stats });
+    }
+  }
+}
+
+void PrintResults(const std::vector<BenchmarkResult> &results)
+{
+  char line[256];
+  snprintf(line, sizeof(line), "%-6s %-22s %-14s %8s %10s %10s %10s %10s %10s\n", "group", "algorithm", "distribution", "size", "median", "mean", "stddev", "min", "p95");
+  std::cout << line;
+  for (auto &result : results)
+  {
+    snprintf(line, sizeof(line), "%-6s %-22s %-14s %8zu %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+      result.group.c_str(), result.algorithm.c_str(), result.distribution.c_str(), result.size,
+      result.stats.medianNs, result.stats.meanNs, result.stats.stdDevNs, result.stats.minNs, result.stats.p95Ns);
+    std::cout << line;
+  }
+  std::cout << "(ns per element)\n";
+}
+
+//fastest algorithm by median for every group/distribution/size, that's what picking a per-bucket strategy needs
+void PrintWinners(const std::vector<BenchmarkResult> &results)
+{
+  std::cout << "\nfastest by median:\n";
+  for (size_t i = 0; i < results.size();)
+  {
+    size_t best = i;
+    size_t j = i;
+    for (; j < results.size() && results[j].group == results[i].group && results[j].distribution == results[i].distribution && results[j].size == results[i].size; j++)
+    {
+      if (results[j].stats.medianNs < results[best].stats.medianNs)
+        best = j;
+    }
+    char line[256];
+    snprintf(line, sizeof(line), "%-6s %-14s %8zu: %s (%.2f ns)\n", results[best].group.c_str(), results[best].distribution.c_str(), results[best].size, results[best].algorithm.c_str(), results[best].stats.medianNs);
+    std::cout << line;
+    i = j;
+  }
+}
+
+void WriteCsv(const std::vector<BenchmarkResult> &results, const std::string &path)
+{
+  std::ofstream file(path);
+  file << "group,algorithm,distribution,size,median_ns,mean_ns,stddev_ns,min_ns,p95_ns\n";
+  for (auto &result : results)
+  {
+    file << result.group << "," << result.algorithm << "," << result.distribution << "," << result.size << ","
+      << result.stats.medianNs << "," << result.stats.meanNs << "," << result.stats.stdDevNs << "," << result.stats.minNs << "," << result.stats.p95Ns << "\n";
+  }
+}
+
+int main(int argc, char **argv)
+{
+  BenchmarkSettings settings;
+  size_t maxSize = 4096;
+  std::string csvPath;
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--reps" && hasValue)
+      settings.repetitionsCount = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--warmup" && hasValue)
+      settings.warmupCount = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--max-size" && hasValue)
+      maxSize = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--csv" && hasValue)
+      csvPath = argv[++argIndex];
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--reps N] [--warmup N] [--max-size N] [--csv path]\n";
+      return 1;
+    }
+  }
+  settings.repetitionsCount = std::max<size_t>(settings.repetitionsCount, 1);
+
+  std::vector<BenchmarkResult> results;
+  RunListBenchmarks(settings, maxSize, results);
+  RunArrayBenchmarks(settings, maxSize, results);
+  RunScanBenchmarks(settings, results);
+
+  PrintResults(results);
+  PrintWinners(results);
+  if (!csvPath.empty())
+    WriteCsv(results, csvPath);
+  return 0;
+}
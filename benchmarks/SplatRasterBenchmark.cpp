@@ -0,0 +1,96 @@
+//standalone check and benchmark of CpuSplatRaster, does not need vulkan. fails if the tiled 32 bit scheme that the
+//PointSplatRasterizer shaders run picks a different point for any pixel than a single 64 bit min of packed depth and index,
+//both with enough tile entries and with so few of them that binned splats fall back to rasterizing themselves.
+//the gpu output is checked against the same reference by LegitEngine --check-splat-raster
+//usage: SplatRasterBenchmark [--points N] [--size N]
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+
+#include "BenchmarkUtils.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include "../src/Render/Common/CpuSplatRaster.h"
+
+int main(int argc, char **argv)
+{
+  size_t pointsCount = size_t(1) << 20;
+  glm::uint viewportSize = 512;
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    if (arg == "--points" && hasValue)
+      pointsCount = size_t(atoll(argv[++argIndex]));
+    else if (arg == "--size" && hasValue)
+      viewportSize = glm::uint(atoi(argv[++argIndex]));
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--points N] [--size N]\n";
+      return 1;
+    }
+  }
+  glm::uvec2 size = glm::uvec2(viewportSize);
+
+  std::default_random_engine eng(1);
+  std::vector<glm::vec4> worldPosRadii = CpuSplatRaster::GenerateTestSplats(pointsCount, eng);
+
+  struct View
+  {
+    const char *name;
+    glm::mat4 projMatrix;
+  };
+  glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  std::vector<View> views = {
+    { "perspective", glm::perspectiveZO(1.0f, 1.0f, 0.1f, 10.0f) },
+    { "ortho", glm::orthoZO(-1.5f, 1.5f, -1.5f, 1.5f, 0.1f, 10.0f) } };
+  const float radiusScales[] = { 0.0f, 1.0f };
+  const size_t maxTileEntriesCount = size_t(1) << 20;
+  const size_t overflowTileEntriesCount = 16;
+
+  bool isValid = true;
+  BenchmarkSettings benchmarkSettings;
+  benchmarkSettings.repetitionsCount = 5;
+  char line[256];
+  snprintf(line, sizeof(line), "%-12s %-7s %-10s %12s %12s %10s\n", "view", "radius", "scheme", "median ns", "min ns", "pixels");
+  std::cout << line;
+  for (auto &view : views)
+  {
+    glm::mat4 viewProjMatrix = view.projMatrix * viewMatrix;
+    for (float radiusScale : radiusScales)
+    {
+      float pixelRadiusScale = CpuSplatRaster::GetPixelRadiusScale(view.projMatrix, size, radiusScale);
+      std::vector<uint32_t> packedIndices = CpuSplatRaster::RasterizePacked(worldPosRadii.data(), worldPosRadii.size(), viewProjMatrix, pixelRadiusScale, size);
+      size_t coveredCount = 0;
+      for (uint32_t pointIndex : packedIndices)
+        coveredCount += pointIndex != 0 ? 1 : 0;
+      for (size_t tileEntriesCount : { maxTileEntriesCount, overflowTileEntriesCount })
+      {
+        std::vector<uint32_t> tiledIndices = CpuSplatRaster::RasterizeTiled(worldPosRadii.data(), worldPosRadii.size(), viewProjMatrix, pixelRadiusScale, size, tileEntriesCount);
+        size_t mismatchesCount = 0;
+        for (size_t pixelIndex = 0; pixelIndex < packedIndices.size(); pixelIndex++)
+          mismatchesCount += packedIndices[pixelIndex] != tiledIndices[pixelIndex] ? 1 : 0;
+        if (mismatchesCount > 0)
+        {
+          std::cerr << view.name << " radius " << radiusScale << ": tiled raster with " << tileEntriesCount << " tile entries differs from packed 64 bit raster in " << mismatchesCount << " pixels\n";
+          isValid = false;
+        }
+      }
+
+      for (int schemeIndex = 0; schemeIndex < 2; schemeIndex++)
+      {
+        std::vector<uint32_t> pointIndices;
+        BenchmarkStats stats = Measure(benchmarkSettings, worldPosRadii.size(), []() {}, [&]()
+        {
+          pointIndices = schemeIndex == 0 ?
+            CpuSplatRaster::RasterizePacked(worldPosRadii.data(), worldPosRadii.size(), viewProjMatrix, pixelRadiusScale, size) :
+            CpuSplatRaster::RasterizeTiled(worldPosRadii.data(), worldPosRadii.size(), viewProjMatrix, pixelRadiusScale, size, maxTileEntriesCount);
+        });
+        snprintf(line, sizeof(line), "%-12s %-7.1f %-10s %12.2f %12.2f %10d\n", view.name, radiusScale, schemeIndex == 0 ? "packed64" : "tiled32", stats.medianNs, stats.minNs, int(coveredCount));
+        std::cout << line;
+      }
+    }
+  }
+  std::cout << "(times are per point)\n";
+  return isValid ? 0 : 1;
+}
\ No newline at end of file
@@ -29,6 +29,15 @@ for /r glsl/ %%I in (*.comp) do (
   %CompilerExe% -V "%%I" -l --target-env vulkan1.1 -o "!outname!".spv
   rem %OptimizerExe% "!outname!"_u.spv -Oconfig="OptimizerConfig.cfg" -o "!outname!".spv
 )
+
+rem sources built once more with extra defines, see shaderVariants.txt
+for /f "eol=# tokens=1,2,*" %%A in (shaderVariants.txt) do (
+  set variantPath=%%A
+  set outname=spirv/!variantPath:.comp=%%B.comp!
+  @echo Building glsl/%%A %%C
+  @echo To !outname!
+  %CompilerExe% -V "glsl/%%A" %%C -l --target-env vulkan1.1 -o "!outname!".spv
+)
 rem pause
 
 rem 
@@ -62,3 +62,11 @@ foreach($srcFile in (Get-ChildItem $sourcePath -Recurse | Where-Object Extension
   }
 }
 
+#sources built once more with extra defines, see shaderVariants.txt. there are only a few, so they're always rebuilt
+foreach($variantLine in (Get-Content "shaderVariants.txt" | Where-Object { $_.Trim() -and !$_.StartsWith("#") }))
+{
+  $variantTokens = $variantLine.Trim().Split(" ", 3)
+  $srcPath = $sourcePath + $variantTokens[0]
+  $dstPath = "spirv/" + $variantTokens[0].Replace(".comp", $variantTokens[1] + ".comp") + ".spv"
+  Invoke-Expression "$compilerExe -V `"$srcPath`" $($variantTokens[2]) -l --target-env vulkan1.1 -o `"$dstPath`""
+}
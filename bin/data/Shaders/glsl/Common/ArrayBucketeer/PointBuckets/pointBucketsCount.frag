@@ -5,19 +5,22 @@
 #include "../passData.decl"
 #include "../../projection.decl"
 #include "../bucketsData.decl"
-#include "../../pointsData.decl"
+#include "../../pointsHotData.decl"
+#include "../../occupiedBucketsData.decl"
 
 layout(location = 0) in flat uint fragPointIndex;
 
 void main() 
 {
-  uvec4 bucketIndices = GetPointBucketBlockIndices(gl_FragCoord.xy, pointsBuf.data[fragPointIndex].worldPos.xyz, pointsBuf.data[fragPointIndex].worldRadius);
+  vec4 worldPosRadius = LoadHotPoint(fragPointIndex);
+  uvec4 bucketIndices = GetPointBucketBlockIndices(gl_FragCoord.xy, worldPosRadius.xyz, worldPosRadius.w);
 
   for(int i = 0; i < 1; i++)
   {
     if(bucketIndices[i] != uint(-1))
     {
-      atomicAdd(bucketsBuf.data[bucketIndices[i]].pointsCount, 1);
+      if(atomicAdd(bucketsBuf.data[bucketIndices[i]].pointsCount, 1) == 0)
+        AddOccupiedBucket(bucketIndices[i]);
     }
   }
 }
\ No newline at end of file
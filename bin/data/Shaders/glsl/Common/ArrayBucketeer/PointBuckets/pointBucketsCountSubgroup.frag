@@ -0,0 +1,33 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_KHR_shader_subgroup_ballot : enable
+#extension GL_KHR_shader_subgroup_shuffle : enable
+
+#include "../passData.decl"
+#include "../../projection.decl"
+#include "../bucketsData.decl"
+#include "../../pointsHotData.decl"
+#include "../../occupiedBucketsData.decl"
+#include "../../subgroupAtomics.decl"
+
+layout(location = 0) in flat uint fragPointIndex;
+
+void main()
+{
+  //atomics of helper lanes are discarded so they can't lead a bucket
+  if(gl_HelperInvocation)
+    return;
+  vec4 worldPosRadius = LoadHotPoint(fragPointIndex);
+  uint bucketIndex = GetPointBucketBlockIndices(gl_FragCoord.xy, worldPosRadius.xyz, worldPosRadius.w)[0];
+
+  if(bucketIndex != uint(-1))
+  {
+    BucketLanes bucketLanes = GetBucketLanes(bucketIndex);
+    if(bucketLanes.laneOffset == 0)
+    {
+      if(atomicAdd(bucketsBuf.data[bucketIndex].pointsCount, bucketLanes.lanesCount) == 0)
+        AddOccupiedBucket(bucketIndex);
+    }
+  }
+}
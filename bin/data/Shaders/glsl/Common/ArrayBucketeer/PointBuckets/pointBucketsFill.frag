@@ -5,17 +5,18 @@
 #include "../passData.decl"
 #include "../../projection.decl"
 #include "../bucketsData.decl"
-#include "../../pointsData.decl"
+#include "../../pointsHotData.decl"
 
 layout(location = 0) in flat uint fragPointIndex;
 
 void main() 
 {
-  uvec4 bucketIndices = GetPointBucketBlockIndices(gl_FragCoord.xy, pointsBuf.data[fragPointIndex].worldPos.xyz, pointsBuf.data[fragPointIndex].worldRadius);
-  float dist = dot(pointsBuf.data[fragPointIndex].worldPos.xyz, passDataBuf.sortDir.xyz);
+  vec4 worldPosRadius = LoadHotPoint(fragPointIndex);
+  uvec4 bucketIndices = GetPointBucketBlockIndices(gl_FragCoord.xy, worldPosRadius.xyz, worldPosRadius.w);
+  float dist = dot(worldPosRadius.xyz, passDataBuf.sortDir.xyz);
   for(int i = 0; i < 1; i++)
   {
-    if(bucketIndices[i] != uint(-1))
+    if(bucketIndices[i] != uint(-1) && bucketsBuf.data[bucketIndices[i]].entryOffset != uint(-1))
     {
       uint offset = bucketsBuf.data[bucketIndices[i]].entryOffset + atomicAdd(bucketsBuf.data[bucketIndices[i]].pointsCount, 1);
       bucketEntriesPoolBuf.data[offset].pointIndex = fragPointIndex;
@@ -0,0 +1,37 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_KHR_shader_subgroup_ballot : enable
+#extension GL_KHR_shader_subgroup_shuffle : enable
+
+#include "../passData.decl"
+#include "../../projection.decl"
+#include "../bucketsData.decl"
+#include "../../pointsHotData.decl"
+#include "../../subgroupAtomics.decl"
+
+layout(location = 0) in flat uint fragPointIndex;
+
+void main()
+{
+  //atomics of helper lanes are discarded so they can't lead a bucket
+  if(gl_HelperInvocation)
+    return;
+  vec4 worldPosRadius = LoadHotPoint(fragPointIndex);
+  uint bucketIndex = GetPointBucketBlockIndices(gl_FragCoord.xy, worldPosRadius.xyz, worldPosRadius.w)[0];
+  float dist = dot(worldPosRadius.xyz, passDataBuf.sortDir.xyz);
+
+  //buckets that didn't fit into the entries pool are left unallocated
+  if(bucketIndex != uint(-1) && bucketsBuf.data[bucketIndex].entryOffset != uint(-1))
+  {
+    BucketLanes bucketLanes = GetBucketLanes(bucketIndex);
+    uint lanesOffset = 0;
+    if(bucketLanes.laneOffset == 0)
+      lanesOffset = atomicAdd(bucketsBuf.data[bucketIndex].pointsCount, bucketLanes.lanesCount);
+    lanesOffset = subgroupShuffle(lanesOffset, bucketLanes.leaderLane);
+
+    uint offset = bucketsBuf.data[bucketIndex].entryOffset + lanesOffset + bucketLanes.laneOffset;
+    bucketEntriesPoolBuf.data[offset].pointIndex = fragPointIndex;
+    bucketEntriesPoolBuf.data[offset].pointDist = dist;
+  }
+}
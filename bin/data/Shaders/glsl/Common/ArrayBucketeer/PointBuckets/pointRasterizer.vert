@@ -4,7 +4,7 @@
 #include "../passData.decl"
 #include "../../projection.decl"
 #include "../bucketsData.decl"
-#include "../../pointsData.decl"
+#include "../../pointsHotData.decl"
 
 out gl_PerVertex 
 {
@@ -17,6 +17,6 @@ layout(location = 0) out uint vertPointIndex;
 void main()
 {
 	vertPointIndex = gl_VertexIndex;
-	gl_Position = passDataBuf.projMatrix * passDataBuf.viewMatrix * vec4(pointsBuf.data[vertPointIndex].worldPos.xyz, 1.0f);
+	gl_Position = passDataBuf.projMatrix * passDataBuf.viewMatrix * vec4(LoadHotPoint(vertPointIndex).xyz, 1.0f);
 	gl_PointSize = 1.0f;
 }
\ No newline at end of file
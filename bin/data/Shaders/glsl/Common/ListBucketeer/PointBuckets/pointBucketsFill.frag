@@ -5,15 +5,17 @@
 #include "../passData.decl"
 #include "../../projection.decl"
 #include "../bucketsData.decl"
-#include "../../pointsData.decl"
+#include "../../pointsHotData.decl"
 #include "../pointsListData.decl"
+#include "../../occupiedBucketsData.decl"
 
 layout(location = 0) in flat uint fragPointIndex;
 
 void main() 
 {
   vec2 screenCoord = gl_FragCoord.xy / vec2(mipInfosBuf.data[0].size.xy);
-  float floatMipLevel = GetPointMipLevel(pointsBuf.data[fragPointIndex].worldPos.xyz, pointsBuf.data[fragPointIndex].worldRadius);
+  vec4 worldPosRadius = LoadHotPoint(fragPointIndex);
+  float floatMipLevel = GetPointMipLevel(worldPosRadius.xyz, worldPosRadius.w);
   /*if(floatMipLevel < 1e-3f)
     return;*/
     
@@ -24,6 +26,8 @@ void main()
   if(bucketIndex != uint(-1))
   {
     uint prevHeadPointIndex = atomicExchange(bucketsBuf.data[bucketIndex].headPointIndex, fragPointIndex);
+    if(prevHeadPointIndex == uint(-1))
+      AddOccupiedBucket(bucketIndex);
     if(pointsListBuf.data[fragPointIndex].nextPointIndex != uint(-1))
       mipInfosBuf.data[0].debug += 1.0f;
     pointsListBuf.data[fragPointIndex].nextPointIndex = prevHeadPointIndex;
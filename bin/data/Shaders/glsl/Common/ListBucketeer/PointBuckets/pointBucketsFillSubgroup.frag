@@ -0,0 +1,48 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_KHR_shader_subgroup_ballot : enable
+#extension GL_KHR_shader_subgroup_shuffle : enable
+
+#include "../passData.decl"
+#include "../../projection.decl"
+#include "../bucketsData.decl"
+#include "../../pointsHotData.decl"
+#include "../pointsListData.decl"
+#include "../../occupiedBucketsData.decl"
+#include "../../subgroupAtomics.decl"
+
+layout(location = 0) in flat uint fragPointIndex;
+
+void main()
+{
+  //atomics of helper lanes are discarded so they can't lead a bucket
+  if(gl_HelperInvocation)
+    return;
+  vec2 screenCoord = gl_FragCoord.xy / vec2(mipInfosBuf.data[0].size.xy);
+  vec4 worldPosRadius = LoadHotPoint(fragPointIndex);
+  float floatMipLevel = GetPointMipLevel(worldPosRadius.xyz, worldPosRadius.w);
+
+  int mipLevel = int(floatMipLevel + 0.5f);
+  ivec2 clampedCoord = GetBucketClampedCoord(screenCoord, mipLevel, vec2(0.5f));
+  uint bucketIndex = GetBucketIndexSafe(clampedCoord, mipLevel);
+
+  if(bucketIndex != uint(-1))
+  {
+    BucketLanes bucketLanes = GetBucketLanes(bucketIndex);
+    //lanes of a bucket are chained in lane order and pushed as a whole, the highest lane becomes the new head
+    uint lastPointIndex = subgroupShuffle(fragPointIndex, subgroupBallotFindMSB(bucketLanes.mask));
+    uint prevLanePointIndex = subgroupShuffle(fragPointIndex, GetPrevBucketLane(bucketLanes));
+    if(bucketLanes.laneOffset == 0)
+    {
+      uint prevHeadPointIndex = atomicExchange(bucketsBuf.data[bucketIndex].headPointIndex, lastPointIndex);
+      if(prevHeadPointIndex == uint(-1))
+        AddOccupiedBucket(bucketIndex);
+      atomicAdd(bucketsBuf.data[bucketIndex].pointsCount, bucketLanes.lanesCount);
+      pointsListBuf.data[fragPointIndex].nextPointIndex = prevHeadPointIndex;
+    }else
+    {
+      pointsListBuf.data[fragPointIndex].nextPointIndex = prevLanePointIndex;
+    }
+  }
+}
@@ -5,7 +5,7 @@
 #include "../passData.decl"
 #include "../../projection.decl"
 #include "../bucketsData.decl"
-#include "../../pointsData.decl"
+#include "../../pointsHotData.decl"
 #include "../pointsListData.decl"
 
 out gl_PerVertex 
@@ -19,8 +19,9 @@ layout(location = 0) out uint vertPointIndex;
 void main()
 {
 	vertPointIndex = gl_VertexIndex;
+	vec4 worldPosRadius = LoadHotPoint(vertPointIndex);
 	pointsListBuf.data[vertPointIndex].nextPointIndex = uint(-1);
-	pointsListBuf.data[vertPointIndex].dist = dot(pointsBuf.data[vertPointIndex].worldPos.xyz, passDataBuf.sortDir.xyz);// + pointsBuf.data[vertPointIndex].worldRadius;
-	gl_Position = passDataBuf.projMatrix * passDataBuf.viewMatrix * vec4(pointsBuf.data[vertPointIndex].worldPos.xyz, 1.0f);
+	pointsListBuf.data[vertPointIndex].dist = dot(worldPosRadius.xyz, passDataBuf.sortDir.xyz);// + worldPosRadius.w;
+	gl_Position = passDataBuf.projMatrix * passDataBuf.viewMatrix * vec4(worldPosRadius.xyz, 1.0f);
 	gl_PointSize = 1.0f;
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_ARB_separate_shader_objects : enable
+
+#include "splatData.decl"
+
+layout(location = 0) out uint outPointIndex;
+
+//empty pixels get 0, same as the cleared attachment of the fixed function path
+void main() 
+{
+  uvec2 pixelCoord = uvec2(gl_FragCoord.xy);
+  uint pointIndex = indexBuf.data[pixelCoord.x + pixelCoord.y * splatDataBuf.size.x];
+  outPointIndex = pointIndex == EmptyIndex ? 0 : pointIndex;
+}
@@ -0,0 +1,90 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0, set = 0) uniform PassDataBuffer
+{
+  mat4 viewMatrix; //world -> camera
+  mat4 projMatrix; //camera -> ndc
+  vec4 viewportSize;
+  uint bucketGroupsCount;
+  float time;
+  uint framesCount;
+  int debugMip;
+  int debugType;
+} passDataBuf;
+
+#include "../Common/projection.decl"
+#include "../Common/ListBucketeer/bucketsData.decl"
+#include "../Common/ListBucketeer/bucketEntriesData.decl"
+#include "../Common/pointsData.decl"
+#include "PointSplatting.decl"
+
+layout(location = 0) in vec2 fragScreenCoord;
+layout(location = 0) out vec4 resColor;
+
+//same merge of 4 sorted buckets as listBucketGathering.frag, but over contiguous entry ranges
+uint AdvanceRanges(inout uvec4 entryIndices, uvec4 entryEnds, inout vec4 entryDists)
+{
+  float maxDist = 1e7f;
+  uint bestCoord = uint(-1);
+  for(int i = 0; i < 4; i++)
+  {
+    if(entryIndices[i] < entryEnds[i] && entryDists[i] < maxDist)
+    {
+      maxDist = entryDists[i];
+      bestCoord = i;
+    }
+  }
+
+  uint bestPointIndex = -1;
+  if(bestCoord != uint(-1))
+  {
+    bestPointIndex = bucketEntriesBuf.data[entryIndices[bestCoord]].pointIndex;
+    entryIndices[bestCoord]++;
+    entryDists[bestCoord] = (entryIndices[bestCoord] < entryEnds[bestCoord]) ? bucketEntriesBuf.data[entryIndices[bestCoord]].dist : 0.0f;
+  }
+
+  return bestPointIndex;
+}
+
+void main()
+{
+  vec2 centerScreenCoord = gl_FragCoord.xy / passDataBuf.viewportSize.xy;
+
+  mat4 viewProjMatrix = passDataBuf.projMatrix * passDataBuf.viewMatrix;
+  mat4 invViewProjMatrix = inverse(viewProjMatrix);
+
+  vec3 rayOrigin = Unproject(vec3(centerScreenCoord, 0.0f), invViewProjMatrix);
+  vec3 rayEnd = Unproject(vec3(centerScreenCoord, 1.0f), invViewProjMatrix);
+  vec3 rayDir = normalize(rayEnd - rayOrigin);
+
+  uint mipsCount = mipInfosBuf.data.length();
+
+  resColor = vec4(0.0f);
+  for(int mipNumber = 0; mipNumber < mipsCount; mipNumber++)
+  {
+    uint mipIndex = mipsCount - 1 - mipNumber;
+    uvec4 bucketIndices = GetBucketBlockIndices(centerScreenCoord, mipIndex, vec2(0.0f));
+
+    uvec4 entryIndices = uvec4(0);
+    uvec4 entryEnds = uvec4(0);
+    vec4 entryDists = vec4(0.0f);
+    for(uint pointNumber = 0; pointNumber < 4; pointNumber++)
+    {
+      uint bucketIndex = bucketIndices[pointNumber];
+      if(bucketIndex == uint(-1) || bucketsBuf.data[bucketIndex].headPointIndex == uint(-1))
+        continue;
+      entryIndices[pointNumber] = bucketsBuf.data[bucketIndex].entryOffset;
+      entryEnds[pointNumber] = entryIndices[pointNumber] + bucketsBuf.data[bucketIndex].pointsCount;
+      entryDists[pointNumber] = bucketEntriesBuf.data[entryIndices[pointNumber]].dist;
+    }
+
+    for(uint pointIndex = AdvanceRanges(entryIndices, entryEnds, entryDists); pointIndex != uint(-1); pointIndex = AdvanceRanges(entryIndices, entryEnds, entryDists))
+    {
+      SplatPoint(rayOrigin, rayDir, pointIndex, passDataBuf.framesCount, resColor);
+      if(resColor.a > 0.9f)
+        return;
+    }
+  }
+}
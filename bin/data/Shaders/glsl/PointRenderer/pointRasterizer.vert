@@ -22,6 +22,7 @@ layout(binding = 0, set = 1) uniform DrawCallData
 	vec4 albedoColor;
 	vec4 emissiveColor;
 	uint basePointIndex;
+	uint leafPointsCount; //lod splats of the object come after its leaf points
 };
 
 out gl_PerVertex 
@@ -59,6 +60,9 @@ void main()
 	pointsBuf.data[pointIndex].worldNormal = vec4(vertWorldNormal, 0.0f);
 	pointsBuf.data[pointIndex].directLight.rgb = emissiveColor.rgb;
 	pointsBuf.data[pointIndex].worldRadius = attribUv.x;
+	//lod splats only need their point data written, moving them outside the clip volume keeps them out of the index pyramid
+	if(gl_VertexIndex >= leafPointsCount)
+		gl_Position = vec4(2.0f, 2.0f, 2.0f, 1.0f);
 	
 	vertUv = attribUv;
 }
\ No newline at end of file
@@ -0,0 +1,151 @@
+#pragma once
+#include <map>
+#include <fstream>
+#include <numeric>
+
+//per-pass cpu and gpu timings of a benchmark run. a pass that runs several times in a frame (once per mip, per bucket group etc)
+//is summed up, so every sample is what that pass cost in one frame. "Frame" holds whole frame times
+class BenchmarkReport
+{
+public:
+  struct Stats
+  {
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double minMs;
+    double maxMs;
+    size_t samplesCount;
+  };
+
+  void AddCpuFrame(const legit::ProfilerTask *tasks, size_t tasksCount)
+  {
+    AddFrame(cpuSamples, tasks, tasksCount);
+  }
+
+  void AddGpuFrame(const legit::ProfilerTask *tasks, size_t tasksCount)
+  {
+    AddFrame(gpuSamples, tasks, tasksCount);
+  }
+
+  Json::Value Save(const BenchmarkDesc &desc) const
+  {
+    Json::Value reportValue;
+    reportValue["benchmark"]["renderer"] = desc.rendererName;
+    reportValue["benchmark"]["scene"] = desc.sceneFilename;
+    reportValue["benchmark"]["viewportSize"].append(desc.viewportSize.x);
+    reportValue["benchmark"]["viewportSize"].append(desc.viewportSize.y);
+    reportValue["benchmark"]["frames"] = Json::UInt64(desc.framesCount);
+    reportValue["cpu"] = SaveSamples(cpuSamples);
+    reportValue["gpu"] = SaveSamples(gpuSamples);
+    return reportValue;
+  }
+
+  //a pass regresses when its median got slower than the baseline's by more than relativeThreshold and by more than
+  //minDiffMs, the latter keeps tiny passes from failing on timer noise. passes missing from either side are not compared
+  std::vector<std::string> FindRegressions(Json::Value baselineValue, double relativeThreshold, double minDiffMs) const
+  {
+    std::vector<std::string> regressions;
+    auto compare = [&](std::string category, const SamplesMap &samplesMap)
+    {
+      for (const auto &it : samplesMap)
+      {
+        Json::Value baselinePass = baselineValue[category][it.first];
+        if (baselinePass.isNull())
+          continue;
+        double baselineMs = baselinePass["p50Ms"].asDouble();
+        double currMs = ComputeStats(it.second).p50Ms;
+        if (currMs > baselineMs * (1.0 + relativeThreshold) && currMs - baselineMs > minDiffMs)
+        {
+          std::stringstream message;
+          message << category << " " << it.first << ": " << baselineMs << "ms -> " << currMs << "ms";
+          regressions.push_back(message.str());
+        }
+      }
+    };
+    compare("cpu", cpuSamples);
+    compare("gpu", gpuSamples);
+    return regressions;
+  }
+
+  void Print() const
+  {
+    auto print = [](std::string category, const SamplesMap &samplesMap)
+    {
+      for (const auto &it : samplesMap)
+      {
+        Stats stats = ComputeStats(it.second);
+        std::cout << category << " " << it.first << ": mean " << stats.meanMs << "ms, p50 " << stats.p50Ms << "ms, p95 " << stats.p95Ms << "ms, p99 " << stats.p99Ms << "ms\n";
+      }
+    };
+    print("cpu", cpuSamples);
+    print("gpu", gpuSamples);
+  }
+
+  static Stats ComputeStats(std::vector<double> samples)
+  {
+    Stats stats = {};
+    if (samples.empty())
+      return stats;
+    std::sort(samples.begin(), samples.end());
+    auto getPercentile = [&](double percentile)
+    {
+      double pos = percentile * double(samples.size() - 1);
+      size_t index = size_t(pos);
+      double ratio = pos - double(index);
+      return (index + 1 < samples.size()) ? samples[index] * (1.0 - ratio) + samples[index + 1] * ratio : samples[index];
+    };
+    stats.p50Ms = getPercentile(0.5);
+    stats.p95Ms = getPercentile(0.95);
+    stats.p99Ms = getPercentile(0.99);
+    stats.minMs = samples.front();
+    stats.maxMs = samples.back();
+    stats.meanMs = std::accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size());
+    stats.samplesCount = samples.size();
+    return stats;
+  }
+private:
+  using SamplesMap = std::map<std::string, std::vector<double>>;
+
+  void AddFrame(SamplesMap &samplesMap, const legit::ProfilerTask *tasks, size_t tasksCount)
+  {
+    if (tasksCount == 0)
+      return;
+    std::map<std::string, double> frameTimes;
+    double frameStart = tasks[0].startTime;
+    double frameEnd = tasks[0].endTime;
+    for (size_t taskIndex = 0; taskIndex < tasksCount; taskIndex++)
+    {
+      const auto &task = tasks[taskIndex];
+      frameTimes[task.name] += (task.endTime - task.startTime) * 1e3;
+      frameStart = std::min(frameStart, task.startTime);
+      frameEnd = std::max(frameEnd, task.endTime);
+    }
+    frameTimes["Frame"] = (frameEnd - frameStart) * 1e3;
+    for (const auto &it : frameTimes)
+      samplesMap[it.first].push_back(it.second);
+  }
+
+  static Json::Value SaveSamples(const SamplesMap &samplesMap)
+  {
+    Json::Value samplesValue(Json::objectValue);
+    for (const auto &it : samplesMap)
+    {
+      Stats stats = ComputeStats(it.second);
+      Json::Value passValue;
+      passValue["meanMs"] = stats.meanMs;
+      passValue["p50Ms"] = stats.p50Ms;
+      passValue["p95Ms"] = stats.p95Ms;
+      passValue["p99Ms"] = stats.p99Ms;
+      passValue["minMs"] = stats.minMs;
+      passValue["maxMs"] = stats.maxMs;
+      passValue["samples"] = Json::UInt64(stats.samplesCount);
+      samplesValue[it.first] = passValue;
+    }
+    return samplesValue;
+  }
+
+  SamplesMap cpuSamples;
+  SamplesMap gpuSamples;
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+//camera and light keyframes indexed by frame number rather than by time, so a replayed path renders exactly the same
+//frames no matter how fast they render
+struct CameraPath
+{
+  struct Keyframe
+  {
+    size_t frameIndex;
+    Camera camera;
+    Camera light;
+  };
+  std::vector<Keyframe> keyframes;
+
+  //linear interpolation between neighbouring keyframes, clamped at both ends
+  void Evaluate(size_t frameIndex, Camera &camera, Camera &light) const
+  {
+    if (keyframes.empty())
+      return;
+    size_t nextIndex = 0;
+    for (; nextIndex < keyframes.size() && keyframes[nextIndex].frameIndex <= frameIndex; nextIndex++);
+    if (nextIndex == 0 || nextIndex == keyframes.size())
+    {
+      const auto &keyframe = keyframes[nextIndex == 0 ? 0 : keyframes.size() - 1];
+      camera = keyframe.camera;
+      light = keyframe.light;
+      return;
+    }
+    const auto &prev = keyframes[nextIndex - 1];
+    const auto &next = keyframes[nextIndex];
+    float ratio = float(frameIndex - prev.frameIndex) / float(next.frameIndex - prev.frameIndex);
+    camera = Lerp(prev.camera, next.camera, ratio);
+    light = Lerp(prev.light, next.light, ratio);
+  }
+
+  size_t GetLastFrameIndex() const
+  {
+    return keyframes.empty() ? 0 : keyframes.back().frameIndex;
+  }
+
+  static CameraPath Load(Json::Value pathValue)
+  {
+    CameraPath path;
+    for (Json::ArrayIndex keyframeIndex = 0; keyframeIndex < pathValue.size(); keyframeIndex++)
+    {
+      Json::Value keyframeValue = pathValue[keyframeIndex];
+      Keyframe keyframe;
+      keyframe.frameIndex = keyframeValue["frame"].asUInt();
+      keyframe.camera = LoadCamera(keyframeValue["camera"]);
+      keyframe.light = LoadCamera(keyframeValue["light"]);
+      path.keyframes.push_back(keyframe);
+    }
+    std::stable_sort(path.keyframes.begin(), path.keyframes.end(), [](const Keyframe &left, const Keyframe &right) { return left.frameIndex < right.frameIndex; });
+    return path;
+  }
+
+  Json::Value Save() const
+  {
+    Json::Value pathValue(Json::arrayValue);
+    for (const auto &keyframe : keyframes)
+    {
+      Json::Value keyframeValue;
+      keyframeValue["frame"] = Json::UInt64(keyframe.frameIndex);
+      keyframeValue["camera"] = SaveCamera(keyframe.camera);
+      keyframeValue["light"] = SaveCamera(keyframe.light);
+      pathValue.append(keyframeValue);
+    }
+    return pathValue;
+  }
+private:
+  static Camera Lerp(const Camera &left, const Camera &right, float ratio)
+  {
+    Camera res;
+    res.pos = glm::mix(left.pos, right.pos, ratio);
+    res.horAngle = glm::mix(left.horAngle, right.horAngle, ratio);
+    res.vertAngle = glm::mix(left.vertAngle, right.vertAngle, ratio);
+    return res;
+  }
+
+  static Camera LoadCamera(Json::Value cameraValue)
+  {
+    Camera camera;
+    camera.pos = ReadJsonVec3f(cameraValue["pos"]);
+    camera.horAngle = cameraValue["horAngle"].asFloat();
+    camera.vertAngle = cameraValue["vertAngle"].asFloat();
+    return camera;
+  }
+
+  static Json::Value SaveCamera(const Camera &camera)
+  {
+    Json::Value cameraValue;
+    for (int i = 0; i < 3; i++)
+      cameraValue["pos"].append(camera.pos[i]);
+    cameraValue["horAngle"] = camera.horAngle;
+    cameraValue["vertAngle"] = camera.vertAngle;
+    return cameraValue;
+  }
+};
+
+//everything needed to reproduce a benchmark run: what to render, at what size and from where
+struct BenchmarkDesc
+{
+  std::string sceneFilename;
+  Scene::GeometryTypes geomType = Scene::GeometryTypes::Triangles;
+  std::string rendererName;
+  glm::uvec2 viewportSize = glm::uvec2(1024, 1024);
+  size_t warmupFramesCount = 30;
+  size_t framesCount = 300;
+  CameraPath path;
+
+  static BenchmarkDesc Load(Json::Value benchmarkValue)
+  {
+    BenchmarkDesc desc;
+    desc.sceneFilename = benchmarkValue["scene"].asString();
+    desc.geomType = GetGeometryType(benchmarkValue["geometryType"].asString());
+    desc.rendererName = benchmarkValue["renderer"].asString();
+    if (benchmarkValue.isMember("viewportSize"))
+      desc.viewportSize = glm::uvec2(ReadJsonVec2i(benchmarkValue["viewportSize"]));
+    if (benchmarkValue.isMember("warmupFrames"))
+      desc.warmupFramesCount = benchmarkValue["warmupFrames"].asUInt();
+    desc.path = CameraPath::Load(benchmarkValue["path"]);
+    //by default the path is played back once
+    desc.framesCount = benchmarkValue.isMember("frames") ? benchmarkValue["frames"].asUInt() : std::max<size_t>(desc.path.GetLastFrameIndex() + 1, 1);
+    return desc;
+  }
+
+  Json::Value Save() const
+  {
+    Json::Value benchmarkValue;
+    benchmarkValue["scene"] = sceneFilename;
+    benchmarkValue["geometryType"] = GetGeometryTypeName(geomType);
+    benchmarkValue["renderer"] = rendererName;
+    benchmarkValue["viewportSize"].append(viewportSize.x);
+    benchmarkValue["viewportSize"].append(viewportSize.y);
+    benchmarkValue["warmupFrames"] = Json::UInt64(warmupFramesCount);
+    benchmarkValue["frames"] = Json::UInt64(framesCount);
+    benchmarkValue["path"] = path.Save();
+    return benchmarkValue;
+  }
+
+  static Scene::GeometryTypes GetGeometryType(std::string name)
+  {
+    if (name == "RegularPoints")
+      return Scene::GeometryTypes::RegularPoints;
+    if (name == "SizedPoints")
+      return Scene::GeometryTypes::SizedPoints;
+    return Scene::GeometryTypes::Triangles;
+  }
+
+  static std::string GetGeometryTypeName(Scene::GeometryTypes geomType)
+  {
+    switch (geomType)
+    {
+      case Scene::GeometryTypes::RegularPoints: return "RegularPoints";
+      case Scene::GeometryTypes::SizedPoints: return "SizedPoints";
+      default: return "Triangles";
+    }
+  }
+};
+
+//samples the camera every few frames while flying around in windowed mode, the result can be saved as a benchmark
+class CameraPathRecorder
+{
+public:
+  void Start()
+  {
+    path.keyframes.clear();
+    frameIndex = 0;
+    isRecording = true;
+  }
+
+  void Stop()
+  {
+    isRecording = false;
+  }
+
+  bool IsRecording()
+  {
+    return isRecording;
+  }
+
+  void AddFrame(const Camera &camera, const Camera &light)
+  {
+    if (!isRecording)
+      return;
+    if (frameIndex % KeyframeInterval == 0)
+      path.keyframes.push_back({ frameIndex, camera, light });
+    frameIndex++;
+  }
+
+  const CameraPath &GetPath()
+  {
+    return path;
+  }
+private:
+  static const size_t KeyframeInterval = 10;
+  CameraPath path;
+  size_t frameIndex = 0;
+  bool isRecording = false;
+};
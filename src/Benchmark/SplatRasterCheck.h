@@ -0,0 +1,89 @@
+#pragma once
+#include <random>
+
+//rasterizes CpuSplatRaster::GenerateTestSplats with PointSplatRasterizer on the gpu and compares the point of every pixel with
+//CpuSplatRaster::RasterizePacked. the gpu may round the projection differently (fma, division), which moves an edge or a depth of
+//a splat by an ulp now and then, so a small share of mismatched pixels is tolerated. the tiled scheme itself is compared exactly
+//with the reference on the cpu by SplatRasterBenchmark
+int RunSplatRasterCheck(glm::uvec2 size, size_t pointsCount)
+{
+  bool enableDebugging = false;
+  #if defined LEGIT_ENABLE_DEBUGGING
+  enableDebugging = true;
+  #endif
+  auto core = std::make_unique<legit::Core>(nullptr, 0, nullptr, enableDebugging);
+
+  //of pixels covered on either side
+  const double maxMismatchRatio = 1e-3;
+  bool isValid = true;
+  {
+    std::default_random_engine eng(1);
+    std::vector<glm::vec4> worldPosRadii = CpuSplatRaster::GenerateTestSplats(pointsCount, eng);
+
+    //same layout as Point of pointsData.decl
+    #pragma pack(push, 1)
+    struct Point
+    {
+      glm::vec4 worldPos;
+      glm::vec4 worldNormal;
+      glm::vec4 directLight;
+      glm::vec4 indirectLight;
+      float worldRadius;
+      float padding[3];
+    };
+    #pragma pack(pop)
+    std::vector<Point> points(pointsCount, Point());
+    for (size_t pointIndex = 0; pointIndex < pointsCount; pointIndex++)
+    {
+      points[pointIndex].worldPos = glm::vec4(glm::vec3(worldPosRadii[pointIndex]), 1.0f);
+      points[pointIndex].worldRadius = worldPosRadii[pointIndex].w;
+    }
+    auto pointBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(Point) * pointsCount, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+    memcpy(pointBuffer->Map(), points.data(), sizeof(Point) * pointsCount);
+    pointBuffer->Unmap();
+    auto pointData = core->GetRenderGraph()->AddExternalBuffer(pointBuffer.get());
+    std::vector<PointRange> pointRanges = { { 0, uint32_t(pointsCount) } };
+
+    PointSplatRasterizer splatRasterizer(core.get());
+    splatRasterizer.RecreateSwapchainResources(size, true);
+    HeadlessQueue headlessQueue(core.get(), size, 1);
+
+    struct View
+    {
+      const char *name;
+      glm::mat4 projMatrix;
+    };
+    glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    std::vector<View> views = {
+      { "perspective", glm::perspectiveZO(1.0f, 1.0f, 0.1f, 10.0f) },
+      { "ortho", glm::orthoZO(-1.5f, 1.5f, -1.5f, 1.5f, 0.1f, 10.0f) } };
+    const float radiusScales[] = { 0.0f, 1.0f };
+
+    for (auto &view : views)
+    {
+      for (float radiusScale : radiusScales)
+      {
+        auto frameInfo = headlessQueue.BeginFrame();
+        splatRasterizer.RasterizeSplats(frameInfo.memoryPool, pointData->Id(), pointRanges, view.projMatrix, viewMatrix, radiusScale);
+        headlessQueue.EndFrame();
+        core->WaitIdle();
+
+        std::vector<uint32_t> gpuIndices = splatRasterizer.ReadPointIndices();
+        float pixelRadiusScale = CpuSplatRaster::GetPixelRadiusScale(view.projMatrix, size, radiusScale);
+        std::vector<uint32_t> referenceIndices = CpuSplatRaster::RasterizePacked(worldPosRadii.data(), worldPosRadii.size(), view.projMatrix * viewMatrix, pixelRadiusScale, size);
+        size_t mismatchesCount = 0;
+        size_t coveredCount = 0;
+        for (size_t pixelIndex = 0; pixelIndex < referenceIndices.size(); pixelIndex++)
+        {
+          mismatchesCount += gpuIndices[pixelIndex] != referenceIndices[pixelIndex] ? 1 : 0;
+          coveredCount += (gpuIndices[pixelIndex] != 0 || referenceIndices[pixelIndex] != 0) ? 1 : 0;
+        }
+        bool isMatching = double(mismatchesCount) <= maxMismatchRatio * double(coveredCount);
+        isValid = isValid && isMatching;
+        std::cout << view.name << " radius scale " << radiusScale << ": " << mismatchesCount << " of " << coveredCount << " covered pixels differ from the cpu reference" << (isMatching ? "\n" : ", too many\n");
+      }
+    }
+  }
+  std::cout << (isValid ? "Splat raster check passed\n" : "Splat raster check failed\n");
+  return isValid ? 0 : 1;
+}
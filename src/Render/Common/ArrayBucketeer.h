@@ -1,4 +1,10 @@
 #pragma once
+#include "PointChunkCuller.h"
+#include "PointPacker.h"
+#include "OccupiedBuckets.h"
+#include "SubgroupAtomics.h"
+#include "HostReadBarrier.h"
+
 glm::uint GetMaxPow(size_t size)
 {
   glm::uint p = 0;
@@ -12,6 +18,7 @@ public:
   ArrayBucketeer(legit::Core *_core)
   {
     this->core = _core;
+    this->useSubgroupAtomics = AreSubgroupAtomicsSupported(core->GetPhysicalDevice());
 
     ReloadShaders();
   }
@@ -21,9 +28,66 @@ public:
     sceneResources.reset(new SceneResources(core, pointsCount)); //may need to update viewport resources here
   }
 
-  void RecreateSwapchainResources(glm::uvec2 viewportSize, size_t framesInFlightCount)
+  void RecreateSwapchainResources(glm::uvec2 viewportSize, size_t framesInFlightCount, size_t maxMipsCount = std::numeric_limits<size_t>::max())
+  {
+    viewportResources.reset(new ViewportResources(core, viewportSize, sceneResources->pointsCount, maxMipsCount));
+  }
+
+  static size_t GetBytesPerBucket()
+  {
+    return sizeof(Bucket) + sizeof(BucketEntry) + sizeof(uint32_t);
+  }
+
+  size_t GetBucketedPointsCount()
+  {
+    return bucketedPointsCount;
+  }
+
+  //non-empty buckets of a recent bucketing, may lag a few frames behind
+  size_t GetOccupiedBucketsCount()
+  {
+    return viewportResources ? viewportResources->occupiedBuckets->GetOccupiedBucketsCount() : 0;
+  }
+
+  size_t GetTotalBucketsCount()
+  {
+    return viewportResources ? viewportResources->totalBucketsCount : 0;
+  }
+
+  bool IsUsingSubgroupAtomics()
+  {
+    return useSubgroupAtomics;
+  }
+
+  //appended to pass names so that BucketGridSizer can tell gpu time of bucketeers apart
+  void SetProfilerTag(std::string profilerTag)
   {
-    viewportResources.reset(new ViewportResources(core, viewportSize, sceneResources->pointsCount));
+    this->profilerTag = profilerTag;
+  }
+
+  struct PoolInfo
+  {
+    size_t entriesPoolSize;
+    size_t requiredEntriesCount;
+    size_t groupEntriesPoolSize;
+    size_t requiredGroupEntriesCount;
+    size_t overflowedBucketsCount; //buckets of a recent bucketing that did not fit into the entries pool and were left empty
+  };
+
+  //gpu reported counts lag a few frames behind
+  PoolInfo GetPoolInfo()
+  {
+    PoolInfo res = {};
+    if (viewportResources)
+    {
+      auto poolStats = viewportResources->GetPoolStats();
+      res.entriesPoolSize = viewportResources->entriesPoolSize.size;
+      res.requiredEntriesCount = poolStats.lastRequiredEntriesCount;
+      res.groupEntriesPoolSize = viewportResources->groupEntriesPoolSize.size;
+      res.requiredGroupEntriesCount = viewportResources->occupiedBuckets->GetOccupiedBucketsCount();
+      res.overflowedBucketsCount = poolStats.lastOverflowedBucketsCount;
+    }
+    return res;
   }
 
 public:
@@ -38,8 +102,17 @@ public:
     size_t bucketGroupsCount;
   };
 
-  BucketBuffers BucketPoints(legit::ShaderMemoryPool *memoryPool, glm::mat4 projMatrix, glm::mat4 viewMatrix, legit::RenderGraph::BufferProxyId pointDataProxyId, uint32_t pointsCount, bool sort)
+  //if visibleRanges are specified, only points inside of them get bucketed, otherwise all pointsCount points are
+  BucketBuffers BucketPoints(legit::ShaderMemoryPool *memoryPool, glm::mat4 projMatrix, glm::mat4 viewMatrix, legit::RenderGraph::BufferProxyId pointsHotProxyId, uint32_t pointsCount, bool sort, const std::vector<PointRange> *visibleRanges = nullptr)
   {
+    std::vector<PointRange> pointRanges;
+    if (visibleRanges)
+      pointRanges = *visibleRanges;
+    else
+      pointRanges.push_back({ 0, pointsCount });
+    this->bucketedPointsCount = GetRangesPointsCount(pointRanges);
+    UpdatePoolSizes();
+
     vk::Extent2D viewportExtent = vk::Extent2D(viewportResources->viewportSize.x, viewportResources->viewportSize.y);
     PassData passData;
     passData.viewMatrix = viewMatrix;
@@ -54,6 +127,8 @@ public:
 
     passData.bucketGroupsCount = glm::uint(viewportResources->bucketGroupsCount);
     passData.time = 0.0f;
+    passData.entriesPoolSize = glm::uint(viewportResources->entriesPoolSize.size);
+    passData.groupEntriesPoolSize = glm::uint(viewportResources->groupEntriesPoolSize.size);
 
     for(int phase = 0; phase < 2; phase++)
     {
@@ -61,8 +136,11 @@ public:
         .SetStorageBuffers({
           viewportResources->bucketsProxy->Id(),
           viewportResources->mipInfosProxy->Id(),
-          viewportResources->bucketEntriesPoolProxy->Id() })
-        .SetProfilerInfo(legit::Colors::emerald, phase == 0 ? "PassBcrClean" : "PassBcrAlloc")
+          viewportResources->bucketEntriesPoolProxy->Id(),
+          viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+          viewportResources->occupiedBuckets->argsProxy->Id(),
+          viewportResources->poolStatsProxy->Id() })
+        .SetProfilerInfo(legit::Colors::emerald, GetPassName(phase == 0 ? "PassBcrClean" : "PassBcrAlloc"))
         .SetRecordFunc([this, memoryPool, passData, phase](legit::RenderGraph::PassContext passContext)
       {
         auto shader = phase == 0 ? pointBuckets.clearShader.compute.get() : pointBuckets.allocShader.compute.get();
@@ -83,12 +161,28 @@ public:
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("MipInfosBuffer", mipInfosBuffer));
           auto bucketEntriesPoolBuffer = passContext.GetBuffer(viewportResources->bucketEntriesPoolProxy->Id());
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketEntriesPoolBuffer", bucketEntriesPoolBuffer));
+          auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+          auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
+          auto poolStatsBuffer = passContext.GetBuffer(viewportResources->poolStatsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PoolStatsBuffer", poolStatsBuffer));
 
           auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
           passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
 
-          size_t workGroupSize = shader->GetLocalSize().x;
-          passContext.GetCommandBuffer().dispatch(uint32_t(viewportResources->totalBucketsCount / (workGroupSize) + 1), 1, 1);
+          //buckets are cleared by index, allocation only visits the occupied ones
+          if (phase == 0)
+          {
+            size_t workGroupSize = shader->GetLocalSize().x;
+            passContext.GetCommandBuffer().dispatch(uint32_t(viewportResources->totalBucketsCount / (workGroupSize) + 1), 1, 1);
+          }
+          else
+          {
+            viewportResources->occupiedBuckets->Dispatch(passContext.GetCommandBuffer(), shader, OccupiedBuckets::DispatchTypes::Buckets);
+          }
+          //GetPoolStats and GetOccupiedBucketsCount read what these passes wrote
+          AddHostReadBarrier(passContext.GetCommandBuffer());
         }
       }));
 
@@ -100,10 +194,12 @@ public:
           viewportResources->bucketsProxy->Id(),
           viewportResources->mipInfosProxy->Id(),
           viewportResources->bucketEntriesPoolProxy->Id(),
-          pointDataProxyId })
+          viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+          viewportResources->occupiedBuckets->argsProxy->Id(),
+          pointsHotProxyId })
         .SetRenderAreaExtent(viewportExtent)
-        .SetProfilerInfo(legit::Colors::carrot, phase == 0 ? "PassBcrCount" : "PassBcrFill")
-        .SetRecordFunc([this, passData, memoryPool, pointDataProxyId, phase, pointsCount](legit::RenderGraph::RenderPassContext passContext)
+        .SetProfilerInfo(legit::Colors::carrot, GetPassName(phase == 0 ? "PassBcrCount" : "PassBcrFill"))
+        .SetRecordFunc([this, passData, memoryPool, pointsHotProxyId, phase, pointRanges](legit::RenderGraph::RenderPassContext passContext)
       {
         std::vector<legit::BlendSettings> attachmentBlendSettings;
         attachmentBlendSettings.resize(passContext.GetRenderPass()->GetColorAttachmentsCount(), legit::BlendSettings::Opaque());
@@ -128,8 +224,13 @@ public:
           auto bucketEntriesPoolBuffer = passContext.GetBuffer(viewportResources->bucketEntriesPoolProxy->Id());
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketEntriesPoolBuffer", bucketEntriesPoolBuffer));
 
-          auto pointsDataBuffer = passContext.GetBuffer(pointDataProxyId);
-          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsDataBuffer));
+          auto pointsHotBuffer = passContext.GetBuffer(pointsHotProxyId);
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
+
+          auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+          auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
 
           auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
 
@@ -137,7 +238,8 @@ public:
             { shaderDataSet },
             { shaderData.dynamicOffset });
 
-          passContext.GetCommandBuffer().draw(pointsCount, 1, 0, 0);
+          for (auto &range : pointRanges)
+            passContext.GetCommandBuffer().draw(range.pointsCount, 1, range.firstPointIndex, 0);
         }
       }));
     }
@@ -149,11 +251,11 @@ public:
           viewportResources->bucketsProxy,
           viewportResources->mipInfosProxy,
           viewportResources->bucketEntriesPoolProxy,
-          pointDataProxyId,
+          pointsHotProxyId,
           viewportResources->bucketGroupsProxy,
           viewportResources->groupEntriesPoolProxy })
-        .SetProfilerInfo(legit::Colors::pomegranate, "PassBcrSort2")
-        .SetRecordFunc([this, memoryPool, viewportResources, passData, pointDataProxyId](legit::RenderGraph::PassContext passContext)
+        .SetProfilerInfo(legit::Colors::pomegranate, GetPassName("PassBcrSort2"))
+        .SetRecordFunc([this, memoryPool, viewportResources, passData, pointsHotProxyId](legit::RenderGraph::PassContext passContext)
       {
         auto shader = sortShader.compute.get();
         auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
@@ -176,8 +278,8 @@ public:
           auto bucketEntriesPoolBuffer = passContext.GetBuffer(viewportResources->bucketEntriesPoolProxy);
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketEntriesPoolBuffer", bucketEntriesPoolBuffer));
 
-          auto pointsDataBuffer = passContext.GetBuffer(pointDataProxyId);
-          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsDataBuffer));
+          auto pointsHotBuffer = passContext.GetBuffer(pointsHotProxyId);
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
 
           auto bucketGroupsBuffer = passContext.GetBuffer(viewportResources->bucketGroupsProxy);
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketGroupsBuffer", bucketGroupsBuffer));
@@ -200,11 +302,11 @@ public:
             viewportResources->bucketsProxy->Id(),
             viewportResources->mipInfosProxy->Id(),
             viewportResources->bucketEntriesPoolProxy->Id(),
-            pointDataProxyId,
+            pointsHotProxyId,
             viewportResources->bucketGroupsProxy->Id(),
             viewportResources->groupEntriesPoolProxy->Id() })
-          .SetProfilerInfo(legit::Colors::sunFlower, phase == 0 ? "PassGrpClear" : "PassGrpAlloc")
-          .SetRecordFunc([this, memoryPool, passData, pointDataProxyId, phase](legit::RenderGraph::PassContext passContext)
+          .SetProfilerInfo(legit::Colors::sunFlower, GetPassName(phase == 0 ? "PassGrpClear" : "PassGrpAlloc"))
+          .SetRecordFunc([this, memoryPool, passData, pointsHotProxyId, phase](legit::RenderGraph::PassContext passContext)
         {
           auto shader = (phase == 0) ? bucketGroups.clearShader.compute.get() : bucketGroups.allocShader.compute.get();
           auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
@@ -233,8 +335,8 @@ public:
             auto groupEntriesPoolBuffer = passContext.GetBuffer(viewportResources->groupEntriesPoolProxy->Id());
             storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("GroupEntriesPoolBuffer", groupEntriesPoolBuffer));
 
-            auto pointsDataBuffer = passContext.GetBuffer(pointDataProxyId);
-            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsDataBuffer));
+            auto pointsHotBuffer = passContext.GetBuffer(pointsHotProxyId);
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
 
             auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
             passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
@@ -251,9 +353,11 @@ public:
             viewportResources->bucketsProxy->Id(),
             viewportResources->mipInfosProxy->Id(),
             viewportResources->bucketEntriesPoolProxy->Id(),
-            pointDataProxyId})
-          .SetProfilerInfo(legit::Colors::clouds, phase == 0 ? "PassGrpCount" : "PassGrpFill")
-          .SetRecordFunc([this, memoryPool, passData, pointDataProxyId, phase](legit::RenderGraph::PassContext passContext)
+            viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+            viewportResources->occupiedBuckets->argsProxy->Id(),
+            pointsHotProxyId})
+          .SetProfilerInfo(legit::Colors::clouds, GetPassName(phase == 0 ? "PassGrpCount" : "PassGrpFill"))
+          .SetRecordFunc([this, memoryPool, passData, pointsHotProxyId, phase](legit::RenderGraph::PassContext passContext)
         {
           auto shader = (phase == 0) ? bucketGroups.countShader.compute.get() : bucketGroups.fillShader.compute.get();
           auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
@@ -282,14 +386,18 @@ public:
             auto groupEntriesPoolBuffer = passContext.GetBuffer(viewportResources->groupEntriesPoolProxy->Id());
             storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("GroupEntriesPoolBuffer", groupEntriesPoolBuffer));
 
-            auto pointsDataBuffer = passContext.GetBuffer(pointDataProxyId);
-            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsDataBuffer));
+            auto pointsHotBuffer = passContext.GetBuffer(pointsHotProxyId);
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
+
+            auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+            auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
 
             auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
             passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
 
-            size_t workGroupSize = shader->GetLocalSize().x;
-            passContext.GetCommandBuffer().dispatch(uint32_t(viewportResources->totalBucketsCount / (workGroupSize) + 1), 1, 1);
+            viewportResources->occupiedBuckets->Dispatch(passContext.GetCommandBuffer(), shader, OccupiedBuckets::DispatchTypes::Buckets);
           }
         }));
       }
@@ -298,11 +406,13 @@ public:
           viewportResources->bucketsProxy->Id(),
           viewportResources->mipInfosProxy->Id(),
           viewportResources->bucketEntriesPoolProxy->Id(),
-          pointDataProxyId,
+          pointsHotProxyId,
           viewportResources->bucketGroupsProxy->Id(),
-          viewportResources->groupEntriesPoolProxy->Id() })
-        .SetProfilerInfo(legit::Colors::amethyst, "PassBcrSort")
-        .SetRecordFunc([this, memoryPool, passData, pointDataProxyId](legit::RenderGraph::PassContext passContext)
+          viewportResources->groupEntriesPoolProxy->Id(),
+          viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+          viewportResources->occupiedBuckets->argsProxy->Id() })
+        .SetProfilerInfo(legit::Colors::amethyst, GetPassName("PassBcrSort"))
+        .SetRecordFunc([this, memoryPool, passData, pointsHotProxyId](legit::RenderGraph::PassContext passContext)
       {
         auto shader = sortShader.compute.get();
         auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
@@ -331,14 +441,18 @@ public:
           auto groupEntriesPoolBuffer = passContext.GetBuffer(viewportResources->groupEntriesPoolProxy->Id());
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("GroupEntriesPoolBuffer", groupEntriesPoolBuffer));
 
-          auto pointsDataBuffer = passContext.GetBuffer(pointDataProxyId);
-          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsDataBuffer));
+          auto pointsHotBuffer = passContext.GetBuffer(pointsHotProxyId);
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
+
+          auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+          auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
 
           auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
           passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
 
-          size_t workGroupSize = shader->GetLocalSize().x;
-          passContext.GetCommandBuffer().dispatch(uint32_t(viewportResources->totalBucketsCount / (workGroupSize) + 1), 1, 1);
+          viewportResources->occupiedBuckets->Dispatch(passContext.GetCommandBuffer(), shader, OccupiedBuckets::DispatchTypes::Buckets);
         }
       }));
 
@@ -353,9 +467,9 @@ public:
               viewportResources->bucketsProxy,
               viewportResources->mipInfosProxy,
               viewportResources->bucketEntriesPoolProxy,
-              pointDataProxyId})
-            .SetProfilerInfo(legit::Colors::amethyst, "PassBtncKernel")
-            .SetRecordFunc([this, memoryPool, viewportResources, passData, pointDataProxyId](legit::RenderGraph::PassContext passContext)
+              pointsHotProxyId})
+            .SetProfilerInfo(legit::Colors::amethyst, GetPassName("PassBtncKernel"))
+            .SetRecordFunc([this, memoryPool, viewportResources, passData, pointsHotProxyId](legit::RenderGraph::PassContext passContext)
           {
             auto shader = bitonicKernelShader.compute.get();
             auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
@@ -378,8 +492,8 @@ public:
               auto bucketEntriesPoolBuffer = passContext.GetBuffer(viewportResources->bucketEntriesPoolProxy);
               storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketEntriesPoolBuffer", bucketEntriesPoolBuffer));
 
-              auto pointsDataBuffer = passContext.GetBuffer(pointDataProxyId);
-              storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsDataBuffer));
+              auto pointsHotBuffer = passContext.GetBuffer(pointsHotProxyId);
+              storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
 
               auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
               passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
@@ -409,11 +523,11 @@ public:
   void ReloadShaders()
   {
     pointBuckets.countShader.vertex.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointRasterizer.vert.spv"));
-    pointBuckets.countShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointBucketsCount.frag.spv"));
+    pointBuckets.countShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), useSubgroupAtomics ? "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointBucketsCountSubgroup.frag.spv" : "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointBucketsCount.frag.spv"));
     pointBuckets.countShader.program.reset(new legit::ShaderProgram(pointBuckets.countShader.vertex.get(), pointBuckets.countShader.fragment.get()));
 
     pointBuckets.fillShader.vertex.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointRasterizer.vert.spv"));
-    pointBuckets.fillShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointBucketsFill.frag.spv"));
+    pointBuckets.fillShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), useSubgroupAtomics ? "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointBucketsFillSubgroup.frag.spv" : "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointBucketsFill.frag.spv"));
     pointBuckets.fillShader.program.reset(new legit::ShaderProgram(pointBuckets.fillShader.vertex.get(), pointBuckets.fillShader.fragment.get()));
 
     pointBuckets.clearShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ArrayBucketeer/PointBuckets/pointBucketsClear.comp.spv"));
@@ -429,8 +543,22 @@ public:
     bitonicKernelShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ArrayBucketeer/bitonicKernel.comp.spv"));
   }
 private:
+  //pools are sized from counts the gpu reported a few frames ago, so a sudden spike overflows for a frame or two before they catch up
+  void UpdatePoolSizes()
+  {
+    auto poolStats = viewportResources->GetPoolStats();
+    if (viewportResources->entriesPoolSize.Update(poolStats.lastRequiredEntriesCount))
+      viewportResources->bucketEntriesPoolProxy = core->GetRenderGraph()->AddBuffer<BucketEntry>(uint32_t(viewportResources->entriesPoolSize.size));
+    if (viewportResources->groupEntriesPoolSize.Update(viewportResources->occupiedBuckets->GetOccupiedBucketsCount()))
+      viewportResources->groupEntriesPoolProxy = core->GetRenderGraph()->AddBuffer<uint32_t>(uint32_t(viewportResources->groupEntriesPoolSize.size));
+  }
 
 
+  std::string GetPassName(const char *passName)
+  {
+    return profilerTag.empty() ? std::string(passName) : std::string(passName) + " " + profilerTag;
+  }
+
   const static uint32_t ShaderDataSetIndex = 0;
   const static uint32_t DrawCallDataSetIndex = 1;
 
@@ -443,10 +571,58 @@ private:
     size_t pointsCount;
   };
   std::unique_ptr<SceneResources> sceneResources;
+  size_t bucketedPointsCount = 0;
+  bool useSubgroupAtomics;
+  std::string profilerTag;
+
+  //grows with some headroom as soon as the demand does not fit, shrinks only after the demand stayed under a quarter of the pool for a while
+  struct PoolSize
+  {
+    PoolSize(size_t initialSize = 0, size_t maxSize = 0)
+    {
+      this->maxSize = maxSize;
+      this->size = std::min(std::max(initialSize, size_t(MinSize)), maxSize);
+      this->underusedFramesCount = 0;
+    }
+
+    //returns true if the pool has to be reallocated
+    bool Update(size_t requiredSize)
+    {
+      size_t targetSize = std::min(std::max(requiredSize + requiredSize / 2, size_t(MinSize)), maxSize);
+      if (requiredSize * 4 < size)
+        underusedFramesCount++;
+      else
+        underusedFramesCount = 0;
+
+      if ((requiredSize > size || underusedFramesCount > ShrinkFramesCount) && targetSize != size)
+      {
+        size = targetSize;
+        underusedFramesCount = 0;
+        return true;
+      }
+      return false;
+    }
+
+    const static size_t MinSize = 1024;
+    const static size_t ShrinkFramesCount = 120;
+    size_t size;
+    size_t maxSize;
+    size_t underusedFramesCount;
+  };
+
+  #pragma pack(push, 1)
+  struct PoolStats
+  {
+    glm::uint lastRequiredEntriesCount;
+    glm::uint overflowedBucketsCount;
+    glm::uint lastOverflowedBucketsCount;
+    glm::uint padding;
+  };
+  #pragma pack(pop)
 
   struct ViewportResources
   {
-    ViewportResources(legit::Core *core, glm::uvec2 viewportSize, size_t pointsCount)
+    ViewportResources(legit::Core *core, glm::uvec2 viewportSize, size_t pointsCount, size_t maxMipsCount)
     {
       this->viewportSize = viewportSize;
       this->mipsCount = 0;
@@ -454,12 +630,13 @@ private:
       std::vector<MipInfo> mipInfosData;
       for (
         glm::uvec2 currMipSize = viewportSize;
-        currMipSize.x > 0 && currMipSize.y > 0;
+        currMipSize.x > 0 && currMipSize.y > 0 && mipsCount < maxMipsCount;
         currMipSize.x /= 2, currMipSize.y /= 2)
       {
         MipInfo mipInfo;
         mipInfo.size = glm::ivec4(currMipSize.x, currMipSize.y, 0, 0);
         mipInfo.bucketIndexOffset = glm::uint(totalBucketsCount);
+        mipInfo.indexPoolDataOffset = 0;
         mipInfosData.push_back(mipInfo);
 
         totalBucketsCount += currMipSize.x * currMipSize.y;
@@ -471,12 +648,30 @@ private:
 
       this->bucketGroupsCount = 50;
       this->bucketGroupsProxy = core->GetRenderGraph()->AddBuffer<BucketGroup>(uint32_t(bucketGroupsCount));
-      this->groupEntriesPoolProxy = core->GetRenderGraph()->AddBuffer<uint32_t>(uint32_t(totalBucketsCount));
+      this->groupEntriesPoolSize = PoolSize(totalBucketsCount, totalBucketsCount);
+      this->groupEntriesPoolProxy = core->GetRenderGraph()->AddBuffer<uint32_t>(uint32_t(groupEntriesPoolSize.size));
 
+      //every point goes to one bucket and every occupied bucket has a terminator, so the pool starts there and gets right-sized from the reported demand
       this->maxIndicesCount = pointsCount * 4 + totalBucketsCount;
+      this->entriesPoolSize = PoolSize(pointsCount + totalBucketsCount, maxIndicesCount);
       this->bucketsProxy = core->GetRenderGraph()->AddBuffer<Bucket>(uint32_t(totalBucketsCount));
-      this->bucketEntriesPoolProxy = core->GetRenderGraph()->AddBuffer<BucketEntry>(uint32_t(maxIndicesCount));
+      this->bucketEntriesPoolProxy = core->GetRenderGraph()->AddBuffer<BucketEntry>(uint32_t(entriesPoolSize.size));
       this->mipInfosProxy = core->GetRenderGraph()->AddExternalBuffer(mipInfosBuffer.get());
+      this->occupiedBuckets.reset(new OccupiedBuckets(core, totalBucketsCount));
+
+      poolStatsBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(PoolStats), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+      PoolStats initialPoolStats = {};
+      memcpy(poolStatsBuffer->Map(), &initialPoolStats, sizeof(PoolStats));
+      poolStatsBuffer->Unmap();
+      this->poolStatsProxy = core->GetRenderGraph()->AddExternalBuffer(poolStatsBuffer.get());
+    }
+
+    PoolStats GetPoolStats()
+    {
+      PoolStats poolStats;
+      memcpy(&poolStats, poolStatsBuffer->Map(), sizeof(PoolStats));
+      poolStatsBuffer->Unmap();
+      return poolStats;
     }
 
     //UnmippedProxy tmpBucketTexture;
@@ -489,6 +684,12 @@ private:
 
     legit::RenderGraph::BufferProxyUnique bucketGroupsProxy;
     legit::RenderGraph::BufferProxyUnique groupEntriesPoolProxy;
+    std::unique_ptr<OccupiedBuckets> occupiedBuckets;
+
+    legit::RenderGraph::BufferProxyUnique poolStatsProxy;
+    std::unique_ptr<legit::Buffer> poolStatsBuffer;
+    PoolSize entriesPoolSize;
+    PoolSize groupEntriesPoolSize;
 
     size_t totalBucketsCount;
     size_t mipsCount;
@@ -515,6 +716,8 @@ private:
     glm::uint isFirstBlock;
 
     float time;
+    glm::uint entriesPoolSize;
+    glm::uint groupEntriesPoolSize;
   };
   #pragma pack(pop)
 
@@ -523,7 +726,8 @@ private:
   {
     glm::ivec4 size;
     glm::uint bucketIndexOffset;
-    float padding[3];
+    glm::uint indexPoolDataOffset;
+    float padding[2];
   };
   #pragma pack(pop)
 
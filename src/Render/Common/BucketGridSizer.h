@@ -0,0 +1,287 @@
+#pragma once
+//chooses bucket grid sizes and mips counts for a set of bucketeers from point density, gpu time spent on bucketing and memory budget.
+//density is the number of points the renderer reports it buckets into a grid, gpu time is measured per grid from pass names
+class BucketGridSizer
+{
+public:
+  struct GridConfig
+  {
+    glm::uvec2 size;
+    size_t mipsCount;
+
+    bool operator == (const GridConfig &other) const
+    {
+      return size == other.size && mipsCount == other.mipsCount;
+    }
+    bool operator != (const GridConfig &other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+  struct GridDesc
+  {
+    std::string name;
+    GridConfig fixedConfig; //used when auto sizing is off
+    glm::uvec2 minSize;
+    glm::uvec2 maxSize;
+    size_t maxMipsCount;
+    float coverage; //fraction of all points that is expected to land in this grid until SetVisiblePointsCount reports it
+    float aspect; //width / height
+    size_t bytesPerBucket;
+    std::string profilerTag; //has to match SetProfilerTag of the grid's bucketeers, no spaces
+  };
+
+  BucketGridSizer()
+  {
+    autoSize = false;
+    targetPointsPerBucket = 4.0f;
+    gpuTimeBudgetMs = 2.0f;
+    memoryBudgetMb = 64;
+    switchDelayFrames = 30;
+
+    pointsCount = 0;
+  }
+
+  size_t AddGrid(GridDesc desc)
+  {
+    Grid grid;
+    grid.desc = desc;
+    grid.config = desc.fixedConfig;
+    grid.pendingConfig = desc.fixedConfig;
+    grid.pendingFramesCount = 0;
+    grid.visiblePointsCount = -1.0f;
+    grid.resolutionScale = 1.0f;
+    grid.bucketingTimeMs = -1.0f;
+    grids.push_back(grid);
+    return grids.size() - 1;
+  }
+
+  void SetPointsCount(size_t pointsCount)
+  {
+    this->pointsCount = pointsCount;
+  }
+
+  //points that actually get bucketed into the grid this frame, after culling and lod selection. smoothed because it follows the camera
+  void SetVisiblePointsCount(size_t gridIndex, size_t visiblePointsCount)
+  {
+    auto &grid = grids[gridIndex];
+    grid.visiblePointsCount = grid.visiblePointsCount < 0.0f ? float(visiblePointsCount) : glm::mix(grid.visiblePointsCount, float(visiblePointsCount), 0.1f);
+  }
+
+  void SetFixedConfig(size_t gridIndex, GridConfig fixedConfig)
+  {
+    grids[gridIndex].desc.fixedConfig = fixedConfig;
+  }
+
+  void SetAspect(size_t gridIndex, float aspect)
+  {
+    grids[gridIndex].desc.aspect = aspect;
+  }
+
+  GridConfig GetConfig(size_t gridIndex) const
+  {
+    return grids[gridIndex].config;
+  }
+
+  //sums up gpu time of bucketing passes of the last finished frame per grid, passes are attributed by the tag after the last space
+  void ProcessProfilerData(const legit::ProfilerTask *tasks, size_t tasksCount)
+  {
+    std::vector<double> gridTimes(grids.size(), 0.0);
+    std::vector<bool> found(grids.size(), false);
+    for (size_t taskIndex = 0; taskIndex < tasksCount; taskIndex++)
+    {
+      const auto &task = tasks[taskIndex];
+      if (!(task.name.compare(0, 7, "PassBcr") == 0 || task.name.compare(0, 8, "PassBlck") == 0 || task.name.compare(0, 7, "PassGrp") == 0 || task.name.compare(0, 16, "PassCompactLists") == 0))
+        continue;
+      size_t tagPos = task.name.rfind(' ');
+      std::string tag = tagPos == std::string::npos ? std::string() : task.name.substr(tagPos + 1);
+      for (size_t gridIndex = 0; gridIndex < grids.size(); gridIndex++)
+      {
+        if (grids[gridIndex].desc.profilerTag != tag)
+          continue;
+        gridTimes[gridIndex] += task.endTime - task.startTime;
+        found[gridIndex] = true;
+      }
+    }
+    for (size_t gridIndex = 0; gridIndex < grids.size(); gridIndex++)
+    {
+      if (!found[gridIndex])
+        continue;
+      auto &grid = grids[gridIndex];
+      float frameTimeMs = float(gridTimes[gridIndex] * 1e3);
+      grid.bucketingTimeMs = grid.bucketingTimeMs < 0.0f ? frameTimeMs : glm::mix(grid.bucketingTimeMs, frameTimeMs, 0.1f);
+    }
+  }
+
+  //returns true if any of the grids has changed its config and needs its resources recreated
+  bool Update()
+  {
+    //over budget only the grid that takes longest gets coarser, under budget all measured grids get finer
+    float bucketingTimeMs = GetBucketingTimeMs();
+    if (autoSize && bucketingTimeMs > 0.0f)
+    {
+      size_t slowestIndex = 0;
+      for (size_t gridIndex = 0; gridIndex < grids.size(); gridIndex++)
+      {
+        if (grids[gridIndex].bucketingTimeMs > grids[slowestIndex].bucketingTimeMs)
+          slowestIndex = gridIndex;
+      }
+      if (bucketingTimeMs > gpuTimeBudgetMs * 1.1f)
+        grids[slowestIndex].resolutionScale *= 0.98f;
+      for (auto &grid : grids)
+      {
+        if (bucketingTimeMs < gpuTimeBudgetMs * 0.7f && grid.bucketingTimeMs > 0.0f)
+          grid.resolutionScale *= 1.02f;
+        grid.resolutionScale = glm::clamp(grid.resolutionScale, 0.125f, 4.0f);
+      }
+    }
+
+    std::vector<GridConfig> desiredConfigs;
+    for (auto &grid : grids)
+      desiredConfigs.push_back(autoSize ? GetDesiredConfig(grid) : grid.desc.fixedConfig);
+
+    if (autoSize)
+      FitMemoryBudget(desiredConfigs);
+
+    bool changed = false;
+    for (size_t gridIndex = 0; gridIndex < grids.size(); gridIndex++)
+    {
+      auto &grid = grids[gridIndex];
+      GridConfig desiredConfig = desiredConfigs[gridIndex];
+      if (desiredConfig == grid.config)
+      {
+        grid.pendingFramesCount = 0;
+        continue;
+      }
+      if (desiredConfig != grid.pendingConfig)
+      {
+        grid.pendingConfig = desiredConfig;
+        grid.pendingFramesCount = 0;
+      }
+      grid.pendingFramesCount++;
+      //switching back to fixed sizes is immediate, auto sizes have to be stable for a while to avoid thrashing
+      if (!autoSize || grid.pendingFramesCount >= switchDelayFrames)
+      {
+        grid.config = grid.pendingConfig;
+        grid.pendingFramesCount = 0;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  void RenderUI()
+  {
+    ImGui::Checkbox("Auto bucket grids", &autoSize);
+    if (autoSize)
+    {
+      ImGui::SliderFloat("Points per bucket", &targetPointsPerBucket, 0.5f, 32.0f);
+      ImGui::SliderFloat("Bucketing budget, ms", &gpuTimeBudgetMs, 0.1f, 16.0f);
+      ImGui::SliderInt("Buckets memory, mb", &memoryBudgetMb, 4, 1024);
+    }
+    ImGui::Text("Bucketing: %.2fms", GetBucketingTimeMs());
+    size_t totalBytes = 0;
+    for (auto &grid : grids)
+    {
+      size_t bytes = GetTotalBucketsCount(grid.config) * grid.desc.bytesPerBucket;
+      totalBytes += bytes;
+      ImGui::Text("%s: %dx%d, %d mips, %.1fmb, %.2fms, scale %.2f", grid.desc.name.c_str(), int(grid.config.size.x), int(grid.config.size.y), int(grid.config.mipsCount), float(bytes) / float(1 << 20), std::max(grid.bucketingTimeMs, 0.0f), grid.resolutionScale);
+    }
+    ImGui::Text("Total: %.1fmb", float(totalBytes) / float(1 << 20));
+  }
+
+  static size_t GetTotalBucketsCount(GridConfig config)
+  {
+    size_t totalBucketsCount = 0;
+    size_t mipsCount = 0;
+    for (
+      glm::uvec2 currMipSize = config.size;
+      currMipSize.x > 0 && currMipSize.y > 0 && mipsCount < config.mipsCount;
+      currMipSize.x /= 2, currMipSize.y /= 2)
+    {
+      totalBucketsCount += currMipSize.x * currMipSize.y;
+      mipsCount++;
+    }
+    return totalBucketsCount;
+  }
+private:
+  struct Grid
+  {
+    GridDesc desc;
+    GridConfig config;
+    GridConfig pendingConfig;
+    int pendingFramesCount;
+    float visiblePointsCount; //negative until reported
+    float resolutionScale;
+    float bucketingTimeMs; //negative until measured
+  };
+
+  static glm::uint RoundToPow2(float val)
+  {
+    return 1u << glm::uint(std::max(0.0f, std::round(std::log2(std::max(val, 1.0f)))));
+  }
+
+  //-1 if none of the grids has been measured yet
+  float GetBucketingTimeMs() const
+  {
+    float bucketingTimeMs = -1.0f;
+    for (auto &grid : grids)
+    {
+      if (grid.bucketingTimeMs > 0.0f)
+        bucketingTimeMs = std::max(bucketingTimeMs, 0.0f) + grid.bucketingTimeMs;
+    }
+    return bucketingTimeMs;
+  }
+
+  GridConfig GetDesiredConfig(const Grid &grid) const
+  {
+    const GridDesc &desc = grid.desc;
+    float gridPointsCount = grid.visiblePointsCount >= 0.0f ? grid.visiblePointsCount : float(pointsCount) * desc.coverage;
+    float bucketsCount = gridPointsCount / targetPointsPerBucket * grid.resolutionScale * grid.resolutionScale;
+    float height = std::sqrt(bucketsCount / desc.aspect);
+    float width = height * desc.aspect;
+
+    GridConfig config;
+    config.size = glm::clamp(glm::uvec2(RoundToPow2(width), RoundToPow2(height)), desc.minSize, desc.maxSize);
+    config.mipsCount = std::min<size_t>(desc.maxMipsCount, GetMaxPow(std::min(config.size.x, config.size.y)) + 1);
+    return config;
+  }
+
+  void FitMemoryBudget(std::vector<GridConfig> &configs) const
+  {
+    size_t budgetBytes = size_t(memoryBudgetMb) << 20;
+    while (true)
+    {
+      size_t totalBytes = 0;
+      size_t largestIndex = size_t(-1);
+      size_t largestBytes = 0;
+      for (size_t gridIndex = 0; gridIndex < grids.size(); gridIndex++)
+      {
+        size_t bytes = GetTotalBucketsCount(configs[gridIndex]) * grids[gridIndex].desc.bytesPerBucket;
+        totalBytes += bytes;
+        bool canShrink = glm::all(glm::greaterThan(configs[gridIndex].size, grids[gridIndex].desc.minSize));
+        if (canShrink && bytes > largestBytes)
+        {
+          largestBytes = bytes;
+          largestIndex = gridIndex;
+        }
+      }
+      if (totalBytes <= budgetBytes || largestIndex == size_t(-1))
+        break;
+      auto &config = configs[largestIndex];
+      config.size = glm::max(config.size / 2u, grids[largestIndex].desc.minSize);
+      config.mipsCount = std::min<size_t>(grids[largestIndex].desc.maxMipsCount, GetMaxPow(std::min(config.size.x, config.size.y)) + 1);
+    }
+  }
+
+  std::vector<Grid> grids;
+
+  bool autoSize;
+  float targetPointsPerBucket;
+  float gpuTimeBudgetMs;
+  int memoryBudgetMb;
+  int switchDelayFrames;
+
+  size_t pointsCount;
+};
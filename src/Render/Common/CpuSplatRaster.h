@@ -0,0 +1,224 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+//cpu reference of PointSplatRasterizer. every splat covers the pixels whose centers are within its projected radius plus the pixel
+//of its center, so a zero radius gives one pixel points. the closest splat wins, ties in depth go to the lower point index.
+//RasterizePacked is the straightforward 64 bit atomic min of packed depth and index, RasterizeTiled mirrors what the shaders do
+//with 32 bit atomics only and splats wider than a tile binned into per-tile lists. both have to agree
+namespace CpuSplatRaster
+{
+  const uint32_t EmptyDepth = 0xffffffff;
+  const uint32_t EmptyIndex = 0xffffffff;
+  const uint32_t TileSize = 16; //SPLAT_TILE_SIZE in splatData.decl
+
+  struct Footprint
+  {
+    glm::vec2 center; //in pixels
+    float pixelRadius;
+    uint32_t depthBits;
+    glm::uvec2 centerPixel;
+    glm::uvec2 minPixel; //bounds of covered pixels, inclusive
+    glm::uvec2 maxPixel;
+  };
+
+  //world radius times this over clip w is the radius in pixels. radiusScale of 0 rasterizes every point into one pixel.
+  //projection matrices of renderers flip y, hence the abs
+  inline float GetPixelRadiusScale(const glm::mat4 &projMatrix, glm::uvec2 size, float radiusScale)
+  {
+    return radiusScale * std::abs(projMatrix[1][1]) * 0.5f * float(size.y);
+  }
+
+  inline glm::uvec2 GetTilesCount(glm::uvec2 size)
+  {
+    return (size + glm::uvec2(TileSize - 1)) / TileSize;
+  }
+
+  //same math as ProjectSplat of splatData.decl. splats are culled by their center, depth is in [0, 1) so its bits sort the same way as the floats
+  inline bool ProjectSplat(const glm::mat4 &viewProjMatrix, glm::vec4 worldPosRadius, float pixelRadiusScale, glm::uvec2 size, Footprint &footprint)
+  {
+    glm::vec4 clipPos = viewProjMatrix * glm::vec4(glm::vec3(worldPosRadius), 1.0f);
+    if (clipPos.w <= 0.0f)
+      return false;
+    glm::vec3 ndcPos = glm::vec3(clipPos) / clipPos.w;
+    if (glm::any(glm::lessThan(ndcPos, glm::vec3(-1.0f, -1.0f, 0.0f))) || glm::any(glm::greaterThanEqual(ndcPos, glm::vec3(1.0f))))
+      return false;
+    footprint.center = (glm::vec2(ndcPos) * 0.5f + glm::vec2(0.5f)) * glm::vec2(size);
+    footprint.centerPixel = glm::min(glm::uvec2(footprint.center), size - glm::uvec2(1));
+    footprint.pixelRadius = worldPosRadius.w * pixelRadiusScale / clipPos.w;
+    memcpy(&footprint.depthBits, &ndcPos.z, sizeof(footprint.depthBits));
+    glm::vec2 minCorner = glm::max(glm::floor(footprint.center - glm::vec2(footprint.pixelRadius)), glm::vec2(0.0f));
+    glm::vec2 maxCorner = glm::min(glm::floor(footprint.center + glm::vec2(footprint.pixelRadius)), glm::vec2(size - glm::uvec2(1)));
+    footprint.minPixel = glm::min(glm::uvec2(minCorner), footprint.centerPixel);
+    footprint.maxPixel = glm::max(glm::uvec2(maxCorner), footprint.centerPixel);
+    return true;
+  }
+
+  inline bool IsPixelCovered(const Footprint &footprint, glm::uvec2 pixelCoord)
+  {
+    glm::vec2 offset = glm::vec2(pixelCoord) + glm::vec2(0.5f) - footprint.center;
+    return pixelCoord == footprint.centerPixel || glm::dot(offset, offset) <= footprint.pixelRadius * footprint.pixelRadius;
+  }
+
+  //splats wider than a tile go to per-tile lists instead of being rasterized by one thread
+  inline bool IsTileBinned(const Footprint &footprint)
+  {
+    return glm::any(glm::greaterThan(footprint.maxPixel - footprint.minPixel, glm::uvec2(TileSize - 1)));
+  }
+
+  template<typename PixelFunc>
+  void ForEachCoveredPixel(const Footprint &footprint, glm::uvec2 minPixel, glm::uvec2 maxPixel, glm::uvec2 size, PixelFunc pixelFunc)
+  {
+    for (glm::uint y = minPixel.y; y <= maxPixel.y; y++)
+    {
+      for (glm::uint x = minPixel.x; x <= maxPixel.x; x++)
+      {
+        if (IsPixelCovered(footprint, glm::uvec2(x, y)))
+          pixelFunc(x + size_t(y) * size.x);
+      }
+    }
+  }
+
+  //index of the closest point per pixel, 0 for empty pixels same as the resolve pass
+  inline std::vector<uint32_t> RasterizePacked(const glm::vec4 *worldPosRadii, size_t pointsCount, const glm::mat4 &viewProjMatrix, float pixelRadiusScale, glm::uvec2 size)
+  {
+    const uint64_t emptyDepthIndex = 0xffffffffffffffffull;
+    std::vector<uint64_t> depthIndices(size_t(size.x) * size.y, emptyDepthIndex);
+    for (size_t pointIndex = 0; pointIndex < pointsCount; pointIndex++)
+    {
+      Footprint footprint;
+      if (!ProjectSplat(viewProjMatrix, worldPosRadii[pointIndex], pixelRadiusScale, size, footprint))
+        continue;
+      uint64_t depthIndex = (uint64_t(footprint.depthBits) << 32) | uint64_t(pointIndex);
+      ForEachCoveredPixel(footprint, footprint.minPixel, footprint.maxPixel, size, [&](size_t pixelIndex)
+      {
+        depthIndices[pixelIndex] = std::min(depthIndices[pixelIndex], depthIndex);
+      });
+    }
+
+    std::vector<uint32_t> pointIndices(depthIndices.size());
+    for (size_t pixelIndex = 0; pixelIndex < depthIndices.size(); pixelIndex++)
+      pointIndices[pixelIndex] = depthIndices[pixelIndex] == emptyDepthIndex ? 0 : uint32_t(depthIndices[pixelIndex] & 0xffffffff);
+    return pointIndices;
+  }
+
+  //splatClear, splatDepth, splatTileDepth, splatIndex, splatTileIndex and splatResolve in order. once maxTileEntriesCount tile entries
+  //are taken, binned splats rasterize their remaining tiles by themselves and every binned splat does so in the index phase as well
+  inline std::vector<uint32_t> RasterizeTiled(const glm::vec4 *worldPosRadii, size_t pointsCount, const glm::mat4 &viewProjMatrix, float pixelRadiusScale, glm::uvec2 size, size_t maxTileEntriesCount)
+  {
+    struct TileEntry
+    {
+      uint32_t pointIndex;
+      uint32_t nextEntryIndex;
+    };
+    size_t pixelsCount = size_t(size.x) * size.y;
+    glm::uvec2 tilesCount = GetTilesCount(size);
+    std::vector<uint32_t> depths(pixelsCount, EmptyDepth);
+    std::vector<uint32_t> indices(pixelsCount, EmptyIndex);
+    std::vector<uint32_t> tileHeads(size_t(tilesCount.x) * tilesCount.y, EmptyIndex);
+    std::vector<TileEntry> tileEntries(maxTileEntriesCount);
+    size_t entriesCount = 0;
+
+    for (size_t pointIndex = 0; pointIndex < pointsCount; pointIndex++)
+    {
+      Footprint footprint;
+      if (!ProjectSplat(viewProjMatrix, worldPosRadii[pointIndex], pixelRadiusScale, size, footprint))
+        continue;
+      auto writeDepth = [&](size_t pixelIndex) { depths[pixelIndex] = std::min(depths[pixelIndex], footprint.depthBits); };
+      if (!IsTileBinned(footprint))
+      {
+        ForEachCoveredPixel(footprint, footprint.minPixel, footprint.maxPixel, size, writeDepth);
+        continue;
+      }
+      for (glm::uint tileY = footprint.minPixel.y / TileSize; tileY <= footprint.maxPixel.y / TileSize; tileY++)
+      {
+        for (glm::uint tileX = footprint.minPixel.x / TileSize; tileX <= footprint.maxPixel.x / TileSize; tileX++)
+        {
+          size_t entryIndex = entriesCount++;
+          size_t tileIndex = tileX + size_t(tileY) * tilesCount.x;
+          if (entryIndex < maxTileEntriesCount)
+          {
+            tileEntries[entryIndex] = { uint32_t(pointIndex), tileHeads[tileIndex] };
+            tileHeads[tileIndex] = uint32_t(entryIndex);
+          }
+          else
+          {
+            glm::uvec2 tileMin = glm::max(glm::uvec2(tileX, tileY) * TileSize, footprint.minPixel);
+            glm::uvec2 tileMax = glm::min(glm::uvec2(tileX, tileY) * TileSize + glm::uvec2(TileSize - 1), footprint.maxPixel);
+            ForEachCoveredPixel(footprint, tileMin, tileMax, size, writeDepth);
+          }
+        }
+      }
+    }
+
+    //one workgroup per tile, one thread per pixel goes over the whole list of the tile
+    auto forEachTilePixel = [&](auto pixelFunc)
+    {
+      for (glm::uint y = 0; y < size.y; y++)
+      {
+        for (glm::uint x = 0; x < size.x; x++)
+          pixelFunc(glm::uvec2(x, y), x + size_t(y) * size.x, tileHeads[x / TileSize + size_t(y / TileSize) * tilesCount.x]);
+      }
+    };
+    forEachTilePixel([&](glm::uvec2 pixelCoord, size_t pixelIndex, uint32_t headEntryIndex)
+    {
+      for (uint32_t entryIndex = headEntryIndex; entryIndex != EmptyIndex; entryIndex = tileEntries[entryIndex].nextEntryIndex)
+      {
+        Footprint footprint;
+        if (ProjectSplat(viewProjMatrix, worldPosRadii[tileEntries[entryIndex].pointIndex], pixelRadiusScale, size, footprint) && IsPixelCovered(footprint, pixelCoord))
+          depths[pixelIndex] = std::min(depths[pixelIndex], footprint.depthBits);
+      }
+    });
+
+    bool isOverflown = entriesCount > maxTileEntriesCount;
+    for (size_t pointIndex = 0; pointIndex < pointsCount; pointIndex++)
+    {
+      Footprint footprint;
+      if (!ProjectSplat(viewProjMatrix, worldPosRadii[pointIndex], pixelRadiusScale, size, footprint) || (IsTileBinned(footprint) && !isOverflown))
+        continue;
+      ForEachCoveredPixel(footprint, footprint.minPixel, footprint.maxPixel, size, [&](size_t pixelIndex)
+      {
+        if (footprint.depthBits == depths[pixelIndex])
+          indices[pixelIndex] = std::min(indices[pixelIndex], uint32_t(pointIndex));
+      });
+    }
+
+    forEachTilePixel([&](glm::uvec2 pixelCoord, size_t pixelIndex, uint32_t headEntryIndex)
+    {
+      for (uint32_t entryIndex = headEntryIndex; entryIndex != EmptyIndex; entryIndex = tileEntries[entryIndex].nextEntryIndex)
+      {
+        Footprint footprint;
+        uint32_t pointIndex = tileEntries[entryIndex].pointIndex;
+        if (ProjectSplat(viewProjMatrix, worldPosRadii[pointIndex], pixelRadiusScale, size, footprint) && IsPixelCovered(footprint, pixelCoord) && footprint.depthBits == depths[pixelIndex])
+          indices[pixelIndex] = std::min(indices[pixelIndex], pointIndex);
+      }
+    });
+
+    for (auto &index : indices)
+      index = index == EmptyIndex ? 0 : index;
+    return indices;
+  }
+
+  //points in [-1, 1]^3 with mostly small radii and a few splats several tiles wide. a quarter of the points repeat earlier ones
+  //at random later indices, so depth ties have to resolve to the lower index
+  inline std::vector<glm::vec4> GenerateTestSplats(size_t pointsCount, std::default_random_engine &eng)
+  {
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> smallRadiusDis(0.0005f, 0.01f);
+    std::uniform_real_distribution<float> largeRadiusDis(0.05f, 0.3f);
+    std::vector<glm::vec4> worldPosRadii(pointsCount);
+    for (size_t pointIndex = 0; pointIndex < pointsCount; pointIndex++)
+    {
+      if (pointIndex > 0 && pointIndex % 4 == 3)
+        worldPosRadii[pointIndex] = worldPosRadii[std::uniform_int_distribution<size_t>(0, pointIndex - 1)(eng)];
+      else
+        worldPosRadii[pointIndex] = glm::vec4(dis(eng), dis(eng), dis(eng), pointIndex % 1024 == 0 ? largeRadiusDis(eng) : smallRadiusDis(eng));
+    }
+    return worldPosRadii;
+  }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+//keeps list bucketings of the whole cloud along a fixed set of directions so that gi casting can reuse them instead of rebucketing along a new random direction every frame
+class DirectionalBucketCache
+{
+public:
+  DirectionalBucketCache(legit::Core *_core)
+  {
+    this->core = _core;
+    this->nextCastIndex = 0;
+    this->nextRefreshIndex = 0;
+    this->isInvalidatedSinceUpdate = false;
+    this->wasInvalidatedBeforeLastUpdate = false;
+  }
+
+  struct CastInfo
+  {
+    size_t directionIndex;
+    glm::mat4 viewMatrix;
+    ListBucketeer::BucketBuffers bucketBuffers;
+  };
+
+  void Recreate(size_t directionsCount, glm::uvec2 gridSize, size_t mipsCount, size_t pointsCount)
+  {
+    directions.clear();
+    for (size_t directionIndex = 0; directionIndex < directionsCount; directionIndex++)
+    {
+      Direction direction;
+      direction.viewMatrix = glm::inverse(GetFibonacciDirection(directionIndex, directionsCount).GetTransformMatrix());
+      direction.bucketeer.reset(new ListBucketeer(core, true));
+      direction.bucketeer->SetProfilerTag(profilerTag);
+      direction.bucketeer->RecreateSwapchainResources(gridSize, 1, mipsCount);
+      direction.bucketeer->RecreateSceneResources(pointsCount);
+      direction.isDirty = true;
+      directions.push_back(std::move(direction));
+    }
+    nextCastIndex = 0;
+    nextRefreshIndex = 0;
+  }
+
+  //applied to bucketeers of all directions, takes effect on next Recreate
+  void SetProfilerTag(std::string profilerTag)
+  {
+    this->profilerTag = profilerTag;
+  }
+
+  //call when point positions or the set of bucketed points change
+  void Invalidate()
+  {
+    for (auto &direction : directions)
+      direction.isDirty = true;
+    isInvalidatedSinceUpdate = true;
+  }
+
+  size_t GetDirectionsCount()
+  {
+    return directions.size();
+  }
+
+  using BucketFunc = std::function<void(ListBucketeer &bucketeer, glm::mat4 viewMatrix)>;
+  //picks the next direction to cast along and rebuckets it if it's dirty, then refreshes up to refreshesCount more dirty directions round robin.
+  //when the cache is invalidated every frame, refreshed directions would go stale before being cast along, so only the cast one gets bucketed
+  CastInfo Update(size_t refreshesCount, BucketFunc bucketFunc)
+  {
+    assert(directions.size() > 0);
+    size_t castIndex = nextCastIndex;
+    nextCastIndex = (nextCastIndex + 1) % directions.size();
+    bool isInvalidatedEveryFrame = isInvalidatedSinceUpdate && wasInvalidatedBeforeLastUpdate;
+    wasInvalidatedBeforeLastUpdate = isInvalidatedSinceUpdate;
+    isInvalidatedSinceUpdate = false;
+
+    auto Refresh = [&](size_t directionIndex)
+    {
+      auto &direction = directions[directionIndex];
+      bucketFunc(*direction.bucketeer, direction.viewMatrix);
+      direction.isDirty = false;
+    };
+
+    if (directions[castIndex].isDirty)
+      Refresh(castIndex);
+    size_t refreshedCount = 0;
+    for (size_t stepNumber = 0; stepNumber < directions.size() && refreshedCount < refreshesCount && !isInvalidatedEveryFrame; stepNumber++)
+    {
+      size_t refreshIndex = nextRefreshIndex;
+      nextRefreshIndex = (nextRefreshIndex + 1) % directions.size();
+      if (refreshIndex != castIndex && directions[refreshIndex].isDirty)
+      {
+        Refresh(refreshIndex);
+        refreshedCount++;
+      }
+    }
+
+    CastInfo res;
+    res.directionIndex = castIndex;
+    res.viewMatrix = directions[castIndex].viewMatrix;
+    res.bucketBuffers = directions[castIndex].bucketeer->GetBucketBuffers();
+    return res;
+  }
+
+  //spherical fibonacci points, same parametrization as uniformly distributed random bucketing directions
+  static Camera GetFibonacciDirection(size_t directionIndex, size_t directionsCount)
+  {
+    const float goldenAngle = 3.1415f * (3.0f - std::sqrt(5.0f));
+    Camera res;
+    res.horAngle = std::fmod(goldenAngle * float(directionIndex), 2.0f * 3.1415f);
+    res.vertAngle = asin(1.0f - (2.0f * float(directionIndex) + 1.0f) / float(directionsCount));
+    return res;
+  }
+private:
+  struct Direction
+  {
+    glm::mat4 viewMatrix;
+    std::unique_ptr<ListBucketeer> bucketeer;
+    bool isDirty;
+  };
+  std::vector<Direction> directions;
+  size_t nextCastIndex;
+  size_t nextRefreshIndex;
+  bool isInvalidatedSinceUpdate;
+  bool wasInvalidatedBeforeLastUpdate;
+  std::string profilerTag;
+
+  legit::Core *core;
+};
@@ -0,0 +1,304 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+#include <glm/glm.hpp>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+//cpu version of FFTRenderer::FFT3d for validating its output and for running spectral solvers without a gpu.
+//works on the same data as the gpu volume: WaveFunc voxels (two complex numbers in rgba), x is the fastest axis.
+//axes are transformed in the same x, y, z order and every inverse axis is scaled by 1 / size like ampMult does
+namespace CpuFFT
+{
+  struct Settings
+  {
+    size_t threadsCount = 0; //0 - one per hardware thread
+    bool useSimd = true; //ignored when built without avx
+  };
+
+  //lines are transformed in pairs, so a pack is one voxel of each line: 4 complex numbers in 8 floats
+  struct ScalarPack
+  {
+    float v[8];
+
+    static ScalarPack Load(const float *src)
+    {
+      ScalarPack res;
+      for (int i = 0; i < 8; i++)
+        res.v[i] = src[i];
+      return res;
+    }
+    void Store(float *dst) const
+    {
+      for (int i = 0; i < 8; i++)
+        dst[i] = v[i];
+    }
+    static ScalarPack Add(ScalarPack a, ScalarPack b)
+    {
+      for (int i = 0; i < 8; i++)
+        a.v[i] += b.v[i];
+      return a;
+    }
+    static ScalarPack Sub(ScalarPack a, ScalarPack b)
+    {
+      for (int i = 0; i < 8; i++)
+        a.v[i] -= b.v[i];
+      return a;
+    }
+    static ScalarPack Mul(ScalarPack a, glm::vec2 c)
+    {
+      ScalarPack res;
+      for (int i = 0; i < 8; i += 2)
+      {
+        res.v[i + 0] = a.v[i] * c.x - a.v[i + 1] * c.y;
+        res.v[i + 1] = a.v[i] * c.y + a.v[i + 1] * c.x;
+      }
+      return res;
+    }
+    //multiplies by sign * i
+    static ScalarPack MulI(ScalarPack a, float sign)
+    {
+      ScalarPack res;
+      for (int i = 0; i < 8; i += 2)
+      {
+        res.v[i + 0] = -sign * a.v[i + 1];
+        res.v[i + 1] = sign * a.v[i];
+      }
+      return res;
+    }
+  };
+
+  #if defined(__AVX__)
+  struct AvxPack
+  {
+    __m256 v;
+
+    static AvxPack Load(const float *src)
+    {
+      return { _mm256_loadu_ps(src) };
+    }
+    void Store(float *dst) const
+    {
+      _mm256_storeu_ps(dst, v);
+    }
+    static AvxPack Add(AvxPack a, AvxPack b)
+    {
+      return { _mm256_add_ps(a.v, b.v) };
+    }
+    static AvxPack Sub(AvxPack a, AvxPack b)
+    {
+      return { _mm256_sub_ps(a.v, b.v) };
+    }
+    //(re, im) * c = (re * c.re - im * c.im, im * c.re + re * c.im), addsub subtracts in even lanes and adds in odd ones
+    static AvxPack Mul(AvxPack a, glm::vec2 c)
+    {
+      __m256 swapped = _mm256_permute_ps(a.v, 0xb1);
+      return { _mm256_addsub_ps(_mm256_mul_ps(a.v, _mm256_set1_ps(c.x)), _mm256_mul_ps(swapped, _mm256_set1_ps(c.y))) };
+    }
+    static AvxPack MulI(AvxPack a, float sign)
+    {
+      __m256 swapped = _mm256_permute_ps(a.v, 0xb1);
+      return { _mm256_mul_ps(swapped, _mm256_setr_ps(-sign, sign, -sign, sign, -sign, sign, -sign, sign)) };
+    }
+  };
+  #endif
+
+  const size_t PackSize = 8;
+
+  //exp(-2 pi i k / n), double precision until the very end
+  std::vector<glm::vec2> ComputeTwiddles(size_t n)
+  {
+    std::vector<glm::vec2> twiddles(n);
+    for (size_t k = 0; k < n; k++)
+    {
+      double phase = -2.0 * 3.14159265358979323846 * double(k) / double(n);
+      twiddles[k] = glm::vec2(float(cos(phase)), float(sin(phase)));
+    }
+    return twiddles;
+  }
+
+  inline glm::vec2 GetTwiddle(const glm::vec2 *twiddles, size_t index, float phaseSign)
+  {
+    return glm::vec2(twiddles[index].x, -phaseSign * twiddles[index].y);
+  }
+
+  //same radix-4 stockham steps with a radix-2 tail as stockham.comp, but ping-ponging between two buffers.
+  //returns whichever of them holds the result
+  template<typename Pack>
+  float *TransformLinePair(float *src, float *tmp, size_t n, const glm::vec2 *twiddles, float phaseSign)
+  {
+    size_t ns = 1;
+    for (; ns * 4 <= n; ns *= 4)
+    {
+      size_t quarter = n / 4;
+      size_t twiddleMult = n / (ns * 4);
+      for (size_t j = 0; j < quarter; j++)
+      {
+        size_t k = j % ns;
+        Pack v0 = Pack::Load(src + (j + 0 * quarter) * PackSize);
+        Pack v1 = Pack::Load(src + (j + 1 * quarter) * PackSize);
+        Pack v2 = Pack::Load(src + (j + 2 * quarter) * PackSize);
+        Pack v3 = Pack::Load(src + (j + 3 * quarter) * PackSize);
+        if (k > 0)
+        {
+          v1 = Pack::Mul(v1, GetTwiddle(twiddles, 1 * k * twiddleMult, phaseSign));
+          v2 = Pack::Mul(v2, GetTwiddle(twiddles, 2 * k * twiddleMult, phaseSign));
+          v3 = Pack::Mul(v3, GetTwiddle(twiddles, 3 * k * twiddleMult, phaseSign));
+        }
+        Pack a0 = Pack::Add(v0, v2);
+        Pack a1 = Pack::Sub(v0, v2);
+        Pack a2 = Pack::Add(v1, v3);
+        Pack a3 = Pack::MulI(Pack::Sub(v1, v3), phaseSign);
+
+        size_t dstIndex = (j / ns) * ns * 4 + k;
+        Pack::Add(a0, a2).Store(tmp + (dstIndex + 0 * ns) * PackSize);
+        Pack::Add(a1, a3).Store(tmp + (dstIndex + 1 * ns) * PackSize);
+        Pack::Sub(a0, a2).Store(tmp + (dstIndex + 2 * ns) * PackSize);
+        Pack::Sub(a1, a3).Store(tmp + (dstIndex + 3 * ns) * PackSize);
+      }
+      std::swap(src, tmp);
+    }
+    if (ns < n)
+    {
+      size_t half = n / 2;
+      size_t twiddleMult = n / (ns * 2);
+      for (size_t j = 0; j < half; j++)
+      {
+        size_t k = j % ns;
+        Pack v0 = Pack::Load(src + j * PackSize);
+        Pack v1 = Pack::Mul(Pack::Load(src + (j + half) * PackSize), GetTwiddle(twiddles, k * twiddleMult, phaseSign));
+
+        size_t dstIndex = (j / ns) * ns * 2 + k;
+        Pack::Add(v0, v1).Store(tmp + dstIndex * PackSize);
+        Pack::Sub(v0, v1).Store(tmp + (dstIndex + ns) * PackSize);
+      }
+      std::swap(src, tmp);
+    }
+    return src;
+  }
+
+  //splits [0, count) into one contiguous range per thread
+  template<typename Func>
+  void ParallelFor(size_t count, size_t threadsCount, Func func)
+  {
+    if (threadsCount == 0)
+      threadsCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    threadsCount = std::min(threadsCount, count);
+    if (threadsCount <= 1)
+    {
+      func(size_t(0), count);
+      return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t threadIndex = 0; threadIndex < threadsCount; threadIndex++)
+      threads.emplace_back(func, count * threadIndex / threadsCount, count * (threadIndex + 1) / threadsCount);
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  //every line along the axis gets gathered into a scratch buffer with its pair, transformed there and scattered back
+  void TransformAxis(glm::vec4 *data, glm::ivec3 size, int axis, bool isForward, const Settings &settings)
+  {
+    size_t n = size_t(size[axis]);
+    assert((n & (n - 1)) == 0);
+    glm::ivec3 strides = glm::ivec3(1, size.x, size.x * size.y);
+    int sideAxis0 = (axis + 1) % 3;
+    int sideAxis1 = (axis + 2) % 3;
+    size_t linesCount = size_t(size[sideAxis0]) * size_t(size[sideAxis1]);
+    auto getLineOffset = [&](size_t lineIndex)
+    {
+      return (lineIndex % size_t(size[sideAxis0])) * size_t(strides[sideAxis0]) + (lineIndex / size_t(size[sideAxis0])) * size_t(strides[sideAxis1]);
+    };
+    size_t stride = size_t(strides[axis]);
+    float ampMult = isForward ? 1.0f : (1.0f / float(n));
+    float phaseSign = isForward ? -1.0f : 1.0f;
+    std::vector<glm::vec2> twiddles = ComputeTwiddles(n);
+
+    size_t pairsCount = (linesCount + 1) / 2;
+    ParallelFor(pairsCount, settings.threadsCount, [&](size_t pairBegin, size_t pairEnd)
+    {
+      std::vector<float> scratch(n * PackSize * 2);
+      for (size_t pairIndex = pairBegin; pairIndex < pairEnd; pairIndex++)
+      {
+        //odd lines count leaves the last line without a pair, it's transformed twice and stored once
+        size_t lineOffsets[2] = { getLineOffset(pairIndex * 2), getLineOffset(std::min(pairIndex * 2 + 1, linesCount - 1)) };
+        float *src = scratch.data();
+        for (size_t i = 0; i < n; i++)
+        {
+          for (size_t lineNumber = 0; lineNumber < 2; lineNumber++)
+          {
+            glm::vec4 voxel = data[lineOffsets[lineNumber] + i * stride] * ampMult;
+            for (int c = 0; c < 4; c++)
+              src[i * PackSize + lineNumber * 4 + c] = voxel[c];
+          }
+        }
+
+        float *res;
+        #if defined(__AVX__)
+        if (settings.useSimd)
+          res = TransformLinePair<AvxPack>(src, src + n * PackSize, n, twiddles.data(), phaseSign);
+        else
+        #endif
+          res = TransformLinePair<ScalarPack>(src, src + n * PackSize, n, twiddles.data(), phaseSign);
+
+        size_t linesInPair = (pairIndex * 2 + 1 < linesCount) ? 2 : 1;
+        for (size_t i = 0; i < n; i++)
+        {
+          for (size_t lineNumber = 0; lineNumber < linesInPair; lineNumber++)
+          {
+            const float *voxel = res + i * PackSize + lineNumber * 4;
+            data[lineOffsets[lineNumber] + i * stride] = glm::vec4(voxel[0], voxel[1], voxel[2], voxel[3]);
+          }
+        }
+      }
+    });
+  }
+
+  void FFT3d(glm::vec4 *data, glm::ivec3 size, bool isForward, const Settings &settings = Settings())
+  {
+    for (int axis = 0; axis < 3; axis++)
+    {
+      if (size[axis] > 1)
+        TransformAxis(data, size, axis, isForward, settings);
+    }
+  }
+
+  //O(n^2) per line reference with the same conventions, only usable on small volumes
+  void NaiveDFT3d(glm::vec4 *data, glm::ivec3 size, bool isForward)
+  {
+    glm::ivec3 strides = glm::ivec3(1, size.x, size.x * size.y);
+    size_t totalCount = size_t(size.x) * size_t(size.y) * size_t(size.z);
+    std::vector<glm::dvec4> line;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      size_t n = size_t(size[axis]);
+      double phaseSign = isForward ? -1.0 : 1.0;
+      double ampMult = isForward ? 1.0 : 1.0 / double(n);
+      line.resize(n);
+      for (size_t lineStart = 0; lineStart < totalCount; lineStart++)
+      {
+        glm::ivec3 coord = glm::ivec3(lineStart % size.x, (lineStart / size.x) % size.y, lineStart / (size_t(size.x) * size.y));
+        if (coord[axis] != 0)
+          continue;
+        for (size_t k = 0; k < n; k++)
+        {
+          glm::dvec4 sum = glm::dvec4(0.0);
+          for (size_t t = 0; t < n; t++)
+          {
+            double phase = phaseSign * 2.0 * 3.14159265358979323846 * double((k * t) % n) / double(n);
+            glm::dvec2 c = glm::dvec2(cos(phase), sin(phase));
+            glm::dvec4 v = glm::dvec4(data[lineStart + t * strides[axis]]);
+            sum += glm::dvec4(v.x * c.x - v.y * c.y, v.x * c.y + v.y * c.x, v.z * c.x - v.w * c.y, v.z * c.y + v.w * c.x);
+          }
+          line[k] = sum * ampMult;
+        }
+        for (size_t k = 0; k < n; k++)
+          data[lineStart + k * strides[axis]] = glm::vec4(line[k]);
+      }
+    }
+  }
+}
@@ -1,5 +1,5 @@
 #pragma once
-//#include "FFT.h"
+#include "FFT.h"
 const float pi = 3.141592f;
 glm::int32 idot(glm::ivec3 a, glm::ivec3 b)
 {
@@ -14,6 +14,17 @@ public:
   {
     this->core = _core;
 
+    std::vector<glm::vec2> twiddlesData(MaxSharedTransformSize);
+    for (size_t twiddleIndex = 0; twiddleIndex < twiddlesData.size(); twiddleIndex++)
+    {
+      double phase = -2.0 * 3.14159265358979323846 * double(twiddleIndex) / double(MaxSharedTransformSize);
+      twiddlesData[twiddleIndex] = glm::vec2(float(cos(phase)), float(sin(phase)));
+    }
+    size_t twiddlesSize = sizeof(glm::vec2) * twiddlesData.size();
+    twiddlesBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), twiddlesSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal));
+    legit::LoadBufferData(core, twiddlesData.data(), twiddlesSize, twiddlesBuffer.get());
+    twiddlesProxy = core->GetRenderGraph()->AddExternalBuffer(twiddlesBuffer.get());
+
     ReloadShaders();
   }
 public:
@@ -42,11 +53,89 @@ public:
       glm::ivec3(0, 0, 1) };
     for (size_t phase = 0; phase < 3; phase++)
     {
-      PostProcessPass(memoryPool, volumeProxy, size, axes[phase], isForward);
-      CooleyTukeyPass(memoryPool, volumeProxy, size, axes[phase], isForward);
+      if (idot(size, axes[phase]) <= MaxSharedTransformSize)
+      {
+        StockhamPass(memoryPool, volumeProxy, size, axes[phase], isForward);
+      }
+      else
+      {
+        PostProcessPass(memoryPool, volumeProxy, size, axes[phase], isForward);
+        CooleyTukeyPass(memoryPool, volumeProxy, size, axes[phase], isForward);
+      }
     }
   }
 
+  //whole 1d transforms along the axis in one dispatch, MaxSharedTransformSize / size lines per workgroup. replaces bit reversal and log2(size) butterfly passes
+  void StockhamPass(legit::ShaderMemoryPool *memoryPool, legit::RenderGraph::ImageViewProxyId volumeProxy, glm::ivec3 size, glm::ivec3 transformAxis, bool isForward)
+  {
+    #pragma pack(push, 1)
+    struct ShaderDataBuffer
+    {
+      glm::ivec4 size;
+      glm::ivec4 transformAxis;
+      int transformSize;
+      int twiddleStride;
+      float phaseSign;
+      float ampMult;
+    } shaderDataBuf;
+    #pragma pack(pop)
+
+    int transformSize = idot(size, transformAxis);
+    assert(transformSize <= MaxSharedTransformSize && (transformSize & (transformSize - 1)) == 0);
+    shaderDataBuf.size = glm::ivec4(size, 0);
+    shaderDataBuf.transformAxis = glm::ivec4(transformAxis, 0);
+    shaderDataBuf.transformSize = transformSize;
+    shaderDataBuf.twiddleStride = MaxSharedTransformSize / transformSize;
+    shaderDataBuf.phaseSign = isForward ? -1.0f : 1.0f;
+    shaderDataBuf.ampMult = isForward ? 1.0f : (1.0f / float(transformSize));
+
+    //lines are packed into workgroups in order, the workgroups are laid out in 2d to stay under the dispatch size limit
+    glm::ivec3 linesGridSize = size - (transformSize - 1) * transformAxis;
+    uint32_t linesCount = uint32_t(linesGridSize.x * linesGridSize.y * linesGridSize.z);
+    uint32_t linesPerGroup = uint32_t(MaxSharedTransformSize / transformSize);
+    uint32_t totalGroupsCount = (linesCount + linesPerGroup - 1) / linesPerGroup;
+    glm::uvec2 groupsCount = glm::uvec2(std::min(totalGroupsCount, uint32_t(MaxGroupsCountX)), 0);
+    groupsCount.y = (totalGroupsCount + groupsCount.x - 1) / groupsCount.x;
+    legit::RenderGraph::BufferProxyId twiddlesProxyId = twiddlesProxy->Id();
+
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers({ twiddlesProxyId })
+      .SetStorageImages({ volumeProxy })
+      .SetProfilerInfo(legit::Colors::pumpkin, "PassStockham")
+      .SetRecordFunc([this, memoryPool, groupsCount, shaderDataBuf, volumeProxy, twiddlesProxyId](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = stockhamShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto mappedShaderDataBuf = memoryPool->GetUniformBufferData<ShaderDataBuffer>("ShaderDataBuffer");
+          *mappedShaderDataBuf = shaderDataBuf;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageBufferBinding> storageBufferBindings;
+        auto twiddlesBuffer = passContext.GetBuffer(twiddlesProxyId);
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("TwiddlesBuffer", twiddlesBuffer));
+
+        std::vector<legit::StorageImageBinding> storageImageBindings;
+        auto volumeView = passContext.GetImageView(volumeProxy);
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("dataImage", volumeView));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageBufferBindings(storageBufferBindings)
+          .SetStorageImageBindings(storageImageBindings);
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        passContext.GetCommandBuffer().dispatch(groupsCount.x, groupsCount.y, 1);
+      }
+    }));
+  }
+
   void PostProcessPass(
     legit::ShaderMemoryPool *memoryPool,
     legit::RenderGraph::ImageViewProxyId volumeProxy,
@@ -177,12 +266,17 @@ public:
   {
     postProcessShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/FFT/postProcess.comp.spv"));
     cooleyTukeyShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/FFT/cooleyTukeyPost.comp.spv"));
+    stockhamShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/FFT/stockham.comp.spv"));
   }
 private:
 
 
   const static uint32_t ShaderDataSetIndex = 0;
   const static uint32_t DrawCallDataSetIndex = 1;
+  //has to match MAX_TRANSFORM_SIZE in stockham.comp, lines this long take 16kb of shared memory
+  const static int MaxSharedTransformSize = 1024;
+  //vulkan only guarantees 65535 workgroups per dimension
+  const static uint32_t MaxGroupsCountX = 32768;
   struct PostProcessShader
   {
     std::unique_ptr<legit::Shader> compute;
@@ -193,6 +287,14 @@ private:
     std::unique_ptr<legit::Shader> compute;
   } cooleyTukeyShader;
 
+  struct StockhamShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } stockhamShader;
+
+  std::unique_ptr<legit::Buffer> twiddlesBuffer;
+  legit::RenderGraph::BufferProxyUnique twiddlesProxy;
+
   legit::Core *core;
 };
 
@@ -0,0 +1,146 @@
+#pragma once
+
+//stand-in for legit::InFlightQueue that renders into offscreen images instead of a swapchain, so it needs neither a window nor a surface.
+//it hands out the same FrameInfo and profiler data, so renderers can't tell the difference. frames are pipelined the same way too,
+//with a fence and an image per in-flight frame, to keep timings comparable with windowed runs
+class HeadlessQueue
+{
+public:
+  HeadlessQueue(legit::Core *core, glm::uvec2 imageSize, size_t inFlightFramesCount, vk::Format imageFormat = vk::Format::eB8G8R8A8Unorm)
+  {
+    this->core = core;
+    this->imageSize = vk::Extent2D(imageSize.x, imageSize.y);
+    this->frameIndex = 0;
+    this->isFrameStarted = false;
+
+    for (size_t frameNumber = 0; frameNumber < inFlightFramesCount; frameNumber++)
+    {
+      FrameResources frame;
+      auto imageCreateDesc = legit::Image::CreateInfo2d(imageSize, 1, 1, imageFormat, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc);
+      frame.image = std::unique_ptr<legit::Image>(new legit::Image(core->GetPhysicalDevice(), core->GetLogicalDevice(), imageCreateDesc));
+      {
+        legit::ExecuteOnceQueue transferQueue(core);
+        auto transferCommandBuffer = transferQueue.BeginCommandBuffer();
+        AddTransitionBarrier(frame.image->GetImageData(), legit::ImageUsageTypes::Unknown, legit::ImageUsageTypes::GraphicsShaderRead, transferCommandBuffer);
+        transferQueue.EndCommandBuffer();
+      }
+      frame.imageView = std::unique_ptr<legit::ImageView>(new legit::ImageView(core->GetLogicalDevice(), frame.image->GetImageData(), 0, 1, 0, 1));
+      frame.imageViewProxy = core->GetRenderGraph()->AddExternalImageView(frame.imageView.get(), legit::ImageUsageTypes::GraphicsShaderRead);
+
+      frame.inFlightFence = core->GetLogicalDevice().createFenceUnique(vk::FenceCreateInfo().setFlags(vk::FenceCreateFlagBits::eSignaled));
+      frame.commandBuffer = std::move(core->AllocateCommandBuffers(1)[0]);
+
+      const size_t shaderMemoryPoolSize = 100000000;
+      frame.shaderMemoryBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), shaderMemoryPoolSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+      frame.shaderMemoryPool = std::unique_ptr<legit::ShaderMemoryPool>(new legit::ShaderMemoryPool(core->GetDynamicMemoryAlignment()));
+      frame.gpuProfiler = std::unique_ptr<legit::GpuProfiler>(new legit::GpuProfiler(core->GetPhysicalDevice(), core->GetLogicalDevice(), 512));
+      frames.push_back(std::move(frame));
+    }
+  }
+
+  vk::Extent2D GetImageSize()
+  {
+    return imageSize;
+  }
+
+  size_t GetInFlightFramesCount()
+  {
+    return frames.size();
+  }
+
+  legit::InFlightQueue::FrameInfo BeginFrame()
+  {
+    assert(!isFrameStarted);
+    auto &currFrame = frames[frameIndex];
+    {
+      auto fenceTask = cpuProfiler.StartScopedTask("WaitForFence", legit::Colors::pomegranate);
+      auto res = core->GetLogicalDevice().waitForFences({ currFrame.inFlightFence.get() }, true, std::numeric_limits<uint64_t>::max());
+      (void)res;
+    }
+    {
+      auto gpuGatheringTask = cpuProfiler.StartScopedTask("GpuPrfGathering", legit::Colors::amethyst);
+      lastFrameGpuProfilerData = currFrame.gpuProfiler->GetProfilerTasks();
+    }
+    lastFrameCpuProfilerData = cpuProfiler.GetProfilerTasks();
+    cpuProfiler.StartFrame();
+
+    currFrame.shaderMemoryPool->MapBuffer(currFrame.shaderMemoryBuffer.get());
+    isFrameStarted = true;
+
+    legit::InFlightQueue::FrameInfo frameInfo;
+    frameInfo.memoryPool = currFrame.shaderMemoryPool.get();
+    frameInfo.frameIndex = frameIndex;
+    frameInfo.swapchainImageViewProxyId = currFrame.imageViewProxy->Id();
+    return frameInfo;
+  }
+
+  void EndFrame()
+  {
+    assert(isFrameStarted);
+    auto &currFrame = frames[frameIndex];
+    {
+      auto creationTask = cpuProfiler.StartScopedTask("Cmd buf creation", legit::Colors::turqoise);
+      auto bufferBeginInfo = vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eSimultaneousUse);
+      currFrame.commandBuffer->begin(bufferBeginInfo);
+      {
+        currFrame.gpuProfiler->StartFrame(currFrame.commandBuffer.get());
+        core->GetRenderGraph()->Execute(currFrame.commandBuffer.get(), &cpuProfiler, currFrame.gpuProfiler.get());
+        currFrame.gpuProfiler->EndFrame();
+      }
+      currFrame.commandBuffer->end();
+    }
+    currFrame.shaderMemoryPool->UnmapBuffer();
+    {
+      //nothing to acquire or present, so the submit only has to signal the frame fence
+      auto submitTask = cpuProfiler.StartScopedTask("Submit", legit::Colors::amethyst);
+      auto submitInfo = vk::SubmitInfo()
+        .setCommandBufferCount(1)
+        .setPCommandBuffers(&currFrame.commandBuffer.get());
+      core->GetLogicalDevice().resetFences({ currFrame.inFlightFence.get() });
+      core->GetGraphicsQueue().submit({ submitInfo }, currFrame.inFlightFence.get());
+    }
+    cpuProfiler.EndFrame();
+    frameIndex = (frameIndex + 1) % frames.size();
+    isFrameStarted = false;
+  }
+
+  const std::vector<legit::ProfilerTask> &GetLastFrameGpuProfilerData()
+  {
+    return lastFrameGpuProfilerData;
+  }
+
+  const std::vector<legit::ProfilerTask> &GetLastFrameCpuProfilerData()
+  {
+    return lastFrameCpuProfilerData;
+  }
+
+  legit::CpuProfiler &GetCpuProfiler()
+  {
+    return cpuProfiler;
+  }
+
+private:
+  struct FrameResources
+  {
+    std::unique_ptr<legit::Image> image;
+    std::unique_ptr<legit::ImageView> imageView;
+    legit::RenderGraph::ImageViewProxyUnique imageViewProxy;
+
+    vk::UniqueFence inFlightFence;
+    vk::UniqueCommandBuffer commandBuffer;
+
+    std::unique_ptr<legit::Buffer> shaderMemoryBuffer;
+    std::unique_ptr<legit::ShaderMemoryPool> shaderMemoryPool;
+    std::unique_ptr<legit::GpuProfiler> gpuProfiler;
+  };
+  std::vector<FrameResources> frames;
+  size_t frameIndex;
+  bool isFrameStarted;
+
+  legit::CpuProfiler cpuProfiler;
+  std::vector<legit::ProfilerTask> lastFrameGpuProfilerData;
+  std::vector<legit::ProfilerTask> lastFrameCpuProfilerData;
+
+  vk::Extent2D imageSize;
+  legit::Core *core;
+};
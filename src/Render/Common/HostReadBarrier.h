@@ -0,0 +1,11 @@
+#pragma once
+
+//host visible buffers that shaders write are read on the host once the frame's fence has signaled, but the fence alone does not
+//make those writes visible to host reads. record this after the last pass that writes such a buffer
+inline void AddHostReadBarrier(vk::CommandBuffer commandBuffer)
+{
+  auto hostBarrier = vk::MemoryBarrier()
+    .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+    .setDstAccessMask(vk::AccessFlagBits::eHostRead);
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, vk::DependencyFlags(), { hostBarrier }, {}, {});
+}
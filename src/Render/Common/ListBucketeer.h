@@ -1,10 +1,18 @@
 #pragma once
+#include "PointChunkCuller.h"
+#include "PointPacker.h"
+#include "OccupiedBuckets.h"
+#include "SubgroupAtomics.h"
+
 class ListBucketeer
 {
 public:
-  ListBucketeer(legit::Core *_core)
+  //persistent bucketeers keep their buckets in external buffers so that they stay valid across frames and can be reused without rebucketing
+  ListBucketeer(legit::Core *_core, bool persistentBuffers = false)
   {
     this->core = _core;
+    this->persistentBuffers = persistentBuffers;
+    this->useSubgroupAtomics = AreSubgroupAtomicsSupported(core->GetPhysicalDevice());
 
     ReloadShaders();
   }
@@ -15,7 +23,9 @@ public:
     legit::RenderGraph::BufferProxyId mipInfosProxyId;
     legit::RenderGraph::BufferProxyId pointsListProxyId;
     legit::RenderGraph::BufferProxyId blockPointsListProxyId;
+    legit::RenderGraph::BufferProxyId bucketEntriesProxyId;
     size_t totalBucketsCount;
+    bool isCompacted; //buckets are contiguous sorted ranges of bucketEntries instead of pointsList/blockPointsList lists
   };
 
   /*void ResizeViewport(glm::uvec2 viewportSize, legit::RenderGraph *renderGraph, size_t framesInFlightCount, Scene *scene)
@@ -38,17 +48,63 @@ public:
   }*/
   void RecreateSwapchainResources(glm::uvec2 viewportSize, size_t framesInFlightCount, size_t maxMipsCount = std::numeric_limits<size_t>::max())
   {
-    viewportResources.reset(new ViewportResources(core, viewportSize, maxMipsCount));
+    viewportResources.reset(new ViewportResources(core, viewportSize, maxMipsCount, persistentBuffers));
   }
 
   void RecreateSceneResources(size_t pointsCount)
   {
-    sceneResources.reset(new SceneResources(core, pointsCount));
+    sceneResources.reset(new SceneResources(core, pointsCount, persistentBuffers));
+  }
+
+  static size_t GetBytesPerBucket()
+  {
+    return sizeof(Bucket);
   }
 
-  BucketBuffers BucketPoints(legit::ShaderMemoryPool *memoryPool, glm::mat4 projMatrix, glm::mat4 viewMatrix, legit::RenderGraph::BufferProxyId pointDataProxyId, uint32_t pointsCount, bool sort)
+  size_t GetBucketedPointsCount()
+  {
+    return bucketedPointsCount;
+  }
+
+  //non-empty buckets of a recent bucketing, may lag a few frames behind
+  size_t GetOccupiedBucketsCount()
+  {
+    return viewportResources ? viewportResources->occupiedBuckets->GetOccupiedBucketsCount() : 0;
+  }
+
+  size_t GetTotalBucketsCount()
+  {
+    return viewportResources ? viewportResources->totalBucketsCount : 0;
+  }
+
+  bool IsUsingSubgroupAtomics()
+  {
+    return useSubgroupAtomics;
+  }
+
+  //appended to pass names so that BucketGridSizer can tell gpu time of bucketeers apart
+  void SetProfilerTag(std::string profilerTag)
+  {
+    this->profilerTag = profilerTag;
+  }
+
+  //compacted bucketing copies lists into sorted contiguous ranges, it replaces both list sorting and block list building
+  void SetCompaction(bool useCompaction)
+  {
+    this->useCompaction = useCompaction;
+  }
+
+  //if visibleRanges are specified, only points inside of them get bucketed, otherwise all pointsCount points are
+  BucketBuffers BucketPoints(legit::ShaderMemoryPool *memoryPool, glm::mat4 projMatrix, glm::mat4 viewMatrix, legit::RenderGraph::BufferProxyId pointsHotProxyId, uint32_t pointsCount, bool sort, const std::vector<PointRange> *visibleRanges = nullptr)
   {
     assert(viewportResources);
+    std::vector<PointRange> pointRanges;
+    if (visibleRanges)
+      pointRanges = *visibleRanges;
+    else
+      pointRanges.push_back({ 0, pointsCount });
+    this->bucketedPointsCount = GetRangesPointsCount(pointRanges);
+
     vk::Extent2D viewportExtent = vk::Extent2D(viewportResources->viewportSize.x, viewportResources->viewportSize.y);
     PassData passData;
     passData.viewMatrix = viewMatrix;
@@ -63,8 +119,9 @@ public:
     core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
       .SetStorageBuffers({
         viewportResources->bucketsProxy->Id(),
-        viewportResources->mipInfosProxy->Id() })
-      .SetProfilerInfo(legit::Colors::emerald, "PassBcrClean")
+        viewportResources->mipInfosProxy->Id(),
+        viewportResources->occupiedBuckets->argsProxy->Id() })
+      .SetProfilerInfo(legit::Colors::emerald, GetPassName("PassBcrClean"))
       .SetRecordFunc([this, memoryPool, passData](legit::RenderGraph::PassContext passContext)
     {
       auto shader = bucketingShaders.clearShader.compute.get();
@@ -83,6 +140,8 @@ public:
         storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketsBuffer", bucketsBuffer));
         auto mipInfosBuffer = passContext.GetBuffer(viewportResources->mipInfosProxy->Id());
         storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("MipInfosBuffer", mipInfosBuffer));
+        auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
 
         auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
         passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
@@ -100,10 +159,12 @@ public:
         viewportResources->bucketsProxy->Id(),
         viewportResources->mipInfosProxy->Id(),
         sceneResources->pointsListProxy->Id(),
-        pointDataProxyId })
+        viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+        viewportResources->occupiedBuckets->argsProxy->Id(),
+        pointsHotProxyId })
       .SetRenderAreaExtent(viewportExtent)
-      .SetProfilerInfo(legit::Colors::carrot, "PassBcrFill")
-      .SetRecordFunc([this, passData, memoryPool, pointDataProxyId, pointsCount](legit::RenderGraph::RenderPassContext passContext)
+      .SetProfilerInfo(legit::Colors::carrot, GetPassName("PassBcrFill"))
+      .SetRecordFunc([this, passData, memoryPool, pointsHotProxyId, pointRanges](legit::RenderGraph::RenderPassContext passContext)
     {
       std::vector<legit::BlendSettings> attachmentBlendSettings;
       attachmentBlendSettings.resize(passContext.GetRenderPass()->GetColorAttachmentsCount(), legit::BlendSettings::Opaque());
@@ -125,8 +186,12 @@ public:
         storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("MipInfosBuffer", mipInfosBuffer));
         auto pointsListBuffer = passContext.GetBuffer(sceneResources->pointsListProxy->Id());
         storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsListBuffer", pointsListBuffer));
-        auto pointsBuffer = passContext.GetBuffer(pointDataProxyId);
-        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsBuffer));
+        auto pointsHotBuffer = passContext.GetBuffer(pointsHotProxyId);
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
+        auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+        auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
 
         auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
 
@@ -134,19 +199,67 @@ public:
           { shaderDataSet },
           { shaderData.dynamicOffset });
 
-        passContext.GetCommandBuffer().draw(pointsCount, 1, 0, 0);
+        for (auto &range : pointRanges)
+          passContext.GetCommandBuffer().draw(range.pointsCount, 1, range.firstPointIndex, 0);
       }
     }));
 
-    if(sort)
+    if(useCompaction)
+    {
+      core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+        .SetStorageBuffers({
+          viewportResources->bucketsProxy->Id(),
+          viewportResources->mipInfosProxy->Id(),
+          sceneResources->pointsListProxy->Id(),
+          sceneResources->bucketEntriesProxy->Id(),
+          viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+          viewportResources->occupiedBuckets->argsProxy->Id() })
+        .SetProfilerInfo(legit::Colors::amethyst, GetPassName("PassCompactLists"))
+        .SetRecordFunc([this, passData, memoryPool](legit::RenderGraph::PassContext passContext)
+      {
+        auto shader = compactShader.compute.get();
+        auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+        {
+          const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+          auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+          {
+            auto passDataBuffer = memoryPool->GetUniformBufferData<PassData>("PassDataBuffer");
+            *passDataBuffer = passData;
+          }
+          memoryPool->EndSet();
+
+          std::vector<legit::StorageBufferBinding> storageBufferBindings;
+          auto bucketsBuffer = passContext.GetBuffer(viewportResources->bucketsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketsBuffer", bucketsBuffer));
+          auto mipInfosBuffer = passContext.GetBuffer(viewportResources->mipInfosProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("MipInfosBuffer", mipInfosBuffer));
+          auto pointsListBuffer = passContext.GetBuffer(sceneResources->pointsListProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsListBuffer", pointsListBuffer));
+          auto bucketEntriesBuffer = passContext.GetBuffer(sceneResources->bucketEntriesProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketEntriesBuffer", bucketEntriesBuffer));
+          auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+          auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
+
+          auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
+          passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+          viewportResources->occupiedBuckets->Dispatch(passContext.GetCommandBuffer(), shader, OccupiedBuckets::DispatchTypes::Buckets);
+        }
+      }));
+    }
+    else if(sort)
     {
       core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
         .SetStorageBuffers({ 
           viewportResources->bucketsProxy->Id(),
           viewportResources->mipInfosProxy->Id(),
-          sceneResources->pointsListProxy->Id() })
-        .SetProfilerInfo(legit::Colors::amethyst, "PassBcrSorting")
-        .SetRecordFunc([this, passData, memoryPool, pointDataProxyId](legit::RenderGraph::PassContext passContext)
+          sceneResources->pointsListProxy->Id(),
+          viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+          viewportResources->occupiedBuckets->argsProxy->Id() })
+        .SetProfilerInfo(legit::Colors::amethyst, GetPassName("PassBcrSorting"))
+        .SetRecordFunc([this, passData, memoryPool, pointsHotProxyId](legit::RenderGraph::PassContext passContext)
       {
         std::vector<legit::BlendSettings> attachmentBlendSettings;
         auto shader = sortShader.compute.get();
@@ -167,12 +280,15 @@ public:
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("MipInfosBuffer", mipInfosBuffer));
           auto pointsListBuffer = passContext.GetBuffer(sceneResources->pointsListProxy->Id());
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsListBuffer", pointsListBuffer));
+          auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+          auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
 
           auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
           passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
 
-          size_t workGroupSize = shader->GetLocalSize().x;
-          passContext.GetCommandBuffer().dispatch(uint32_t(viewportResources->totalBucketsCount / (workGroupSize) + 1), 1, 1);
+          viewportResources->occupiedBuckets->Dispatch(passContext.GetCommandBuffer(), shader, OccupiedBuckets::DispatchTypes::Buckets);
         }
       }));
       core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
@@ -180,9 +296,11 @@ public:
           viewportResources->bucketsProxy->Id(),
           viewportResources->mipInfosProxy->Id(),
           sceneResources->pointsListProxy->Id(),
-          sceneResources->blockPointsListProxy->Id() })
-        .SetProfilerInfo(legit::Colors::orange, "PassBlckSorting")
-        .SetRecordFunc([this, passData, memoryPool, pointDataProxyId](legit::RenderGraph::PassContext passContext)
+          sceneResources->blockPointsListProxy->Id(),
+          viewportResources->occupiedBuckets->bucketIndicesProxy->Id(),
+          viewportResources->occupiedBuckets->argsProxy->Id() })
+        .SetProfilerInfo(legit::Colors::orange, GetPassName("PassBlckSorting"))
+        .SetRecordFunc([this, passData, memoryPool, pointsHotProxyId](legit::RenderGraph::PassContext passContext)
       {
         std::vector<legit::BlendSettings> attachmentBlendSettings;
         auto shader = blockSortShader.compute.get();
@@ -205,23 +323,34 @@ public:
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsListBuffer", pointsListBuffer));
           auto blockPointsListBuffer = passContext.GetBuffer(sceneResources->blockPointsListProxy->Id());
           storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BlockPointsListBuffer", blockPointsListBuffer));
+          auto occupiedBucketsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->bucketIndicesProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsBuffer", occupiedBucketsBuffer));
+          auto occupiedBucketsArgsBuffer = passContext.GetBuffer(viewportResources->occupiedBuckets->argsProxy->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("OccupiedBucketsArgsBuffer", occupiedBucketsArgsBuffer));
 
           auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
           passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
 
-          size_t workGroupSize = shader->GetLocalSize().x;
-          passContext.GetCommandBuffer().dispatch(uint32_t(viewportResources->totalBucketsCount / (workGroupSize) + 1), 1, 1);
+          viewportResources->occupiedBuckets->Dispatch(passContext.GetCommandBuffer(), shader, OccupiedBuckets::DispatchTypes::Blocks);
         }
       }));
 
       
     }
+    return GetBucketBuffers();
+  }
+
+  //buffers filled by the last BucketPoints call
+  BucketBuffers GetBucketBuffers()
+  {
     BucketBuffers res;
     res.bucketsProxyId = viewportResources->bucketsProxy->Id();
     res.mipInfosProxyId = viewportResources->mipInfosProxy->Id();
     res.pointsListProxyId = sceneResources->pointsListProxy->Id();
     res.blockPointsListProxyId = sceneResources->blockPointsListProxy->Id();
+    res.bucketEntriesProxyId = sceneResources->bucketEntriesProxy->Id();
     res.totalBucketsCount = viewportResources->totalBucketsCount;
+    res.isCompacted = useCompaction;
 
     return res;
   }
@@ -230,23 +359,29 @@ public:
   {
 
     bucketingShaders.fillShader.vertex.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/pointRasterizer.vert.spv"));
-    bucketingShaders.fillShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/pointBucketsFill.frag.spv"));
+    bucketingShaders.fillShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), useSubgroupAtomics ? "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/pointBucketsFillSubgroup.frag.spv" : "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/pointBucketsFill.frag.spv"));
     bucketingShaders.fillShader.program.reset(new legit::ShaderProgram(bucketingShaders.fillShader.vertex.get(), bucketingShaders.fillShader.fragment.get()));
 
     bucketingShaders.clearShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/pointBucketsClear.comp.spv"));
     sortShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/bucketSort.comp.spv"));
     blockSortShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/blockSort.comp.spv"));
+    compactShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/ListBucketeer/PointBuckets/bucketCompact.comp.spv"));
   }
 private:
 
 
+  std::string GetPassName(const char *passName)
+  {
+    return profilerTag.empty() ? std::string(passName) : std::string(passName) + " " + profilerTag;
+  }
+
   const static uint32_t ShaderDataSetIndex = 0;
   const static uint32_t DrawCallDataSetIndex = 1;
 
 
   struct ViewportResources
   {
-    ViewportResources(legit::Core *core, glm::uvec2 viewportSize, size_t maxMipsCount)
+    ViewportResources(legit::Core *core, glm::uvec2 viewportSize, size_t maxMipsCount, bool persistentBuffers)
     {
       this->viewportSize = viewportSize;
       this->mipsCount = 0;
@@ -269,14 +404,25 @@ private:
       mipInfosBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), mipInfosSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal));
       legit::LoadBufferData(core, mipInfosData.data(), mipInfosSize, mipInfosBuffer.get());
 
-      this->bucketsProxy = core->GetRenderGraph()->AddBuffer<Bucket>(uint32_t(totalBucketsCount));
+      if (persistentBuffers)
+      {
+        bucketsBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(Bucket) * totalBucketsCount, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        this->bucketsProxy = core->GetRenderGraph()->AddExternalBuffer(bucketsBuffer.get());
+      }
+      else
+      {
+        this->bucketsProxy = core->GetRenderGraph()->AddBuffer<Bucket>(uint32_t(totalBucketsCount));
+      }
       this->mipInfosProxy = core->GetRenderGraph()->AddExternalBuffer(mipInfosBuffer.get());
+      this->occupiedBuckets.reset(new OccupiedBuckets(core, totalBucketsCount));
     }
 
     legit::RenderGraph::BufferProxyUnique bucketsProxy;
     legit::RenderGraph::BufferProxyUnique mipInfosProxy;
+    std::unique_ptr<OccupiedBuckets> occupiedBuckets;
 
     std::unique_ptr<legit::Buffer> mipInfosBuffer;
+    std::unique_ptr<legit::Buffer> bucketsBuffer;
     glm::uvec2 viewportSize;
     size_t totalBucketsCount;
     size_t mipsCount;
@@ -285,15 +431,38 @@ private:
 
   struct SceneResources
   {
-    SceneResources(legit::Core *core, size_t pointsCount)
+    SceneResources(legit::Core *core, size_t pointsCount, bool persistentBuffers)
     {
-      this->pointsListProxy = core->GetRenderGraph()->AddBuffer<PointNode>(uint32_t(pointsCount));
-      this->blockPointsListProxy = core->GetRenderGraph()->AddBuffer<BlockPointNode>(uint32_t(pointsCount));
+      if (persistentBuffers)
+      {
+        pointsListBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(PointNode) * pointsCount, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        blockPointsListBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(BlockPointNode) * pointsCount, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        bucketEntriesBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(BucketEntry) * pointsCount, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        this->pointsListProxy = core->GetRenderGraph()->AddExternalBuffer(pointsListBuffer.get());
+        this->blockPointsListProxy = core->GetRenderGraph()->AddExternalBuffer(blockPointsListBuffer.get());
+        this->bucketEntriesProxy = core->GetRenderGraph()->AddExternalBuffer(bucketEntriesBuffer.get());
+      }
+      else
+      {
+        this->pointsListProxy = core->GetRenderGraph()->AddBuffer<PointNode>(uint32_t(pointsCount));
+        this->blockPointsListProxy = core->GetRenderGraph()->AddBuffer<BlockPointNode>(uint32_t(pointsCount));
+        this->bucketEntriesProxy = core->GetRenderGraph()->AddBuffer<BucketEntry>(uint32_t(pointsCount));
+      }
     }
     legit::RenderGraph::BufferProxyUnique pointsListProxy;
     legit::RenderGraph::BufferProxyUnique blockPointsListProxy;
+    legit::RenderGraph::BufferProxyUnique bucketEntriesProxy;
+
+    std::unique_ptr<legit::Buffer> pointsListBuffer;
+    std::unique_ptr<legit::Buffer> blockPointsListBuffer;
+    std::unique_ptr<legit::Buffer> bucketEntriesBuffer;
   };
   std::unique_ptr<SceneResources> sceneResources;
+  size_t bucketedPointsCount = 0;
+  bool persistentBuffers;
+  bool useSubgroupAtomics;
+  std::string profilerTag;
+  bool useCompaction = false;
 
   #pragma pack(push, 1)
   struct PassData
@@ -315,7 +484,8 @@ private:
     glm::ivec4 size;
     glm::uint bucketIndexOffset;
     float debug;
-    float padding[2];
+    glm::uint entriesPoolOffset;
+    float padding[1];
   };
   #pragma pack(pop)
 
@@ -325,7 +495,7 @@ private:
     glm::uint headPointIndex;
     glm::uint pointsCount;
     glm::uint blockHeadPointIndex;
-    float padding;
+    glm::uint entryOffset;
   };
   #pragma pack(pop)
 
@@ -348,6 +518,14 @@ private:
   };
   #pragma pack(pop)
 
+  #pragma pack(push, 1)
+  struct BucketEntry
+  {
+    glm::uint pointIndex;
+    float dist;
+  };
+  #pragma pack(pop)
+
   struct BucketingShader
   {
     struct ClearShader
@@ -373,6 +551,11 @@ private:
     std::unique_ptr<legit::Shader> compute;
   } blockSortShader;
 
+  struct CompactShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } compactShader;
+
   std::unique_ptr<legit::Sampler> screenspaceSampler;
 
   std::default_random_engine eng;
@@ -0,0 +1,71 @@
+#pragma once
+
+//compacted list of non-empty buckets that bucket filling appends to, along with indirect dispatch arguments for passes that only need to visit those.
+//layout matches Shaders/glsl/Common/occupiedBucketsData.decl
+struct OccupiedBuckets
+{
+  //workgroup size of every pass dispatched over occupied buckets
+  const static uint32_t GroupSize = 64;
+
+  enum struct DispatchTypes
+  {
+    Buckets, //one invocation per occupied bucket
+    Blocks //four invocations per occupied bucket, one per 2x2 block it belongs to
+  };
+
+  OccupiedBuckets(legit::Core *core, size_t totalBucketsCount)
+  {
+    this->totalBucketsCount = totalBucketsCount;
+    this->bucketIndicesProxy = core->GetRenderGraph()->AddBuffer<glm::uint>(uint32_t(totalBucketsCount));
+
+    //host visible so that occupancy can be shown without a readback pass, it's only a few bytes
+    argsBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(Args), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+    Args initialArgs = {};
+    memcpy(argsBuffer->Map(), &initialArgs, sizeof(Args));
+    argsBuffer->Unmap();
+    this->argsProxy = core->GetRenderGraph()->AddExternalBuffer(argsBuffer.get());
+  }
+
+  //render graph barriers only cover shader access, so indirect argument reads get their own barrier
+  void Dispatch(vk::CommandBuffer commandBuffer, const legit::Shader *shader, DispatchTypes dispatchType)
+  {
+    assert(shader->GetLocalSize().x == GroupSize);
+    auto argsBarrier = vk::BufferMemoryBarrier()
+      .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+      .setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead)
+      .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+      .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+      .setBuffer(argsBuffer->GetHandle())
+      .setOffset(0)
+      .setSize(VK_WHOLE_SIZE);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, vk::DependencyFlags(), {}, { argsBarrier }, {});
+
+    size_t argsOffset = (dispatchType == DispatchTypes::Buckets) ? offsetof(Args, bucketsDispatch) : offsetof(Args, blocksDispatch);
+    commandBuffer.dispatchIndirect(argsBuffer->GetHandle(), vk::DeviceSize(argsOffset));
+  }
+
+  //count of the previous bucketing that finished on gpu, it's copied aside when buckets get cleared
+  size_t GetOccupiedBucketsCount()
+  {
+    Args args;
+    memcpy(&args, argsBuffer->Map(), sizeof(Args));
+    argsBuffer->Unmap();
+    return std::min(size_t(args.lastOccupiedBucketsCount), totalBucketsCount);
+  }
+
+  #pragma pack(push, 1)
+  struct Args
+  {
+    glm::uvec4 bucketsDispatch; //xyz - VkDispatchIndirectCommand
+    glm::uvec4 blocksDispatch;
+    glm::uint occupiedBucketsCount;
+    glm::uint lastOccupiedBucketsCount;
+    glm::uint padding[2];
+  };
+  #pragma pack(pop)
+
+  legit::RenderGraph::BufferProxyUnique bucketIndicesProxy;
+  legit::RenderGraph::BufferProxyUnique argsProxy;
+  std::unique_ptr<legit::Buffer> argsBuffer;
+  size_t totalBucketsCount;
+};
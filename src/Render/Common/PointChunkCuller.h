@@ -0,0 +1,117 @@
+#pragma once
+struct PointRange
+{
+  uint32_t firstPointIndex;
+  uint32_t pointsCount;
+};
+
+//box is outside if all of its corners are outside of the same clip plane
+bool IsBoxOutsideFrustum(glm::mat4 viewProjMatrix, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+  glm::uint outsideMask = 0x3f;
+  for (int cornerIndex = 0; cornerIndex < 8; cornerIndex++)
+  {
+    glm::vec3 corner = glm::vec3(
+      (cornerIndex & 1) ? boxMax.x : boxMin.x,
+      (cornerIndex & 2) ? boxMax.y : boxMin.y,
+      (cornerIndex & 4) ? boxMax.z : boxMin.z);
+    glm::vec4 clipPos = viewProjMatrix * glm::vec4(corner, 1.0f);
+    glm::uint cornerMask = 0;
+    cornerMask |= (clipPos.x < -clipPos.w) ? 0x01 : 0;
+    cornerMask |= (clipPos.x >  clipPos.w) ? 0x02 : 0;
+    cornerMask |= (clipPos.y < -clipPos.w) ? 0x04 : 0;
+    cornerMask |= (clipPos.y >  clipPos.w) ? 0x08 : 0;
+    cornerMask |= (clipPos.z < 0.0f)       ? 0x10 : 0;
+    cornerMask |= (clipPos.z >  clipPos.w) ? 0x20 : 0;
+    outsideMask &= cornerMask;
+    if (!outsideMask)
+      return false;
+  }
+  return true;
+}
+
+//returns ranges of points of chunks that can land inside the viewport, adjacent chunks are merged into one range
+std::vector<PointRange> CullPointChunks(const std::vector<PointChunk> &pointChunks, glm::mat4 viewProjMatrix)
+{
+  std::vector<PointRange> pointRanges;
+  for (auto &chunk : pointChunks)
+  {
+    if (IsBoxOutsideFrustum(viewProjMatrix, chunk.boxMin, chunk.boxMax))
+      continue;
+    if (pointRanges.size() > 0 && pointRanges.back().firstPointIndex + pointRanges.back().pointsCount == chunk.firstPointIndex)
+      pointRanges.back().pointsCount += chunk.pointsCount;
+    else
+      pointRanges.push_back({ chunk.firstPointIndex, chunk.pointsCount });
+  }
+  return pointRanges;
+}
+
+//all chunk points without culling. points that are not covered by chunks (lod splats) are skipped
+std::vector<PointRange> GetPointChunkRanges(const std::vector<PointChunk> &pointChunks)
+{
+  std::vector<PointRange> pointRanges;
+  for (auto &chunk : pointChunks)
+  {
+    if (pointRanges.size() > 0 && pointRanges.back().firstPointIndex + pointRanges.back().pointsCount == chunk.firstPointIndex)
+      pointRanges.back().pointsCount += chunk.pointsCount;
+    else
+      pointRanges.push_back({ chunk.firstPointIndex, chunk.pointsCount });
+  }
+  return pointRanges;
+}
+
+//picks the coarsest set of lod nodes whose projected error is below maxPixelError, nodes outside of the frustum are dropped along with their subtrees
+std::vector<PointRange> SelectPointLodCut(const std::vector<PointLodNode> &nodes, const std::vector<uint32_t> &roots, glm::mat4 projMatrix, glm::mat4 viewMatrix, float viewportHeight, float maxPixelError)
+{
+  glm::mat4 viewProjMatrix = projMatrix * viewMatrix;
+  float pixelsPerUnit = std::abs(projMatrix[1][1]) * 0.5f * viewportHeight; //at unit distance for perspective, everywhere for ortho
+  bool isOrtho = projMatrix[3][3] == 1.0f;
+
+  std::vector<PointRange> pointRanges;
+  std::vector<uint32_t> stack = roots;
+  while (!stack.empty())
+  {
+    const PointLodNode &node = nodes[stack.back()];
+    stack.pop_back();
+    if (IsBoxOutsideFrustum(viewProjMatrix, node.boxMin, node.boxMax))
+      continue;
+
+    bool isLeaf = node.childrenCount == 0;
+    if (!isLeaf)
+    {
+      //nearest point of the box in view space gives the most conservative error estimate
+      glm::vec3 boxCenter = (node.boxMin + node.boxMax) * 0.5f;
+      float boxRadius = glm::length(node.boxMax - node.boxMin) * 0.5f;
+      float dist = -(viewMatrix * glm::vec4(boxCenter, 1.0f)).z - boxRadius;
+      float pixelError = node.error * pixelsPerUnit;
+      if (!isOrtho)
+        pixelError = dist > 1e-3f ? pixelError / dist : std::numeric_limits<float>::max();
+      if (pixelError > maxPixelError)
+      {
+        for (uint32_t childNumber = 0; childNumber < node.childrenCount; childNumber++)
+          stack.push_back(node.firstChildIndex + childNumber);
+        continue;
+      }
+    }
+    pointRanges.push_back({ node.firstPointIndex, node.pointsCount });
+  }
+
+  std::sort(pointRanges.begin(), pointRanges.end(), [](const PointRange &left, const PointRange &right) { return left.firstPointIndex < right.firstPointIndex; });
+  std::vector<PointRange> mergedRanges;
+  for (auto &range : pointRanges)
+  {
+    if (mergedRanges.size() > 0 && mergedRanges.back().firstPointIndex + mergedRanges.back().pointsCount == range.firstPointIndex)
+      mergedRanges.back().pointsCount += range.pointsCount;
+    else
+      mergedRanges.push_back(range);
+  }
+  return mergedRanges;
+}
+
+size_t GetRangesPointsCount(const std::vector<PointRange> &pointRanges)
+{
+  size_t pointsCount = 0;
+  for (auto &range : pointRanges)
+    pointsCount += range.pointsCount;
+  return pointsCount;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "PointPacking.h"
+
+//packs 80 byte points written by rasterization/simulation passes into the hot buffer once per frame, 8.25 bytes per point with the
+//position quantized inside its chunk's box, see PointPacking.h. every bucketing pass reads only that buffer, the directional
+//and viewport bucketeers go over it several times per frame. lighting passes accumulate into the full points and keep reading them
+class PointPacker
+{
+public:
+  PointPacker(legit::Core *_core)
+  {
+    this->core = _core;
+
+    ReloadShaders();
+  }
+
+  struct PackedBuffers
+  {
+    legit::RenderGraph::BufferProxyId pointsHotProxyId;
+  };
+
+  void RecreateSceneResources(size_t pointsCount)
+  {
+    sceneResources.reset(new SceneResources(core, pointsCount));
+  }
+
+  PackedBuffers PackPoints(legit::ShaderMemoryPool *memoryPool, legit::RenderGraph::BufferProxyId pointDataProxyId, uint32_t pointsCount)
+  {
+    assert(sceneResources);
+    PackData packData;
+    packData.pointsCount = pointsCount;
+
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers({
+        pointDataProxyId,
+        sceneResources->pointsHotProxy->Id() })
+      .SetProfilerInfo(legit::Colors::clouds, "PassPointPack")
+      .SetRecordFunc([this, memoryPool, packData, pointDataProxyId](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = packShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto packDataBuffer = memoryPool->GetUniformBufferData<PackData>("PackDataBuffer");
+          *packDataBuffer = packData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageBufferBinding> storageBufferBindings;
+        auto pointsBuffer = passContext.GetBuffer(pointDataProxyId);
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsBuffer));
+        auto pointsHotBuffer = passContext.GetBuffer(sceneResources->pointsHotProxy->Id());
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsHotBuffer", pointsHotBuffer));
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        //one workgroup per chunk, an extra one would write a box past the end of the buffer
+        assert(shader->GetLocalSize().x == PointPacking::ChunkPointsCount);
+        passContext.GetCommandBuffer().dispatch(uint32_t(GetChunksCount(packData.pointsCount)), 1, 1);
+      }
+    }));
+
+    PackedBuffers res;
+    res.pointsHotProxyId = sceneResources->pointsHotProxy->Id();
+    return res;
+  }
+
+  static size_t GetChunksCount(size_t pointsCount)
+  {
+    return (pointsCount + PointPacking::ChunkPointsCount - 1) / PointPacking::ChunkPointsCount;
+  }
+
+  void ReloadShaders()
+  {
+    packShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/PointPacker/pointsPack.comp.spv"));
+  }
+private:
+  const static uint32_t ShaderDataSetIndex = 0;
+
+  struct SceneResources
+  {
+    SceneResources(legit::Core *core, size_t pointsCount)
+    {
+      this->pointsHotProxy = core->GetRenderGraph()->AddBuffer<PointPacking::HotChunk>(uint32_t(std::max<size_t>(GetChunksCount(pointsCount), 1)));
+    }
+    legit::RenderGraph::BufferProxyUnique pointsHotProxy;
+  };
+  std::unique_ptr<SceneResources> sceneResources;
+
+  #pragma pack(push, 1)
+  struct PackData
+  {
+    glm::uint pointsCount;
+  };
+  #pragma pack(pop)
+
+  struct PackShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } packShader;
+
+  legit::Core *core;
+};
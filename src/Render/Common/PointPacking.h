@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+//compact point encodings, the same math as Shaders/glsl/Common/pointsPacking.decl. the hot record is what bucketing passes read:
+//points are grouped into chunks of consecutive indices, each chunk stores the box of its points and every point stores its position
+//quantized to 16 bits per axis inside that box plus a half float radius, 8 bytes per point and 32 bytes of box per chunk.
+//octahedral normal and rgb9e5 light are the encodings of the rest of the attributes
+namespace PointPacking
+{
+  const uint32_t ChunkPointsCount = 128; //POINT_HOT_CHUNK_SIZE in pointsPacking.decl, one pack workgroup per chunk
+  const float PosQuantizationMax = 65535.0f;
+  const float HalfMaxValue = 65504.0f;
+
+  #pragma pack(push, 1)
+  struct HotChunk
+  {
+    glm::vec4 boxMin; //xyz - min corner of the chunk's points, w - unused
+    glm::vec4 boxSize; //xyz - size of the chunk's box, w - unused
+    glm::uvec2 points[ChunkPointsCount]; //x - 16 bit x and y, y - 16 bit z and half float radius
+  };
+  #pragma pack(pop)
+  static_assert(sizeof(HotChunk) == 32 + 8 * ChunkPointsCount, "Hot chunk has to match std430 layout of PointHotChunk");
+
+  inline glm::uvec2 EncodeHotPoint(glm::vec3 pos, float radius, glm::vec3 boxMin, glm::vec3 boxSize)
+  {
+    glm::vec3 invStep = glm::vec3(
+      boxSize.x > 0.0f ? PosQuantizationMax / boxSize.x : 0.0f,
+      boxSize.y > 0.0f ? PosQuantizationMax / boxSize.y : 0.0f,
+      boxSize.z > 0.0f ? PosQuantizationMax / boxSize.z : 0.0f);
+    glm::uvec3 quantized = glm::uvec3(glm::clamp(glm::floor((pos - boxMin) * invStep + glm::vec3(0.5f)), glm::vec3(0.0f), glm::vec3(PosQuantizationMax)));
+    glm::uint packedRadius = glm::uint(glm::packHalf1x16(glm::clamp(radius, 0.0f, HalfMaxValue)));
+    return glm::uvec2(quantized.x | (quantized.y << 16), quantized.z | (packedRadius << 16));
+  }
+
+  //xyz - position, w - radius
+  inline glm::vec4 DecodeHotPoint(glm::uvec2 packedPoint, glm::vec3 boxMin, glm::vec3 boxSize)
+  {
+    glm::vec3 quantized = glm::vec3(float(packedPoint.x & 0xffff), float(packedPoint.x >> 16), float(packedPoint.y & 0xffff));
+    return glm::vec4(boxMin + quantized * (boxSize / PosQuantizationMax), glm::unpackHalf1x16(uint16_t(packedPoint.y >> 16)));
+  }
+
+  //what pointsPack.comp does for one chunk, posRadius has pointsCount <= ChunkPointsCount entries
+  inline void PackHotChunk(const glm::vec4 *posRadius, size_t pointsCount, HotChunk &chunk)
+  {
+    glm::vec3 boxMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boxMax = -boxMin;
+    for (size_t pointNumber = 0; pointNumber < pointsCount; pointNumber++)
+    {
+      boxMin = glm::min(boxMin, glm::vec3(posRadius[pointNumber]));
+      boxMax = glm::max(boxMax, glm::vec3(posRadius[pointNumber]));
+    }
+    chunk.boxMin = glm::vec4(boxMin, 0.0f);
+    chunk.boxSize = glm::vec4(glm::max(boxMax - boxMin, glm::vec3(0.0f)), 0.0f);
+    for (size_t pointNumber = 0; pointNumber < pointsCount; pointNumber++)
+      chunk.points[pointNumber] = EncodeHotPoint(glm::vec3(posRadius[pointNumber]), posRadius[pointNumber].w, boxMin, glm::vec3(chunk.boxSize));
+  }
+
+  inline glm::uint EncodeOctNormal(glm::vec3 normal)
+  {
+    normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) + 1e-7f;
+    glm::vec2 oct = glm::vec2(normal.x, normal.y);
+    if (normal.z < 0.0f)
+      oct = (1.0f - glm::abs(glm::vec2(oct.y, oct.x))) * glm::vec2(oct.x >= 0.0f ? 1.0f : -1.0f, oct.y >= 0.0f ? 1.0f : -1.0f);
+    return glm::packSnorm2x16(oct);
+  }
+
+  inline glm::vec3 DecodeOctNormal(glm::uint packedNormal)
+  {
+    glm::vec2 oct = glm::unpackSnorm2x16(packedNormal);
+    glm::vec3 normal = glm::vec3(oct, 1.0f - std::abs(oct.x) - std::abs(oct.y));
+    float t = std::max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -t : t;
+    normal.y += normal.y >= 0.0f ? -t : t;
+    return glm::normalize(normal + glm::vec3(0.0f, 0.0f, 1e-7f));
+  }
+
+  //shared exponent: 9 bit mantissa per channel, 5 bit exponent with bias 15
+  const float Rgb9e5MaxValue = 65408.0f;
+
+  inline glm::uint EncodeRgb9e5(glm::vec3 color)
+  {
+    color = glm::clamp(color, glm::vec3(0.0f), glm::vec3(Rgb9e5MaxValue));
+    float maxChannel = std::max(color.r, std::max(color.g, color.b));
+    int exponent = std::max(-16, int(std::floor(std::log2(std::max(maxChannel, 1e-20f))))) + 16;
+    float scale = std::exp2(float(exponent - 24));
+    if (glm::uint(std::floor(maxChannel / scale + 0.5f)) == 512)
+    {
+      exponent++;
+      scale *= 2.0f;
+    }
+    glm::uvec3 mantissa = glm::min(glm::uvec3(glm::floor(color / scale + 0.5f)), glm::uvec3(511));
+    return mantissa.r | (mantissa.g << 9) | (mantissa.b << 18) | (glm::uint(exponent) << 27);
+  }
+
+  inline glm::vec3 DecodeRgb9e5(glm::uint packedColor)
+  {
+    float scale = std::exp2(float(int(packedColor >> 27) - 24));
+    return glm::vec3(float(packedColor & 0x1ff), float((packedColor >> 9) & 0x1ff), float((packedColor >> 18) & 0x1ff)) * scale;
+  }
+}
@@ -0,0 +1,283 @@
+#pragma once
+#include "PointChunkCuller.h"
+#include "HostReadBarrier.h"
+#include "CpuSplatRaster.h"
+
+//rasterizes points as screen space discs with compute shaders instead of the fixed function point pipeline. closest point per pixel is found
+//with two 32 bit atomic min passes (depth, then index at that depth) so no 64 bit atomics are needed. discs up to a tile wide are rasterized
+//by the thread of their point, wider ones are binned into per-tile lists that a workgroup per tile goes over, so one big splat does not
+//stall its whole workgroup. CpuSplatRaster mirrors it
+class PointSplatRasterizer
+{
+public:
+  PointSplatRasterizer(legit::Core *_core)
+  {
+    this->core = _core;
+
+    ReloadShaders();
+  }
+
+  //isIndexHostReadable puts the index buffer into host visible memory so that ReadPointIndices can be used, for tests only
+  void RecreateSwapchainResources(glm::uvec2 size, bool isIndexHostReadable = false)
+  {
+    viewportResources.reset(new ViewportResources(core, size, isIndexHostReadable));
+  }
+
+  //writes index of the closest point of every pixel into dstImageViewProxyId, 0 for empty pixels. only points of pointRanges get rasterized.
+  //radiusScale multiplies world radii of points, 0 gives one pixel per point
+  void RasterizePointIndices(legit::ShaderMemoryPool *memoryPool, legit::RenderGraph::BufferProxyId pointDataProxyId, const std::vector<PointRange> &pointRanges, glm::mat4 projMatrix, glm::mat4 viewMatrix, float radiusScale, legit::RenderGraph::ImageViewProxyId dstImageViewProxyId)
+  {
+    RasterizeSplats(memoryPool, pointDataProxyId, pointRanges, projMatrix, viewMatrix, radiusScale);
+    SplatData splatData = MakeSplatData(projMatrix, viewMatrix, radiusScale);
+
+    vk::Extent2D extent(viewportResources->size.x, viewportResources->size.y);
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::RenderPassDesc()
+      .SetColorAttachments({
+        { dstImageViewProxyId, vk::AttachmentLoadOp::eDontCare } })
+      .SetStorageBuffers(GetSplatBufferProxyIds())
+      .SetRenderAreaExtent(extent)
+      .SetProfilerInfo(legit::Colors::sunFlower, "PassSplatResolve")
+      .SetRecordFunc([this, memoryPool, splatData](legit::RenderGraph::RenderPassContext passContext)
+    {
+      auto shaderProgram = resolveShader.program.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindGraphicsPipeline(passContext.GetCommandBuffer(), passContext.GetRenderPass()->GetHandle(), legit::DepthSettings::Disabled(), { legit::BlendSettings::Opaque() }, legit::VertexDeclaration(), vk::PrimitiveTopology::eTriangleFan, shaderProgram);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shaderProgram->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto splatDataBuffer = memoryPool->GetUniformBufferData<SplatData>("SplatDataBuffer");
+          *splatDataBuffer = splatData;
+        }
+        memoryPool->EndSet();
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, GetSplatBufferBindings(passContext, shaderDataSetInfo), {});
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+        passContext.GetCommandBuffer().draw(4, 1, 0, 0);
+      }
+    }));
+  }
+
+  //index of the closest point of every pixel from the last submitted frame, 0 for empty pixels. needs isIndexHostReadable
+  //and the fence of that frame to have signaled
+  std::vector<uint32_t> ReadPointIndices()
+  {
+    assert(viewportResources && viewportResources->indexBuffer);
+    std::vector<uint32_t> pointIndices(size_t(viewportResources->size.x) * viewportResources->size.y);
+    memcpy(pointIndices.data(), viewportResources->indexBuffer->Map(), sizeof(uint32_t) * pointIndices.size());
+    viewportResources->indexBuffer->Unmap();
+    for (auto &pointIndex : pointIndices)
+      pointIndex = pointIndex == CpuSplatRaster::EmptyIndex ? 0 : pointIndex;
+    return pointIndices;
+  }
+
+  //everything but the resolve, leaves the closest point of every pixel in the index buffer
+  void RasterizeSplats(legit::ShaderMemoryPool *memoryPool, legit::RenderGraph::BufferProxyId pointDataProxyId, const std::vector<PointRange> &pointRanges, glm::mat4 projMatrix, glm::mat4 viewMatrix, float radiusScale)
+  {
+    SplatData splatData = MakeSplatData(projMatrix, viewMatrix, radiusScale);
+    size_t pixelsCount = size_t(viewportResources->size.x) * viewportResources->size.y;
+
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers(GetSplatBufferProxyIds())
+      .SetProfilerInfo(legit::Colors::emerald, "PassSplatClear")
+      .SetRecordFunc([this, memoryPool, splatData, pixelsCount](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = clearShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto splatDataBuffer = memoryPool->GetUniformBufferData<SplatData>("SplatDataBuffer");
+          *splatDataBuffer = splatData;
+        }
+        memoryPool->EndSet();
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, GetSplatBufferBindings(passContext, shaderDataSetInfo), {});
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        size_t workGroupSize = shader->GetLocalSize().x;
+        passContext.GetCommandBuffer().dispatch(uint32_t(pixelsCount / workGroupSize + 1), 1, 1);
+      }
+    }));
+
+    auto storageBufferProxyIds = GetSplatBufferProxyIds();
+    storageBufferProxyIds.push_back(pointDataProxyId);
+    bool isIndexHostReadable = viewportResources->indexBuffer != nullptr;
+    //phase 0 finds the closest depth of every pixel, phase 1 the lowest index among points at that depth. each phase first goes over
+    //points, binning wide splats, then over tiles
+    for (int phase = 0; phase < 2; phase++)
+    {
+      core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+        .SetStorageBuffers(storageBufferProxyIds)
+        .SetProfilerInfo(legit::Colors::carrot, phase == 0 ? "PassSplatDepth" : "PassSplatIndex")
+        .SetRecordFunc([this, memoryPool, splatData, pointRanges, pointDataProxyId, phase](legit::RenderGraph::PassContext passContext)
+      {
+        auto shader = phase == 0 ? depthShader.compute.get() : indexShader.compute.get();
+        auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto storageBufferBindings = GetSplatBufferBindings(passContext, shaderDataSetInfo);
+        auto pointsBuffer = passContext.GetBuffer(pointDataProxyId);
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsBuffer));
+        size_t workGroupSize = shader->GetLocalSize().x;
+
+        for (auto &range : pointRanges)
+        {
+          auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+          {
+            auto splatDataBuffer = memoryPool->GetUniformBufferData<SplatData>("SplatDataBuffer");
+            *splatDataBuffer = splatData;
+            splatDataBuffer->firstPointIndex = range.firstPointIndex;
+            splatDataBuffer->pointsCount = range.pointsCount;
+          }
+          memoryPool->EndSet();
+
+          auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
+          passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+          passContext.GetCommandBuffer().dispatch(uint32_t(range.pointsCount / workGroupSize + 1), 1, 1);
+        }
+      }));
+
+      core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+        .SetStorageBuffers(storageBufferProxyIds)
+        .SetProfilerInfo(legit::Colors::orange, phase == 0 ? "PassSplatTileDepth" : "PassSplatTileIndex")
+        .SetRecordFunc([this, memoryPool, splatData, pointDataProxyId, phase, isIndexHostReadable](legit::RenderGraph::PassContext passContext)
+      {
+        auto shader = phase == 0 ? tileDepthShader.compute.get() : tileIndexShader.compute.get();
+        auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+        {
+          const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+          auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+          {
+            auto splatDataBuffer = memoryPool->GetUniformBufferData<SplatData>("SplatDataBuffer");
+            *splatDataBuffer = splatData;
+          }
+          memoryPool->EndSet();
+
+          auto storageBufferBindings = GetSplatBufferBindings(passContext, shaderDataSetInfo);
+          auto pointsBuffer = passContext.GetBuffer(pointDataProxyId);
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsBuffer));
+          auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
+          passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+          assert(shader->GetLocalSize().x == CpuSplatRaster::TileSize && shader->GetLocalSize().y == CpuSplatRaster::TileSize);
+          passContext.GetCommandBuffer().dispatch(splatData.size.z, splatData.size.w, 1);
+        }
+        if (phase == 1 && isIndexHostReadable)
+          AddHostReadBarrier(passContext.GetCommandBuffer());
+      }));
+    }
+  }
+
+  void ReloadShaders()
+  {
+    clearShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/PointSplatRasterizer/splatClear.comp.spv"));
+    depthShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/PointSplatRasterizer/splatDepth.comp.spv"));
+    indexShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/PointSplatRasterizer/splatIndex.comp.spv"));
+    tileDepthShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/PointSplatRasterizer/splatTileDepth.comp.spv"));
+    tileIndexShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/PointSplatRasterizer/splatTileIndex.comp.spv"));
+    resolveShader.vertex.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/screenspaceQuad.vert.spv"));
+    resolveShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/PointSplatRasterizer/splatResolve.frag.spv"));
+    resolveShader.program.reset(new legit::ShaderProgram(resolveShader.vertex.get(), resolveShader.fragment.get()));
+  }
+private:
+  const static uint32_t ShaderDataSetIndex = 0;
+  //8mb, a screen sized splat at 1024x1024 takes 4096 entries. splats that do not fit are rasterized by their own thread instead
+  const static uint32_t MaxTileEntriesCount = 1 << 20;
+
+  #pragma pack(push, 1)
+  struct SplatData
+  {
+    glm::mat4 viewProjMatrix;
+    glm::uvec4 size;
+    glm::uint firstPointIndex;
+    glm::uint pointsCount;
+    float pixelRadiusScale;
+    glm::uint maxTileEntriesCount;
+  };
+  #pragma pack(pop)
+
+  SplatData MakeSplatData(glm::mat4 projMatrix, glm::mat4 viewMatrix, float radiusScale)
+  {
+    assert(viewportResources);
+    SplatData splatData;
+    splatData.viewProjMatrix = projMatrix * viewMatrix;
+    splatData.size = glm::uvec4(viewportResources->size, CpuSplatRaster::GetTilesCount(viewportResources->size));
+    splatData.firstPointIndex = 0;
+    splatData.pointsCount = 0;
+    splatData.pixelRadiusScale = CpuSplatRaster::GetPixelRadiusScale(projMatrix, viewportResources->size, radiusScale);
+    splatData.maxTileEntriesCount = MaxTileEntriesCount;
+    return splatData;
+  }
+
+  std::vector<legit::RenderGraph::BufferProxyId> GetSplatBufferProxyIds()
+  {
+    return {
+      viewportResources->depthProxy->Id(),
+      viewportResources->indexProxy->Id(),
+      viewportResources->tileHeadsProxy->Id(),
+      viewportResources->tileEntriesProxy->Id() };
+  }
+
+  template<typename PassContext>
+  std::vector<legit::StorageBufferBinding> GetSplatBufferBindings(PassContext &passContext, const legit::DescriptorSetLayoutKey *shaderDataSetInfo)
+  {
+    std::vector<legit::StorageBufferBinding> storageBufferBindings;
+    auto depthBuffer = passContext.GetBuffer(viewportResources->depthProxy->Id());
+    storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("DepthBuffer", depthBuffer));
+    auto indexBuffer = passContext.GetBuffer(viewportResources->indexProxy->Id());
+    storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("IndexBuffer", indexBuffer));
+    auto tileHeadsBuffer = passContext.GetBuffer(viewportResources->tileHeadsProxy->Id());
+    storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("TileHeadsBuffer", tileHeadsBuffer));
+    auto tileEntriesBuffer = passContext.GetBuffer(viewportResources->tileEntriesProxy->Id());
+    storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("TileEntriesBuffer", tileEntriesBuffer));
+    return storageBufferBindings;
+  }
+
+  struct ViewportResources
+  {
+    ViewportResources(legit::Core *core, glm::uvec2 size, bool isIndexHostReadable)
+    {
+      this->size = size;
+      this->depthProxy = core->GetRenderGraph()->AddBuffer<glm::uint>(uint32_t(size.x * size.y));
+      if (isIndexHostReadable)
+      {
+        indexBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(glm::uint) * size.x * size.y, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+        this->indexProxy = core->GetRenderGraph()->AddExternalBuffer(indexBuffer.get());
+      }
+      else
+      {
+        this->indexProxy = core->GetRenderGraph()->AddBuffer<glm::uint>(uint32_t(size.x * size.y));
+      }
+      glm::uvec2 tilesCount = CpuSplatRaster::GetTilesCount(size);
+      this->tileHeadsProxy = core->GetRenderGraph()->AddBuffer<glm::uint>(tilesCount.x * tilesCount.y);
+      //entries count and padding, then an index pair per entry
+      this->tileEntriesProxy = core->GetRenderGraph()->AddBuffer<glm::uint>(4 + 2 * MaxTileEntriesCount);
+    }
+    std::unique_ptr<legit::Buffer> indexBuffer;
+    legit::RenderGraph::BufferProxyUnique depthProxy;
+    legit::RenderGraph::BufferProxyUnique indexProxy;
+    legit::RenderGraph::BufferProxyUnique tileHeadsProxy;
+    legit::RenderGraph::BufferProxyUnique tileEntriesProxy;
+    glm::uvec2 size;
+  };
+  std::unique_ptr<ViewportResources> viewportResources;
+
+  struct ComputeShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  };
+  ComputeShader clearShader;
+  ComputeShader depthShader;
+  ComputeShader indexShader;
+  ComputeShader tileDepthShader;
+  ComputeShader tileIndexShader;
+
+  struct ResolveShader
+  {
+    std::unique_ptr<legit::Shader> vertex;
+    std::unique_ptr<legit::Shader> fragment;
+    std::unique_ptr<legit::ShaderProgram> program;
+  } resolveShader;
+
+  legit::Core *core;
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <map>
+#include <fstream>
+#include <cstdio>
+
+//records cpu and gpu profiler tasks of a range of frames and saves them as chrome trace-event json (chrome://tracing, ui.perfetto.dev).
+//profiler tasks are timed relative to the start of their own frame and cpu and gpu clocks are unrelated, so every frame gets
+//placed on one host clock: cpu tasks start when the frame begins, gpu tasks start once the frame is submitted and the gpu
+//has finished the previous frame. gpu placement is an estimate, durations within a frame are exact
+class ProfilerTraceRecorder
+{
+public:
+  ProfilerTraceRecorder(size_t inFlightFramesCount)
+  {
+    this->inFlightFramesCount = inFlightFramesCount;
+    this->frameNumber = 0;
+    this->captureBegin = 0;
+    this->captureEnd = 0;
+    this->lastGpuFrameEnd = 0.0;
+    this->originTime = Clock::now();
+  }
+
+  //records framesCount frames starting with the current one
+  void StartCapture(size_t framesCount)
+  {
+    captureBegin = frameNumber;
+    captureEnd = frameNumber + framesCount;
+    events = Json::Value(Json::arrayValue);
+    AddThreadName(CpuThreadId, "CPU");
+    AddThreadName(GpuThreadId, "GPU");
+  }
+
+  bool IsCapturing()
+  {
+    return captureEnd > captureBegin;
+  }
+
+  //gpu data of a frame only becomes available inFlightFramesCount frames later
+  bool IsCaptureFinished()
+  {
+    return IsCapturing() && frameNumber >= captureEnd + inFlightFramesCount;
+  }
+
+  //call right before the queue's BeginFrame()
+  void BeginFrame()
+  {
+    frameTimings[frameNumber].beginTime = GetTime();
+  }
+
+  //call right after the queue's EndFrame() with the data the queue returned for this frame:
+  //cpu tasks belong to the previous frame, gpu tasks to the one that last used the same in-flight slot
+  void EndFrame(const std::vector<legit::ProfilerTask> &lastFrameCpuTasks, const std::vector<legit::ProfilerTask> &lastFrameGpuTasks)
+  {
+    frameTimings[frameNumber].submitTime = GetTime();
+
+    if (frameNumber >= 1)
+      AddCpuFrame(frameNumber - 1, lastFrameCpuTasks);
+    if (frameNumber >= inFlightFramesCount)
+      AddGpuFrame(frameNumber - inFlightFramesCount, lastFrameGpuTasks);
+
+    while (!frameTimings.empty() && frameTimings.begin()->first + inFlightFramesCount + 1 < frameNumber)
+      frameTimings.erase(frameTimings.begin());
+    frameNumber++;
+  }
+
+  bool SaveTrace(std::string filename)
+  {
+    Json::Value root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    std::ofstream fileStream(filename);
+    if (!fileStream.is_open())
+    {
+      std::cout << "Can't open trace file " << filename << "\n";
+      return false;
+    }
+    Json::FastWriter writer;
+    fileStream << writer.write(root);
+    std::cout << "Saved " << (captureEnd - captureBegin) << " frames of profiler data to " << filename << "\n";
+
+    captureBegin = captureEnd = 0;
+    events = Json::Value();
+    return true;
+  }
+private:
+  using Clock = std::chrono::steady_clock;
+  static const int CpuThreadId = 0;
+  static const int GpuThreadId = 1;
+
+  bool IsCaptured(size_t frame)
+  {
+    return frame >= captureBegin && frame < captureEnd;
+  }
+
+  void AddCpuFrame(size_t frame, const std::vector<legit::ProfilerTask> &tasks)
+  {
+    auto it = frameTimings.find(frame);
+    if (!IsCaptured(frame) || it == frameTimings.end())
+      return;
+    AddTasks(CpuThreadId, frame, it->second.beginTime, tasks);
+  }
+
+  void AddGpuFrame(size_t frame, const std::vector<legit::ProfilerTask> &tasks)
+  {
+    auto it = frameTimings.find(frame);
+    if (it == frameTimings.end())
+      return;
+    //gpu can't start before the submit and before it's done with the previous frame
+    double frameStart = std::max(it->second.submitTime, lastGpuFrameEnd);
+    double frameLength = 0.0;
+    for (const auto &task : tasks)
+      frameLength = std::max(frameLength, task.endTime);
+    lastGpuFrameEnd = frameStart + frameLength;
+
+    if (IsCaptured(frame))
+      AddTasks(GpuThreadId, frame, frameStart, tasks);
+  }
+
+  void AddTasks(int threadId, size_t frame, double frameStart, const std::vector<legit::ProfilerTask> &tasks)
+  {
+    for (const auto &task : tasks)
+    {
+      Json::Value event;
+      event["name"] = task.name;
+      event["cat"] = threadId == CpuThreadId ? "cpu" : "gpu";
+      event["ph"] = "X";
+      event["pid"] = 0;
+      event["tid"] = threadId;
+      event["ts"] = (frameStart + task.startTime) * 1e6;
+      event["dur"] = (task.endTime - task.startTime) * 1e6;
+      event["args"]["frame"] = Json::UInt64(frame);
+      event["args"]["color"] = GetColorString(task.color);
+      events.append(event);
+    }
+  }
+
+  void AddThreadName(int threadId, std::string name)
+  {
+    Json::Value event;
+    event["name"] = "thread_name";
+    event["ph"] = "M";
+    event["pid"] = 0;
+    event["tid"] = threadId;
+    event["args"]["name"] = name;
+    events.append(event);
+  }
+
+  //profiler colors are packed the way imgui wants them: r in the lowest byte
+  static std::string GetColorString(uint32_t color)
+  {
+    char str[8];
+    snprintf(str, sizeof(str), "#%02x%02x%02x", color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff);
+    return str;
+  }
+
+  double GetTime()
+  {
+    return std::chrono::duration<double>(Clock::now() - originTime).count();
+  }
+
+  struct FrameTiming
+  {
+    double beginTime = 0.0;
+    double submitTime = 0.0;
+  };
+  std::map<size_t, FrameTiming> frameTimings;
+  size_t inFlightFramesCount;
+  size_t frameNumber;
+  size_t captureBegin;
+  size_t captureEnd;
+  double lastGpuFrameEnd;
+  Json::Value events;
+  Clock::time_point originTime;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+//bucket fill shaders have *Subgroup.frag variants that do one atomic per distinct bucket in a subgroup instead of one per point.
+//they need ballot and shuffle operations in fragment shaders, otherwise the per point variants are used
+bool AreSubgroupAtomicsSupported(vk::PhysicalDevice physicalDevice)
+{
+  if (physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1)
+    return false;
+  auto propertiesChain = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>();
+  auto subgroupProperties = propertiesChain.get<vk::PhysicalDeviceSubgroupProperties>();
+
+  vk::SubgroupFeatureFlags requiredOperations = vk::SubgroupFeatureFlagBits::eBasic | vk::SubgroupFeatureFlagBits::eBallot | vk::SubgroupFeatureFlagBits::eShuffle;
+  return
+    (subgroupProperties.supportedStages & vk::ShaderStageFlagBits::eFragment) &&
+    (subgroupProperties.supportedOperations & requiredOperations) == requiredOperations;
+}
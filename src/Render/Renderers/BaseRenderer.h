@@ -13,4 +13,5 @@ public:
   virtual void RenderFrame(const legit::InFlightQueue::FrameInfo &frameInfo, const Camera &camera, const Camera &light, Scene *scene, GLFWwindow *window){}
   virtual void ReloadShaders(){}
   virtual void ChangeView(){}
+  virtual void ProcessGpuProfilerData(const legit::ProfilerTask *tasks, size_t tasksCount){}
 };
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include "../Common/BlurBuilder.h"
 #include "../Common/ArrayBucketeer.h"
 #include "../Common/ListBucketeer.h"
+#include "../Common/BucketGridSizer.h"
+#include "../Common/DirectionalBucketCache.h"
+#include "../Common/PointSplatRasterizer.h"
 #include "../Common/DebugRenderer.h"
 
 
@@ -15,7 +18,10 @@ public:
     arrayBucketeer(_core),
     listBucketeer(_core),
     giBucketeer(_core),
-    directLightBucketeer(_core)
+    directLightBucketeer(_core),
+    pointPacker(_core),
+    splatRasterizer(_core),
+    giDirectionCache(_core)
   {
     this->core = _core;
 
@@ -39,9 +45,60 @@ public:
     useArrayBuckets = false;
     useBlockGathering = true;
     useSizedGathering = true;
+    useBucketCompaction = false;
+    useChunkCulling = true;
+    usePointLod = true;
+    maxLodPixelError = 1.0f;
+    useGiDirectionCache = false;
+    giDirectionsCount = 16;
+    giDirectionRefreshesCount = 1;
+    isGiDirectionCacheOutdated = true;
+    useComputeRasterization = false;
+    computeSplatRadiusScale = 0.0f;
 
     debugMip = -1;
     debugType = -1;
+
+    {
+      BucketGridSizer::GridDesc gridDesc;
+      gridDesc.maxMipsCount = std::numeric_limits<size_t>::max();
+      gridDesc.aspect = 1.0f;
+
+      gridDesc.name = "List buckets";
+      gridDesc.profilerTag = "List";
+      gridDesc.fixedConfig = { glm::uvec2(512, 512), 10 };
+      gridDesc.minSize = glm::uvec2(64, 64);
+      gridDesc.maxSize = glm::uvec2(1024, 1024);
+      gridDesc.coverage = 0.5f;
+      gridDesc.bytesPerBucket = ListBucketeer::GetBytesPerBucket();
+      listGridIndex = gridSizer.AddGrid(gridDesc);
+
+      gridDesc.name = "Array buckets";
+      gridDesc.profilerTag = "Array";
+      gridDesc.bytesPerBucket = ArrayBucketeer::GetBytesPerBucket();
+      arrayGridIndex = gridSizer.AddGrid(gridDesc);
+
+      gridDesc.name = "GI buckets";
+      gridDesc.profilerTag = "Gi";
+      gridDesc.fixedConfig = { glm::uvec2(128, 128), 8 };
+      gridDesc.minSize = glm::uvec2(32, 32);
+      gridDesc.maxSize = glm::uvec2(512, 512);
+      gridDesc.coverage = 1.0f; //ortho projection covers the whole scene
+      gridDesc.bytesPerBucket = ListBucketeer::GetBytesPerBucket();
+      giGridIndex = gridSizer.AddGrid(gridDesc);
+
+      gridDesc.name = "Direct light buckets";
+      gridDesc.profilerTag = "DirectLight";
+      gridDesc.fixedConfig = { glm::uvec2(64, 64), 7 };
+      gridDesc.maxSize = glm::uvec2(256, 256);
+      gridDesc.coverage = 0.5f;
+      directLightGridIndex = gridSizer.AddGrid(gridDesc);
+    }
+    listBucketeer.SetProfilerTag("List");
+    arrayBucketeer.SetProfilerTag("Array");
+    giBucketeer.SetProfilerTag("Gi");
+    giDirectionCache.SetProfilerTag("Gi");
+    directLightBucketeer.SetProfilerTag("DirectLight");
   }
 
   void RecreateSceneResources(Scene *scene)
@@ -54,10 +111,27 @@ public:
 
 
     sceneResources.reset(new SceneResources(core, pointsCount));
+    //leaf points of an object are the ones covered by its chunks, its lod splats come after them
+    const auto &pointChunks = scene->GetPointChunks();
+    uint32_t basePointIndex = 0;
+    scene->IterateObjects([&](glm::mat4 objectToWorld, glm::vec3 albedoColor, glm::vec3 emissiveColor, vk::Buffer vertexBuffer, vk::Buffer indexBuffer, uint32_t verticesCount, uint32_t indicesCount)
+    {
+      uint32_t leafPointsCount = 0;
+      for (auto &chunk : pointChunks)
+      {
+        if (chunk.firstPointIndex >= basePointIndex && chunk.firstPointIndex < basePointIndex + verticesCount)
+          leafPointsCount += chunk.pointsCount;
+      }
+      sceneResources->objectLeafPointsCounts.push_back(pointChunks.empty() ? verticesCount : leafPointsCount);
+      basePointIndex += verticesCount;
+    });
+    gridSizer.SetPointsCount(pointsCount);
     listBucketeer.RecreateSceneResources(pointsCount);
     giBucketeer.RecreateSceneResources(pointsCount);
     directLightBucketeer.RecreateSceneResources(pointsCount);
     arrayBucketeer.RecreateSceneResources(pointsCount);
+    pointPacker.RecreateSceneResources(pointsCount);
+    isGiDirectionCacheOutdated = true;
   }
   
   void RecreateSwapchainResources(vk::Extent2D viewportExtent, size_t framesInFlightCount)
@@ -66,12 +140,19 @@ public:
 
     glm::uvec2 viewportSize = { viewportExtent.width, viewportExtent.height };
     viewportResources.reset(new ViewportResources(core->GetRenderGraph(), viewportSize));
+    splatRasterizer.RecreateSwapchainResources(viewportResources->shadowmapIndexPyramid.baseSize);
+
+    this->framesInFlightCount = framesInFlightCount;
+    float aspect = float(viewportExtent.width) / float(viewportExtent.height);
+    gridSizer.SetAspect(listGridIndex, aspect);
+    gridSizer.SetAspect(arrayGridIndex, aspect);
+    gridSizer.Update();
+    RecreateBucketeers();
+  }
 
-    listBucketeer.RecreateSwapchainResources(glm::uvec2(512, 512), framesInFlightCount);
-    this->giViewportSize = glm::uvec2(128, 128);
-    giBucketeer.RecreateSwapchainResources(giViewportSize, framesInFlightCount);
-    directLightBucketeer.RecreateSwapchainResources(glm::uvec2(64, 64), framesInFlightCount);
-    arrayBucketeer.RecreateSwapchainResources(glm::uvec2(512, 512), framesInFlightCount);
+  void ProcessGpuProfilerData(const legit::ProfilerTask *tasks, size_t tasksCount)
+  {
+    gridSizer.ProcessProfilerData(tasks, tasksCount);
   }
 private:
   #pragma pack(push, 1)
@@ -81,6 +162,7 @@ private:
     glm::vec4 albedoColor;
     glm::vec4 emissiveColor;
     int basePointIndex;
+    int leafPointsCount;
   };
   #pragma pack(pop)
   
@@ -106,65 +188,78 @@ private:
   {
     vk::Extent2D viewportSize(indexPyramid.baseSize.x, indexPyramid.baseSize.y);
 
-    renderGraph->AddPass(legit::RenderGraph::RenderPassDesc()
-      .SetColorAttachments({ 
-        { indexPyramid.mipImageViewProxies[0]->Id(), vk::AttachmentLoadOp::eClear, vk::ClearColorValue(std::array<int32_t, 4>{0, 0, 0, 0})} })
-      .SetDepthAttachment(depthStencilProxyId, vk::AttachmentLoadOp::eClear)
-      .SetStorageBuffers({
-        this->sceneResources->pointData->Id()})
-      .SetRenderAreaExtent(viewportSize)
-      .SetProfilerInfo(legit::Colors::carrot, "PassPointRaster")
-      .SetRecordFunc([this, passData, viewportSize, projMatrix, viewMatrix](legit::RenderGraph::RenderPassContext passContext)
+    //compute path reads point positions written by the fixed function pass, so the latter has to run at least once per scene
+    if (useComputeRasterization && sceneResources->isPointDataInitialized)
     {
-      std::vector<legit::BlendSettings> attachmentBlendSettings;
-      attachmentBlendSettings.resize(passContext.GetRenderPass()->GetColorAttachmentsCount(), legit::BlendSettings::Opaque());
-      auto shaderProgram = pointRasterizerShader.program.get();
-      auto pipeineInfo = this->core->GetPipelineCache()->BindGraphicsPipeline(passContext.GetCommandBuffer(), passContext.GetRenderPass()->GetHandle(), legit::DepthSettings::DepthTest(), attachmentBlendSettings, vertexDecl, vk::PrimitiveTopology::ePointList, shaderProgram);
+      ResetDirectLight(passData);
+      auto leafRanges = GetLeafPointRanges(passData.scene, projMatrix, viewMatrix);
+      splatRasterizer.RasterizePointIndices(passData.memoryPool, this->sceneResources->pointData->Id(), leafRanges, projMatrix, viewMatrix, computeSplatRadiusScale, indexPyramid.mipImageViewProxies[0]->Id());
+    }
+    else
+    {
+      renderGraph->AddPass(legit::RenderGraph::RenderPassDesc()
+        .SetColorAttachments({ 
+          { indexPyramid.mipImageViewProxies[0]->Id(), vk::AttachmentLoadOp::eClear, vk::ClearColorValue(std::array<int32_t, 4>{0, 0, 0, 0})} })
+        .SetDepthAttachment(depthStencilProxyId, vk::AttachmentLoadOp::eClear)
+        .SetStorageBuffers({
+          this->sceneResources->pointData->Id()})
+        .SetRenderAreaExtent(viewportSize)
+        .SetProfilerInfo(legit::Colors::carrot, "PassPointRaster")
+        .SetRecordFunc([this, passData, viewportSize, projMatrix, viewMatrix](legit::RenderGraph::RenderPassContext passContext)
       {
-        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shaderProgram->GetSetInfo(ShaderDataSetIndex);
-        auto shaderData = passData.memoryPool->BeginSet(shaderDataSetInfo);
+        std::vector<legit::BlendSettings> attachmentBlendSettings;
+        attachmentBlendSettings.resize(passContext.GetRenderPass()->GetColorAttachmentsCount(), legit::BlendSettings::Opaque());
+        auto shaderProgram = pointRasterizerShader.program.get();
+        auto pipeineInfo = this->core->GetPipelineCache()->BindGraphicsPipeline(passContext.GetCommandBuffer(), passContext.GetRenderPass()->GetHandle(), legit::DepthSettings::DepthTest(), attachmentBlendSettings, vertexDecl, vk::PrimitiveTopology::ePointList, shaderProgram);
         {
-          auto shaderDataBuffer = passData.memoryPool->GetUniformBufferData<PointRasterizerShader::DataBuffer>("PointRasterizerData");
+          const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shaderProgram->GetSetInfo(ShaderDataSetIndex);
+          auto shaderData = passData.memoryPool->BeginSet(shaderDataSetInfo);
+          {
+            auto shaderDataBuffer = passData.memoryPool->GetUniformBufferData<PointRasterizerShader::DataBuffer>("PointRasterizerData");
 
-          shaderDataBuffer->projMatrix = projMatrix;
-          shaderDataBuffer->viewMatrix = viewMatrix;
-          shaderDataBuffer->viewportSize = glm::vec4(viewportSize.width, viewportSize.height, 0.0f, 0.0f);
-          shaderDataBuffer->time = 0.0f;
-        }
-        passData.memoryPool->EndSet();
+            shaderDataBuffer->projMatrix = projMatrix;
+            shaderDataBuffer->viewMatrix = viewMatrix;
+            shaderDataBuffer->viewportSize = glm::vec4(viewportSize.width, viewportSize.height, 0.0f, 0.0f);
+            shaderDataBuffer->time = 0.0f;
+          }
+          passData.memoryPool->EndSet();
 
-        std::vector<legit::StorageBufferBinding> storageBufferBindings;
-        auto pointDataBuffer = passContext.GetBuffer(this->sceneResources->pointData->Id());
-        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointDataBuffer));
+          std::vector<legit::StorageBufferBinding> storageBufferBindings;
+          auto pointDataBuffer = passContext.GetBuffer(this->sceneResources->pointData->Id());
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointDataBuffer));
 
-        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
+          auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
 
-        const legit::DescriptorSetLayoutKey *drawCallSetInfo = shaderProgram->GetSetInfo(DrawCallDataSetIndex);
+          const legit::DescriptorSetLayoutKey *drawCallSetInfo = shaderProgram->GetSetInfo(DrawCallDataSetIndex);
 
-        int basePointIndex = 0;
-        passData.scene->IterateObjects([&](glm::mat4 objectToWorld, glm::vec3 albedoColor, glm::vec3 emissiveColor, vk::Buffer vertexBuffer , vk::Buffer indexBuffer, uint32_t verticesCount, uint32_t indicesCount)
-        {
-          auto drawCallData = passData.memoryPool->BeginSet(drawCallSetInfo);
+          int basePointIndex = 0;
+          size_t objectIndex = 0;
+          passData.scene->IterateObjects([&](glm::mat4 objectToWorld, glm::vec3 albedoColor, glm::vec3 emissiveColor, vk::Buffer vertexBuffer , vk::Buffer indexBuffer, uint32_t verticesCount, uint32_t indicesCount)
           {
-            auto drawCallData = passData.memoryPool->GetUniformBufferData<DrawCallDataBuffer>("DrawCallData");
-            drawCallData->modelMatrix = objectToWorld;
-            drawCallData->albedoColor = glm::vec4(albedoColor, 1.0f);
-            drawCallData->emissiveColor = glm::vec4(emissiveColor, 1.0f);
-            drawCallData->basePointIndex = basePointIndex;
-          }
-          passData.memoryPool->EndSet();
-          basePointIndex += verticesCount;
+            auto drawCallData = passData.memoryPool->BeginSet(drawCallSetInfo);
+            {
+              auto drawCallData = passData.memoryPool->GetUniformBufferData<DrawCallDataBuffer>("DrawCallData");
+              drawCallData->modelMatrix = objectToWorld;
+              drawCallData->albedoColor = glm::vec4(albedoColor, 1.0f);
+              drawCallData->emissiveColor = glm::vec4(emissiveColor, 1.0f);
+              drawCallData->basePointIndex = basePointIndex;
+              drawCallData->leafPointsCount = int(this->sceneResources->objectLeafPointsCounts[objectIndex++]);
+            }
+            passData.memoryPool->EndSet();
+            basePointIndex += verticesCount;
 
-          auto drawCallSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*drawCallSetInfo, drawCallData.uniformBufferBindings, {}, {});
-          passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeineInfo.pipelineLayout, ShaderDataSetIndex,
-            { shaderDataSet, drawCallSet },
-            { shaderData.dynamicOffset, drawCallData.dynamicOffset });
+            auto drawCallSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*drawCallSetInfo, drawCallData.uniformBufferBindings, {}, {});
+            passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeineInfo.pipelineLayout, ShaderDataSetIndex,
+              { shaderDataSet, drawCallSet },
+              { shaderData.dynamicOffset, drawCallData.dynamicOffset });
 
-          passContext.GetCommandBuffer().bindVertexBuffers(0, { vertexBuffer }, { 0 });
-          passContext.GetCommandBuffer().draw(verticesCount, 1, 0, 0);
-        });
-      }
-    }));
+            passContext.GetCommandBuffer().bindVertexBuffers(0, { vertexBuffer }, { 0 });
+            passContext.GetCommandBuffer().draw(verticesCount, 1, 0, 0);
+          });
+        }
+      }));
+      sceneResources->isPointDataInitialized = true;
+    }
 
     vk::Extent2D prevLevelViewportSize = viewportSize;
     for (size_t level = 1; level < indexPyramid.mipImageViewProxies.size(); level++)
@@ -274,11 +369,138 @@ private:
   }
 
 
+  void RecreateBucketeers()
+  {
+    auto listConfig = gridSizer.GetConfig(listGridIndex);
+    listBucketeer.RecreateSwapchainResources(listConfig.size, framesInFlightCount, listConfig.mipsCount);
+    auto giConfig = gridSizer.GetConfig(giGridIndex);
+    this->giViewportSize = giConfig.size;
+    giBucketeer.RecreateSwapchainResources(giConfig.size, framesInFlightCount, giConfig.mipsCount);
+    auto directLightConfig = gridSizer.GetConfig(directLightGridIndex);
+    directLightBucketeer.RecreateSwapchainResources(directLightConfig.size, framesInFlightCount, directLightConfig.mipsCount);
+    auto arrayConfig = gridSizer.GetConfig(arrayGridIndex);
+    arrayBucketeer.RecreateSwapchainResources(arrayConfig.size, framesInFlightCount, arrayConfig.mipsCount);
+    isGiDirectionCacheOutdated = true;
+  }
+
+  //with direction cache on, gi is cast along one of a fixed set of directions per frame and only a few of their bucketings get refreshed
+  ListBucketeer::BucketBuffers BucketGiPoints(legit::ShaderMemoryPool *memoryPool, Scene *scene, PassData &passData, legit::RenderGraph::BufferProxyId pointsHotProxyId)
+  {
+    float gridHeight = float(gridSizer.GetConfig(giGridIndex).size.y);
+    if (!useGiDirectionCache)
+    {
+      auto visibleRanges = GetVisiblePointRanges(scene, passData.bucketProjMatrix, passData.bucketViewMatrix, gridHeight);
+      gridSizer.SetVisiblePointsCount(giGridIndex, GetRangesPointsCount(visibleRanges));
+      return giBucketeer.BucketPoints(memoryPool, passData.bucketProjMatrix, passData.bucketViewMatrix, pointsHotProxyId, uint32_t(sceneResources->pointsCount), true, &visibleRanges);
+    }
+
+    auto castInfo = giDirectionCache.Update(size_t(giDirectionRefreshesCount), [&](ListBucketeer &bucketeer, glm::mat4 viewMatrix)
+    {
+      auto visibleRanges = GetVisiblePointRanges(scene, passData.bucketProjMatrix, viewMatrix, gridHeight);
+      gridSizer.SetVisiblePointsCount(giGridIndex, GetRangesPointsCount(visibleRanges));
+      bucketeer.BucketPoints(memoryPool, passData.bucketProjMatrix, viewMatrix, pointsHotProxyId, uint32_t(sceneResources->pointsCount), true, &visibleRanges);
+    });
+    passData.bucketViewMatrix = castInfo.viewMatrix;
+    return castInfo.bucketBuffers;
+  }
+
+  //lod splats are stored after leaf points so the whole point buffer can't be bucketed as is once the scene has lods
+  std::vector<PointRange> GetVisiblePointRanges(Scene *scene, glm::mat4 projMatrix, glm::mat4 viewMatrix, float gridHeight)
+  {
+    if (scene->GetPointChunks().empty())
+      return { { 0, uint32_t(sceneResources->pointsCount) } };
+    if (usePointLod && !scene->GetPointLodNodes().empty())
+      return SelectPointLodCut(scene->GetPointLodNodes(), scene->GetPointLodRoots(), projMatrix, viewMatrix, gridHeight, maxLodPixelError);
+    if (useChunkCulling)
+      return CullPointChunks(scene->GetPointChunks(), projMatrix * viewMatrix);
+    return GetPointChunkRanges(scene->GetPointChunks());
+  }
+
+  //does the part of pointRasterizer.vert that has to happen every frame, direct light is accumulated on top of emissive by splatting
+  void ResetDirectLight(PassData passData)
+  {
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers({
+        this->sceneResources->pointData->Id() })
+      .SetProfilerInfo(legit::Colors::clouds, "PassDirectLightReset")
+      .SetRecordFunc([this, passData](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = directLightResetShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+      std::vector<legit::StorageBufferBinding> storageBufferBindings;
+      auto pointDataBuffer = passContext.GetBuffer(this->sceneResources->pointData->Id());
+      storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointDataBuffer));
+      size_t workGroupSize = shader->GetLocalSize().x;
+
+      uint32_t basePointIndex = 0;
+      passData.scene->IterateObjects([&](glm::mat4 objectToWorld, glm::vec3 albedoColor, glm::vec3 emissiveColor, vk::Buffer vertexBuffer, vk::Buffer indexBuffer, uint32_t verticesCount, uint32_t indicesCount)
+      {
+        auto shaderData = passData.memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderDataBuffer = passData.memoryPool->GetUniformBufferData<DirectLightResetShader::DataBuffer>("DirectLightResetData");
+          shaderDataBuffer->emissiveColor = glm::vec4(emissiveColor, 1.0f);
+          shaderDataBuffer->firstPointIndex = basePointIndex;
+          shaderDataBuffer->pointsCount = verticesCount;
+        }
+        passData.memoryPool->EndSet();
+        basePointIndex += verticesCount;
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, {});
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+        passContext.GetCommandBuffer().dispatch(uint32_t(verticesCount / workGroupSize + 1), 1, 1);
+      });
+    }));
+  }
+
+  //lod splats still go through the fixed function pass to get their point data written, but only leaves get rasterized
+  std::vector<PointRange> GetLeafPointRanges(Scene *scene, glm::mat4 projMatrix, glm::mat4 viewMatrix)
+  {
+    if (scene->GetPointChunks().empty())
+      return { { 0, uint32_t(sceneResources->pointsCount) } };
+    if (useChunkCulling)
+      return CullPointChunks(scene->GetPointChunks(), projMatrix * viewMatrix);
+    return GetPointChunkRanges(scene->GetPointChunks());
+  }
+
   public:
   void RenderFrame(const legit::InFlightQueue::FrameInfo &frameInfo, const Camera &camera, const Camera &light, Scene *scene, GLFWwindow *window)
   {
     ImGui::Begin("Point renderer stuff");
 
+    bool pointSetChanged = false;
+    pointSetChanged |= ImGui::Checkbox("Use chunk culling", &useChunkCulling);
+    pointSetChanged |= ImGui::Checkbox("Use point lod", &usePointLod);
+    if (usePointLod)
+      pointSetChanged |= ImGui::SliderFloat("Lod pixel error", &maxLodPixelError, 0.1f, 16.0f);
+
+    ImGui::Checkbox("Use compute rasterization", &useComputeRasterization);
+    if (useComputeRasterization)
+      ImGui::SliderFloat("Splat radius scale", &computeSplatRadiusScale, 0.0f, 2.0f);
+    ImGui::Checkbox("Cache gi directions", &useGiDirectionCache);
+    if (useGiDirectionCache)
+    {
+      isGiDirectionCacheOutdated |= ImGui::SliderInt("Gi directions", &giDirectionsCount, 1, 64);
+      ImGui::SliderInt("Gi refreshes per frame", &giDirectionRefreshesCount, 0, 8);
+    }
+
+    gridSizer.RenderUI();
+    if (gridSizer.Update())
+    {
+      //buckets of previous frames can still be in flight
+      core->WaitIdle();
+      RecreateBucketeers();
+    }
+    if (useGiDirectionCache && isGiDirectionCacheOutdated)
+    {
+      core->WaitIdle();
+      auto giConfig = gridSizer.GetConfig(giGridIndex);
+      giDirectionCache.Recreate(size_t(giDirectionsCount), giConfig.size, giConfig.mipsCount, sceneResources->pointsCount);
+      isGiDirectionCacheOutdated = false;
+    }
+    if (pointSetChanged)
+      giDirectionCache.Invalidate();
+
     static float ang = 0.0f;
     Camera bucketPos;
     bucketPos.horAngle = 2.0f * 3.1415f * dis(eng);
@@ -399,6 +621,9 @@ private:
       passData.lightViewMatrix, 
       passData);
 
+    //bucketing passes only need positions and radii, so they read the compact hot buffer instead of full points
+    auto packedPoints = pointPacker.PackPoints(frameInfo.memoryPool, sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount));
+
     //direct light splatting
     /*core->GetRenderGraph()->AddPass(legit::RenderGraph::RenderPassDesc()
       .SetColorAttachments({
@@ -486,7 +711,9 @@ private:
     }));*/
     if(0)
     {
-      auto res = directLightBucketeer.BucketPoints(frameInfo.memoryPool, passData.lightProjMatrix, passData.lightViewMatrix, this->sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount), true);
+      auto visibleRanges = GetVisiblePointRanges(scene, passData.lightProjMatrix, passData.lightViewMatrix, float(gridSizer.GetConfig(directLightGridIndex).size.y));
+      gridSizer.SetVisiblePointsCount(directLightGridIndex, GetRangesPointsCount(visibleRanges));
+      auto res = directLightBucketeer.BucketPoints(frameInfo.memoryPool, passData.lightProjMatrix, passData.lightViewMatrix, packedPoints.pointsHotProxyId, uint32_t(sceneResources->pointsCount), true, &visibleRanges);
 
       //direct light casting
       core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
@@ -538,7 +765,7 @@ private:
     }
 
     {
-      auto res = giBucketeer.BucketPoints(frameInfo.memoryPool, passData.bucketProjMatrix, passData.bucketViewMatrix, this->sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount), true);
+      auto res = BucketGiPoints(frameInfo.memoryPool, scene, passData, packedPoints.pointsHotProxyId);
 
       //bucket casting
       /*core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
@@ -696,13 +923,23 @@ private:
     ImGui::Checkbox("Use array buckets", &useArrayBuckets);
     ImGui::Checkbox("Use block gathering", &useBlockGathering);
     ImGui::Checkbox("Use sized gathering", &useSizedGathering);
+    ImGui::Checkbox("Compact bucket lists", &useBucketCompaction);
     ImGui::SliderInt("Debug mip", &debugMip, -1, 10);
     ImGui::SliderInt("Debug type", &debugType, -1, 3);
 
 
     if(useArrayBuckets)
     {
-      auto res = arrayBucketeer.BucketPoints(frameInfo.memoryPool, passData.projMatrix, passData.viewMatrix, this->sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount), true);
+      auto visibleRanges = GetVisiblePointRanges(scene, passData.projMatrix, passData.viewMatrix, float(viewportExtent.height));
+      gridSizer.SetVisiblePointsCount(arrayGridIndex, GetRangesPointsCount(visibleRanges));
+      auto res = arrayBucketeer.BucketPoints(frameInfo.memoryPool, passData.projMatrix, passData.viewMatrix, packedPoints.pointsHotProxyId, uint32_t(sceneResources->pointsCount), true, &visibleRanges);
+      ImGui::Text("Bucketed points: %d / %d", int(arrayBucketeer.GetBucketedPointsCount()), int(sceneResources->pointsCount));
+      ImGui::Text("Occupied buckets: %d / %d (%.1f%%)", int(arrayBucketeer.GetOccupiedBucketsCount()), int(arrayBucketeer.GetTotalBucketsCount()), 100.0f * float(arrayBucketeer.GetOccupiedBucketsCount()) / float(std::max<size_t>(arrayBucketeer.GetTotalBucketsCount(), 1)));
+      ImGui::Text("Subgroup atomics: %s", arrayBucketeer.IsUsingSubgroupAtomics() ? "on" : "off");
+      auto poolInfo = arrayBucketeer.GetPoolInfo();
+      ImGui::Text("Entries pool: %d / %d, group entries pool: %d / %d", int(poolInfo.requiredEntriesCount), int(poolInfo.entriesPoolSize), int(poolInfo.requiredGroupEntriesCount), int(poolInfo.groupEntriesPoolSize));
+      if(poolInfo.overflowedBucketsCount > 0)
+        ImGui::Text("Entries pool overflow: %d buckets dropped", int(poolInfo.overflowedBucketsCount));
 
       core->GetRenderGraph()->AddPass( legit::RenderGraph::RenderPassDesc()
         .SetColorAttachments({
@@ -765,9 +1002,69 @@ private:
       }));
     }else
     {
-      auto res = listBucketeer.BucketPoints(frameInfo.memoryPool, passData.projMatrix, passData.viewMatrix, this->sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount), true);
+      auto visibleRanges = GetVisiblePointRanges(scene, passData.projMatrix, passData.viewMatrix, float(viewportExtent.height));
+      gridSizer.SetVisiblePointsCount(listGridIndex, GetRangesPointsCount(visibleRanges));
+      listBucketeer.SetCompaction(useBucketCompaction);
+      auto res = listBucketeer.BucketPoints(frameInfo.memoryPool, passData.projMatrix, passData.viewMatrix, packedPoints.pointsHotProxyId, uint32_t(sceneResources->pointsCount), true, &visibleRanges);
+      ImGui::Text("Bucketed points: %d / %d", int(listBucketeer.GetBucketedPointsCount()), int(sceneResources->pointsCount));
+      ImGui::Text("Occupied buckets: %d / %d (%.1f%%)", int(listBucketeer.GetOccupiedBucketsCount()), int(listBucketeer.GetTotalBucketsCount()), 100.0f * float(listBucketeer.GetOccupiedBucketsCount()) / float(std::max<size_t>(listBucketeer.GetTotalBucketsCount(), 1)));
+      ImGui::Text("Subgroup atomics: %s", listBucketeer.IsUsingSubgroupAtomics() ? "on" : "off");
+
+      if(res.isCompacted)
+      {
+        core->GetRenderGraph()->AddPass( legit::RenderGraph::RenderPassDesc()
+          .SetColorAttachments({
+            {frameInfo.swapchainImageViewProxyId, vk::AttachmentLoadOp::eDontCare } })
+          .SetStorageBuffers({
+            this->sceneResources->pointData->Id(),
+            res.bucketsProxyId,
+            res.mipInfosProxyId,
+            res.bucketEntriesProxyId })
+          .SetRenderAreaExtent(this->viewportExtent)
+          .SetProfilerInfo(legit::Colors::turqoise, "PassCompactGathering")
+          .SetRecordFunc([this, passData, res](legit::RenderGraph::RenderPassContext passContext)
+        {
+          auto shaderProgram = listCompactGatheringShader.program.get();
+          auto pipeineInfo = this->core->GetPipelineCache()->BindGraphicsPipeline(passContext.GetCommandBuffer(), passContext.GetRenderPass()->GetHandle(), legit::DepthSettings::Disabled(), { legit::BlendSettings::Opaque() }, legit::VertexDeclaration(), vk::PrimitiveTopology::eTriangleFan, shaderProgram);
+          {
+            const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shaderProgram->GetSetInfo(ShaderDataSetIndex);
+            auto shaderData = passData.memoryPool->BeginSet(shaderDataSetInfo);
+            {
+              auto shaderDataBuffer = passData.memoryPool->GetUniformBufferData<ListBucketGatheringShader::DataBuffer>("PassDataBuffer");
 
-      if(useBlockGathering)
+              shaderDataBuffer->viewMatrix = passData.viewMatrix;
+              shaderDataBuffer->projMatrix = passData.projMatrix;
+              shaderDataBuffer->viewportSize = glm::vec4(this->viewportExtent.width, this->viewportExtent.height, 0.0f, 0.0f);
+              shaderDataBuffer->time = 0.0f;
+              shaderDataBuffer->framesCount = passData.frameIndex;
+            }
+            passData.memoryPool->EndSet();
+
+
+            std::vector<legit::StorageBufferBinding> storageBufferBindings;
+            auto bucketsBuffer = passContext.GetBuffer(res.bucketsProxyId);
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketsBuffer", bucketsBuffer));
+
+            auto mipInfosBuffer = passContext.GetBuffer(res.mipInfosProxyId);
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("MipInfosBuffer", mipInfosBuffer));
+
+            auto bucketEntriesBuffer = passContext.GetBuffer(res.bucketEntriesProxyId);
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("BucketEntriesBuffer", bucketEntriesBuffer));
+
+            auto pointsBuffer = passContext.GetBuffer(this->sceneResources->pointData->Id());
+            storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", pointsBuffer));
+
+            std::vector<legit::ImageSamplerBinding> imageSamplerBindings;
+            imageSamplerBindings.push_back(shaderDataSetInfo->MakeImageSamplerBinding("brushSampler", brushImageView.get(), screenspaceSampler.get()));
+
+
+            auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderData.uniformBufferBindings, storageBufferBindings, imageSamplerBindings);
+            passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+            passContext.GetCommandBuffer().draw(4, 1, 0, 0);
+          }
+        }));
+      }
+      else if(useBlockGathering)
       {
         core->GetRenderGraph()->AddPass( legit::RenderGraph::RenderPassDesc()
           .SetColorAttachments({
@@ -931,6 +1228,10 @@ private:
     listBucketGatheringShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/PointRenderer/listBucketGathering.frag.spv"));
     listBucketGatheringShader.program.reset(new legit::ShaderProgram(listBucketGatheringShader.vertex.get(), listBucketGatheringShader.fragment.get()));
 
+    listCompactGatheringShader.vertex.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/screenspaceQuad.vert.spv"));
+    listCompactGatheringShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/PointRenderer/listCompactGathering.frag.spv"));
+    listCompactGatheringShader.program.reset(new legit::ShaderProgram(listCompactGatheringShader.vertex.get(), listCompactGatheringShader.fragment.get()));
+
     listBlockGatheringShader.vertex.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/Common/screenspaceQuad.vert.spv"));
     listBlockGatheringShader.fragment.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/PointRenderer/listBlockGathering.frag.spv"));
     listBlockGatheringShader.program.reset(new legit::ShaderProgram(listBlockGatheringShader.vertex.get(), listBlockGatheringShader.fragment.get()));
@@ -944,12 +1245,15 @@ private:
     listBlockSizedCastingShader.program.reset(new legit::ShaderProgram(listBlockSizedCastingShader.vertex.get(), listBlockSizedCastingShader.fragment.get()));
 
     listDirectLightShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/PointRenderer/listDirectLight.comp.spv"));
+    directLightResetShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/PointRenderer/directLightReset.comp.spv"));
 
     mipBuilder.ReloadShaders();
     blurBuilder.ReloadShaders();
     debugRenderer.ReloadShaders();
     arrayBucketeer.ReloadShaders();
     listBucketeer.ReloadShaders();
+    pointPacker.ReloadShaders();
+    splatRasterizer.ReloadShaders();
   }
 private:
 
@@ -984,12 +1288,15 @@ private:
     SceneResources(legit::Core *core, size_t pointsCount)
     {
       this->pointsCount = pointsCount;
+      this->isPointDataInitialized = false;
       pointBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(Point) * pointsCount, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal));
       pointData = core->GetRenderGraph()->AddExternalBuffer(pointBuffer.get());
     }
     std::unique_ptr<legit::Buffer> pointBuffer;
     legit::RenderGraph::BufferProxyUnique pointData;
     size_t pointsCount;
+    std::vector<uint32_t> objectLeafPointsCounts;
+    bool isPointDataInitialized;
   };
   std::unique_ptr<SceneResources> sceneResources;
 
@@ -1153,6 +1460,20 @@ private:
     std::unique_ptr<legit::Shader> compute;
   } listDirectLightShader;
 
+  struct DirectLightResetShader
+  {
+    #pragma pack(push, 1)
+    struct DataBuffer
+    {
+      glm::vec4 emissiveColor;
+      glm::uint firstPointIndex;
+      glm::uint pointsCount;
+    };
+    #pragma pack(pop)
+
+    std::unique_ptr<legit::Shader> compute;
+  } directLightResetShader;
+
   struct FinalGatheringShader
   {
     #pragma pack(push, 1)
@@ -1211,6 +1532,14 @@ private:
     std::unique_ptr<legit::ShaderProgram> program;
   } listBucketGatheringShader;
 
+  //uses ListBucketGatheringShader::DataBuffer
+  struct ListCompactGatheringShader
+  {
+    std::unique_ptr<legit::Shader> vertex;
+    std::unique_ptr<legit::Shader> fragment;
+    std::unique_ptr<legit::ShaderProgram> program;
+  } listCompactGatheringShader;
+
   struct ListBlockGatheringShader
   {
     #pragma pack(push, 1)
@@ -1264,10 +1593,30 @@ private:
   ListBucketeer listBucketeer;
   ListBucketeer giBucketeer;
   ListBucketeer directLightBucketeer;
+  PointPacker pointPacker;
+  PointSplatRasterizer splatRasterizer;
+  DirectionalBucketCache giDirectionCache;
+
+  BucketGridSizer gridSizer;
+  size_t listGridIndex;
+  size_t arrayGridIndex;
+  size_t giGridIndex;
+  size_t directLightGridIndex;
+  size_t framesInFlightCount;
 
   bool useArrayBuckets;
   bool useBlockGathering;
   bool useSizedGathering;
+  bool useBucketCompaction;
+  bool useChunkCulling;
+  bool usePointLod;
+  float maxLodPixelError;
+  bool useGiDirectionCache;
+  int giDirectionsCount;
+  int giDirectionRefreshesCount;
+  bool isGiDirectionCacheOutdated;
+  bool useComputeRasterization;
+  float computeSplatRadiusScale; //0 keeps one pixel per point like the fixed function path
   int debugMip;
   int debugType;
 
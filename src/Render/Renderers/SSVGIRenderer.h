@@ -285,7 +285,7 @@ public:
           shaderDataBuffer->viewMatrix = passData.viewMatrix;
           shaderDataBuffer->projMatrix = passData.projMatrix;
           shaderDataBuffer->viewportExtent = glm::vec4(this->viewportExtent.width, this->viewportExtent.height, 0.0f, 0.0f);
-          shaderDataBuffer->radius = (!glfwGetKey(window, GLFW_KEY_A) ? 0 : 2);
+          shaderDataBuffer->radius = ((!window || !glfwGetKey(window, GLFW_KEY_A)) ? 0 : 2);
         }
         passData.memoryPool->EndSet();
 
@@ -0,0 +1,296 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <vector>
+#include <future>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "../../../Scene/MappedFile.h"
+#include "FieldCompression.h"
+
+//baked or recorded solver fields: a header followed by one frame per simulated step. a frame is the rgba32f velocity volume,
+//x-fastest, exactly the layout of ShrodingerSolver's velocity volume, optionally followed by the wave function volume.
+//compressed frames store every field as a uint64 byte size and the FieldCompression stream instead.
+//the frames count is not stored, it follows from the file size, so a bake or a recording that got killed halfway is still
+//playable up to its last complete frame. version 1 files (velocity only, uncompressed, no fieldsCount/compression) still load
+#pragma pack(push, 1)
+struct BakedVelocityHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t volumeResolution[3];
+  float volumeMin[3];
+  float volumeMax[3];
+  float timeStep;
+  float h;
+  uint32_t fieldsCount; //1 - velocity, 2 - velocity and wave function
+  uint32_t compression;
+
+  static const uint32_t Magic = 0x4C45564C; //"LVEL"
+  static const uint32_t Version = 2;
+  static const size_t Version1Size = 52;
+
+  enum Compression : uint32_t
+  {
+    None = 0,
+    BrickRans = 1
+  };
+
+  glm::uvec3 GetVolumeResolution() const
+  {
+    return glm::uvec3(volumeResolution[0], volumeResolution[1], volumeResolution[2]);
+  }
+  size_t GetVolumeSize() const
+  {
+    return size_t(volumeResolution[0]) * size_t(volumeResolution[1]) * size_t(volumeResolution[2]);
+  }
+  //uncompressed size of one field
+  size_t GetFieldSize() const
+  {
+    return GetVolumeSize() * sizeof(glm::vec4);
+  }
+};
+#pragma pack(pop)
+
+class BakedVelocityWriter
+{
+public:
+  //compression needs the resolution to be a multiple of FieldCompression::BrickSize
+  bool Open(std::string filename, glm::uvec3 volumeResolution, glm::vec3 volumeMin, glm::vec3 volumeMax, float timeStep, float h, uint32_t fieldsCount = 1, uint32_t compression = BakedVelocityHeader::None)
+  {
+    if (compression != BakedVelocityHeader::None && (volumeResolution.x % FieldCompression::BrickSize != 0 || volumeResolution.y % FieldCompression::BrickSize != 0 || volumeResolution.z % FieldCompression::BrickSize != 0))
+      return false;
+    fileStream.open(filename, std::ios::binary | std::ios::trunc);
+    if (!fileStream.is_open())
+      return false;
+    header.magic = BakedVelocityHeader::Magic;
+    header.version = BakedVelocityHeader::Version;
+    for (int i = 0; i < 3; i++)
+    {
+      header.volumeResolution[i] = volumeResolution[i];
+      header.volumeMin[i] = volumeMin[i];
+      header.volumeMax[i] = volumeMax[i];
+    }
+    header.timeStep = timeStep;
+    header.h = h;
+    header.fieldsCount = fieldsCount;
+    header.compression = compression;
+    fileStream.write((const char*)&header, sizeof(header));
+    return bool(fileStream);
+  }
+
+  //frames are flushed right away so a long bake can be previewed while it's still running
+  bool WriteFrame(const glm::vec4 *velocity, const glm::vec4 *waveFunc = nullptr)
+  {
+    lastFrameSize = 0;
+    const glm::vec4 *fields[] = { velocity, waveFunc };
+    for (uint32_t fieldIndex = 0; fieldIndex < header.fieldsCount; fieldIndex++)
+    {
+      if (!fields[fieldIndex])
+        return false;
+      WriteField(fields[fieldIndex]);
+    }
+    fileStream.flush();
+    return bool(fileStream);
+  }
+
+  bool IsOpen() const
+  {
+    return fileStream.is_open();
+  }
+  const BakedVelocityHeader &GetHeader() const
+  {
+    return header;
+  }
+  //bytes the last frame took in the file, for compression stats
+  size_t GetLastFrameSize() const
+  {
+    return lastFrameSize;
+  }
+private:
+  void WriteField(const glm::vec4 *field)
+  {
+    if (header.compression == BakedVelocityHeader::None)
+    {
+      fileStream.write((const char*)field, header.GetFieldSize());
+      lastFrameSize += header.GetFieldSize();
+    }
+    else
+    {
+      std::vector<uint8_t> compressedField = FieldCompression::Compress(field, header.GetVolumeResolution());
+      uint64_t compressedSize = compressedField.size();
+      fileStream.write((const char*)&compressedSize, sizeof(compressedSize));
+      fileStream.write((const char*)compressedField.data(), compressedField.size());
+      lastFrameSize += sizeof(compressedSize) + compressedField.size();
+    }
+  }
+
+  std::ofstream fileStream;
+  BakedVelocityHeader header;
+  size_t lastFrameSize = 0;
+};
+
+//frames are read straight from a mapping of the file. while the caller uploads a frame the next one is already being
+//decompressed on another thread, so sequential playback only waits for the disk when it falls behind
+class BakedVelocityReader
+{
+public:
+  ~BakedVelocityReader()
+  {
+    if (prefetch.valid())
+      prefetch.wait();
+  }
+
+  bool Open(std::string filename)
+  {
+    if (prefetch.valid())
+      prefetch.wait();
+    mappedFile.reset(new MappedFile(filename));
+    const uint8_t *data = mappedFile->GetData();
+    size_t size = mappedFile->GetSize();
+    if (!data || size < BakedVelocityHeader::Version1Size)
+      return false;
+
+    header = BakedVelocityHeader();
+    memcpy(&header, data, BakedVelocityHeader::Version1Size);
+    if (header.magic != BakedVelocityHeader::Magic)
+      return false;
+    size_t headerSize = 0;
+    if (header.version == 1)
+    {
+      headerSize = BakedVelocityHeader::Version1Size;
+      header.fieldsCount = 1;
+      header.compression = BakedVelocityHeader::None;
+    }
+    else if (header.version == BakedVelocityHeader::Version && size >= sizeof(BakedVelocityHeader))
+    {
+      headerSize = sizeof(BakedVelocityHeader);
+      memcpy(&header, data, sizeof(BakedVelocityHeader));
+    }
+    else
+      return false;
+    if (header.fieldsCount < 1 || header.fieldsCount > 2 || header.GetFieldSize() == 0)
+      return false;
+
+    //field offsets of every complete frame
+    fieldRanges.clear();
+    size_t offset = headerSize;
+    while (true)
+    {
+      std::vector<FieldRange> frameRanges;
+      for (uint32_t fieldIndex = 0; fieldIndex < header.fieldsCount; fieldIndex++)
+      {
+        FieldRange range;
+        if (header.compression == BakedVelocityHeader::None)
+        {
+          range.offset = offset;
+          range.size = header.GetFieldSize();
+        }
+        else
+        {
+          uint64_t compressedSize = 0;
+          if (offset + sizeof(compressedSize) > size)
+            break;
+          memcpy(&compressedSize, data + offset, sizeof(compressedSize));
+          range.offset = offset + sizeof(compressedSize);
+          range.size = size_t(compressedSize);
+        }
+        if (range.offset + range.size > size)
+          break;
+        frameRanges.push_back(range);
+        offset = range.offset + range.size;
+      }
+      if (frameRanges.size() < header.fieldsCount)
+        break;
+      fieldRanges.insert(fieldRanges.end(), frameRanges.begin(), frameRanges.end());
+    }
+    framesCount = fieldRanges.size() / header.fieldsCount;
+    prefetchFrameIndex = size_t(-1);
+    return framesCount > 0;
+  }
+
+  //waveFunc can be null even if the file has it
+  bool ReadFrame(size_t frameIndex, glm::vec4 *velocity, glm::vec4 *waveFunc = nullptr)
+  {
+    if (frameIndex >= framesCount)
+      return false;
+    bool isRead = false;
+    if (prefetch.valid())
+    {
+      bool isPrefetched = prefetch.get();
+      if (isPrefetched && prefetchFrameIndex == frameIndex)
+      {
+        memcpy(velocity, prefetchFields[0].data(), header.GetFieldSize());
+        if (waveFunc && header.fieldsCount > 1)
+          memcpy(waveFunc, prefetchFields[1].data(), header.GetFieldSize());
+        isRead = true;
+      }
+    }
+    if (!isRead)
+    {
+      glm::vec4 *fields[] = { velocity, header.fieldsCount > 1 ? waveFunc : nullptr };
+      if (!DecodeFrame(frameIndex, fields))
+        return false;
+    }
+
+    prefetchFrameIndex = (frameIndex + 1) % framesCount;
+    prefetch = std::async(std::launch::async, [this]()
+    {
+      glm::vec4 *fields[2];
+      for (uint32_t fieldIndex = 0; fieldIndex < header.fieldsCount; fieldIndex++)
+      {
+        prefetchFields[fieldIndex].resize(header.GetVolumeSize());
+        fields[fieldIndex] = prefetchFields[fieldIndex].data();
+      }
+      return DecodeFrame(prefetchFrameIndex, fields);
+    });
+    return true;
+  }
+
+  const BakedVelocityHeader &GetHeader() const
+  {
+    return header;
+  }
+  size_t GetFramesCount() const
+  {
+    return framesCount;
+  }
+  bool HasWaveFunc() const
+  {
+    return header.fieldsCount > 1;
+  }
+private:
+  struct FieldRange
+  {
+    size_t offset;
+    size_t size;
+  };
+
+  bool DecodeFrame(size_t frameIndex, glm::vec4 **fields)
+  {
+    for (uint32_t fieldIndex = 0; fieldIndex < header.fieldsCount; fieldIndex++)
+    {
+      if (!fields[fieldIndex])
+        continue;
+      const FieldRange &range = fieldRanges[frameIndex * header.fieldsCount + fieldIndex];
+      const uint8_t *fieldData = mappedFile->GetData() + range.offset;
+      if (header.compression == BakedVelocityHeader::None)
+        memcpy(fields[fieldIndex], fieldData, range.size);
+      else if (!FieldCompression::Decompress(fieldData, range.size, header.GetVolumeResolution(), fields[fieldIndex]))
+        return false;
+    }
+    return true;
+  }
+
+  std::unique_ptr<MappedFile> mappedFile;
+  BakedVelocityHeader header = {};
+  std::vector<FieldRange> fieldRanges;
+  size_t framesCount = 0;
+
+  std::vector<glm::vec4> prefetchFields[2];
+  size_t prefetchFrameIndex = size_t(-1);
+  //declared last so that it's destroyed first while the buffers it writes into are still alive
+  std::future<bool> prefetch;
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+//cpu reference of ParticleSorter: particles are keyed by the morton code of the velocity grid cell they're in and sorted
+//with the same lsd radix sort the shaders run, one workgroup sized block at a time: count digits per block, exclusive scan
+//of the digit-major histograms, stable scatter by the rank within the block. gives exactly the gpu permutation
+namespace CpuParticleSort
+{
+  //have to match RADIX_BITS and WORKGROUP_SIZE of the ParticleSort shaders
+  const uint32_t RadixBits = 4;
+  const uint32_t RadixSize = 1u << RadixBits;
+  const uint32_t GroupSize = 128;
+
+  struct Grid
+  {
+    glm::uvec3 resolution;
+    glm::vec3 volumeMin;
+    glm::vec3 volumeMax;
+  };
+
+  //10 bits per axis
+  inline uint32_t SpreadBits(uint32_t value)
+  {
+    value &= 0x3ff;
+    value = (value | (value << 16)) & 0x030000ff;
+    value = (value | (value << 8)) & 0x0300f00f;
+    value = (value | (value << 4)) & 0x030c30c3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+  }
+  inline uint32_t GetMortonCode(glm::uvec3 cell)
+  {
+    return SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2);
+  }
+
+  //particles outside of the volume go to the nearest border cell, same as the sampler clamps them
+  inline uint32_t GetCellKey(const Grid &grid, glm::vec3 worldPos)
+  {
+    glm::vec3 normPos = (worldPos - grid.volumeMin) / (grid.volumeMax - grid.volumeMin);
+    glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(normPos * glm::vec3(grid.resolution))), glm::ivec3(0), glm::ivec3(grid.resolution) - glm::ivec3(1));
+    return GetMortonCode(glm::uvec3(cell));
+  }
+
+  //morton codes of a grid use 3 bits per level of its largest axis
+  inline uint32_t GetKeyBitsCount(glm::uvec3 resolution)
+  {
+    uint32_t maxResolution = glm::max(resolution.x, glm::max(resolution.y, resolution.z));
+    uint32_t levelsCount = 0;
+    while ((1u << levelsCount) < maxResolution)
+      levelsCount++;
+    return levelsCount * 3;
+  }
+  inline uint32_t GetPassesCount(uint32_t keyBitsCount)
+  {
+    return (keyBitsCount + RadixBits - 1) / RadixBits;
+  }
+
+  //sorts values by keys, both get permuted. scratch buffers are resized as needed
+  inline void RadixSort(std::vector<uint32_t> &keys, std::vector<uint32_t> &values, uint32_t keyBitsCount, std::vector<uint32_t> &tmpKeys, std::vector<uint32_t> &tmpValues, std::vector<uint32_t> &histograms)
+  {
+    size_t count = keys.size();
+    size_t groupsCount = (count + GroupSize - 1) / GroupSize;
+    tmpKeys.resize(count);
+    tmpValues.resize(count);
+    histograms.resize(groupsCount * RadixSize);
+    for (uint32_t passIndex = 0; passIndex < GetPassesCount(keyBitsCount); passIndex++)
+    {
+      uint32_t digitShift = passIndex * RadixBits;
+      //radixSortCount.comp, digit-major so that one scan gives every block its output offset per digit
+      std::fill(histograms.begin(), histograms.end(), 0);
+      for (size_t index = 0; index < count; index++)
+        histograms[((keys[index] >> digitShift) & (RadixSize - 1)) * groupsCount + index / GroupSize]++;
+      //radixSortScan.comp
+      uint32_t sum = 0;
+      for (auto &histogram : histograms)
+      {
+        uint32_t groupCount = histogram;
+        histogram = sum;
+        sum += groupCount;
+      }
+      //radixSortScatter.comp, elements of a block keep their order within a digit which makes every pass stable
+      for (size_t index = 0; index < count; index++)
+      {
+        uint32_t &offset = histograms[((keys[index] >> digitShift) & (RadixSize - 1)) * groupsCount + index / GroupSize];
+        tmpKeys[offset] = keys[index];
+        tmpValues[offset] = values[index];
+        offset++;
+      }
+      keys.swap(tmpKeys);
+      values.swap(tmpValues);
+    }
+  }
+
+  //particlesSortKeys.comp + radix sort: indices of particles in the order they should be stored in
+  template<typename GetPositionFunc>
+  std::vector<uint32_t> GetSortedIndices(const Grid &grid, size_t particlesCount, GetPositionFunc getPositionFunc)
+  {
+    std::vector<uint32_t> keys(particlesCount);
+    std::vector<uint32_t> indices(particlesCount);
+    for (size_t particleIndex = 0; particleIndex < particlesCount; particleIndex++)
+    {
+      keys[particleIndex] = GetCellKey(grid, getPositionFunc(particleIndex));
+      indices[particleIndex] = uint32_t(particleIndex);
+    }
+    std::vector<uint32_t> tmpKeys, tmpValues, histograms;
+    RadixSort(keys, indices, GetKeyBitsCount(grid.resolution), tmpKeys, tmpValues, histograms);
+    return indices;
+  }
+
+  //particlesPermute.comp + particlesCopy.comp
+  template<typename Particle>
+  void Permute(std::vector<Particle> &particles, const std::vector<uint32_t> &sortedIndices)
+  {
+    std::vector<Particle> sortedParticles(particles.size());
+    for (size_t index = 0; index < particles.size(); index++)
+      sortedParticles[index] = particles[sortedIndices[index]];
+    particles.swap(sortedParticles);
+  }
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <glm/glm.hpp>
+#include "../../Common/FFT/FFT.h"
+
+//cpu version of MultigridPoissonSolver with the same discretization, smoother and transfer operators as the Multigrid
+//shaders, used to check the gpu one and by CpuShrodingerSolver. solves laplacian(p) = rhs on a periodic cell-centered grid,
+//levels halve the resolution down to MinLevelSize: red-black gauss-seidel smoothing, 8-children average restriction
+//of the residual and trilinear prolongation of the correction
+class CpuPoissonMultigrid
+{
+public:
+  struct Settings
+  {
+    int preSmoothIterations = 2;
+    int postSmoothIterations = 2;
+    int coarseIterations = 32;
+    CpuFFT::Settings parallelSettings;
+  };
+  static const int MinLevelSize = 16;
+
+  CpuPoissonMultigrid(glm::ivec3 size, float stepSize, const Settings &settings)
+  {
+    this->settings = settings;
+    this->size = size;
+    this->stepSize = stepSize;
+    glm::ivec3 levelSize = size / 2;
+    float levelStepSize = stepSize * 2.0f;
+    while (levelSize.x >= MinLevelSize && levelSize.y >= MinLevelSize && levelSize.z >= MinLevelSize)
+    {
+      Level level;
+      level.size = levelSize;
+      level.stepSize = levelStepSize;
+      level.pressure.resize(GetNodesCount(levelSize));
+      level.rhs.resize(GetNodesCount(levelSize));
+      coarseLevels.push_back(std::move(level));
+      levelSize /= 2;
+      levelStepSize *= 2.0f;
+    }
+  }
+
+  //plain red-black gauss-seidel on the finest level, what poissonIteration.comp does on its own
+  void Smooth(float *pressure, const float *rhs, int iterationsCount)
+  {
+    Smooth(size, stepSize, pressure, rhs, iterationsCount);
+  }
+
+  void VCycle(float *pressure, const float *rhs)
+  {
+    VCycle(0, size, stepSize, pressure, rhs);
+  }
+
+  //max norm of the residual relative to the max norm of the right hand side, what residualNorm.comp reports
+  float ComputeRelativeResidual(const float *pressure, const float *rhs)
+  {
+    std::vector<float> threadMaxResiduals;
+    std::vector<float> threadMaxRhs;
+    std::mutex mutex;
+    ForEachSlice(size, [&](int zBegin, int zEnd)
+    {
+      float maxResidual = 0.0f;
+      float maxRhs = 0.0f;
+      for (int z = zBegin; z < zEnd; z++)
+      {
+        for (int y = 0; y < size.y; y++)
+        {
+          for (int x = 0; x < size.x; x++)
+          {
+            glm::ivec3 node = glm::ivec3(x, y, z);
+            maxResidual = std::max(maxResidual, std::abs(ComputeResidual(size, stepSize, pressure, rhs, node)));
+            maxRhs = std::max(maxRhs, std::abs(rhs[GetNodeOffset(size, node)]));
+          }
+        }
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      threadMaxResiduals.push_back(maxResidual);
+      threadMaxRhs.push_back(maxRhs);
+    });
+    float maxResidual = *std::max_element(threadMaxResiduals.begin(), threadMaxResiduals.end());
+    float maxRhs = *std::max_element(threadMaxRhs.begin(), threadMaxRhs.end());
+    return maxResidual / std::max(maxRhs, 1e-20f);
+  }
+
+  //v-cycles until the relative residual drops below tolerance, returns how many were needed
+  int Solve(float *pressure, const float *rhs, float tolerance, int maxCyclesCount)
+  {
+    int cyclesCount = 0;
+    while (cyclesCount < maxCyclesCount && ComputeRelativeResidual(pressure, rhs) > tolerance)
+    {
+      VCycle(pressure, rhs);
+      cyclesCount++;
+    }
+    return cyclesCount;
+  }
+
+  size_t GetLevelsCount() const
+  {
+    return coarseLevels.size() + 1;
+  }
+private:
+  struct Level
+  {
+    glm::ivec3 size;
+    float stepSize;
+    std::vector<float> pressure;
+    std::vector<float> rhs;
+  };
+
+  static size_t GetNodesCount(glm::ivec3 size)
+  {
+    return size_t(size.x) * size_t(size.y) * size_t(size.z);
+  }
+  static size_t GetNodeOffset(glm::ivec3 size, glm::ivec3 node)
+  {
+    return size_t(node.x) + size_t(size.x) * (size_t(node.y) + size_t(size.y) * size_t(node.z));
+  }
+  static size_t GetWrappedOffset(glm::ivec3 size, glm::ivec3 node)
+  {
+    return GetNodeOffset(size, ((node % size) + size) % size);
+  }
+
+  //calls func(zBegin, zEnd) for ranges of z slices from several threads
+  template<typename Func>
+  void ForEachSlice(glm::ivec3 levelSize, Func func)
+  {
+    CpuFFT::ParallelFor(size_t(levelSize.z), settings.parallelSettings.threadsCount, [&](size_t zBegin, size_t zEnd)
+    {
+      func(int(zBegin), int(zEnd));
+    });
+  }
+
+  static float GetNeighboursSum(glm::ivec3 levelSize, const float *pressure, glm::ivec3 node)
+  {
+    return
+      pressure[GetWrappedOffset(levelSize, node + glm::ivec3(-1, 0, 0))] +
+      pressure[GetWrappedOffset(levelSize, node + glm::ivec3( 1, 0, 0))] +
+      pressure[GetWrappedOffset(levelSize, node + glm::ivec3(0, -1, 0))] +
+      pressure[GetWrappedOffset(levelSize, node + glm::ivec3(0,  1, 0))] +
+      pressure[GetWrappedOffset(levelSize, node + glm::ivec3(0, 0, -1))] +
+      pressure[GetWrappedOffset(levelSize, node + glm::ivec3(0, 0,  1))];
+  }
+
+  static float ComputeResidual(glm::ivec3 levelSize, float levelStepSize, const float *pressure, const float *rhs, glm::ivec3 node)
+  {
+    size_t offset = GetNodeOffset(levelSize, node);
+    float laplacian = (GetNeighboursSum(levelSize, pressure, node) - 6.0f * pressure[offset]) / (levelStepSize * levelStepSize);
+    return rhs[offset] - laplacian;
+  }
+
+  //a phase only updates nodes of one checkerboard color and only reads the other one, so slices can go in parallel
+  void Smooth(glm::ivec3 levelSize, float levelStepSize, float *pressure, const float *rhs, int iterationsCount)
+  {
+    float sqrStep = levelStepSize * levelStepSize;
+    for (int iterationIndex = 0; iterationIndex < iterationsCount; iterationIndex++)
+    {
+      for (int phase = 0; phase < 2; phase++)
+      {
+        ForEachSlice(levelSize, [&](int zBegin, int zEnd)
+        {
+          for (int z = zBegin; z < zEnd; z++)
+          {
+            for (int y = 0; y < levelSize.y; y++)
+            {
+              for (int x = (y + z + phase) % 2; x < levelSize.x; x += 2)
+              {
+                glm::ivec3 node = glm::ivec3(x, y, z);
+                size_t offset = GetNodeOffset(levelSize, node);
+                pressure[offset] = (GetNeighboursSum(levelSize, pressure, node) - sqrStep * rhs[offset]) / 6.0f;
+              }
+            }
+          }
+        });
+      }
+    }
+  }
+
+  //restrict.comp
+  void Restrict(glm::ivec3 levelSize, float levelStepSize, const float *pressure, const float *rhs, Level &coarseLevel)
+  {
+    ForEachSlice(coarseLevel.size, [&](int zBegin, int zEnd)
+    {
+      for (int z = zBegin; z < zEnd; z++)
+      {
+        for (int y = 0; y < coarseLevel.size.y; y++)
+        {
+          for (int x = 0; x < coarseLevel.size.x; x++)
+          {
+            glm::ivec3 coarseNode = glm::ivec3(x, y, z);
+            float residualSum = 0.0f;
+            for (int childIndex = 0; childIndex < 8; childIndex++)
+            {
+              glm::ivec3 childOffset = glm::ivec3(childIndex & 1, (childIndex >> 1) & 1, (childIndex >> 2) & 1);
+              residualSum += ComputeResidual(levelSize, levelStepSize, pressure, rhs, coarseNode * 2 + childOffset);
+            }
+            size_t coarseOffset = GetNodeOffset(coarseLevel.size, coarseNode);
+            coarseLevel.rhs[coarseOffset] = residualSum * 0.125f;
+            coarseLevel.pressure[coarseOffset] = 0.0f;
+          }
+        }
+      }
+    });
+  }
+
+  //prolongate.comp
+  void Prolongate(const Level &coarseLevel, glm::ivec3 levelSize, float *pressure)
+  {
+    ForEachSlice(levelSize, [&](int zBegin, int zEnd)
+    {
+      for (int z = zBegin; z < zEnd; z++)
+      {
+        for (int y = 0; y < levelSize.y; y++)
+        {
+          for (int x = 0; x < levelSize.x; x++)
+          {
+            glm::ivec3 node = glm::ivec3(x, y, z);
+            glm::vec3 coarsePos = (glm::vec3(node) + glm::vec3(0.5f)) * 0.5f - glm::vec3(0.5f);
+            glm::vec3 floorPos = glm::floor(coarsePos);
+            glm::vec3 ratio = coarsePos - floorPos;
+            glm::ivec3 baseNode = glm::ivec3(floorPos);
+
+            float correction = 0.0f;
+            for (int cornerIndex = 0; cornerIndex < 8; cornerIndex++)
+            {
+              glm::ivec3 cornerOffset = glm::ivec3(cornerIndex & 1, (cornerIndex >> 1) & 1, (cornerIndex >> 2) & 1);
+              glm::vec3 weights = glm::mix(glm::vec3(1.0f) - ratio, ratio, glm::vec3(cornerOffset));
+              correction += coarseLevel.pressure[GetWrappedOffset(coarseLevel.size, baseNode + cornerOffset)] * weights.x * weights.y * weights.z;
+            }
+            pressure[GetNodeOffset(levelSize, node)] += correction;
+          }
+        }
+      }
+    });
+  }
+
+  void VCycle(size_t levelIndex, glm::ivec3 levelSize, float levelStepSize, float *pressure, const float *rhs)
+  {
+    if (levelIndex == coarseLevels.size())
+    {
+      Smooth(levelSize, levelStepSize, pressure, rhs, settings.coarseIterations);
+      return;
+    }
+    Level &coarseLevel = coarseLevels[levelIndex];
+    Smooth(levelSize, levelStepSize, pressure, rhs, settings.preSmoothIterations);
+    Restrict(levelSize, levelStepSize, pressure, rhs, coarseLevel);
+    VCycle(levelIndex + 1, coarseLevel.size, coarseLevel.stepSize, coarseLevel.pressure.data(), coarseLevel.rhs.data());
+    Prolongate(coarseLevel, levelSize, pressure);
+    Smooth(levelSize, levelStepSize, pressure, rhs, settings.postSmoothIterations);
+  }
+
+  Settings settings;
+  glm::ivec3 size;
+  float stepSize;
+  std::vector<Level> coarseLevels;
+};
@@ -0,0 +1,350 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include "../../Common/FFT/FFT.h"
+#include "CpuPoissonMultigrid.h"
+#include "CpuSpectralPoisson.h"
+
+//cpu port of ShrodingerSolver for baking long high resolution simulations without a gpu. runs the same passes with the same
+//constants as the shaders: fieldsInit, shrodingerSolveFFT, pressure projection with a spectral solve, multigrid or the old
+//fixed count of checkerboard gauss-seidel sweeps and computeWaveVelocity. volumes are stored x-fastest like the gpu images and neighbours wrap around like ClampNode does
+class CpuShrodingerSolver
+{
+public:
+  enum struct PoissonSolverTypes
+  {
+    Spectral, //exact, fixed cost of two 3d ffts
+    Multigrid,
+    GaussSeidel
+  };
+  //fields rounded to half floats every time they're stored, what 16 bit volumes of ShrodingerSolver do to them.
+  //math in between stays 32 bit like it does in the shaders
+  struct StoragePrecision
+  {
+    bool halfWaveFunc = false;
+    bool halfVelocity = false;
+    bool halfDivergence = false;
+    bool halfPressure = false;
+  };
+  struct Settings
+  {
+    glm::uvec3 volumeResolution = glm::uvec3(128, 128, 128);
+    glm::vec3 volumeMin = glm::vec3(-1.0f);
+    glm::vec3 volumeMax = glm::vec3(1.0f);
+    float timeStep = 1.0f / 50.0f;
+    float h = 0.03f;
+    PoissonSolverTypes poissonSolverType = PoissonSolverTypes::Spectral;
+    float poissonTolerance = 1e-3f; //relative residual a projection is solved to with multigrid
+    int maxPoissonCyclesCount = 16;
+    int poissonIterationsCount = 20; //gauss-seidel sweeps, like the gpu solver used to do
+    StoragePrecision storagePrecision;
+    CpuFFT::Settings parallelSettings;
+  };
+
+  CpuShrodingerSolver(const Settings &settings) :
+    poissonSolver(glm::ivec3(settings.volumeResolution), ((settings.volumeMax - settings.volumeMin) / glm::vec3(settings.volumeResolution)).x, GetPoissonSettings(settings)),
+    spectralPoissonSolver(glm::ivec3(settings.volumeResolution), (settings.volumeMax - settings.volumeMin) / glm::vec3(settings.volumeResolution), settings.parallelSettings)
+  {
+    this->settings = settings;
+    this->size = glm::ivec3(settings.volumeResolution);
+    this->stepSize = (settings.volumeMax - settings.volumeMin) / glm::vec3(settings.volumeResolution);
+    this->invStepSize = glm::vec3(1.0f) / stepSize;
+
+    size_t nodesCount = size_t(size.x) * size_t(size.y) * size_t(size.z);
+    waveFunc.resize(nodesCount);
+    velocity.resize(nodesCount);
+    pressure.resize(nodesCount);
+    divergence.resize(nodesCount);
+  }
+
+  //same as the first frame of ShrodingerSolver::Update: the initial field is projected, its phase is reset and it's projected again
+  void Init()
+  {
+    for (int iterationIndex = 0; iterationIndex < 2; iterationIndex++)
+    {
+      FieldsInit(iterationIndex);
+      ProjectPressure();
+    }
+  }
+
+  //one frame of ShrodingerSolver::Update, velocity is up to date afterwards
+  void Step()
+  {
+    ShrodingerSolveFFT();
+    ProjectPressure();
+    ComputeVelocity();
+  }
+
+  //particlesAdvect.comp: explicit euler step through the velocity sampled the way a clamp-to-edge linear sampler does
+  void AdvectParticles(glm::vec3 *positions, size_t particlesCount)
+  {
+    CpuFFT::ParallelFor(particlesCount, settings.parallelSettings.threadsCount, [&](size_t particleBegin, size_t particleEnd)
+    {
+      for (size_t particleIndex = particleBegin; particleIndex < particleEnd; particleIndex++)
+        positions[particleIndex] += SampleVelocity(positions[particleIndex]) * settings.timeStep;
+    });
+  }
+
+  glm::vec3 SampleVelocity(glm::vec3 worldPos) const
+  {
+    glm::vec3 uv = (worldPos - settings.volumeMin) / (settings.volumeMax - settings.volumeMin);
+    glm::vec3 texelPos = uv * glm::vec3(size) - glm::vec3(0.5f);
+    glm::vec3 floorPos = glm::floor(texelPos);
+    glm::vec3 ratio = texelPos - floorPos;
+    glm::ivec3 baseNode = glm::ivec3(floorPos);
+
+    glm::vec3 res = glm::vec3(0.0f);
+    for (int corner = 0; corner < 8; corner++)
+    {
+      glm::ivec3 offset = glm::ivec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+      glm::ivec3 node = glm::clamp(baseNode + offset, glm::ivec3(0), size - glm::ivec3(1));
+      glm::vec3 weights = glm::mix(glm::vec3(1.0f) - ratio, ratio, glm::vec3(offset));
+      res += glm::vec3(velocity[GetNodeOffset(node)]) * (weights.x * weights.y * weights.z);
+    }
+    return res;
+  }
+
+  //rgba32f layout of the gpu velocity volume, w is 0
+  const std::vector<glm::vec4> &GetVelocity() const
+  {
+    return velocity;
+  }
+  //layout of the gpu wave function volume, two complex components per node
+  const std::vector<glm::vec4> &GetWaveFunc() const
+  {
+    return waveFunc;
+  }
+
+  const Settings &GetSettings() const
+  {
+    return settings;
+  }
+
+  //continues from the state of another solver with the same resolution, settings stay
+  void CopyFields(const CpuShrodingerSolver &other)
+  {
+    waveFunc = other.waveFunc;
+    velocity = other.velocity;
+    pressure = other.pressure;
+    divergence = other.divergence;
+  }
+
+  //v-cycles the last projection needed, 0 for the other solvers
+  int GetLastPoissonCyclesCount() const
+  {
+    return lastPoissonCyclesCount;
+  }
+  float GetLastPoissonResidual() const
+  {
+    return lastPoissonResidual;
+  }
+private:
+  using Complex = glm::vec2;
+  using WaveFunc = glm::vec4;
+
+  static Complex Mul(Complex a, Complex b)
+  {
+    return Complex(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+  }
+  static WaveFunc Mul(Complex c, WaveFunc waveFunc)
+  {
+    Complex xy = Mul(c, Complex(waveFunc.x, waveFunc.y));
+    Complex zw = Mul(c, Complex(waveFunc.z, waveFunc.w));
+    return WaveFunc(xy.x, xy.y, zw.x, zw.y);
+  }
+  static WaveFunc Conjugate(WaveFunc waveFunc)
+  {
+    return WaveFunc(waveFunc.x, -waveFunc.y, waveFunc.z, -waveFunc.w);
+  }
+  static Complex Dot(WaveFunc a, WaveFunc b)
+  {
+    return Mul(Complex(a.x, a.y), Complex(b.x, b.y)) + Mul(Complex(a.z, a.w), Complex(b.z, b.w));
+  }
+  static Complex Polar(float theta)
+  {
+    return Complex(std::cos(theta), std::sin(theta));
+  }
+  static float Arg(Complex c)
+  {
+    return std::atan2(c.y, c.x);
+  }
+  static float RoundToHalf(float value)
+  {
+    return glm::unpackHalf1x16(glm::packHalf1x16(value));
+  }
+  static glm::vec4 RoundToHalf(glm::vec4 value)
+  {
+    return glm::unpackHalf4x16(glm::packHalf4x16(value));
+  }
+  template<typename Value>
+  void StoreField(std::vector<Value> &field, bool isHalf)
+  {
+    if (!isHalf)
+      return;
+    ForEachNode([&](glm::ivec3 node)
+    {
+      size_t offset = GetNodeOffset(node);
+      field[offset] = RoundToHalf(field[offset]);
+    });
+  }
+  Complex WavePhase(glm::vec3 waveVec, glm::vec3 pos, float time) const
+  {
+    float phase = glm::dot(waveVec, pos) - settings.h / 2.0f * glm::dot(waveVec, waveVec) * time;
+    return Polar(phase + 3.1415f);
+  }
+
+  size_t GetNodeOffset(glm::ivec3 node) const
+  {
+    return size_t(node.x) + size_t(size.x) * (size_t(node.y) + size_t(size.y) * size_t(node.z));
+  }
+  size_t GetWrappedOffset(glm::ivec3 node) const
+  {
+    node = ((node % size) + size) % size;
+    return GetNodeOffset(node);
+  }
+
+  //calls func(node) for every node, z slices are split between threads
+  template<typename Func>
+  void ForEachNode(Func func)
+  {
+    CpuFFT::ParallelFor(size_t(size.z), settings.parallelSettings.threadsCount, [&](size_t zBegin, size_t zEnd)
+    {
+      for (int z = int(zBegin); z < int(zEnd); z++)
+        for (int y = 0; y < size.y; y++)
+          for (int x = 0; x < size.x; x++)
+            func(glm::ivec3(x, y, z));
+    });
+  }
+
+  void FieldsInit(int iterationIndex)
+  {
+    glm::vec3 volumeSize = settings.volumeMax - settings.volumeMin;
+    ForEachNode([&](glm::ivec3 node)
+    {
+      size_t offset = GetNodeOffset(node);
+      glm::vec3 normPos = (glm::vec3(node) + glm::vec3(0.5f)) / glm::vec3(size);
+      glm::vec3 worldPos = settings.volumeMin + volumeSize * normPos;
+
+      WaveFunc nodeWaveFunc = (iterationIndex == 0) ? glm::normalize(WaveFunc(1.0f, 0.0f, 0.01f, 0.0f)) : waveFunc[offset];
+      nodeWaveFunc = WaveFunc(glm::length(glm::vec2(nodeWaveFunc.x, nodeWaveFunc.y)), 0.0f, glm::length(glm::vec2(nodeWaveFunc.z, nodeWaveFunc.w)), 0.0f);
+
+      if (glm::length(normPos - glm::vec3(0.3f, 0.5f, 0.5f)) < 0.1f)
+        nodeWaveFunc = Mul(WavePhase(glm::vec3(0.25f * volumeSize.x, 0.25f * volumeSize.y, 0.0f) / settings.h, worldPos, 0.0f), nodeWaveFunc);
+      else if (glm::length(normPos - glm::vec3(0.7f, 0.5f, 0.5f)) < 0.1f)
+        nodeWaveFunc = Mul(WavePhase(glm::vec3(-0.25f * volumeSize.x, 0.25f * volumeSize.y, 0.0f) / settings.h, worldPos, 0.0f), nodeWaveFunc);
+      waveFunc[offset] = nodeWaveFunc;
+
+      if (iterationIndex == 0)
+        pressure[offset] = 0.0f;
+    });
+    StoreField(waveFunc, settings.storagePrecision.halfWaveFunc);
+  }
+
+  void ShrodingerSolveFFT()
+  {
+    CpuFFT::FFT3d(waveFunc.data(), size, true, settings.parallelSettings);
+    glm::vec3 sqrStep = stepSize * stepSize;
+    float pi = 3.1415926f;
+    ForEachNode([&](glm::ivec3 node)
+    {
+      glm::vec3 sins = glm::sin(pi * glm::vec3(node) / glm::vec3(size));
+      float lambda = glm::dot(-glm::vec3(4.0f) / sqrStep, sins * sins);
+      size_t offset = GetNodeOffset(node);
+      waveFunc[offset] = Mul(Polar(lambda * settings.timeStep * settings.h * 0.5f), waveFunc[offset]);
+    });
+    CpuFFT::FFT3d(waveFunc.data(), size, false, settings.parallelSettings);
+    StoreField(waveFunc, settings.storagePrecision.halfWaveFunc);
+  }
+
+  void ComputeVelocity()
+  {
+    const glm::ivec3 axes[3] = { glm::ivec3(1, 0, 0), glm::ivec3(0, 1, 0), glm::ivec3(0, 0, 1) };
+    ForEachNode([&](glm::ivec3 node)
+    {
+      WaveFunc center = waveFunc[GetNodeOffset(node)];
+      glm::vec3 edgeFluxes;
+      for (int axis = 0; axis < 3; axis++)
+      {
+        WaveFunc next = waveFunc[GetWrappedOffset(node + axes[axis])];
+        WaveFunc prev = waveFunc[GetWrappedOffset(node - axes[axis])];
+        edgeFluxes[axis] = Arg(0.5f * (Dot(Conjugate(center), next) + Dot(center, Conjugate(prev))));
+      }
+      velocity[GetNodeOffset(node)] = glm::vec4(settings.h * edgeFluxes * invStepSize, 0.0f);
+    });
+    StoreField(velocity, settings.storagePrecision.halfVelocity);
+  }
+
+  void ComputeDivergence()
+  {
+    const glm::ivec3 axes[3] = { glm::ivec3(1, 0, 0), glm::ivec3(0, 1, 0), glm::ivec3(0, 0, 1) };
+    ForEachNode([&](glm::ivec3 node)
+    {
+      float nodeDivergence = 0.0f;
+      for (int axis = 0; axis < 3; axis++)
+        nodeDivergence += (velocity[GetWrappedOffset(node + axes[axis])][axis] - velocity[GetWrappedOffset(node - axes[axis])][axis]) * 0.5f * invStepSize[axis];
+      divergence[GetNodeOffset(node)] = nodeDivergence;
+    });
+    StoreField(divergence, settings.storagePrecision.halfDivergence);
+  }
+
+  static CpuPoissonMultigrid::Settings GetPoissonSettings(const Settings &settings)
+  {
+    CpuPoissonMultigrid::Settings poissonSettings;
+    poissonSettings.parallelSettings = settings.parallelSettings;
+    return poissonSettings;
+  }
+
+  //pressure from the previous projection is the initial guess, so later frames usually need a single v-cycle
+  void SolvePoisson()
+  {
+    lastPoissonCyclesCount = 0;
+    switch (settings.poissonSolverType)
+    {
+      case PoissonSolverTypes::Spectral:
+      {
+        spectralPoissonSolver.Solve(pressure.data(), divergence.data());
+      }break;
+      case PoissonSolverTypes::Multigrid:
+      {
+        lastPoissonCyclesCount = poissonSolver.Solve(pressure.data(), divergence.data(), settings.poissonTolerance, settings.maxPoissonCyclesCount);
+      }break;
+      case PoissonSolverTypes::GaussSeidel:
+      {
+        poissonSolver.Smooth(pressure.data(), divergence.data(), settings.poissonIterationsCount);
+      }break;
+    }
+    //the solvers iterate in 32 bit and only their result is stored, so this is a lower bound of what a half pressure image
+    //that gets rounded after every gpu sweep would do
+    StoreField(pressure, settings.storagePrecision.halfPressure);
+    lastPoissonResidual = poissonSolver.ComputeRelativeResidual(pressure.data(), divergence.data());
+  }
+
+  void ProjectPressure()
+  {
+    ComputeVelocity();
+    ComputeDivergence();
+    SolvePoisson();
+    ForEachNode([&](glm::ivec3 node)
+    {
+      size_t offset = GetNodeOffset(node);
+      waveFunc[offset] = Mul(Polar(-pressure[offset] / settings.h), waveFunc[offset]);
+    });
+    StoreField(waveFunc, settings.storagePrecision.halfWaveFunc);
+  }
+
+  Settings settings;
+  glm::ivec3 size;
+  glm::vec3 stepSize;
+  glm::vec3 invStepSize;
+
+  std::vector<WaveFunc> waveFunc;
+  std::vector<glm::vec4> velocity;
+  std::vector<float> pressure;
+  std::vector<float> divergence;
+
+  CpuPoissonMultigrid poissonSolver;
+  CpuSpectralPoisson spectralPoissonSolver;
+  int lastPoissonCyclesCount = 0;
+  float lastPoissonResidual = 0.0f;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "../../Common/FFT/FFT.h"
+
+//cpu version of ShrodingerSolver's spectral poisson solve. on a periodic grid the 7 point laplacian is diagonal in the
+//fourier basis, so forward fft of the rhs, division by the laplacian eigenvalues and inverse fft solve it exactly in one go.
+//the constant mode has a zero eigenvalue, it's dropped which gives the zero-mean pressure
+class CpuSpectralPoisson
+{
+public:
+  CpuSpectralPoisson(glm::ivec3 size, glm::vec3 stepSize, const CpuFFT::Settings &settings)
+  {
+    this->size = size;
+    this->settings = settings;
+    spectrum.resize(size_t(size.x) * size_t(size.y) * size_t(size.z));
+
+    //-4 / step^2 * sin^2(pi * k / n) per axis, same as shrodingerSolveFFT.comp
+    for (int axis = 0; axis < 3; axis++)
+    {
+      axisEigenvalues[axis].resize(size[axis]);
+      for (int k = 0; k < size[axis]; k++)
+      {
+        float s = std::sin(3.1415926f * float(k) / float(size[axis]));
+        axisEigenvalues[axis][k] = -4.0f / (stepSize[axis] * stepSize[axis]) * s * s;
+      }
+    }
+  }
+
+  void Solve(float *pressure, const float *rhs)
+  {
+    //only the first complex number of the voxel is used, the second one is transformed along for free
+    for (size_t offset = 0; offset < spectrum.size(); offset++)
+      spectrum[offset] = glm::vec4(rhs[offset], 0.0f, 0.0f, 0.0f);
+    CpuFFT::FFT3d(spectrum.data(), size, true, settings);
+
+    CpuFFT::ParallelFor(size_t(size.z), settings.threadsCount, [&](size_t zBegin, size_t zEnd)
+    {
+      for (int z = int(zBegin); z < int(zEnd); z++)
+      {
+        for (int y = 0; y < size.y; y++)
+        {
+          for (int x = 0; x < size.x; x++)
+          {
+            float lambda = axisEigenvalues[0][x] + axisEigenvalues[1][y] + axisEigenvalues[2][z];
+            size_t offset = size_t(x) + size_t(size.x) * (size_t(y) + size_t(size.y) * size_t(z));
+            spectrum[offset] = lambda < 0.0f ? spectrum[offset] / lambda : glm::vec4(0.0f);
+          }
+        }
+      }
+    });
+
+    CpuFFT::FFT3d(spectrum.data(), size, false, settings);
+    for (size_t offset = 0; offset < spectrum.size(); offset++)
+      pressure[offset] = spectrum[offset].x;
+  }
+private:
+  glm::ivec3 size;
+  CpuFFT::Settings settings;
+  std::vector<float> axisEigenvalues[3];
+  std::vector<glm::vec4> spectrum;
+};
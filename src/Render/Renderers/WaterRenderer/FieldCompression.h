@@ -0,0 +1,317 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "../../Common/FFT/FFT.h"
+
+//lossy compression of rgba32f solver volumes for recordings. every 8^3 brick is quantized to 16 bits per component between
+//its own min and max, each value is predicted from the previous node of the brick and the zigzagged residual bytes are
+//entropy coded with order 0 rANS. one frequency table per field is shared by all bricks, bricks are independent streams
+//so they are encoded and decoded in parallel.
+//layout: uint16 freqs[256], uint32 brickSizes[bricksCount], then per brick float mins[4], float maxs[4], rANS stream
+namespace FieldCompression
+{
+  const int BrickSize = 8;
+  const size_t BrickNodesCount = BrickSize * BrickSize * BrickSize;
+  //2 bytes per component
+  const size_t BrickSymbolsCount = BrickNodesCount * 4 * 2;
+
+  const uint32_t ProbBits = 12;
+  const uint32_t ProbScale = 1u << ProbBits;
+  const uint32_t RansLowerBound = 1u << 23;
+
+  struct SymbolTable
+  {
+    uint32_t freqs[256];
+    uint32_t starts[256];
+    uint8_t slotSymbols[ProbScale];
+
+    void Build(const uint16_t *_freqs)
+    {
+      uint32_t start = 0;
+      for (int symbol = 0; symbol < 256; symbol++)
+      {
+        freqs[symbol] = _freqs[symbol];
+        starts[symbol] = start;
+        for (uint32_t slot = start; slot < start + freqs[symbol] && slot < ProbScale; slot++)
+          slotSymbols[slot] = uint8_t(symbol);
+        start += freqs[symbol];
+      }
+    }
+  };
+
+  //every symbol that occurs keeps at least 1, the rest of the scale goes to the most frequent ones
+  inline void NormalizeFreqs(const uint64_t *counts, uint16_t *freqs)
+  {
+    uint64_t totalCount = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+      totalCount += counts[symbol];
+    if (totalCount == 0)
+    {
+      for (int symbol = 0; symbol < 256; symbol++)
+        freqs[symbol] = symbol == 0 ? uint16_t(ProbScale) : 0;
+      return;
+    }
+    int64_t freqsSum = 0;
+    int maxSymbol = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+      uint64_t freq = counts[symbol] * ProbScale / totalCount;
+      freqs[symbol] = uint16_t((counts[symbol] > 0) ? std::max<uint64_t>(freq, 1) : 0);
+      freqsSum += freqs[symbol];
+      if (counts[symbol] > counts[maxSymbol])
+        maxSymbol = symbol;
+    }
+    while (freqsSum != int64_t(ProbScale))
+    {
+      if (freqsSum < int64_t(ProbScale))
+      {
+        freqs[maxSymbol]++;
+        freqsSum++;
+      }
+      else
+      {
+        int largestSymbol = 0;
+        for (int symbol = 0; symbol < 256; symbol++)
+        {
+          if (freqs[symbol] > freqs[largestSymbol])
+            largestSymbol = symbol;
+        }
+        freqs[largestSymbol]--;
+        freqsSum--;
+      }
+    }
+  }
+
+  inline glm::ivec3 GetBricksCount(glm::uvec3 volumeResolution)
+  {
+    return glm::ivec3(volumeResolution) / BrickSize;
+  }
+  inline size_t GetNodeOffset(glm::uvec3 volumeResolution, glm::ivec3 node)
+  {
+    return size_t(node.x) + size_t(volumeResolution.x) * (size_t(node.y) + size_t(volumeResolution.y) * size_t(node.z));
+  }
+  inline glm::ivec3 GetBrickOrigin(glm::ivec3 bricksCount, size_t brickIndex)
+  {
+    return glm::ivec3(int(brickIndex % bricksCount.x), int((brickIndex / bricksCount.x) % bricksCount.y), int(brickIndex / (size_t(bricksCount.x) * bricksCount.y))) * BrickSize;
+  }
+  //x-fastest within the brick
+  inline glm::ivec3 GetBrickNode(glm::ivec3 brickOrigin, size_t nodeIndex)
+  {
+    return brickOrigin + glm::ivec3(int(nodeIndex % BrickSize), int((nodeIndex / BrickSize) % BrickSize), int(nodeIndex / (BrickSize * BrickSize)));
+  }
+
+  struct BrickRange
+  {
+    float mins[4];
+    float maxs[4];
+  };
+
+  inline void QuantizeBrick(const glm::vec4 *field, glm::uvec3 volumeResolution, glm::ivec3 brickOrigin, BrickRange &range, uint8_t *symbols)
+  {
+    for (int component = 0; component < 4; component++)
+    {
+      range.mins[component] = std::numeric_limits<float>::max();
+      range.maxs[component] = -std::numeric_limits<float>::max();
+    }
+    for (size_t nodeIndex = 0; nodeIndex < BrickNodesCount; nodeIndex++)
+    {
+      glm::vec4 value = field[GetNodeOffset(volumeResolution, GetBrickNode(brickOrigin, nodeIndex))];
+      for (int component = 0; component < 4; component++)
+      {
+        range.mins[component] = std::min(range.mins[component], value[component]);
+        range.maxs[component] = std::max(range.maxs[component], value[component]);
+      }
+    }
+    for (int component = 0; component < 4; component++)
+    {
+      float valueRange = range.maxs[component] - range.mins[component];
+      float scale = valueRange > 0.0f ? 65535.0f / valueRange : 0.0f;
+      int prevValue = 0;
+      uint8_t *componentSymbols = symbols + component * BrickNodesCount * 2;
+      for (size_t nodeIndex = 0; nodeIndex < BrickNodesCount; nodeIndex++)
+      {
+        float value = field[GetNodeOffset(volumeResolution, GetBrickNode(brickOrigin, nodeIndex))][component];
+        int quantized = int((value - range.mins[component]) * scale + 0.5f);
+        int16_t residual = int16_t(uint16_t(quantized - prevValue));
+        uint16_t zigzag = uint16_t((uint16_t(residual) << 1) ^ uint16_t(residual >> 15));
+        componentSymbols[nodeIndex * 2 + 0] = uint8_t(zigzag & 0xff);
+        componentSymbols[nodeIndex * 2 + 1] = uint8_t(zigzag >> 8);
+        prevValue = quantized;
+      }
+    }
+  }
+
+  inline void DequantizeBrick(const uint8_t *symbols, const BrickRange &range, glm::uvec3 volumeResolution, glm::ivec3 brickOrigin, glm::vec4 *field)
+  {
+    for (int component = 0; component < 4; component++)
+    {
+      float step = (range.maxs[component] - range.mins[component]) / 65535.0f;
+      uint16_t quantized = 0;
+      const uint8_t *componentSymbols = symbols + component * BrickNodesCount * 2;
+      for (size_t nodeIndex = 0; nodeIndex < BrickNodesCount; nodeIndex++)
+      {
+        uint16_t zigzag = uint16_t(componentSymbols[nodeIndex * 2 + 0] | (componentSymbols[nodeIndex * 2 + 1] << 8));
+        uint16_t residual = uint16_t((zigzag >> 1) ^ uint16_t(-int(zigzag & 1)));
+        quantized = uint16_t(quantized + residual);
+        field[GetNodeOffset(volumeResolution, GetBrickNode(brickOrigin, nodeIndex))][component] = range.mins[component] + float(quantized) * step;
+      }
+    }
+  }
+
+  //symbols are encoded back to front so that the decoder reads the stream front to back
+  inline void EncodeSymbols(const uint8_t *symbols, size_t symbolsCount, const SymbolTable &table, std::vector<uint8_t> &dst)
+  {
+    std::vector<uint8_t> buffer(symbolsCount * 2 + 8);
+    uint8_t *ptr = buffer.data() + buffer.size();
+    uint32_t state = RansLowerBound;
+    for (size_t symbolIndex = symbolsCount; symbolIndex-- > 0;)
+    {
+      uint32_t freq = table.freqs[symbols[symbolIndex]];
+      uint32_t maxState = ((RansLowerBound >> ProbBits) << 8) * freq;
+      while (state >= maxState)
+      {
+        *--ptr = uint8_t(state & 0xff);
+        state >>= 8;
+      }
+      state = ((state / freq) << ProbBits) + (state % freq) + table.starts[symbols[symbolIndex]];
+    }
+    ptr -= 4;
+    for (int byteIndex = 0; byteIndex < 4; byteIndex++)
+      ptr[byteIndex] = uint8_t(state >> (byteIndex * 8));
+    dst.insert(dst.end(), ptr, buffer.data() + buffer.size());
+  }
+
+  inline bool DecodeSymbols(const uint8_t *src, size_t srcSize, const SymbolTable &table, uint8_t *symbols, size_t symbolsCount)
+  {
+    if (srcSize < 4)
+      return false;
+    const uint8_t *srcEnd = src + srcSize;
+    uint32_t state = uint32_t(src[0]) | (uint32_t(src[1]) << 8) | (uint32_t(src[2]) << 16) | (uint32_t(src[3]) << 24);
+    src += 4;
+    for (size_t symbolIndex = 0; symbolIndex < symbolsCount; symbolIndex++)
+    {
+      uint32_t slot = state & (ProbScale - 1);
+      uint8_t symbol = table.slotSymbols[slot];
+      symbols[symbolIndex] = symbol;
+      state = table.freqs[symbol] * (state >> ProbBits) + slot - table.starts[symbol];
+      while (state < RansLowerBound)
+      {
+        if (src == srcEnd)
+          return false;
+        state = (state << 8) | *src++;
+      }
+    }
+    return true;
+  }
+
+  //volume resolution has to be a multiple of BrickSize
+  inline std::vector<uint8_t> Compress(const glm::vec4 *field, glm::uvec3 volumeResolution, const CpuFFT::Settings &parallelSettings = CpuFFT::Settings())
+  {
+    glm::ivec3 bricksCount = GetBricksCount(volumeResolution);
+    size_t totalBricksCount = size_t(bricksCount.x) * size_t(bricksCount.y) * size_t(bricksCount.z);
+    std::vector<BrickRange> ranges(totalBricksCount);
+    std::vector<uint8_t> symbols(totalBricksCount * BrickSymbolsCount);
+
+    uint64_t counts[256] = {};
+    std::mutex countsMutex;
+    CpuFFT::ParallelFor(totalBricksCount, parallelSettings.threadsCount, [&](size_t brickBegin, size_t brickEnd)
+    {
+      uint64_t threadCounts[256] = {};
+      for (size_t brickIndex = brickBegin; brickIndex < brickEnd; brickIndex++)
+      {
+        uint8_t *brickSymbols = symbols.data() + brickIndex * BrickSymbolsCount;
+        QuantizeBrick(field, volumeResolution, GetBrickOrigin(bricksCount, brickIndex), ranges[brickIndex], brickSymbols);
+        for (size_t symbolIndex = 0; symbolIndex < BrickSymbolsCount; symbolIndex++)
+          threadCounts[brickSymbols[symbolIndex]]++;
+      }
+      std::lock_guard<std::mutex> lock(countsMutex);
+      for (int symbol = 0; symbol < 256; symbol++)
+        counts[symbol] += threadCounts[symbol];
+    });
+
+    uint16_t freqs[256];
+    NormalizeFreqs(counts, freqs);
+    std::unique_ptr<SymbolTable> table(new SymbolTable());
+    table->Build(freqs);
+
+    std::vector<std::vector<uint8_t>> brickStreams(totalBricksCount);
+    CpuFFT::ParallelFor(totalBricksCount, parallelSettings.threadsCount, [&](size_t brickBegin, size_t brickEnd)
+    {
+      for (size_t brickIndex = brickBegin; brickIndex < brickEnd; brickIndex++)
+      {
+        auto &stream = brickStreams[brickIndex];
+        stream.resize(sizeof(BrickRange));
+        memcpy(stream.data(), &ranges[brickIndex], sizeof(BrickRange));
+        EncodeSymbols(symbols.data() + brickIndex * BrickSymbolsCount, BrickSymbolsCount, *table, stream);
+      }
+    });
+
+    std::vector<uint8_t> res(sizeof(freqs) + totalBricksCount * sizeof(uint32_t));
+    memcpy(res.data(), freqs, sizeof(freqs));
+    for (size_t brickIndex = 0; brickIndex < totalBricksCount; brickIndex++)
+    {
+      uint32_t brickSize = uint32_t(brickStreams[brickIndex].size());
+      memcpy(res.data() + sizeof(freqs) + brickIndex * sizeof(uint32_t), &brickSize, sizeof(uint32_t));
+    }
+    for (auto &stream : brickStreams)
+      res.insert(res.end(), stream.begin(), stream.end());
+    return res;
+  }
+
+  inline bool Decompress(const uint8_t *data, size_t dataSize, glm::uvec3 volumeResolution, glm::vec4 *field, const CpuFFT::Settings &parallelSettings = CpuFFT::Settings())
+  {
+    glm::ivec3 bricksCount = GetBricksCount(volumeResolution);
+    size_t totalBricksCount = size_t(bricksCount.x) * size_t(bricksCount.y) * size_t(bricksCount.z);
+    size_t tablesSize = 256 * sizeof(uint16_t) + totalBricksCount * sizeof(uint32_t);
+    if (dataSize < tablesSize)
+      return false;
+
+    uint16_t freqs[256];
+    memcpy(freqs, data, sizeof(freqs));
+    std::unique_ptr<SymbolTable> table(new SymbolTable());
+    table->Build(freqs);
+
+    std::vector<size_t> brickOffsets(totalBricksCount + 1);
+    brickOffsets[0] = tablesSize;
+    for (size_t brickIndex = 0; brickIndex < totalBricksCount; brickIndex++)
+    {
+      uint32_t brickSize;
+      memcpy(&brickSize, data + sizeof(freqs) + brickIndex * sizeof(uint32_t), sizeof(uint32_t));
+      brickOffsets[brickIndex + 1] = brickOffsets[brickIndex] + brickSize;
+    }
+    if (brickOffsets.back() > dataSize)
+      return false;
+
+    std::atomic<bool> isValid(true);
+    CpuFFT::ParallelFor(totalBricksCount, parallelSettings.threadsCount, [&](size_t brickBegin, size_t brickEnd)
+    {
+      std::vector<uint8_t> symbols(BrickSymbolsCount);
+      for (size_t brickIndex = brickBegin; brickIndex < brickEnd; brickIndex++)
+      {
+        const uint8_t *brickData = data + brickOffsets[brickIndex];
+        size_t brickSize = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+        BrickRange range;
+        if (brickSize < sizeof(BrickRange))
+        {
+          isValid = false;
+          return;
+        }
+        memcpy(&range, brickData, sizeof(BrickRange));
+        if (!DecodeSymbols(brickData + sizeof(BrickRange), brickSize - sizeof(BrickRange), *table, symbols.data(), BrickSymbolsCount))
+        {
+          isValid = false;
+          return;
+        }
+        DequantizeBrick(symbols.data(), range, volumeResolution, GetBrickOrigin(bricksCount, brickIndex), field);
+      }
+    });
+    return isValid;
+  }
+}
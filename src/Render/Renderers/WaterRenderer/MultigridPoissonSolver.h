@@ -0,0 +1,402 @@
+#pragma once
+#include "../../Common/HostReadBarrier.h"
+
+//pressure poisson solve for the water solvers: geometric multigrid v-cycles, or the plain red-black gauss-seidel sweeps of
+//poissonIteration.comp. the smoother is poissonIteration.comp run on every level with the level's resolution and step size,
+//Multigrid/restrict.comp and Multigrid/prolongate.comp move between levels. CpuPoissonMultigrid does exactly the same on the cpu.
+//the gpu can't stop when converged, so the max norm of the residual is read back a few frames later and the number of
+//v-cycles (or sweeps) per solve is adjusted until it stays under the tolerance
+class MultigridPoissonSolver
+{
+public:
+  MultigridPoissonSolver(legit::Core *_core)
+  {
+    this->core = _core;
+    this->useMultigrid = true;
+    this->tolerance = 1e-3f;
+    this->cyclesCount = 1;
+    this->sweepsCount = 20;
+    this->lastRelativeResidual = 0.0f;
+    ReloadShaders();
+  }
+
+  void RecreateSceneResources(glm::uvec3 volumeResolution)
+  {
+    coarseLevels.clear();
+    glm::uvec3 levelResolution = volumeResolution / 2u;
+    while (levelResolution.x >= MinLevelSize && levelResolution.y >= MinLevelSize && levelResolution.z >= MinLevelSize)
+    {
+      coarseLevels.emplace_back(new Level(core->GetRenderGraph(), levelResolution));
+      levelResolution /= 2u;
+    }
+    this->volumeResolution = volumeResolution;
+
+    residualStatsBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(ResidualStats), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+    ResidualStats initialResidualStats = {};
+    memcpy(residualStatsBuffer->Map(), &initialResidualStats, sizeof(ResidualStats));
+    residualStatsBuffer->Unmap();
+    residualStatsProxy = core->GetRenderGraph()->AddExternalBuffer(residualStatsBuffer.get());
+  }
+
+  //once per frame before any Solve(): reads back the residual of an earlier frame, adjusts the iterations count and shows the controls
+  template<typename SimulationData>
+  void BeginFrame(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData)
+  {
+    ResidualStats residualStats;
+    memcpy(&residualStats, residualStatsBuffer->Map(), sizeof(ResidualStats));
+    residualStatsBuffer->Unmap();
+    lastRelativeResidual = residualStats.lastMaxResidual / std::max(residualStats.lastMaxRhs, 1e-20f);
+
+    //grows fast so a disturbance gets solved within a few frames, shrinks slowly so it doesn't oscillate
+    int &count = useMultigrid ? cyclesCount : sweepsCount;
+    int maxCount = useMultigrid ? MaxCyclesCount : MaxSweepsCount;
+    if (lastRelativeResidual > tolerance)
+      count = std::min(count * 2, maxCount);
+    else if (lastRelativeResidual < tolerance * 0.25f)
+      count = std::max(count - 1, 1);
+
+    ImGui::Checkbox("Multigrid poisson", &useMultigrid);
+    ImGui::SliderFloat("Poisson tolerance", &tolerance, 1e-5f, 1e-1f, "%.0e", 10.0f);
+    ImGui::Text("Poisson residual %.2e, %d %s per solve", lastRelativeResidual, count, useMultigrid ? "v-cycles" : "sweeps");
+
+    AddResetStatsPass(memoryPool, simulationData);
+  }
+
+  //simulationData describes the finest level, pressure is the initial guess and gets the solution
+  template<typename SimulationData>
+  void Solve(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy)
+  {
+    if (useMultigrid)
+    {
+      for (int cycleIndex = 0; cycleIndex < cyclesCount; cycleIndex++)
+        VCycle(memoryPool, simulationData, 0, pressureVolumeProxy, divergenceVolumeProxy);
+    }
+    else
+    {
+      Smooth(memoryPool, simulationData, pressureVolumeProxy, divergenceVolumeProxy, sweepsCount);
+    }
+    AddResidualNormPass(memoryPool, simulationData, pressureVolumeProxy, divergenceVolumeProxy);
+  }
+
+  void ReloadShaders()
+  {
+    poissonIterationShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/poissonIteration.comp.spv"));
+    restrictShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/Multigrid/restrict.comp.spv"));
+    prolongateShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/Multigrid/prolongate.comp.spv"));
+    residualNormShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/Multigrid/residualNorm.comp.spv"));
+    residualStatsResetShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/Multigrid/residualStatsReset.comp.spv"));
+  }
+private:
+  const static uint32_t ShaderDataSetIndex = 0;
+  //poissonIteration.comp dispatches half of the nodes along x in 8-wide groups
+  const static uint32_t MinLevelSize = 16;
+  const static int PreSmoothIterations = 2;
+  const static int PostSmoothIterations = 2;
+  const static int CoarseIterations = 32;
+  const static int MaxCyclesCount = 16;
+  const static int MaxSweepsCount = 512;
+
+  //layout matches Multigrid/residualStats.decl, the shaders treat the maximums as uint bits
+  struct ResidualStats
+  {
+    float maxResidual;
+    float maxRhs;
+    float lastMaxResidual;
+    float lastMaxRhs;
+  };
+
+  //transient, coarse levels only exist during the solve
+  struct Level
+  {
+    Level(legit::RenderGraph *renderGraph, glm::uvec3 _resolution) :
+      pressureVolumeProxy(renderGraph, vk::Format::eR32Sfloat, _resolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage),
+      divergenceVolumeProxy(renderGraph, vk::Format::eR32Sfloat, _resolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage)
+    {
+      this->resolution = _resolution;
+    }
+    VolumeProxy pressureVolumeProxy;
+    VolumeProxy divergenceVolumeProxy;
+    glm::uvec3 resolution;
+  };
+
+  template<typename SimulationData>
+  static SimulationData GetLevelData(SimulationData simulationData, glm::uvec3 resolution)
+  {
+    glm::vec3 stepSize = (glm::vec3(simulationData.volumeMax) - glm::vec3(simulationData.volumeMin)) / glm::vec3(resolution);
+    simulationData.volumeResolution = glm::uvec4(resolution, 0);
+    simulationData.stepSize = glm::vec4(stepSize, 0.0f);
+    simulationData.invStepSize = glm::vec4(glm::vec3(1.0f) / stepSize, 0.0f);
+    return simulationData;
+  }
+
+  template<typename SimulationData>
+  void VCycle(legit::ShaderMemoryPool *memoryPool, SimulationData levelData, size_t levelIndex, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy)
+  {
+    if (levelIndex == coarseLevels.size())
+    {
+      Smooth(memoryPool, levelData, pressureVolumeProxy, divergenceVolumeProxy, CoarseIterations);
+      return;
+    }
+    Level *coarseLevel = coarseLevels[levelIndex].get();
+    auto coarsePressureProxy = coarseLevel->pressureVolumeProxy.imageViewProxy->Id();
+    auto coarseDivergenceProxy = coarseLevel->divergenceVolumeProxy.imageViewProxy->Id();
+
+    Smooth(memoryPool, levelData, pressureVolumeProxy, divergenceVolumeProxy, PreSmoothIterations);
+    AddRestrictPass(memoryPool, levelData, pressureVolumeProxy, divergenceVolumeProxy, coarsePressureProxy, coarseDivergenceProxy);
+    VCycle(memoryPool, GetLevelData(levelData, coarseLevel->resolution), levelIndex + 1, coarsePressureProxy, coarseDivergenceProxy);
+    AddProlongatePass(memoryPool, levelData, coarsePressureProxy, pressureVolumeProxy);
+    Smooth(memoryPool, levelData, pressureVolumeProxy, divergenceVolumeProxy, PostSmoothIterations);
+  }
+
+  template<typename SimulationData>
+  void Smooth(legit::ShaderMemoryPool *memoryPool, SimulationData levelData, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy, int iterationsCount)
+  {
+    glm::uvec3 resolution = glm::uvec3(levelData.volumeResolution);
+    for (int i = 0; i < iterationsCount; i++)
+    {
+      for (int phase = 0; phase < 2; phase++)
+      {
+        levelData.iterationIndex = phase;
+        core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+          .SetStorageImages({ pressureVolumeProxy, divergenceVolumeProxy })
+          .SetProfilerInfo(legit::Colors::emerald, "PassPoissonIteration")
+          .SetRecordFunc([this, memoryPool, levelData, resolution, pressureVolumeProxy, divergenceVolumeProxy](legit::RenderGraph::PassContext passContext)
+        {
+          auto shader = poissonIterationShader.compute.get();
+          auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+          {
+            const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+            auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+            {
+              auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+              *shaderPassDataBuffer = levelData;
+            }
+            memoryPool->EndSet();
+
+            std::vector<legit::StorageImageBinding> storageImageBindings;
+            auto pressureVolumeView = passContext.GetImageView(pressureVolumeProxy);
+            storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("pressureImage", pressureVolumeView));
+            auto divergenceVolumeView = passContext.GetImageView(divergenceVolumeProxy);
+            storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("divergenceImage", divergenceVolumeView));
+
+            auto shaderDataSetBindings = legit::DescriptorSetBindings()
+              .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+              .SetStorageImageBindings(storageImageBindings);
+
+            auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+            passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+            glm::uvec3 workGroupSize = shader->GetLocalSize();
+            passContext.GetCommandBuffer().dispatch(
+              uint32_t(resolution.x / workGroupSize.x / 2), //because of checkerboard
+              uint32_t(resolution.y / workGroupSize.y),
+              uint32_t(resolution.z / workGroupSize.z));
+          }
+        }));
+      }
+    }
+  }
+
+  template<typename SimulationData>
+  void AddRestrictPass(legit::ShaderMemoryPool *memoryPool, SimulationData levelData, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy, legit::RenderGraph::ImageViewProxyId coarsePressureProxy, legit::RenderGraph::ImageViewProxyId coarseDivergenceProxy)
+  {
+    glm::uvec3 coarseResolution = glm::uvec3(levelData.volumeResolution) / 2u;
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageImages({ pressureVolumeProxy, divergenceVolumeProxy, coarsePressureProxy, coarseDivergenceProxy })
+      .SetProfilerInfo(legit::Colors::emerald, "PassMultigridRestrict")
+      .SetRecordFunc([this, memoryPool, levelData, coarseResolution, pressureVolumeProxy, divergenceVolumeProxy, coarsePressureProxy, coarseDivergenceProxy](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = restrictShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+          *shaderPassDataBuffer = levelData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageImageBinding> storageImageBindings;
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("pressureImage", passContext.GetImageView(pressureVolumeProxy)));
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("divergenceImage", passContext.GetImageView(divergenceVolumeProxy)));
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("coarsePressureImage", passContext.GetImageView(coarsePressureProxy)));
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("coarseDivergenceImage", passContext.GetImageView(coarseDivergenceProxy)));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageImageBindings(storageImageBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        glm::uvec3 workGroupSize = shader->GetLocalSize();
+        passContext.GetCommandBuffer().dispatch(
+          uint32_t(coarseResolution.x / workGroupSize.x),
+          uint32_t(coarseResolution.y / workGroupSize.y),
+          uint32_t(coarseResolution.z / workGroupSize.z));
+      }
+    }));
+  }
+
+  template<typename SimulationData>
+  void AddProlongatePass(legit::ShaderMemoryPool *memoryPool, SimulationData levelData, legit::RenderGraph::ImageViewProxyId coarsePressureProxy, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy)
+  {
+    glm::uvec3 resolution = glm::uvec3(levelData.volumeResolution);
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageImages({ coarsePressureProxy, pressureVolumeProxy })
+      .SetProfilerInfo(legit::Colors::emerald, "PassMultigridProlongate")
+      .SetRecordFunc([this, memoryPool, levelData, resolution, coarsePressureProxy, pressureVolumeProxy](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = prolongateShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+          *shaderPassDataBuffer = levelData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageImageBinding> storageImageBindings;
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("coarsePressureImage", passContext.GetImageView(coarsePressureProxy)));
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("pressureImage", passContext.GetImageView(pressureVolumeProxy)));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageImageBindings(storageImageBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        glm::uvec3 workGroupSize = shader->GetLocalSize();
+        passContext.GetCommandBuffer().dispatch(
+          uint32_t(resolution.x / workGroupSize.x),
+          uint32_t(resolution.y / workGroupSize.y),
+          uint32_t(resolution.z / workGroupSize.z));
+      }
+    }));
+  }
+
+  template<typename SimulationData>
+  void AddResidualNormPass(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy)
+  {
+    glm::uvec3 resolution = glm::uvec3(simulationData.volumeResolution);
+    legit::RenderGraph::BufferProxyId residualStatsProxyId = residualStatsProxy->Id();
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers({ residualStatsProxyId })
+      .SetStorageImages({ pressureVolumeProxy, divergenceVolumeProxy })
+      .SetProfilerInfo(legit::Colors::emerald, "PassPoissonResidualNorm")
+      .SetRecordFunc([this, memoryPool, simulationData, resolution, residualStatsProxyId, pressureVolumeProxy, divergenceVolumeProxy](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = residualNormShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+          *shaderPassDataBuffer = simulationData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageBufferBinding> storageBufferBindings;
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("ResidualStatsBuffer", passContext.GetBuffer(residualStatsProxyId)));
+
+        std::vector<legit::StorageImageBinding> storageImageBindings;
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("pressureImage", passContext.GetImageView(pressureVolumeProxy)));
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("divergenceImage", passContext.GetImageView(divergenceVolumeProxy)));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageBufferBindings(storageBufferBindings)
+          .SetStorageImageBindings(storageImageBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        glm::uvec3 workGroupSize = shader->GetLocalSize();
+        passContext.GetCommandBuffer().dispatch(
+          uint32_t(resolution.x / workGroupSize.x),
+          uint32_t(resolution.y / workGroupSize.y),
+          uint32_t(resolution.z / workGroupSize.z));
+        //BeginFrame reads the stats back
+        AddHostReadBarrier(passContext.GetCommandBuffer());
+      }
+    }));
+  }
+
+  template<typename SimulationData>
+  void AddResetStatsPass(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData)
+  {
+    legit::RenderGraph::BufferProxyId residualStatsProxyId = residualStatsProxy->Id();
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers({ residualStatsProxyId })
+      .SetProfilerInfo(legit::Colors::emerald, "PassPoissonResidualReset")
+      .SetRecordFunc([this, memoryPool, simulationData, residualStatsProxyId](legit::RenderGraph::PassContext passContext)
+    {
+      auto shader = residualStatsResetShader.compute.get();
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+          *shaderPassDataBuffer = simulationData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageBufferBinding> storageBufferBindings;
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("ResidualStatsBuffer", passContext.GetBuffer(residualStatsProxyId)));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageBufferBindings(storageBufferBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+        passContext.GetCommandBuffer().dispatch(1, 1, 1);
+        AddHostReadBarrier(passContext.GetCommandBuffer());
+      }
+    }));
+  }
+
+  struct PoissonIterationShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } poissonIterationShader;
+
+  struct RestrictShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } restrictShader;
+
+  struct ProlongateShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } prolongateShader;
+
+  struct ResidualNormShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } residualNormShader;
+
+  struct ResidualStatsResetShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } residualStatsResetShader;
+
+  std::vector<std::unique_ptr<Level>> coarseLevels;
+  glm::uvec3 volumeResolution;
+  std::unique_ptr<legit::Buffer> residualStatsBuffer;
+  legit::RenderGraph::BufferProxyUnique residualStatsProxy;
+
+  bool useMultigrid;
+  float tolerance;
+  int cyclesCount;
+  int sweepsCount;
+  float lastRelativeResidual;
+
+  legit::Core *core;
+};
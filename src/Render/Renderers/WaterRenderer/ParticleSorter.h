@@ -0,0 +1,185 @@
+#pragma once
+#include "CpuParticleSort.h"
+
+//reorders particles by the morton code of the velocity grid cell they're in. particles start in a coherent order but the flow
+//mixes them, so neighbouring invocations of particlesAdvect.comp and of the bucketing passes end up touching unrelated parts
+//of the volume and of the buckets. sorted with a stable lsd radix sort: per workgroup digit counts, one scan of all counts,
+//scatter by the rank within the workgroup. CpuParticleSort runs the same steps on the cpu.
+//has to be included after Point is defined
+class ParticleSorter
+{
+public:
+  ParticleSorter(legit::Core *_core)
+  {
+    this->core = _core;
+    ReloadShaders();
+  }
+
+  //keys have 10 bits per axis so the grid can't be larger than 1024^3
+  void RecreateSceneResources(size_t particlesCount, glm::uvec3 gridResolution, glm::vec3 volumeMin, glm::vec3 volumeMax)
+  {
+    assert(glm::all(glm::lessThanEqual(gridResolution, glm::uvec3(1024))));
+    this->particlesCount = particlesCount;
+    this->groupsCount = uint32_t((particlesCount + CpuParticleSort::GroupSize - 1) / CpuParticleSort::GroupSize);
+    this->keyBitsCount = CpuParticleSort::GetKeyBitsCount(gridResolution);
+
+    sortData.gridResolution = glm::uvec4(gridResolution, 0);
+    sortData.volumeMin = glm::vec4(volumeMin, 0.0f);
+    sortData.volumeMax = glm::vec4(volumeMax, 0.0f);
+    sortData.particlesCount = glm::uint(particlesCount);
+    sortData.groupsCount = groupsCount;
+    sortData.digitShift = 0;
+    sortData.padding = 0;
+
+    auto renderGraph = core->GetRenderGraph();
+    for (int pingPongIndex = 0; pingPongIndex < 2; pingPongIndex++)
+    {
+      keysProxies[pingPongIndex] = renderGraph->AddBuffer<glm::uint>(uint32_t(particlesCount));
+      valuesProxies[pingPongIndex] = renderGraph->AddBuffer<glm::uint>(uint32_t(particlesCount));
+    }
+    histogramsProxy = renderGraph->AddBuffer<glm::uint>(groupsCount * CpuParticleSort::RadixSize);
+    sortedPointsProxy = renderGraph->AddBuffer<Point>(uint32_t(particlesCount));
+  }
+
+  //permutes the particles in place, everything that refers to particles by index has to be rebuilt afterwards
+  void Sort(legit::ShaderMemoryPool *memoryPool, legit::RenderGraph::BufferProxyId pointsDataProxyId)
+  {
+    if (particlesCount == 0)
+      return;
+    AddSortPass(memoryPool, keysShader.compute.get(), "PassParticlesSortKeys", groupsCount, 0, { { "PointsBuffer", pointsDataProxyId }, { "DstKeysBuffer", keysProxies[0]->Id() }, { "DstValuesBuffer", valuesProxies[0]->Id() } });
+
+    int srcIndex = 0;
+    for (uint32_t passIndex = 0; passIndex < CpuParticleSort::GetPassesCount(keyBitsCount); passIndex++)
+    {
+      uint32_t digitShift = passIndex * CpuParticleSort::RadixBits;
+      int dstIndex = 1 - srcIndex;
+      AddSortPass(memoryPool, countShader.compute.get(), "PassRadixSortCount", groupsCount, digitShift, { { "SrcKeysBuffer", keysProxies[srcIndex]->Id() }, { "HistogramsBuffer", histogramsProxy->Id() } });
+      AddSortPass(memoryPool, scanShader.compute.get(), "PassRadixSortScan", 1, digitShift, { { "HistogramsBuffer", histogramsProxy->Id() } });
+      AddSortPass(memoryPool, scatterShader.compute.get(), "PassRadixSortScatter", groupsCount, digitShift, {
+        { "SrcKeysBuffer", keysProxies[srcIndex]->Id() },
+        { "SrcValuesBuffer", valuesProxies[srcIndex]->Id() },
+        { "DstKeysBuffer", keysProxies[dstIndex]->Id() },
+        { "DstValuesBuffer", valuesProxies[dstIndex]->Id() },
+        { "HistogramsBuffer", histogramsProxy->Id() } });
+      srcIndex = dstIndex;
+    }
+
+    AddSortPass(memoryPool, permuteShader.compute.get(), "PassParticlesPermute", groupsCount, 0, { { "PointsBuffer", pointsDataProxyId }, { "SrcValuesBuffer", valuesProxies[srcIndex]->Id() }, { "SortedPointsBuffer", sortedPointsProxy->Id() } });
+    AddSortPass(memoryPool, copyShader.compute.get(), "PassParticlesCopy", groupsCount, 0, { { "SortedPointsBuffer", sortedPointsProxy->Id() }, { "PointsBuffer", pointsDataProxyId } });
+  }
+
+  void ReloadShaders()
+  {
+    keysShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ParticleSort/particlesSortKeys.comp.spv"));
+    countShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ParticleSort/radixSortCount.comp.spv"));
+    scanShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ParticleSort/radixSortScan.comp.spv"));
+    scatterShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ParticleSort/radixSortScatter.comp.spv"));
+    permuteShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ParticleSort/particlesPermute.comp.spv"));
+    copyShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ParticleSort/particlesCopy.comp.spv"));
+  }
+private:
+  const static uint32_t ShaderDataSetIndex = 0;
+
+  #pragma pack(push, 1)
+  struct SortData
+  {
+    glm::uvec4 gridResolution;
+    glm::vec4 volumeMin;
+    glm::vec4 volumeMax;
+    glm::uint particlesCount;
+    glm::uint groupsCount;
+    glm::uint digitShift;
+    glm::uint padding;
+  };
+  #pragma pack(pop)
+
+  struct BufferBinding
+  {
+    std::string name;
+    legit::RenderGraph::BufferProxyId bufferProxyId;
+  };
+
+  //every pass is one invocation per particle with storage buffers only, except the scan that runs as a single workgroup
+  void AddSortPass(legit::ShaderMemoryPool *memoryPool, legit::Shader *shader, const char *passName, uint32_t groupsCount, uint32_t digitShift, std::vector<BufferBinding> bufferBindings)
+  {
+    std::vector<legit::RenderGraph::BufferProxyId> storageBuffers;
+    for (auto &bufferBinding : bufferBindings)
+      storageBuffers.push_back(bufferBinding.bufferProxyId);
+
+    SortData passSortData = sortData;
+    passSortData.digitShift = digitShift;
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers(std::move(storageBuffers))
+      .SetProfilerInfo(legit::Colors::emerald, passName)
+      .SetRecordFunc([this, memoryPool, passSortData, shader, groupsCount, bufferBindings](legit::RenderGraph::PassContext passContext)
+    {
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SortData>("SortDataBuffer");
+          *shaderPassDataBuffer = passSortData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageBufferBinding> storageBufferBindings;
+        for (auto &bufferBinding : bufferBindings)
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding(bufferBinding.name, passContext.GetBuffer(bufferBinding.bufferProxyId)));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageBufferBindings(storageBufferBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        //the count and scatter passes index histograms by workgroup, so there can't be any extra workgroups
+        assert(shader->GetLocalSize().x == CpuParticleSort::GroupSize);
+        passContext.GetCommandBuffer().dispatch(groupsCount, 1, 1);
+      }
+    }));
+  }
+
+  struct KeysShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } keysShader;
+
+  struct CountShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } countShader;
+
+  struct ScanShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } scanShader;
+
+  struct ScatterShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } scatterShader;
+
+  struct PermuteShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } permuteShader;
+
+  struct CopyShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } copyShader;
+
+  //transient, only live through the sort
+  legit::RenderGraph::BufferProxyUnique keysProxies[2];
+  legit::RenderGraph::BufferProxyUnique valuesProxies[2];
+  legit::RenderGraph::BufferProxyUnique histogramsProxy;
+  legit::RenderGraph::BufferProxyUnique sortedPointsProxy;
+
+  SortData sortData;
+  size_t particlesCount = 0;
+  uint32_t groupsCount = 0;
+  uint32_t keyBitsCount = 0;
+  legit::Core *core;
+};
@@ -1,4 +1,7 @@
 #include "../../Common/FFT/FFTRenderer.h"
+#include "BakedVelocityFrames.h"
+#include "MultigridPoissonSolver.h"
+#include "SpectralPoissonSolver.h"
 #pragma once
 
 #pragma pack(push, 1)
@@ -18,10 +21,22 @@ class ShrodingerSolver
 {
 public:
   ShrodingerSolver(legit::Core *_core) :
-    fftRenderer(_core)
+    fftRenderer(_core),
+    poissonSolver(_core),
+    spectralPoissonSolver(_core, &fftRenderer)
   {
     //FFT_Test();
     this->core = _core;
+    this->framesInFlightCount = 1;
+    this->isFieldsInitNeeded = true;
+    this->useSpectralPoisson = true;
+    this->useHalfVelocity = false;
+    this->useShrodingerFFT = true;
+    this->recordWaveFunc = false;
+    this->cflTarget = 0.5f;
+    this->maxWaveFuncChange = 0.25f;
+    this->substepsCount = 1;
+    this->solveSubstepsCount = 10;
     linearSampler.reset(new legit::Sampler(core->GetLogicalDevice(), vk::SamplerAddressMode::eClampToEdge, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear));
 
     ReloadShaders();
@@ -34,13 +49,114 @@ public:
   void RecreateSwapchainResources(glm::uvec2 viewportSize, size_t framesInFlightCount, size_t maxMipsCount = std::numeric_limits<size_t>::max())
   {
     //viewportResources.reset(new ViewportResources(core, viewportSize, maxMipsCount));
+    this->framesInFlightCount = framesInFlightCount;
   }
 
   void RecreateSceneResources(glm::uvec3 volumeResolution, glm::vec3 volumeMin, glm::vec3 volumeMax)
   {
-    sceneResources.reset(new SceneResources(core, volumeResolution, volumeMin, volumeMax));
+    StopRecording();
+    bakedVelocity.reset();
+    sceneResources.reset(new SceneResources(core, volumeResolution, volumeMin, volumeMax, GetVelocityFormat()));
+    poissonSolver.RecreateSceneResources(volumeResolution);
+    spectralPoissonSolver.RecreateSceneResources(volumeResolution);
+    isFieldsInitNeeded = true;
+
+    stepStatsBuffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(StepStats), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+    StepStats initialStepStats = {};
+    memcpy(stepStatsBuffer->Map(), &initialStepStats, sizeof(StepStats));
+    stepStatsBuffer->Unmap();
+    stepStatsProxy = core->GetRenderGraph()->AddExternalBuffer(stepStatsBuffer.get());
   }
+
+  //velocity baked offline by ShrodingerBake or recorded from this solver. the volume is recreated to match the file,
+  //particles are then moved by the played back frames instead of the live solver until playback is unchecked. if the file
+  //has the wave function too, it's played back as well so the live solver resumes from the last played frame
+  bool LoadBakedVelocity(std::string filename)
+  {
+    //a recording of the same file has to be complete before it's mapped
+    StopRecording();
+    std::unique_ptr<BakedVelocity> newBakedVelocity(new BakedVelocity());
+    if (!newBakedVelocity->reader.Open(filename))
+    {
+      std::cout << "Can't load baked velocity " << filename << "\n";
+      return false;
+    }
+    const auto &header = newBakedVelocity->reader.GetHeader();
+    core->WaitIdle();
+    RecreateSceneResources(header.GetVolumeResolution(), glm::vec3(header.volumeMin[0], header.volumeMin[1], header.volumeMin[2]), glm::vec3(header.volumeMax[0], header.volumeMax[1], header.volumeMax[2]));
+
+    //one upload buffer per frame in flight so a frame is never overwritten while the gpu still reads it
+    size_t buffersCount = framesInFlightCount * header.fieldsCount;
+    for (size_t bufferIndex = 0; bufferIndex < buffersCount; bufferIndex++)
+    {
+      auto buffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), header.GetFieldSize(), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+      newBakedVelocity->uploadProxies.push_back(core->GetRenderGraph()->AddExternalBuffer(buffer.get()));
+      newBakedVelocity->uploadBuffers.push_back(std::move(buffer));
+    }
+    newBakedVelocity->frameIndex = 0;
+    bakedVelocity = std::move(newBakedVelocity);
+    std::cout << "Loaded " << bakedVelocity->reader.GetFramesCount() << " baked velocity frames from " << filename << "\n";
+    return true;
+  }
+
+  //fields are copied into host visible buffers on gpu and written to disk framesInFlightCount frames later, once the frame
+  //that filled them is complete. compression and writing run on another thread so recording doesn't stall the frame
+  bool StartRecording(std::string filename, bool recordWaveFunc)
+  {
+    StopRecording();
+    std::unique_ptr<Recording> newRecording(new Recording());
+    uint32_t fieldsCount = recordWaveFunc ? 2 : 1;
+    if (!newRecording->writer.Open(filename, sceneResources->volumeResolution, sceneResources->volumeMin, sceneResources->volumeMax, simulationData.timeStep, simulationData.h, fieldsCount, BakedVelocityHeader::BrickRans))
+    {
+      std::cout << "Can't record to " << filename << "\n";
+      return false;
+    }
+    const auto &header = newRecording->writer.GetHeader();
+    size_t buffersCount = framesInFlightCount * fieldsCount;
+    for (size_t bufferIndex = 0; bufferIndex < buffersCount; bufferIndex++)
+    {
+      auto buffer = std::unique_ptr<legit::Buffer>(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), header.GetFieldSize(), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+      newRecording->readbackProxies.push_back(core->GetRenderGraph()->AddExternalBuffer(buffer.get()));
+      newRecording->readbackBuffers.push_back(std::move(buffer));
+    }
+    for (uint32_t fieldIndex = 0; fieldIndex < fieldsCount; fieldIndex++)
+      newRecording->stagingFields[fieldIndex].resize(header.GetVolumeSize());
+    newRecording->slotsCount = framesInFlightCount;
+    newRecording->frameIndex = 0;
+    newRecording->lastFrameSize = 0;
+    recording = std::move(newRecording);
+    return true;
+  }
+
+  //frames that are still in flight are waited for and written, so the file ends with the last recorded frame
+  void StopRecording()
+  {
+    if (!recording)
+      return;
+    core->WaitIdle();
+    size_t pendingFramesCount = std::min(recording->frameIndex, recording->slotsCount);
+    for (size_t frameIndex = recording->frameIndex - pendingFramesCount; frameIndex < recording->frameIndex; frameIndex++)
+      WriteRecordedFrame(frameIndex % recording->slotsCount);
+    if (recording->write.valid())
+      recording->write.wait();
+    std::cout << "Recorded " << recording->frameIndex << " frames\n";
+    recording.reset();
+  }
+  //every frame steps the wave function and projects it once over FrameTime, then advects particles in substeps that keep
+  //them under cflTarget cells each through the same velocity
+  SolverBuffers Update(legit::ShaderMemoryPool *memoryPool, legit::RenderGraph::BufferProxyId pointsDataProxyId, size_t pointsCount)
+  {
+    return UpdateFields(memoryPool, &pointsDataProxyId, pointsCount);
+  }
+
+  //for renderers that only look at the fields, nothing is advected
   SolverBuffers Update(legit::ShaderMemoryPool *memoryPool)
+  {
+    return UpdateFields(memoryPool, nullptr, 0);
+  }
+private:
+  //pointsDataProxyId is null when there are no particles
+  SolverBuffers UpdateFields(legit::ShaderMemoryPool *memoryPool, const legit::RenderGraph::BufferProxyId *pointsDataProxyId, size_t pointsCount)
   {
 
     simulationData.volumeResolution = glm::uvec4(sceneResources->volumeResolution, 0.0f);
@@ -49,14 +165,45 @@ public:
     glm::vec3 stepSize = (sceneResources->volumeMax - sceneResources->volumeMin) / glm::vec3(sceneResources->volumeResolution);
     simulationData.stepSize = glm::vec4(stepSize, 0.0f);
     simulationData.invStepSize = glm::vec4(glm::vec3(1.0f) / stepSize, 0.0f);
-    simulationData.timeStep = 1.0f / 50.0f;
+    simulationData.timeStep = FrameTime;
     simulationData.h = 0.03f;
+    simulationData.particlesCount = glm::uint32_t(pointsCount);
     simulationData.iterationIndex = 0;
 
+    //velocity is transient and evaluated from the wave function every frame, so its format changes without restarting
+    if (ImGui::Checkbox("Half precision velocity", &useHalfVelocity))
+      sceneResources->velocityVolumeProxy = VolumeProxy(core->GetRenderGraph(), GetVelocityFormat(), sceneResources->volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage);
+
+    if (ImGui::Button("Load baked velocity"))
+      LoadBakedVelocity(BakedVelocityFilename);
+    if (ImGui::Button("Load recording"))
+      LoadBakedVelocity(RecordingFilename);
+    if (bakedVelocity)
+    {
+      static bool playBakedVelocity = true;
+      ImGui::Checkbox("Play baked velocity", &playBakedVelocity);
+      if (playBakedVelocity)
+      {
+        //frames were baked with a fixed step, they're played back with a single one
+        simulationData.timeStep = bakedVelocity->reader.GetHeader().timeStep;
+        LoadBakedVelocityFrame(memoryPool, simulationData, sceneResources->velocityVolumeProxy.imageViewProxy->Id(), sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id());
+        if (pointsDataProxyId)
+          AdvectParticles(memoryPool, simulationData, sceneResources->velocityVolumeProxy.imageViewProxy->Id(), *pointsDataProxyId, pointsCount);
+
+        SolverBuffers res;
+        res.velocityProxyId = sceneResources->velocityVolumeProxy.imageViewProxy->Id();
+        res.waveFuncProxyId = sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id();
+        return res;
+      }
+    }
+
+    ImGui::Checkbox("Spectral poisson", &useSpectralPoisson);
+    if (!useSpectralPoisson)
+      poissonSolver.BeginFrame(memoryPool, simulationData);
+
     static int globalIterationIndex = 0;
-    static bool setData = true;
-    ImGui::Checkbox("Set data", &setData);
-    if(setData)
+    ImGui::Checkbox("Set data", &isFieldsInitNeeded);
+    if(isFieldsInitNeeded)
     {
       for (int i = 0; i < 2; i++)
       {
@@ -64,23 +211,52 @@ public:
         FieldsInit(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id(), sceneResources->pressureVolumeProxy.imageViewProxy->Id());
         ProjectPressure(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id(), sceneResources->pressureVolumeProxy.imageViewProxy->Id(), sceneResources->divergenceVolumeProxy.imageViewProxy->Id());
       }
-      setData = false;
+      isFieldsInitNeeded = false;
     }
 
-    static bool useShrodingerFFT = true;
     ImGui::Checkbox("Use Shrodinger FFT", &useShrodingerFFT);
+    BeginSubsteps(memoryPool, simulationData);
+
+    bool isRecording = recording != nullptr;
+    if (ImGui::Checkbox("Record", &isRecording))
+    {
+      if (isRecording)
+        StartRecording(RecordingFilename, recordWaveFunc);
+      else
+        StopRecording();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("With wave function", &recordWaveFunc);
+    if (recording)
+    {
+      float rawFrameSize = float(recording->writer.GetHeader().GetFieldSize() * recording->writer.GetHeader().fieldsCount);
+      ImGui::Text("Recorded %d frames, %.1f%% of raw size", int(recording->frameIndex), 100.0f * float(recording->lastFrameSize) / rawFrameSize);
+    }
+
     if (useShrodingerFFT)
     {
       ShrodingerSolveFFT(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id());
     }
     else
     {
-      ShrodingerSolve(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id());
+      ShrodingerSolve(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id(), solveSubstepsCount);
     }
     //for(int i = 0; i < 10; i++)
     ProjectPressure(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id(), sceneResources->pressureVolumeProxy.imageViewProxy->Id(), sceneResources->divergenceVolumeProxy.imageViewProxy->Id());
 
     ComputeVelocity(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id(), sceneResources->velocityVolumeProxy.imageViewProxy->Id());
+    if (pointsDataProxyId)
+    {
+      AddParticlesStatsPass(memoryPool, simulationData, sceneResources->velocityVolumeProxy.imageViewProxy->Id(), *pointsDataProxyId);
+      simulationData.timeStep = FrameTime / float(substepsCount);
+      for (int substepIndex = 0; substepIndex < substepsCount; substepIndex++)
+        AdvectParticles(memoryPool, simulationData, sceneResources->velocityVolumeProxy.imageViewProxy->Id(), *pointsDataProxyId, pointsCount);
+      simulationData.timeStep = FrameTime;
+    }
+    if (!useShrodingerFFT)
+      AddWaveFuncStatsPass(memoryPool, simulationData, sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id());
+    if (recording)
+      RecordFrame(memoryPool, simulationData);
 
     SolverBuffers res;
     res.velocityProxyId = sceneResources->velocityVolumeProxy.imageViewProxy->Id();
@@ -88,40 +264,43 @@ public:
 
     return res;
   }
-
-  void AdvectParticles(legit::ShaderMemoryPool *memoryPool, legit::RenderGraph::BufferProxyId pointsDataProxyId, size_t pointsCount)
-  {
-    simulationData.particlesCount = glm::uint32_t(pointsCount);
-    AdvectParticles(memoryPool, simulationData, sceneResources->velocityVolumeProxy.imageViewProxy->Id(), pointsDataProxyId, pointsCount);
-  }
-
-
+public:
   void ReloadShaders()
   {
     fieldsInitShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/fieldsInit.comp.spv"));
     waveVelocityDivergenceShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/computeWaveVelocityDivergence.comp.spv"));
-    velocityDivergenceShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/velocityDivergence.comp.spv"));
-    poissonIterationShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/poissonIteration.comp.spv"));
+    velocityDivergenceShader.Load(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/velocityDivergence");
     applyPressureGradientShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/applyPressureGradient.comp.spv"));
     shrodingerSolveShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/shrodingerSolve.comp.spv"));
     shrodingerSolveFFTShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/shrodingerSolveFFT.comp.spv"));
-    computeVelocityShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/computeWaveVelocity.comp.spv"));
+    computeVelocityShader.Load(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/computeWaveVelocity");
     //enforceBoundariesShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/enforceBoundaries.comp.spv"));
     particlesAdvectShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/particlesAdvect.comp.spv"));
+    loadBakedVelocityShader.Load(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/loadBakedVelocity");
+    storeFieldShader.Load(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/storeField");
+    stepStatsResetShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/stepStatsReset.comp.spv"));
+    stepStatsParticlesShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/stepStatsParticles.comp.spv"));
+    stepStatsWaveFuncShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/ShrodingerSolver/stepStatsWaveFunc.comp.spv"));
+    poissonSolver.ReloadShaders();
+    spectralPoissonSolver.ReloadShaders();
   }
 private:
 
 
   const static uint32_t ShaderDataSetIndex = 0;
   const static uint32_t DrawCallDataSetIndex = 1;
+  //every frame simulates the same time, substeps only split it
+  constexpr static float FrameTime = 1.0f / 50.0f;
+  const static int MaxSubstepsCount = 16;
+  const static int MaxSolveSubstepsCount = 128;
 
 
   struct SceneResources
   {
-    SceneResources(legit::Core *core, glm::uvec3 _volumeResolution, glm::vec3 _volumeMin, glm::vec3 _volumeMax) :
+    SceneResources(legit::Core *core, glm::uvec3 _volumeResolution, glm::vec3 _volumeMin, glm::vec3 _volumeMax, vk::Format velocityFormat) :
       waveFunctionVolumeProxy(core, vk::Format::eR32G32B32A32Sfloat, _volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage, legit::ImageUsageTypes::ComputeShaderReadWrite),
       pressureVolumeProxy(core, vk::Format::eR32Sfloat, _volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage, legit::ImageUsageTypes::ComputeShaderReadWrite),
-      velocityVolumeProxy(core->GetRenderGraph(), vk::Format::eR32G32B32A32Sfloat, _volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage),
+      velocityVolumeProxy(core->GetRenderGraph(), velocityFormat, _volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage),
       tmpPressureVolumeProxy(core->GetRenderGraph(), vk::Format::eR32Sfloat, _volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage),
       divergenceVolumeProxy(core->GetRenderGraph(), vk::Format::eR32Sfloat, _volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage)
     {
@@ -142,6 +321,13 @@ private:
   };
   std::unique_ptr<SceneResources> sceneResources;
 
+  //the wave function is the integrated state and pressure is accumulated over sweeps and frames, both stay 32 bit. velocity
+  //is evaluated from the wave function every frame, half floats only cost it rounding that PrecisionBenchmark measures
+  vk::Format GetVelocityFormat() const
+  {
+    return useHalfVelocity ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR32G32B32A32Sfloat;
+  }
+
   #pragma pack(push, 1)
   struct SimulationData
   {
@@ -157,6 +343,120 @@ private:
   }simulationData;
   #pragma pack(pop)
 
+  //layout matches ShrodingerSolver/stepStats.decl, the shaders treat the maximums as uint bits
+  struct StepStats
+  {
+    float maxSpeed;
+    float maxWaveFuncRate;
+    float lastMaxSpeed;
+    float lastMaxWaveFuncRate;
+  };
+
+  //once per frame before the substeps: reads back the stats of an earlier frame and picks how many substeps this one takes.
+  //both stats are per second so they don't depend on the substeps they were measured with. counts grow right away so
+  //particles don't skip cells for more than a few frames and shrink by one per frame so they don't oscillate
+  void BeginSubsteps(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData)
+  {
+    StepStats stepStats;
+    memcpy(&stepStats, stepStatsBuffer->Map(), sizeof(StepStats));
+    stepStatsBuffer->Unmap();
+
+    auto adaptCount = [](int &count, float requiredCount, int maxCount)
+    {
+      int clampedCount = glm::clamp(int(std::ceil(requiredCount)), 1, maxCount);
+      if (clampedCount > count)
+        count = clampedCount;
+      else if (clampedCount < count)
+        count--;
+    };
+    ImGui::SliderFloat("CFL target", &cflTarget, 0.1f, 2.0f);
+    adaptCount(substepsCount, stepStats.lastMaxSpeed * FrameTime / cflTarget, MaxSubstepsCount);
+    float substepTime = FrameTime / float(substepsCount);
+    //substeps only advect, the pressure projection runs once per frame whatever the count
+    ImGui::Text("advection dt %.4f, %d substeps, max particle speed %.2f cells/frame", substepTime, substepsCount, stepStats.lastMaxSpeed * FrameTime);
+
+    if (!useShrodingerFFT)
+    {
+      //no stats while the fft solve was used, the laplacian of a unit wave function is bounded by the grid alone
+      float waveFuncRate = stepStats.lastMaxWaveFuncRate;
+      if (waveFuncRate <= 0.0f)
+      {
+        glm::vec3 invStepSize = glm::vec3(simulationData.invStepSize);
+        waveFuncRate = 0.5f * simulationData.h * 4.0f * glm::dot(invStepSize, invStepSize);
+      }
+      ImGui::SliderFloat("Max wave function change", &maxWaveFuncChange, 0.01f, 1.0f);
+      adaptCount(solveSubstepsCount, waveFuncRate * FrameTime / maxWaveFuncChange, MaxSolveSubstepsCount);
+      ImGui::Text("%d wave function steps per frame, 1 pressure projection", solveSubstepsCount);
+    }
+
+    AddStepStatsPass(memoryPool, simulationData, stepStatsResetShader.compute.get(), "PassStepStatsReset", glm::uvec3(1), {}, {}, {});
+  }
+
+  //max particle speed, after the velocity it's measured on is evaluated
+  void AddParticlesStatsPass(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId velocityVolumeProxy, legit::RenderGraph::BufferProxyId pointsDataProxyId)
+  {
+    glm::uvec3 groupsCount = glm::uvec3(uint32_t(simulationData.particlesCount / stepStatsParticlesShader.compute->GetLocalSize().x) + 1, 1, 1);
+    AddStepStatsPass(memoryPool, simulationData, stepStatsParticlesShader.compute.get(), "PassStepStatsParticles", groupsCount, { pointsDataProxyId }, {}, { velocityVolumeProxy });
+  }
+
+  //max rate of change of the explicit solve, on the wave function it ended the frame with
+  void AddWaveFuncStatsPass(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId waveFuncVolumeProxy)
+  {
+    glm::uvec3 groupsCount = sceneResources->volumeResolution / stepStatsWaveFuncShader.compute->GetLocalSize();
+    AddStepStatsPass(memoryPool, simulationData, stepStatsWaveFuncShader.compute.get(), "PassStepStatsWaveFunc", groupsCount, {}, { waveFuncVolumeProxy }, {});
+  }
+
+  //stats shaders bind at most the points buffer, the wave function as a storage image and the velocity as a sampler
+  void AddStepStatsPass(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::Shader *shader, const char *passName, glm::uvec3 groupsCount, std::vector<legit::RenderGraph::BufferProxyId> pointsProxies, std::vector<legit::RenderGraph::ImageViewProxyId> waveFuncProxies, std::vector<legit::RenderGraph::ImageViewProxyId> velocityProxies)
+  {
+    legit::RenderGraph::BufferProxyId stepStatsProxyId = stepStatsProxy->Id();
+    std::vector<legit::RenderGraph::BufferProxyId> storageBuffers = pointsProxies;
+    storageBuffers.push_back(stepStatsProxyId);
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers(std::move(storageBuffers))
+      .SetStorageImages(waveFuncProxies)
+      .SetInputImages(velocityProxies)
+      .SetProfilerInfo(legit::Colors::emerald, passName)
+      .SetRecordFunc([this, memoryPool, simulationData, shader, groupsCount, stepStatsProxyId, pointsProxies, waveFuncProxies, velocityProxies](legit::RenderGraph::PassContext passContext)
+    {
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+          *shaderPassDataBuffer = simulationData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageBufferBinding> storageBufferBindings;
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("StepStatsBuffer", passContext.GetBuffer(stepStatsProxyId)));
+        for (auto pointsProxyId : pointsProxies)
+          storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("PointsBuffer", passContext.GetBuffer(pointsProxyId)));
+
+        std::vector<legit::StorageImageBinding> storageImageBindings;
+        for (auto waveFuncProxyId : waveFuncProxies)
+          storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("waveFuncImage", passContext.GetImageView(waveFuncProxyId)));
+
+        std::vector<legit::ImageSamplerBinding> imageSamplerBindings;
+        for (auto velocityProxyId : velocityProxies)
+          imageSamplerBindings.push_back(shaderDataSetInfo->MakeImageSamplerBinding("velocitySampler", passContext.GetImageView(velocityProxyId), linearSampler.get()));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageBufferBindings(storageBufferBindings)
+          .SetStorageImageBindings(storageImageBindings)
+          .SetImageSamplerBindings(imageSamplerBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+        passContext.GetCommandBuffer().dispatch(groupsCount.x, groupsCount.y, groupsCount.z);
+        //read back in BeginSubsteps
+        AddHostReadBarrier(passContext.GetCommandBuffer());
+      }
+    }));
+  }
+
   /*void EnforceBoundaries(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData)
   {
     core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
@@ -237,55 +537,6 @@ private:
     }));
   }
 
-  void SolvePoisson(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy, int iterationsCount)
-  {
-    static int globalIterationIndex = 0;
-    for(int i = 0; i < iterationsCount; i++)
-    {
-      for(int phase = 0; phase < 2; phase++)
-      {
-        simulationData.iterationIndex = globalIterationIndex++;
-        core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
-          .SetStorageImages({
-            pressureVolumeProxy, divergenceVolumeProxy })
-          .SetProfilerInfo(legit::Colors::emerald, "PassPoissonIteration")
-          .SetRecordFunc([this, memoryPool, simulationData, pressureVolumeProxy, divergenceVolumeProxy](legit::RenderGraph::PassContext passContext)
-        {
-          auto shader = poissonIterationShader.compute.get();
-          auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
-          {
-            const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
-            auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
-            {
-              auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
-              *shaderPassDataBuffer = simulationData;
-            }
-            memoryPool->EndSet();
-
-            std::vector<legit::StorageImageBinding> storageImageBindings;
-            auto pressureVolumeView = passContext.GetImageView(pressureVolumeProxy);
-            storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("pressureImage", pressureVolumeView));
-            auto divergenceVolumeView = passContext.GetImageView(divergenceVolumeProxy);
-            storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("divergenceImage", divergenceVolumeView));
-
-            auto shaderDataSetBindings = legit::DescriptorSetBindings()
-              .SetUniformBufferBindings(shaderData.uniformBufferBindings)
-              .SetStorageImageBindings(storageImageBindings);
-
-            auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
-            passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
-
-            glm::uvec3 workGroupSize = shader->GetLocalSize();
-            passContext.GetCommandBuffer().dispatch(
-              uint32_t(sceneResources->volumeResolution.x / workGroupSize.x / 2), //because of checkerboard
-              uint32_t(sceneResources->volumeResolution.y / workGroupSize.y),
-              uint32_t(sceneResources->volumeResolution.z / workGroupSize.z));
-          }
-        }));
-      }
-    }
-  }
-
   void ProjectPressure(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId waveFuncVolumeProxy, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy)
   {    
     if (0)
@@ -329,14 +580,14 @@ private:
     }
     else
     {
-      ComputeVelocity(memoryPool, simulationData, waveFuncVolumeProxy, sceneResources->velocityVolumeProxy.imageViewProxy->Id());
+      ComputeVelocity(memoryPool, simulationData, waveFuncVolumeProxy, sceneResources->velocityVolumeProxy.imageViewProxy->Id(), false);
 
       core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
         .SetStorageImages({ sceneResources->velocityVolumeProxy.imageViewProxy->Id(), divergenceVolumeProxy })
         .SetProfilerInfo(legit::Colors::emerald, "PassDivergence")
         .SetRecordFunc([this, memoryPool, simulationData, waveFuncVolumeProxy, divergenceVolumeProxy](legit::RenderGraph::PassContext passContext)
       {
-        auto shader = velocityDivergenceShader.compute.get();
+        auto shader = velocityDivergenceShader.Get(useHalfVelocity);
         auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
         {
           const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
@@ -369,7 +620,10 @@ private:
       }));
     }
 
-    SolvePoisson(memoryPool, simulationData, pressureVolumeProxy, divergenceVolumeProxy, 20);
+    if (useSpectralPoisson)
+      spectralPoissonSolver.Solve(memoryPool, simulationData, pressureVolumeProxy, divergenceVolumeProxy);
+    else
+      poissonSolver.Solve(memoryPool, simulationData, pressureVolumeProxy, divergenceVolumeProxy);
 
     core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
       .SetStorageImages({waveFuncVolumeProxy, pressureVolumeProxy})
@@ -409,11 +663,11 @@ private:
     }));
   }
 
-  void ShrodingerSolve(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId waveFuncVolumeProxy)
+  //explicit, the step is split further so that every step changes the wave function by at most maxWaveFuncChange
+  void ShrodingerSolve(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId waveFuncVolumeProxy, int substepsCount)
   {
-    int substeps = 10;
-    simulationData.timeStep /= substeps;
-    for (int i = 0; i < substeps; i++)
+    simulationData.timeStep /= substepsCount;
+    for (int i = 0; i < substepsCount; i++)
     {
       core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
         .SetStorageImages({ waveFuncVolumeProxy })
@@ -501,7 +755,7 @@ private:
       .SetProfilerInfo(legit::Colors::emerald, "PassComputeVelocity")
       .SetRecordFunc([this, memoryPool, simulationData, waveFuncVolumeProxy, velocityVolumeProxy](legit::RenderGraph::PassContext passContext)
     {
-      auto shader = computeVelocityShader.compute.get();
+      auto shader = computeVelocityShader.Get(useHalfVelocity);
       auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
       {
         const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
@@ -534,6 +788,114 @@ private:
     }));
   }
 
+  //playback loops over the file, frames are streamed from disk into the next upload buffers and copied into the volumes.
+  //the wave function is only needed to resume simulating
+  void LoadBakedVelocityFrame(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId velocityVolumeProxy, legit::RenderGraph::ImageViewProxyId waveFuncVolumeProxy)
+  {
+    size_t fieldsCount = bakedVelocity->reader.GetHeader().fieldsCount;
+    size_t slotsCount = bakedVelocity->uploadBuffers.size() / fieldsCount;
+    size_t bufferIndex = (bakedVelocity->frameIndex % slotsCount) * fieldsCount;
+    auto velocityUploadBuffer = bakedVelocity->uploadBuffers[bufferIndex].get();
+    glm::vec4 *waveFuncData = bakedVelocity->reader.HasWaveFunc() ? (glm::vec4*)bakedVelocity->uploadBuffers[bufferIndex + 1]->Map() : nullptr;
+    bakedVelocity->reader.ReadFrame(bakedVelocity->frameIndex % bakedVelocity->reader.GetFramesCount(), (glm::vec4*)velocityUploadBuffer->Map(), waveFuncData);
+    velocityUploadBuffer->Unmap();
+    bakedVelocity->frameIndex++;
+
+    AddFieldCopyPass(memoryPool, simulationData, loadBakedVelocityShader.Get(useHalfVelocity), "PassLoadBakedVelocity", bakedVelocity->uploadProxies[bufferIndex]->Id(), velocityVolumeProxy, false);
+    if (waveFuncData)
+    {
+      bakedVelocity->uploadBuffers[bufferIndex + 1]->Unmap();
+      AddFieldCopyPass(memoryPool, simulationData, loadBakedVelocityShader.Get(false), "PassLoadBakedWaveFunc", bakedVelocity->uploadProxies[bufferIndex + 1]->Id(), waveFuncVolumeProxy, false);
+      isFieldsInitNeeded = false;
+    }
+  }
+
+  //before a readback buffer is refilled, the frame that filled it framesInFlightCount frames ago is handed to the writer
+  void RecordFrame(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData)
+  {
+    size_t fieldsCount = recording->writer.GetHeader().fieldsCount;
+    size_t slotIndex = recording->frameIndex % recording->slotsCount;
+    if (recording->frameIndex >= recording->slotsCount)
+      WriteRecordedFrame(slotIndex);
+
+    legit::RenderGraph::ImageViewProxyId fieldProxies[] = { sceneResources->velocityVolumeProxy.imageViewProxy->Id(), sceneResources->waveFunctionVolumeProxy.imageViewProxy->Id() };
+    legit::Shader *fieldShaders[] = { storeFieldShader.Get(useHalfVelocity), storeFieldShader.Get(false) };
+    const char *passNames[] = { "PassStoreVelocity", "PassStoreWaveFunc" };
+    for (size_t fieldIndex = 0; fieldIndex < fieldsCount; fieldIndex++)
+      AddFieldCopyPass(memoryPool, simulationData, fieldShaders[fieldIndex], passNames[fieldIndex], recording->readbackProxies[slotIndex * fieldsCount + fieldIndex]->Id(), fieldProxies[fieldIndex], true);
+    recording->frameIndex++;
+  }
+
+  //the previous write is finished first so that frames stay in order and the staging copy can be reused
+  void WriteRecordedFrame(size_t slotIndex)
+  {
+    if (recording->write.valid())
+    {
+      if (!recording->write.get())
+        std::cout << "Can't write recorded frame\n";
+      recording->lastFrameSize = recording->writer.GetLastFrameSize();
+    }
+    size_t fieldsCount = recording->writer.GetHeader().fieldsCount;
+    for (size_t fieldIndex = 0; fieldIndex < fieldsCount; fieldIndex++)
+    {
+      auto readbackBuffer = recording->readbackBuffers[slotIndex * fieldsCount + fieldIndex].get();
+      memcpy(recording->stagingFields[fieldIndex].data(), readbackBuffer->Map(), recording->writer.GetHeader().GetFieldSize());
+      readbackBuffer->Unmap();
+    }
+    Recording *recordingPtr = recording.get();
+    recording->write = std::async(std::launch::async, [recordingPtr, fieldsCount]()
+    {
+      return recordingPtr->writer.WriteFrame(recordingPtr->stagingFields[0].data(), fieldsCount > 1 ? recordingPtr->stagingFields[1].data() : nullptr);
+    });
+  }
+
+  //one node per invocation copy between a field buffer and a volume, the direction depends on the shader.
+  //isHostRead is set when the field buffer is a readback buffer the host reads once the frame is done
+  void AddFieldCopyPass(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::Shader *shader, const char *passName, legit::RenderGraph::BufferProxyId fieldBufferProxyId, legit::RenderGraph::ImageViewProxyId volumeProxy, bool isHostRead)
+  {
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageBuffers({ fieldBufferProxyId })
+      .SetStorageImages({ volumeProxy })
+      .SetProfilerInfo(legit::Colors::emerald, passName)
+      .SetRecordFunc([this, memoryPool, simulationData, shader, fieldBufferProxyId, volumeProxy, isHostRead](legit::RenderGraph::PassContext passContext)
+    {
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+          *shaderPassDataBuffer = simulationData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageBufferBinding> storageBufferBindings;
+        auto fieldBuffer = passContext.GetBuffer(fieldBufferProxyId);
+        storageBufferBindings.push_back(shaderDataSetInfo->MakeStorageBufferBinding("FieldBuffer", fieldBuffer));
+
+        std::vector<legit::StorageImageBinding> storageImageBindings;
+        auto volumeView = passContext.GetImageView(volumeProxy);
+        storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding("fieldImage", volumeView));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageBufferBindings(storageBufferBindings)
+          .SetStorageImageBindings(storageImageBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        glm::uvec3 workGroupSize = shader->GetLocalSize();
+        passContext.GetCommandBuffer().dispatch(
+          uint32_t(sceneResources->volumeResolution.x / workGroupSize.x),
+          uint32_t(sceneResources->volumeResolution.y / workGroupSize.y),
+          uint32_t(sceneResources->volumeResolution.z / workGroupSize.z));
+        if (isHostRead)
+          AddHostReadBarrier(passContext.GetCommandBuffer());
+      }
+    }));
+  }
+
   void AdvectParticles(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId velocityVolumeProxy, legit::RenderGraph::BufferProxyId pointsDataProxyId, size_t pointsCount)
   {
     core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
@@ -598,20 +960,23 @@ private:
     std::unique_ptr<legit::Shader> compute;
   } waveVelocityDivergenceShader;
 
-  struct VelocityDivergenceShader
-  {
-    std::unique_ptr<legit::Shader> compute;
-  } velocityDivergenceShader;
-
-  struct PoissonIterationShader
-  {
-    std::unique_ptr<legit::Shader> compute;
-  } poissonIterationShader;
-
-  struct ComputeVelocityShader
+  //shaders that access the velocity volume, built once more as <name>Half.comp.spv with an rgba16f format, see Shaders/shaderVariants.txt
+  struct VelocityFormatShader
   {
+    void Load(vk::Device logicalDevice, std::string basePath)
+    {
+      compute.reset(new legit::Shader(logicalDevice, (basePath + ".comp.spv").c_str()));
+      computeHalf.reset(new legit::Shader(logicalDevice, (basePath + "Half.comp.spv").c_str()));
+    }
+    legit::Shader *Get(bool isHalf) const
+    {
+      return isHalf ? computeHalf.get() : compute.get();
+    }
     std::unique_ptr<legit::Shader> compute;
-  } computeVelocityShader;
+    std::unique_ptr<legit::Shader> computeHalf;
+  };
+  VelocityFormatShader velocityDivergenceShader;
+  VelocityFormatShader computeVelocityShader;
 
   struct ApplyPressureGradientShader
   {
@@ -628,7 +993,66 @@ private:
     std::unique_ptr<legit::Shader> compute;
   } particlesAdvectShader;
 
+  VelocityFormatShader loadBakedVelocityShader;
+  VelocityFormatShader storeFieldShader;
+
+  struct StepStatsResetShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } stepStatsResetShader;
+
+  struct StepStatsParticlesShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } stepStatsParticlesShader;
+
+  struct StepStatsWaveFuncShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } stepStatsWaveFuncShader;
+
+  struct BakedVelocity
+  {
+    BakedVelocityReader reader;
+    std::vector<std::unique_ptr<legit::Buffer>> uploadBuffers;
+    std::vector<legit::RenderGraph::BufferProxyUnique> uploadProxies;
+    size_t frameIndex;
+  };
+  std::unique_ptr<BakedVelocity> bakedVelocity;
+  constexpr static const char *BakedVelocityFilename = "../data/Bakes/ShrodingerBake.lvel";
+
+  struct Recording
+  {
+    BakedVelocityWriter writer;
+    //slotsCount slots of fieldsCount buffers each
+    std::vector<std::unique_ptr<legit::Buffer>> readbackBuffers;
+    std::vector<legit::RenderGraph::BufferProxyUnique> readbackProxies;
+    std::vector<glm::vec4> stagingFields[2];
+    size_t slotsCount;
+    size_t frameIndex;
+    size_t lastFrameSize;
+    //declared last so that it's destroyed first while the writer and staging fields are still alive
+    std::future<bool> write;
+  };
+  std::unique_ptr<Recording> recording;
+  constexpr static const char *RecordingFilename = "../data/Bakes/Recording.lvel";
+  bool recordWaveFunc;
+  size_t framesInFlightCount;
+  bool isFieldsInitNeeded;
+
   FFTRenderer fftRenderer;
+  MultigridPoissonSolver poissonSolver;
+  SpectralPoissonSolver spectralPoissonSolver;
+  bool useSpectralPoisson;
+  bool useHalfVelocity;
+  bool useShrodingerFFT;
+
+  std::unique_ptr<legit::Buffer> stepStatsBuffer;
+  legit::RenderGraph::BufferProxyUnique stepStatsProxy;
+  float cflTarget; //cells a particle can move per substep
+  float maxWaveFuncChange;
+  int substepsCount;
+  int solveSubstepsCount; //explicit wave function steps per frame
 
   std::unique_ptr<legit::Sampler> linearSampler;
 
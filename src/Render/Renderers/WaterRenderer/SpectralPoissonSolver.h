@@ -0,0 +1,114 @@
+#pragma once
+
+//direct pressure solve for periodic volumes: the 7 point laplacian is diagonal in the fourier basis, so the divergence is
+//transformed with FFTRenderer::FFT3d, divided by the laplacian eigenvalues and transformed back. the solution is exact
+//(up to float rounding) in a fixed number of passes no matter how smooth the divergence is, CpuSpectralPoisson does the same
+//on the cpu. only valid because ClampNode wraps around, walls would need a cosine transform instead
+class SpectralPoissonSolver
+{
+public:
+  SpectralPoissonSolver(legit::Core *_core, FFTRenderer *_fftRenderer)
+  {
+    this->core = _core;
+    this->fftRenderer = _fftRenderer;
+    ReloadShaders();
+  }
+
+  void RecreateSceneResources(glm::uvec3 volumeResolution)
+  {
+    spectrumVolumeProxy.reset(new VolumeProxy(core->GetRenderGraph(), vk::Format::eR32G32B32A32Sfloat, volumeResolution, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage));
+    this->volumeResolution = volumeResolution;
+  }
+
+  template<typename SimulationData>
+  void Solve(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::RenderGraph::ImageViewProxyId pressureVolumeProxy, legit::RenderGraph::ImageViewProxyId divergenceVolumeProxy)
+  {
+    auto spectrumProxy = spectrumVolumeProxy->imageViewProxy->Id();
+    AddVolumePass(memoryPool, simulationData, packShader.compute.get(), "PassSpectralPack", { { "divergenceImage", divergenceVolumeProxy }, { "spectrumImage", spectrumProxy } });
+    fftRenderer->FFT3d(memoryPool, spectrumProxy, volumeResolution, true);
+    AddVolumePass(memoryPool, simulationData, divideShader.compute.get(), "PassSpectralDivide", { { "spectrumImage", spectrumProxy } });
+    fftRenderer->FFT3d(memoryPool, spectrumProxy, volumeResolution, false);
+    AddVolumePass(memoryPool, simulationData, unpackShader.compute.get(), "PassSpectralUnpack", { { "spectrumImage", spectrumProxy }, { "pressureImage", pressureVolumeProxy } });
+  }
+
+  void ReloadShaders()
+  {
+    packShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/SpectralPoisson/spectralPack.comp.spv"));
+    divideShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/SpectralPoisson/spectralDivide.comp.spv"));
+    unpackShader.compute.reset(new legit::Shader(core->GetLogicalDevice(), "../data/Shaders/spirv/WaterRenderer/Solvers/SpectralPoisson/spectralUnpack.comp.spv"));
+  }
+private:
+  const static uint32_t ShaderDataSetIndex = 0;
+
+  struct VolumeBinding
+  {
+    std::string name;
+    legit::RenderGraph::ImageViewProxyId imageViewProxyId;
+  };
+
+  //all three passes are one invocation per node with nothing but storage images bound
+  template<typename SimulationData>
+  void AddVolumePass(legit::ShaderMemoryPool *memoryPool, SimulationData simulationData, legit::Shader *shader, const char *passName, std::vector<VolumeBinding> volumeBindings)
+  {
+    std::vector<legit::RenderGraph::ImageViewProxyId> storageImages;
+    for (auto &volumeBinding : volumeBindings)
+      storageImages.push_back(volumeBinding.imageViewProxyId);
+
+    glm::uvec3 resolution = volumeResolution;
+    core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
+      .SetStorageImages(std::move(storageImages))
+      .SetProfilerInfo(legit::Colors::emerald, passName)
+      .SetRecordFunc([this, memoryPool, simulationData, shader, resolution, volumeBindings](legit::RenderGraph::PassContext passContext)
+    {
+      auto pipeineInfo = this->core->GetPipelineCache()->BindComputePipeline(passContext.GetCommandBuffer(), shader);
+      {
+        const legit::DescriptorSetLayoutKey *shaderDataSetInfo = shader->GetSetInfo(ShaderDataSetIndex);
+        auto shaderData = memoryPool->BeginSet(shaderDataSetInfo);
+        {
+          auto shaderPassDataBuffer = memoryPool->GetUniformBufferData<SimulationData>("SimulationDataBuffer");
+          *shaderPassDataBuffer = simulationData;
+        }
+        memoryPool->EndSet();
+
+        std::vector<legit::StorageImageBinding> storageImageBindings;
+        for (auto &volumeBinding : volumeBindings)
+          storageImageBindings.push_back(shaderDataSetInfo->MakeStorageImageBinding(volumeBinding.name, passContext.GetImageView(volumeBinding.imageViewProxyId)));
+
+        auto shaderDataSetBindings = legit::DescriptorSetBindings()
+          .SetUniformBufferBindings(shaderData.uniformBufferBindings)
+          .SetStorageImageBindings(storageImageBindings);
+
+        auto shaderDataSet = this->core->GetDescriptorSetCache()->GetDescriptorSet(*shaderDataSetInfo, shaderDataSetBindings);
+        passContext.GetCommandBuffer().bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeineInfo.pipelineLayout, ShaderDataSetIndex, { shaderDataSet }, { shaderData.dynamicOffset });
+
+        glm::uvec3 workGroupSize = shader->GetLocalSize();
+        passContext.GetCommandBuffer().dispatch(
+          uint32_t(resolution.x / workGroupSize.x),
+          uint32_t(resolution.y / workGroupSize.y),
+          uint32_t(resolution.z / workGroupSize.z));
+      }
+    }));
+  }
+
+  struct PackShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } packShader;
+
+  struct DivideShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } divideShader;
+
+  struct UnpackShader
+  {
+    std::unique_ptr<legit::Shader> compute;
+  } unpackShader;
+
+  //transient, only lives through the solve
+  std::unique_ptr<VolumeProxy> spectrumVolumeProxy;
+  glm::uvec3 volumeResolution;
+
+  FFTRenderer *fftRenderer;
+  legit::Core *core;
+};
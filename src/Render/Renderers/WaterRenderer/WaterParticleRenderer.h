@@ -2,8 +2,11 @@
 #include "../../Common/BlurBuilder.h"
 #include "../../Common/ArrayBucketeer.h"
 #include "../../Common/ListBucketeer.h"
+#include "../../Common/BucketGridSizer.h"
+#include "../../Common/DirectionalBucketCache.h"
 #include "../../Common/DebugRenderer.h"
 #include "ShrodingerSolver.h"
+#include "ParticleSorter.h"
 //#include "SimpleSolver.h"
 
 class WaterParticleRenderer : public BaseRenderer
@@ -16,7 +19,10 @@ public:
     viewportBucketeer(_core),
     giBucketeer(_core),
     directLightBucketeer(_core),
-    solver(_core)
+    pointPacker(_core),
+    giDirectionCache(_core),
+    solver(_core),
+    particleSorter(_core)
   {
     this->core = _core;
 
@@ -39,16 +45,61 @@ public:
 
     debugMip = -1;
     debugType = -1;
+
+    useGiDirectionCache = false;
+    giDirectionsCount = 16;
+    giDirectionRefreshesCount = 1;
+    isGiDirectionCacheOutdated = true;
+    particlesSortPeriod = 16;
+    framesSinceParticlesSort = 0;
+
+    {
+      BucketGridSizer::GridDesc gridDesc;
+      gridDesc.maxMipsCount = std::numeric_limits<size_t>::max();
+      gridDesc.aspect = 1.0f;
+      gridDesc.bytesPerBucket = ListBucketeer::GetBytesPerBucket();
+
+      gridDesc.name = "Viewport buckets";
+      gridDesc.profilerTag = "Viewport";
+      gridDesc.fixedConfig = { glm::uvec2(256, 256), 9 }; //overridden by viewport size
+      gridDesc.minSize = glm::uvec2(64, 64);
+      gridDesc.maxSize = glm::uvec2(1024, 1024);
+      gridDesc.coverage = 1.0f;
+      viewportGridIndex = gridSizer.AddGrid(gridDesc);
+
+      gridDesc.name = "GI buckets";
+      gridDesc.profilerTag = "Gi";
+      gridDesc.fixedConfig = { glm::uvec2(128, 128), 1 };
+      gridDesc.minSize = glm::uvec2(32, 32);
+      gridDesc.maxSize = glm::uvec2(512, 512);
+      gridDesc.maxMipsCount = 1;
+      giGridIndex = gridSizer.AddGrid(gridDesc);
+
+      gridDesc.name = "Direct light buckets";
+      gridDesc.profilerTag = "DirectLight";
+      gridDesc.fixedConfig = { glm::uvec2(256, 256), 9 };
+      gridDesc.maxMipsCount = std::numeric_limits<size_t>::max();
+      directLightGridIndex = gridSizer.AddGrid(gridDesc);
+    }
+    viewportBucketeer.SetProfilerTag("Viewport");
+    giBucketeer.SetProfilerTag("Gi");
+    giDirectionCache.SetProfilerTag("Gi");
+    directLightBucketeer.SetProfilerTag("DirectLight");
   }
 
   void RecreateSceneResources(Scene *scene)
   {
     sceneResources.reset(new SceneResources(core, glm::vec3(-2.5f, -2.5f, -2.5f), glm::vec3(2.5f, 2.5f, 2.5f)));
+    gridSizer.SetPointsCount(sceneResources->pointsCount);
     viewportBucketeer.RecreateSceneResources(sceneResources->pointsCount);
     giBucketeer.RecreateSceneResources(sceneResources->pointsCount);
     directLightBucketeer.RecreateSceneResources(sceneResources->pointsCount);
+    pointPacker.RecreateSceneResources(sceneResources->pointsCount);
+    isGiDirectionCacheOutdated = true;
 
-    solver.RecreateSceneResources(glm::uvec3(128, 128, 128), sceneResources->volumeMin, sceneResources->volumeMax);
+    glm::uvec3 volumeResolution = glm::uvec3(128, 128, 128);
+    solver.RecreateSceneResources(volumeResolution, sceneResources->volumeMin, sceneResources->volumeMax);
+    particleSorter.RecreateSceneResources(sceneResources->pointsCount, volumeResolution, sceneResources->volumeMin, sceneResources->volumeMax);
   }
   
   void RecreateSwapchainResources(vk::Extent2D viewportExtent, size_t framesInFlightCount)
@@ -58,10 +109,18 @@ public:
     glm::uvec2 viewportSize = { viewportExtent.width, viewportExtent.height };
     viewportResources.reset(new ViewportResources(core->GetRenderGraph(), viewportSize));
 
-    viewportBucketeer.RecreateSwapchainResources(glm::uvec2(viewportExtent.width / 4, viewportExtent.height / 4), framesInFlightCount);
-    this->giViewportSize = glm::uvec2(128, 128);
-    giBucketeer.RecreateSwapchainResources(giViewportSize, framesInFlightCount, 1);
-    directLightBucketeer.RecreateSwapchainResources(glm::uvec2(256, 256), framesInFlightCount);
+    this->framesInFlightCount = framesInFlightCount;
+    solver.RecreateSwapchainResources(viewportSize, framesInFlightCount);
+    glm::uvec2 viewportGridSize = glm::uvec2(viewportExtent.width / 4, viewportExtent.height / 4);
+    gridSizer.SetFixedConfig(viewportGridIndex, { viewportGridSize, GetMaxPow(std::min(viewportGridSize.x, viewportGridSize.y)) + 1 });
+    gridSizer.SetAspect(viewportGridIndex, float(viewportExtent.width) / float(viewportExtent.height));
+    gridSizer.Update();
+    RecreateBucketeers();
+  }
+
+  void ProcessGpuProfilerData(const legit::ProfilerTask *tasks, size_t tasksCount)
+  {
+    gridSizer.ProcessProfilerData(tasks, tasksCount);
   }
 private:
   #pragma pack(push, 1)
@@ -95,20 +154,77 @@ private:
   };
 
 
+  ListBucketeer::BucketBuffers BucketGiPoints(legit::ShaderMemoryPool *memoryPool, PassData &passData, legit::RenderGraph::BufferProxyId pointsHotProxyId)
+  {
+    if (!useGiDirectionCache)
+      return giBucketeer.BucketPoints(memoryPool, passData.bucketProjMatrix, passData.bucketViewMatrix, pointsHotProxyId, uint32_t(sceneResources->pointsCount), true);
+
+    auto castInfo = giDirectionCache.Update(size_t(giDirectionRefreshesCount), [&](ListBucketeer &bucketeer, glm::mat4 viewMatrix)
+    {
+      bucketeer.BucketPoints(memoryPool, passData.bucketProjMatrix, viewMatrix, pointsHotProxyId, uint32_t(sceneResources->pointsCount), true);
+    });
+    passData.bucketViewMatrix = castInfo.viewMatrix;
+    return castInfo.bucketBuffers;
+  }
+
+  void RecreateBucketeers()
+  {
+    auto viewportConfig = gridSizer.GetConfig(viewportGridIndex);
+    viewportBucketeer.RecreateSwapchainResources(viewportConfig.size, framesInFlightCount, viewportConfig.mipsCount);
+    auto giConfig = gridSizer.GetConfig(giGridIndex);
+    this->giViewportSize = giConfig.size;
+    giBucketeer.RecreateSwapchainResources(giConfig.size, framesInFlightCount, giConfig.mipsCount);
+    auto directLightConfig = gridSizer.GetConfig(directLightGridIndex);
+    directLightBucketeer.RecreateSwapchainResources(directLightConfig.size, framesInFlightCount, directLightConfig.mipsCount);
+    isGiDirectionCacheOutdated = true;
+  }
+
   public:
   void RenderFrame(const legit::InFlightQueue::FrameInfo &frameInfo, const Camera &camera, const Camera &light, Scene *scene, GLFWwindow *window)
   {
     ImGui::Begin("Point renderer stuff");
 
+    gridSizer.RenderUI();
+    if (gridSizer.Update())
+    {
+      //buckets of previous frames can still be in flight
+      core->WaitIdle();
+      RecreateBucketeers();
+    }
+
     static float ang = 0.0f;
 
+    ImGui::Checkbox("Cache gi directions", &useGiDirectionCache);
+    if (useGiDirectionCache)
+    {
+      isGiDirectionCacheOutdated |= ImGui::SliderInt("Gi directions", &giDirectionsCount, 1, 64);
+      ImGui::SliderInt("Gi refreshes per frame", &giDirectionRefreshesCount, 0, 8);
+    }
+    if (useGiDirectionCache && isGiDirectionCacheOutdated)
+    {
+      core->WaitIdle();
+      auto giConfig = gridSizer.GetConfig(giGridIndex);
+      giDirectionCache.Recreate(size_t(giDirectionsCount), giConfig.size, giConfig.mipsCount, sceneResources->pointsCount);
+      isGiDirectionCacheOutdated = false;
+    }
+
     static bool updateSimulation = true;
     ImGui::Checkbox("Update", &updateSimulation);
+    ImGui::SliderInt("Sort particles every N frames", &particlesSortPeriod, 0, 128);
     if (updateSimulation)
     {
-      solver.Update(frameInfo.memoryPool);
-      solver.AdvectParticles(frameInfo.memoryPool, sceneResources->pointData->Id(), sceneResources->pointsCount);
+      //sorted before the solver so that advection already reads particles in cell order
+      if (particlesSortPeriod > 0 && ++framesSinceParticlesSort >= particlesSortPeriod)
+      {
+        particleSorter.Sort(frameInfo.memoryPool, sceneResources->pointData->Id());
+        framesSinceParticlesSort = 0;
+      }
+      //advects particles too, once per substep
+      solver.Update(frameInfo.memoryPool, sceneResources->pointData->Id(), sceneResources->pointsCount);
+      //particles moved so every cached bucketing is stale, only the cast direction gets rebucketed
+      giDirectionCache.Invalidate();
     }
+    auto packedPoints = pointPacker.PackPoints(frameInfo.memoryPool, sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount));
 
     PassData passData;
 
@@ -139,7 +255,7 @@ private:
       ang += 0.01f;
       passData.bucketViewMatrix = glm::inverse(bucketPos.GetTransformMatrix());
 
-      auto res = directLightBucketeer.BucketPoints(frameInfo.memoryPool, passData.lightProjMatrix, passData.lightViewMatrix, this->sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount), true);
+      auto res = directLightBucketeer.BucketPoints(frameInfo.memoryPool, passData.lightProjMatrix, passData.lightViewMatrix, packedPoints.pointsHotProxyId, uint32_t(sceneResources->pointsCount), true);
 
       //direct light casting
       core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
@@ -193,7 +309,7 @@ private:
 
     if(1)
     {
-      auto res = giBucketeer.BucketPoints(frameInfo.memoryPool, passData.bucketProjMatrix, passData.bucketViewMatrix, this->sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount), true);
+      auto res = BucketGiPoints(frameInfo.memoryPool, passData, packedPoints.pointsHotProxyId);
 
       //bucket casting
       core->GetRenderGraph()->AddPass(legit::RenderGraph::ComputePassDesc()
@@ -256,7 +372,7 @@ private:
 
 
     {
-      auto res = viewportBucketeer.BucketPoints(frameInfo.memoryPool, passData.projMatrix, passData.viewMatrix, this->sceneResources->pointData->Id(), uint32_t(sceneResources->pointsCount), true);
+      auto res = viewportBucketeer.BucketPoints(frameInfo.memoryPool, passData.projMatrix, passData.viewMatrix, packedPoints.pointsHotProxyId, uint32_t(sceneResources->pointsCount), true);
 
       core->GetRenderGraph()->AddPass( legit::RenderGraph::RenderPassDesc()
         .SetColorAttachments({
@@ -347,7 +463,9 @@ private:
     blurBuilder.ReloadShaders();
     debugRenderer.ReloadShaders();
     viewportBucketeer.ReloadShaders();
+    pointPacker.ReloadShaders();
     solver.ReloadShaders();
+    particleSorter.ReloadShaders();
   }
 private:
 
@@ -555,8 +673,19 @@ private:
   ListBucketeer viewportBucketeer;
   ListBucketeer giBucketeer;
   ListBucketeer directLightBucketeer;
+  PointPacker pointPacker;
+  DirectionalBucketCache giDirectionCache;
   ShrodingerSolver solver;
   //SimpleSolver solver;
+  ParticleSorter particleSorter;
+  int particlesSortPeriod; //in simulated frames, 0 disables sorting
+  int framesSinceParticlesSort;
+
+  BucketGridSizer gridSizer;
+  size_t viewportGridIndex;
+  size_t giGridIndex;
+  size_t directLightGridIndex;
+  size_t framesInFlightCount;
 
   bool useArrayBuckets;
   bool useBlockGathering;
@@ -572,6 +701,11 @@ private:
 
   glm::uvec2 giViewportSize;
 
+  bool useGiDirectionCache;
+  int giDirectionsCount;
+  int giDirectionRefreshesCount;
+  bool isGiDirectionCacheOutdated;
+
   std::default_random_engine eng;
   std::uniform_real_distribution<float> dis{ 0.0f, 1.0f };
 
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#ifdef _WIN32
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+//read only mapping of a whole file. pages are loaded by the os on access so the file does not have to fit into memory
+class MappedFile
+{
+public:
+  MappedFile(std::string filename)
+  {
+    data = nullptr;
+    size = 0;
+#ifdef _WIN32
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    mappingHandle = nullptr;
+    if (fileHandle == INVALID_HANDLE_VALUE)
+      return;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+      return;
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle)
+      return;
+    data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (data)
+      size = size_t(fileSize.QuadPart);
+#else
+    fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+      return;
+    struct stat fileStat;
+    if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+      return;
+    void *mapping = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (mapping == MAP_FAILED)
+      return;
+    madvise(mapping, size_t(fileStat.st_size), MADV_SEQUENTIAL);
+    data = (const uint8_t*)mapping;
+    size = size_t(fileStat.st_size);
+#endif
+  }
+  ~MappedFile()
+  {
+#ifdef _WIN32
+    if (data)
+      UnmapViewOfFile(data);
+    if (mappingHandle)
+      CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+      CloseHandle(fileHandle);
+#else
+    if (data)
+      munmap((void*)data, size);
+    if (fileDescriptor >= 0)
+      close(fileDescriptor);
+#endif
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const uint8_t *GetData() const
+  {
+    return data;
+  }
+  size_t GetSize() const
+  {
+    return size;
+  }
+private:
+  const uint8_t *data;
+  size_t size;
+#ifdef _WIN32
+  HANDLE fileHandle;
+  HANDLE mappingHandle;
+#else
+  int fileDescriptor;
+#endif
+};
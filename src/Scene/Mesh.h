@@ -1,4 +1,6 @@
 #include <random>
+#include <fstream>
+#include <filesystem>
 namespace tinyobj
 {
   bool operator < (const tinyobj::index_t &left, const tinyobj::index_t &right)
@@ -7,6 +9,26 @@ namespace tinyobj
   }
 }
 
+struct PointChunk
+{
+  glm::vec3 boxMin;
+  glm::vec3 boxMax;
+  uint32_t firstPointIndex;
+  uint32_t pointsCount;
+};
+
+//leaves are point chunks, inner nodes hold merged splats of their children that are stored after all leaf points
+struct PointLodNode
+{
+  glm::vec3 boxMin;
+  glm::vec3 boxMax;
+  uint32_t firstPointIndex;
+  uint32_t pointsCount;
+  float error; //max distance between merged splats and source points, 0 for leaves
+  uint32_t firstChildIndex;
+  uint32_t childrenCount;
+};
+
 struct MeshData
 {
   MeshData() {}
@@ -232,9 +254,261 @@ struct MeshData
     return res;
   }
 
+  static glm::uint SpreadBits(glm::uint val) //inserts 2 zero bits after each of the lower 10 bits
+  {
+    val = (val * 0x00010001u) & 0xFF0000FFu;
+    val = (val * 0x00000101u) & 0x0F00F00Fu;
+    val = (val * 0x00000011u) & 0xC30C30C3u;
+    val = (val * 0x00000005u) & 0x49249249u;
+    return val;
+  }
+
+  //reorders points along a morton curve and splits them into chunks of consecutive points with their bounds
+  void BuildPointChunks(size_t chunkSize)
+  {
+    assert(primitiveTopology == vk::PrimitiveTopology::ePointList);
+    pointChunks.clear();
+    if (vertices.size() == 0)
+      return;
+
+    glm::vec3 boxMin = vertices[0].pos;
+    glm::vec3 boxMax = vertices[0].pos;
+    for (auto &vertex : vertices)
+    {
+      boxMin = glm::min(boxMin, vertex.pos);
+      boxMax = glm::max(boxMax, vertex.pos);
+    }
+    glm::vec3 cellScale = glm::vec3(1023.0f) / glm::max(boxMax - boxMin, glm::vec3(1e-5f));
+
+    std::vector<std::pair<glm::uint, size_t>> mortonKeys;
+    mortonKeys.reserve(vertices.size());
+    for (size_t vertexIndex = 0; vertexIndex < vertices.size(); vertexIndex++)
+    {
+      glm::uvec3 cell = glm::uvec3((vertices[vertexIndex].pos - boxMin) * cellScale);
+      glm::uint key = SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2);
+      mortonKeys.push_back({ key, vertexIndex });
+    }
+    std::sort(mortonKeys.begin(), mortonKeys.end());
+
+    std::vector<Vertex> sortedVertices;
+    sortedVertices.reserve(vertices.size());
+    for (auto &mortonKey : mortonKeys)
+      sortedVertices.push_back(vertices[mortonKey.second]);
+    vertices = std::move(sortedVertices);
+
+    for (size_t firstPointIndex = 0; firstPointIndex < vertices.size(); firstPointIndex += chunkSize)
+    {
+      PointChunk chunk;
+      chunk.firstPointIndex = uint32_t(firstPointIndex);
+      chunk.pointsCount = uint32_t(std::min(chunkSize, vertices.size() - firstPointIndex));
+      chunk.boxMin = glm::vec3(std::numeric_limits<float>::max());
+      chunk.boxMax = glm::vec3(-std::numeric_limits<float>::max());
+      for (size_t pointIndex = chunk.firstPointIndex; pointIndex < chunk.firstPointIndex + chunk.pointsCount; pointIndex++)
+      {
+        float radius = vertices[pointIndex].uv.x; //point meshes store their radius in uv.x
+        chunk.boxMin = glm::min(chunk.boxMin, vertices[pointIndex].pos - glm::vec3(radius));
+        chunk.boxMax = glm::max(chunk.boxMax, vertices[pointIndex].pos + glm::vec3(radius));
+      }
+      pointChunks.push_back(chunk);
+    }
+  }
+
+  //area weighted merge, point area is proportional to squared radius stored in uv.x
+  static Vertex MergeSplats(const Vertex *splats, size_t splatsCount, float &maxDisplacement)
+  {
+    Vertex res = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f) };
+    float totalWeight = 0.0f;
+    for (size_t splatIndex = 0; splatIndex < splatsCount; splatIndex++)
+    {
+      float weight = std::max(splats[splatIndex].uv.x * splats[splatIndex].uv.x, 1e-12f);
+      res.pos += splats[splatIndex].pos * weight;
+      res.normal += splats[splatIndex].normal * weight;
+      res.uv.y += splats[splatIndex].uv.y * weight;
+      totalWeight += weight;
+    }
+    res.pos /= totalWeight;
+    res.uv.y /= totalWeight;
+    res.uv.x = std::sqrt(totalWeight);
+    res.normal = glm::length(res.normal) > 1e-5f ? glm::normalize(res.normal) : splats[0].normal;
+
+    maxDisplacement = 0.0f;
+    for (size_t splatIndex = 0; splatIndex < splatsCount; splatIndex++)
+      maxDisplacement = std::max(maxDisplacement, glm::length(splats[splatIndex].pos - res.pos));
+    return res;
+  }
+
+  //merges splats that fall into the same cell of a grid, cell size grows until there are at most maxSplatsCount cells occupied
+  static std::vector<Vertex> ClusterSplats(const std::vector<Vertex> &splats, glm::vec3 boxMin, glm::vec3 boxMax, size_t maxSplatsCount, float &maxDisplacement)
+  {
+    float extent = std::max(1e-5f, std::max(boxMax.x - boxMin.x, std::max(boxMax.y - boxMin.y, boxMax.z - boxMin.z)));
+    float cellSize = extent / 1024.0f;
+
+    std::vector<std::pair<uint64_t, uint32_t>> cellSplats(splats.size());
+    size_t occupiedCellsCount = 0;
+    do
+    {
+      cellSize *= 1.25f;
+      for (size_t splatIndex = 0; splatIndex < splats.size(); splatIndex++)
+      {
+        glm::uvec3 cell = glm::uvec3(glm::max(glm::vec3(0.0f), (splats[splatIndex].pos - boxMin) / cellSize));
+        cellSplats[splatIndex] = { uint64_t(cell.x) | (uint64_t(cell.y) << 21) | (uint64_t(cell.z) << 42), uint32_t(splatIndex) };
+      }
+      std::sort(cellSplats.begin(), cellSplats.end());
+      occupiedCellsCount = 0;
+      for (size_t pairIndex = 0; pairIndex < cellSplats.size(); pairIndex++)
+        occupiedCellsCount += (pairIndex == 0 || cellSplats[pairIndex].first != cellSplats[pairIndex - 1].first) ? 1 : 0;
+    } while (occupiedCellsCount > maxSplatsCount);
+
+    std::vector<Vertex> sortedSplats;
+    for (auto &cellSplat : cellSplats)
+      sortedSplats.push_back(splats[cellSplat.second]);
+
+    std::vector<Vertex> mergedSplats;
+    maxDisplacement = 0.0f;
+    for (size_t cellStart = 0; cellStart < cellSplats.size();)
+    {
+      size_t cellEnd = cellStart;
+      while (cellEnd < cellSplats.size() && cellSplats[cellEnd].first == cellSplats[cellStart].first)
+        cellEnd++;
+      float displacement;
+      mergedSplats.push_back(MergeSplats(sortedSplats.data() + cellStart, cellEnd - cellStart, displacement));
+      maxDisplacement = std::max(maxDisplacement, displacement);
+      cellStart = cellEnd;
+    }
+    return mergedSplats;
+  }
+
+  //builds a tree over point chunks, has to be called after BuildPointChunks. each inner node merges splats of childrenCount children into at most maxNodePointsCount splats
+  void BuildPointLod(size_t childrenCount, size_t maxNodePointsCount)
+  {
+    pointLodNodes.clear();
+    std::vector<uint32_t> levelNodeIndices;
+    for (auto &chunk : pointChunks)
+    {
+      PointLodNode node;
+      node.boxMin = chunk.boxMin;
+      node.boxMax = chunk.boxMax;
+      node.firstPointIndex = chunk.firstPointIndex;
+      node.pointsCount = chunk.pointsCount;
+      node.error = 0.0f;
+      node.firstChildIndex = 0;
+      node.childrenCount = 0;
+      levelNodeIndices.push_back(uint32_t(pointLodNodes.size()));
+      pointLodNodes.push_back(node);
+    }
+
+    while (levelNodeIndices.size() > 1)
+    {
+      std::vector<uint32_t> nextLevelNodeIndices;
+      for (size_t groupStart = 0; groupStart < levelNodeIndices.size(); groupStart += childrenCount)
+      {
+        size_t groupSize = std::min(childrenCount, levelNodeIndices.size() - groupStart);
+
+        PointLodNode node;
+        node.firstChildIndex = levelNodeIndices[groupStart];
+        node.childrenCount = uint32_t(groupSize);
+        node.boxMin = glm::vec3(std::numeric_limits<float>::max());
+        node.boxMax = glm::vec3(-std::numeric_limits<float>::max());
+        float childrenError = 0.0f;
+
+        std::vector<Vertex> childSplats;
+        for (size_t childNumber = 0; childNumber < groupSize; childNumber++)
+        {
+          const PointLodNode &child = pointLodNodes[node.firstChildIndex + childNumber];
+          node.boxMin = glm::min(node.boxMin, child.boxMin);
+          node.boxMax = glm::max(node.boxMax, child.boxMax);
+          childrenError = std::max(childrenError, child.error);
+          childSplats.insert(childSplats.end(), vertices.begin() + child.firstPointIndex, vertices.begin() + child.firstPointIndex + child.pointsCount);
+        }
+
+        node.firstPointIndex = uint32_t(vertices.size());
+        float maxDisplacement = 0.0f;
+        auto mergedSplats = ClusterSplats(childSplats, node.boxMin, node.boxMax, maxNodePointsCount, maxDisplacement);
+        vertices.insert(vertices.end(), mergedSplats.begin(), mergedSplats.end());
+        node.pointsCount = uint32_t(vertices.size() - node.firstPointIndex);
+        node.error = childrenError + maxDisplacement;
+
+        nextLevelNodeIndices.push_back(uint32_t(pointLodNodes.size()));
+        pointLodNodes.push_back(node);
+      }
+      levelNodeIndices = nextLevelNodeIndices;
+    }
+  }
+
+  static const uint32_t PointCacheMagic = 0x50434C47; //"GLCP"
+  static const uint32_t PointCacheVersion = 1;
+
+  template<typename T>
+  static void WriteVector(std::ofstream &file, const std::vector<T> &data)
+  {
+    uint64_t size = data.size();
+    file.write((const char*)&size, sizeof(size));
+    file.write((const char*)data.data(), sizeof(T) * size);
+  }
+
+  template<typename T>
+  static void ReadVector(std::ifstream &file, std::vector<T> &data)
+  {
+    uint64_t size = 0;
+    file.read((char*)&size, sizeof(size));
+    data.resize(file ? size_t(size) : 0);
+    file.read((char*)data.data(), sizeof(T) * data.size());
+  }
+
+  //scale is baked into point positions so caches made with a different scale are rejected
+  bool LoadPointCache(std::string filename, glm::vec3 scale)
+  {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+      return false;
+    uint32_t magic = 0, version = 0;
+    glm::vec3 cacheScale(0.0f);
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&cacheScale, sizeof(cacheScale));
+    if (!file || magic != PointCacheMagic || version != PointCacheVersion || cacheScale != scale)
+      return false;
+    ReadVector(file, vertices);
+    ReadVector(file, pointChunks);
+    ReadVector(file, pointLodNodes);
+    indices.clear();
+    primitiveTopology = vk::PrimitiveTopology::ePointList;
+    return bool(file);
+  }
+
+  void SavePointCache(std::string filename, glm::vec3 scale) const
+  {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+      std::cout << "Can't write point cache " << filename << "\n";
+      return;
+    }
+    uint32_t magic = PointCacheMagic, version = PointCacheVersion;
+    file.write((const char*)&magic, sizeof(magic));
+    file.write((const char*)&version, sizeof(version));
+    file.write((const char*)&scale, sizeof(scale));
+    WriteVector(file, vertices);
+    WriteVector(file, pointChunks);
+    WriteVector(file, pointLodNodes);
+  }
+
+  //cache is valid if it was written after the source mesh was last modified
+  static bool IsPointCacheValid(std::string cacheFilename, std::string meshFilename)
+  {
+    std::error_code err;
+    auto cacheTime = std::filesystem::last_write_time(cacheFilename, err);
+    if (err)
+      return false;
+    auto meshTime = std::filesystem::last_write_time(meshFilename, err);
+    return !err && cacheTime >= meshTime;
+  }
+
   using IndexType = uint32_t;
   std::vector<Vertex> vertices;
   std::vector<IndexType> indices;
+  std::vector<PointChunk> pointChunks;
+  std::vector<PointLodNode> pointLodNodes;
   vk::PrimitiveTopology primitiveTopology;
 };
 
@@ -246,6 +520,8 @@ struct Mesh
     this->primitiveTopology = meshData.primitiveTopology;
     indicesCount = meshData.indices.size();
     verticesCount = meshData.vertices.size();
+    pointChunks = meshData.pointChunks;
+    pointLodNodes = meshData.pointLodNodes;
 
     vertexBuffer = std::make_unique<legit::StagedBuffer>(physicalDevice, logicalDevice, meshData.vertices.size() * sizeof(MeshData::Vertex), vk::BufferUsageFlagBits::eVertexBuffer);
     if(indicesCount > 0)
@@ -260,6 +536,19 @@ struct Mesh
       indexBuffer->Unmap(transferCommandBuffer);
     }
   }
+  //point cloud that is streamed into the vertex buffer by LoadPointCloudMesh, there's no staging copy of the whole cloud
+  Mesh(vk::PhysicalDevice physicalDevice, vk::Device logicalDevice, size_t pointsCount)
+  {
+    this->primitiveTopology = vk::PrimitiveTopology::ePointList;
+    indicesCount = 0;
+    verticesCount = pointsCount;
+
+    pointCloudBuffer = std::make_unique<legit::Buffer>(physicalDevice, logicalDevice, pointsCount * sizeof(MeshData::Vertex), vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
+  }
+  vk::Buffer GetVertexBuffer()
+  {
+    return vertexBuffer ? vertexBuffer->GetBuffer() : pointCloudBuffer->GetHandle();
+  }
   static legit::VertexDeclaration GetVertexDeclaration()
   {
     legit::VertexDeclaration vertexDecl;
@@ -281,7 +570,10 @@ struct Mesh
 
   std::unique_ptr<legit::StagedBuffer> vertexBuffer;
   std::unique_ptr<legit::StagedBuffer> indexBuffer;
+  std::unique_ptr<legit::Buffer> pointCloudBuffer;
   size_t indicesCount;
   size_t verticesCount;
+  std::vector<PointChunk> pointChunks; //object space
+  std::vector<PointLodNode> pointLodNodes; //object space
   vk::PrimitiveTopology primitiveTopology;
 };
\ No newline at end of file
@@ -0,0 +1,406 @@
+#pragma once
+#include <thread>
+#include "MappedFile.h"
+
+//binary little endian ply and uncompressed las point clouds. points are decoded on demand straight from the mapped file
+class PointCloudFile
+{
+public:
+  PointCloudFile(std::string filename) :
+    mappedFile(filename)
+  {
+    pointsCount = 0;
+    pointsOffset = 0;
+    pointStride = 0;
+    hasNormals = false;
+    hasRadius = false;
+    positionScale = glm::dvec3(1.0);
+    positionOffset = glm::dvec3(0.0);
+    if (!mappedFile.GetData())
+    {
+      std::cout << "Can't open point cloud " << filename << "\n";
+      return;
+    }
+
+    bool isParsed = false;
+    if (mappedFile.GetSize() >= 4 && memcmp(mappedFile.GetData(), "ply\n", 4) == 0)
+      isParsed = ParsePlyHeader();
+    else if (mappedFile.GetSize() >= 4 && memcmp(mappedFile.GetData(), "LASF", 4) == 0)
+      isParsed = ParseLasHeader();
+    else
+      std::cout << "Unknown point cloud format " << filename << "\n";
+
+    if (!isParsed || pointsOffset + pointsCount * pointStride > mappedFile.GetSize())
+    {
+      std::cout << "Can't parse point cloud " << filename << "\n";
+      pointsCount = 0;
+    }
+  }
+
+  static bool IsPointCloudFilename(std::string filename)
+  {
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(std::tolower(c)); });
+    return extension == ".ply" || extension == ".las";
+  }
+
+  size_t GetPointsCount() const
+  {
+    return pointsCount;
+  }
+
+  //decodes a range of points into point mesh vertices, uv.x is world radius. safe to call from several threads at once
+  void ReadPoints(size_t firstPointIndex, size_t readPointsCount, glm::vec3 scale, float defaultRadius, MeshData::Vertex *dstVertices) const
+  {
+    assert(firstPointIndex + readPointsCount <= pointsCount);
+    float radiusScale = std::max(scale.x, std::max(scale.y, scale.z));
+    const uint8_t *srcPoint = mappedFile.GetData() + pointsOffset + firstPointIndex * pointStride;
+    for (size_t pointNumber = 0; pointNumber < readPointsCount; pointNumber++, srcPoint += pointStride)
+    {
+      MeshData::Vertex &vertex = dstVertices[pointNumber];
+      glm::dvec3 pos = glm::dvec3(
+        ReadValue(srcPoint, posAttribs[0]),
+        ReadValue(srcPoint, posAttribs[1]),
+        ReadValue(srcPoint, posAttribs[2])) * positionScale + positionOffset;
+      vertex.pos = glm::vec3(pos) * scale;
+      if (hasNormals)
+      {
+        glm::vec3 normal = glm::vec3(
+          float(ReadValue(srcPoint, normalAttribs[0])),
+          float(ReadValue(srcPoint, normalAttribs[1])),
+          float(ReadValue(srcPoint, normalAttribs[2])));
+        float normalLength = glm::length(normal);
+        vertex.normal = normalLength > 1e-7f ? normal / normalLength : glm::vec3(0.0f, 1.0f, 0.0f);
+      }
+      else
+      {
+        vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+      }
+      vertex.uv = glm::vec2((hasRadius ? float(ReadValue(srcPoint, radiusAttrib)) : defaultRadius) * radiusScale, 0.0f);
+    }
+  }
+private:
+  enum struct ValueTypes
+  {
+    Int8,
+    Uint8,
+    Int16,
+    Uint16,
+    Int32,
+    Uint32,
+    Float32,
+    Float64
+  };
+  struct Attrib
+  {
+    ValueTypes type;
+    size_t offset;
+  };
+
+  static size_t GetValueSize(ValueTypes type)
+  {
+    switch (type)
+    {
+      case ValueTypes::Int8: case ValueTypes::Uint8: return 1;
+      case ValueTypes::Int16: case ValueTypes::Uint16: return 2;
+      case ValueTypes::Int32: case ValueTypes::Uint32: case ValueTypes::Float32: return 4;
+      case ValueTypes::Float64: return 8;
+    }
+    return 0;
+  }
+
+  template<typename T>
+  static T ReadRaw(const uint8_t *src)
+  {
+    T val;
+    memcpy(&val, src, sizeof(T));
+    return val;
+  }
+
+  static double ReadValue(const uint8_t *srcPoint, Attrib attrib)
+  {
+    const uint8_t *src = srcPoint + attrib.offset;
+    switch (attrib.type)
+    {
+      case ValueTypes::Int8: return double(ReadRaw<int8_t>(src));
+      case ValueTypes::Uint8: return double(ReadRaw<uint8_t>(src));
+      case ValueTypes::Int16: return double(ReadRaw<int16_t>(src));
+      case ValueTypes::Uint16: return double(ReadRaw<uint16_t>(src));
+      case ValueTypes::Int32: return double(ReadRaw<int32_t>(src));
+      case ValueTypes::Uint32: return double(ReadRaw<uint32_t>(src));
+      case ValueTypes::Float32: return double(ReadRaw<float>(src));
+      case ValueTypes::Float64: return ReadRaw<double>(src);
+    }
+    return 0.0;
+  }
+
+  static bool ParsePlyType(std::string name, ValueTypes &type)
+  {
+    if (name == "char" || name == "int8") type = ValueTypes::Int8;
+    else if (name == "uchar" || name == "uint8") type = ValueTypes::Uint8;
+    else if (name == "short" || name == "int16") type = ValueTypes::Int16;
+    else if (name == "ushort" || name == "uint16") type = ValueTypes::Uint16;
+    else if (name == "int" || name == "int32") type = ValueTypes::Int32;
+    else if (name == "uint" || name == "uint32") type = ValueTypes::Uint32;
+    else if (name == "float" || name == "float32") type = ValueTypes::Float32;
+    else if (name == "double" || name == "float64") type = ValueTypes::Float64;
+    else return false;
+    return true;
+  }
+
+  //only the vertex element is read, elements before it must not have list properties so that its offset is known
+  bool ParsePlyHeader()
+  {
+    const char *headerEnd = "end_header\n";
+    const uint8_t *data = mappedFile.GetData();
+    const uint8_t *dataEnd = data + std::min<size_t>(mappedFile.GetSize(), 1 << 16);
+    const uint8_t *headerEndPos = std::search(data, dataEnd, headerEnd, headerEnd + strlen(headerEnd));
+    if (headerEndPos == dataEnd)
+      return false;
+    pointsOffset = size_t(headerEndPos - data) + strlen(headerEnd);
+
+    std::istringstream header(std::string((const char*)data, (const char*)headerEndPos));
+    std::string line;
+    bool isVertexElement = false;
+    bool isVertexElementFound = false;
+    bool hasPos[3] = { false, false, false };
+    bool hasNormal[3] = { false, false, false };
+    size_t elementStride = 0;
+    size_t elementsCount = 0;
+    while (std::getline(header, line))
+    {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      std::istringstream tokens(line);
+      std::string keyword;
+      tokens >> keyword;
+      if (keyword == "format")
+      {
+        std::string format;
+        tokens >> format;
+        if (format != "binary_little_endian")
+        {
+          std::cout << "Only binary little endian ply is supported, got " << format << "\n";
+          return false;
+        }
+      }
+      else if (keyword == "element")
+      {
+        if (!isVertexElementFound)
+          pointsOffset += elementStride * elementsCount;
+        std::string elementName;
+        tokens >> elementName >> elementsCount;
+        elementStride = 0;
+        isVertexElement = elementName == "vertex";
+        if (isVertexElement)
+        {
+          if (isVertexElementFound)
+            return false;
+          isVertexElementFound = true;
+          pointsCount = elementsCount;
+        }
+      }
+      else if (keyword == "property")
+      {
+        std::string typeName, propertyName;
+        tokens >> typeName;
+        if (typeName == "list")
+        {
+          if (!isVertexElementFound || isVertexElement)
+          {
+            std::cout << "List properties are not supported in ply vertices or before them\n";
+            return false;
+          }
+          continue;
+        }
+        tokens >> propertyName;
+        ValueTypes type;
+        if (!ParsePlyType(typeName, type))
+          return false;
+        Attrib attrib = { type, elementStride };
+        elementStride += GetValueSize(type);
+        if (!isVertexElement)
+          continue;
+        const char *posNames[] = { "x", "y", "z" };
+        const char *normalNames[] = { "nx", "ny", "nz" };
+        for (int axis = 0; axis < 3; axis++)
+        {
+          if (propertyName == posNames[axis])
+          {
+            posAttribs[axis] = attrib;
+            hasPos[axis] = true;
+          }
+          if (propertyName == normalNames[axis])
+          {
+            normalAttribs[axis] = attrib;
+            hasNormal[axis] = true;
+          }
+        }
+        if (propertyName == "radius")
+        {
+          radiusAttrib = attrib;
+          hasRadius = true;
+        }
+        pointStride = elementStride;
+      }
+    }
+    hasNormals = hasNormal[0] && hasNormal[1] && hasNormal[2];
+    return isVertexElementFound && hasPos[0] && hasPos[1] && hasPos[2];
+  }
+
+  //las 1.0-1.4 point formats 0-10, laz is not supported. positions are recentered around the bounding box because las coordinates are usually georeferenced and don't fit into floats
+  bool ParseLasHeader()
+  {
+    const uint8_t *data = mappedFile.GetData();
+    if (mappedFile.GetSize() < 227)
+      return false;
+    uint8_t versionMinor = ReadRaw<uint8_t>(data + 25);
+    pointsOffset = ReadRaw<uint32_t>(data + 96);
+    uint8_t pointFormat = ReadRaw<uint8_t>(data + 104);
+    pointStride = ReadRaw<uint16_t>(data + 105);
+    pointsCount = ReadRaw<uint32_t>(data + 107);
+    if (pointsCount == 0 && versionMinor >= 4 && mappedFile.GetSize() >= 255)
+      pointsCount = size_t(ReadRaw<uint64_t>(data + 247));
+    if (pointFormat & 0xc0)
+    {
+      std::cout << "Compressed las is not supported\n";
+      return false;
+    }
+    if (pointStride < 12)
+      return false;
+
+    positionScale = glm::dvec3(ReadRaw<double>(data + 131), ReadRaw<double>(data + 139), ReadRaw<double>(data + 147));
+    glm::dvec3 boxMax = glm::dvec3(ReadRaw<double>(data + 179), ReadRaw<double>(data + 195), ReadRaw<double>(data + 211));
+    glm::dvec3 boxMin = glm::dvec3(ReadRaw<double>(data + 187), ReadRaw<double>(data + 203), ReadRaw<double>(data + 219));
+    positionOffset = glm::dvec3(ReadRaw<double>(data + 155), ReadRaw<double>(data + 163), ReadRaw<double>(data + 171)) - (boxMin + boxMax) * 0.5;
+    for (int axis = 0; axis < 3; axis++)
+      posAttribs[axis] = { ValueTypes::Int32, size_t(axis * 4) };
+    return true;
+  }
+
+  MappedFile mappedFile;
+  size_t pointsCount;
+  size_t pointsOffset;
+  size_t pointStride;
+  Attrib posAttribs[3];
+  Attrib normalAttribs[3];
+  Attrib radiusAttrib;
+  bool hasNormals;
+  bool hasRadius;
+  glm::dvec3 positionScale;
+  glm::dvec3 positionOffset;
+};
+
+//converts the cloud in parallel into a bounded ring of staging buffers and copies them into a device local vertex buffer,
+//so host memory used does not depend on the cloud size. each slot has its own fence and the loader only waits when it reuses a slot,
+//so decoding the next slot overlaps with the copy of the previous ones. points are chunked in file order, scanned clouds are usually spatially coherent in it
+std::unique_ptr<Mesh> LoadPointCloudMesh(legit::Core *core, std::string filename, glm::vec3 scale, float pointRadius, size_t chunkSize)
+{
+  std::cout << "Loading point cloud: " << filename << "\n";
+  PointCloudFile pointCloud(filename);
+  size_t pointsCount = pointCloud.GetPointsCount();
+  if (pointsCount == 0)
+    return nullptr;
+
+  const size_t stagingSlotsCount = 4;
+  const size_t stagingSlotChunksCount = 256;
+  const size_t stagingSlotPointsCount = stagingSlotChunksCount * chunkSize;
+  struct StagingSlot
+  {
+    std::unique_ptr<legit::Buffer> buffer;
+    vk::UniqueFence copyFence;
+    vk::UniqueCommandBuffer commandBuffer;
+  };
+  std::vector<StagingSlot> stagingSlots;
+  for (size_t slotIndex = 0; slotIndex < stagingSlotsCount; slotIndex++)
+  {
+    StagingSlot slot;
+    slot.buffer.reset(new legit::Buffer(core->GetPhysicalDevice(), core->GetLogicalDevice(), sizeof(MeshData::Vertex) * stagingSlotPointsCount, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+    slot.copyFence = core->GetLogicalDevice().createFenceUnique(vk::FenceCreateInfo().setFlags(vk::FenceCreateFlagBits::eSignaled));
+    slot.commandBuffer = std::move(core->AllocateCommandBuffers(1)[0]);
+    stagingSlots.push_back(std::move(slot));
+  }
+
+  std::unique_ptr<Mesh> mesh(new Mesh(core->GetPhysicalDevice(), core->GetLogicalDevice(), pointsCount));
+  size_t chunksCount = (pointsCount + chunkSize - 1) / chunkSize;
+  mesh->pointChunks.resize(chunksCount);
+
+  size_t threadsCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+  size_t slotIndex = 0;
+  for (size_t slotFirstPointIndex = 0; slotFirstPointIndex < pointsCount; slotFirstPointIndex += stagingSlotPointsCount)
+  {
+    StagingSlot &slot = stagingSlots[slotIndex];
+    slotIndex = (slotIndex + 1) % stagingSlotsCount;
+    //the slot's previous copy has to finish before its staging buffer is overwritten
+    auto res = core->GetLogicalDevice().waitForFences({ slot.copyFence.get() }, true, std::numeric_limits<uint64_t>::max());
+    (void)res;
+
+    size_t slotPointsCount = std::min(stagingSlotPointsCount, pointsCount - slotFirstPointIndex);
+    size_t slotFirstChunkIndex = slotFirstPointIndex / chunkSize;
+    size_t slotChunksCount = (slotPointsCount + chunkSize - 1) / chunkSize;
+
+    MeshData::Vertex *slotVertices = (MeshData::Vertex*)slot.buffer->Map();
+    std::vector<std::thread> threads;
+    for (size_t threadIndex = 0; threadIndex < threadsCount; threadIndex++)
+    {
+      threads.emplace_back([&, threadIndex]()
+      {
+        for (size_t chunkNumber = threadIndex; chunkNumber < slotChunksCount; chunkNumber += threadsCount)
+        {
+          size_t chunkFirstPointIndex = slotFirstPointIndex + chunkNumber * chunkSize;
+          size_t chunkPointsCount = std::min(chunkSize, pointsCount - chunkFirstPointIndex);
+          MeshData::Vertex *chunkVertices = slotVertices + chunkNumber * chunkSize;
+          pointCloud.ReadPoints(chunkFirstPointIndex, chunkPointsCount, scale, pointRadius, chunkVertices);
+
+          PointChunk &chunk = mesh->pointChunks[slotFirstChunkIndex + chunkNumber];
+          chunk.firstPointIndex = uint32_t(chunkFirstPointIndex);
+          chunk.pointsCount = uint32_t(chunkPointsCount);
+          chunk.boxMin = glm::vec3(std::numeric_limits<float>::max());
+          chunk.boxMax = glm::vec3(-std::numeric_limits<float>::max());
+          for (size_t pointNumber = 0; pointNumber < chunkPointsCount; pointNumber++)
+          {
+            float radius = chunkVertices[pointNumber].uv.x; //same radius inflated bounds as MeshData::BuildPointChunks
+            chunk.boxMin = glm::min(chunk.boxMin, chunkVertices[pointNumber].pos - glm::vec3(radius));
+            chunk.boxMax = glm::max(chunk.boxMax, chunkVertices[pointNumber].pos + glm::vec3(radius));
+          }
+        }
+      });
+    }
+    for (auto &thread : threads)
+      thread.join();
+    slot.buffer->Unmap();
+
+    auto copyRegion = vk::BufferCopy()
+      .setSrcOffset(0)
+      .setDstOffset(sizeof(MeshData::Vertex) * slotFirstPointIndex)
+      .setSize(sizeof(MeshData::Vertex) * slotPointsCount);
+    slot.commandBuffer->begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    slot.commandBuffer->copyBuffer(slot.buffer->GetHandle(), mesh->pointCloudBuffer->GetHandle(), { copyRegion });
+    slot.commandBuffer->end();
+
+    auto submitInfo = vk::SubmitInfo()
+      .setCommandBufferCount(1)
+      .setPCommandBuffers(&slot.commandBuffer.get());
+    core->GetLogicalDevice().resetFences({ slot.copyFence.get() });
+    core->GetGraphicsQueue().submit({ submitInfo }, slot.copyFence.get());
+  }
+  for (auto &slot : stagingSlots)
+  {
+    auto res = core->GetLogicalDevice().waitForFences({ slot.copyFence.get() }, true, std::numeric_limits<uint64_t>::max());
+    (void)res;
+  }
+
+  //no merged splats for streamed clouds, a root that can never be selected makes the lod cut fall through to the chunks
+  for (auto &chunk : mesh->pointChunks)
+    mesh->pointLodNodes.push_back({ chunk.boxMin, chunk.boxMax, chunk.firstPointIndex, chunk.pointsCount, 0.0f, 0, 0 });
+  PointLodNode root = { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()), 0, 0, std::numeric_limits<float>::max(), 0, uint32_t(chunksCount) };
+  for (auto &chunk : mesh->pointChunks)
+  {
+    root.boxMin = glm::min(root.boxMin, chunk.boxMin);
+    root.boxMax = glm::max(root.boxMax, chunk.boxMax);
+  }
+  mesh->pointLodNodes.push_back(root);
+
+  std::cout << "Point cloud loaded: " << pointsCount << " points\n";
+  return mesh;
+}
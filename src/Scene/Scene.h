@@ -51,6 +51,15 @@ public:
 
     std::map<std::string, Mesh*> nameToMesh;
 
+    struct PointCloudDesc
+    {
+      std::string name;
+      std::string filename;
+      glm::vec3 scale;
+      float pointRadius;
+    };
+    std::vector<PointCloudDesc> pointCloudDescs;
+
     auto transferCommandBuffer = transferQueue.BeginCommandBuffer();
     {
       Json::Value meshArray = sceneConfig["meshes"];
@@ -61,19 +70,54 @@ public:
         std::string meshFilename = currMeshNode.get("filename", "<unspecified>").asString();
         glm::vec3 scale = ReadJsonVec3f(currMeshNode["scale"]);
 
-        auto meshData = MeshData(meshFilename, scale);
+        //scanned clouds are streamed after the rest of the meshes are transferred
+        if (PointCloudFile::IsPointCloudFilename(meshFilename))
+        {
+          if (geometryType == GeometryTypes::Triangles)
+          {
+            std::cout << "Point cloud " << meshFilename << " can't be used as triangle geometry\n";
+            continue;
+          }
+          pointCloudDescs.push_back({ currMeshNode.get("name", "<unspecified>").asString(), meshFilename, scale, currMeshNode.get("pointRadius", 0.01f).asFloat() });
+          continue;
+        }
+
+        //point generation, chunking and lod building are slow for big meshes so their results are cached next to the mesh
+        std::string pointCacheFilename;
         switch (geometryType)
         {
-          case GeometryTypes::RegularPoints:
+          case GeometryTypes::RegularPoints: pointCacheFilename = meshFilename + ".regular.pointcache"; break;
+          case GeometryTypes::SizedPoints: pointCacheFilename = meshFilename + ".sized.pointcache"; break;
+          default:{}break;
+        }
+
+        MeshData meshData;
+        if (pointCacheFilename.empty() || !MeshData::IsPointCacheValid(pointCacheFilename, meshFilename) || !meshData.LoadPointCache(pointCacheFilename, scale))
+        {
+          meshData = MeshData(meshFilename, scale);
+          switch (geometryType)
           {
-            float splatSize = 0.1f;
-            meshData = MeshData::GeneratePointMeshRegular(meshData, std::pow(1.0f / splatSize, 2.0f));
-          }break;
-          case GeometryTypes::SizedPoints:
+            case GeometryTypes::RegularPoints:
+            {
+              float splatSize = 0.1f;
+              meshData = MeshData::GeneratePointMeshRegular(meshData, std::pow(1.0f / splatSize, 2.0f));
+            }break;
+            case GeometryTypes::SizedPoints:
+            {
+              meshData = MeshData::GeneratePointMeshSized(meshData, 1);
+            }break;
+            default:{}break;
+          }
+          if (meshData.primitiveTopology == vk::PrimitiveTopology::ePointList)
           {
-            meshData = MeshData::GeneratePointMeshSized(meshData, 1);
-          }break;
-          default:{}break;
+            meshData.BuildPointChunks(1024);
+            meshData.BuildPointLod(4, 1024);
+            meshData.SavePointCache(pointCacheFilename, scale);
+          }
+        }
+        else
+        {
+          std::cout << "Point cache loaded: " << pointCacheFilename << "\n";
         }
         auto mesh = std::unique_ptr<Mesh>(new Mesh(meshData, core->GetPhysicalDevice(), core->GetLogicalDevice(), transferCommandBuffer));
         meshes.push_back(std::move(mesh));
@@ -84,6 +128,14 @@ public:
     }
     transferQueue.EndCommandBuffer();
 
+    for (auto &pointCloudDesc : pointCloudDescs)
+    {
+      auto mesh = LoadPointCloudMesh(core, pointCloudDesc.filename, pointCloudDesc.scale, pointCloudDesc.pointRadius, 1024);
+      if (!mesh)
+        continue;
+      meshes.push_back(std::move(mesh));
+      nameToMesh[pointCloudDesc.name] = meshes.back().get();
+    }
 
     for (Json::ArrayIndex objectIndex = 0; objectIndex < sceneConfig["objects"].size(); objectIndex++)
     {
@@ -116,6 +168,36 @@ public:
       objects.push_back(object);
     }
 
+    uint32_t basePointIndex = 0;
+    for (auto &object : objects)
+    {
+      uint32_t baseNodeIndex = uint32_t(pointLodNodes.size());
+      //node error is an object space distance, largest axis scale keeps it conservative under non uniform scaling
+      float objScale = std::max(glm::length(glm::vec3(object.objToWorld[0])), std::max(glm::length(glm::vec3(object.objToWorld[1])), glm::length(glm::vec3(object.objToWorld[2]))));
+      for (auto &node : object.mesh->pointLodNodes)
+      {
+        PointLodNode worldNode = node;
+        TransformBox(object.objToWorld, node.boxMin, node.boxMax, worldNode.boxMin, worldNode.boxMax);
+        worldNode.error = node.error * objScale;
+        worldNode.firstPointIndex = basePointIndex + node.firstPointIndex;
+        worldNode.firstChildIndex = baseNodeIndex + node.firstChildIndex;
+        pointLodNodes.push_back(worldNode);
+      }
+      //root is always the last node built
+      if (!object.mesh->pointLodNodes.empty())
+        pointLodRoots.push_back(uint32_t(pointLodNodes.size() - 1));
+
+      for (auto &chunk : object.mesh->pointChunks)
+      {
+        PointChunk worldChunk;
+        TransformBox(object.objToWorld, chunk.boxMin, chunk.boxMax, worldChunk.boxMin, worldChunk.boxMax);
+        worldChunk.firstPointIndex = basePointIndex + chunk.firstPointIndex;
+        worldChunk.pointsCount = chunk.pointsCount;
+        pointChunks.push_back(worldChunk);
+      }
+      basePointIndex += uint32_t(object.mesh->verticesCount);
+    }
+
     /*std::unique_ptr<Mesh> sponzaMesh;
     auto transferCommandBuffer = transferQueue.BeginCommandBuffer();
     {
@@ -142,12 +224,45 @@ public:
   {
     for (auto &object : objects)
     {
-      objectCallback(object.objToWorld, object.albedoColor, object.emissiveColor, object.mesh->vertexBuffer->GetBuffer(), object.mesh->indexBuffer ? object.mesh->indexBuffer->GetBuffer() : nullptr, uint32_t(object.mesh->verticesCount), uint32_t(object.mesh->indicesCount));
+      objectCallback(object.objToWorld, object.albedoColor, object.emissiveColor, object.mesh->GetVertexBuffer(), object.mesh->indexBuffer ? object.mesh->indexBuffer->GetBuffer() : nullptr, uint32_t(object.mesh->verticesCount), uint32_t(object.mesh->indicesCount));
     }
   }
+  //world space chunks of all point objects, indexed the same way as points of IterateObjects
+  const std::vector<PointChunk> &GetPointChunks() const
+  {
+    return pointChunks;
+  }
+  //world space lod nodes of all point objects, children of a node are stored contiguously
+  const std::vector<PointLodNode> &GetPointLodNodes() const
+  {
+    return pointLodNodes;
+  }
+  const std::vector<uint32_t> &GetPointLodRoots() const
+  {
+    return pointLodRoots;
+  }
 private:
+  static void TransformBox(glm::mat4 transform, glm::vec3 boxMin, glm::vec3 boxMax, glm::vec3 &dstMin, glm::vec3 &dstMax)
+  {
+    dstMin = glm::vec3(std::numeric_limits<float>::max());
+    dstMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (int cornerIndex = 0; cornerIndex < 8; cornerIndex++)
+    {
+      glm::vec3 corner = glm::vec3(
+        (cornerIndex & 1) ? boxMax.x : boxMin.x,
+        (cornerIndex & 2) ? boxMax.y : boxMin.y,
+        (cornerIndex & 4) ? boxMax.z : boxMin.z);
+      glm::vec3 worldCorner = glm::vec3(transform * glm::vec4(corner, 1.0f));
+      dstMin = glm::min(dstMin, worldCorner);
+      dstMax = glm::max(dstMax, worldCorner);
+    }
+  }
+
   std::vector<std::unique_ptr<Mesh>> meshes;
   std::vector<Object> objects;
+  std::vector<PointChunk> pointChunks;
+  std::vector<PointLodNode> pointLodNodes;
+  std::vector<uint32_t> pointLodRoots;
   size_t markerObjectIndex;
 
   legit::VertexDeclaration vertexDecl;
@@ -36,6 +36,7 @@ glm::uvec3 ReadJsonVec3u(Json::Value vectorValue)
 }
 
 #include "Scene/Mesh.h"
+#include "Scene/PointCloudLoader.h"
 #include "Scene/Scene.h"
 #include "imgui.h"
 #include "LegitProfiler/ImGuiProfilerRenderer.h"
@@ -45,6 +46,11 @@ glm::uvec3 ReadJsonVec3u(Json::Value vectorValue)
 #include "Render/Renderers/VolumeRenderer.h"
 #include "Render/Renderers/PointRenderer.h"
 #include "Render/Renderers/WaterRenderer/WaterParticleRenderer.h"
+#include "Render/Common/HeadlessQueue.h"
+#include "Render/Common/ProfilerTraceRecorder.h"
+#include "Benchmark/CameraPath.h"
+#include "Benchmark/BenchmarkReport.h"
+#include "Benchmark/SplatRasterCheck.h"
 
 
 struct ImGuiScopedFrame
@@ -81,38 +87,71 @@ glm::uvec2 GetGlfwWindowClientSize(GLFWwindow *window)
   return {width, height};
 }
 
-int RunDemo(int currDemo, legit::WindowFactory::Window *window)
+struct DemoDesc
 {
   std::string configFilename;
   Scene::GeometryTypes geomType;
   std::string rendererName;
+};
 
-  if(currDemo == 0)
+DemoDesc GetDemoDesc(int demoIndex)
+{
+  DemoDesc demoDesc;
+  if(demoIndex == 0)
   {
-    configFilename = "../data/Scenes/DummyScene.json";
-    geomType = Scene::GeometryTypes::Triangles;
-    rendererName = "WaterRenderer";
+    demoDesc.configFilename = "../data/Scenes/DummyScene.json";
+    demoDesc.geomType = Scene::GeometryTypes::Triangles;
+    demoDesc.rendererName = "WaterRenderer";
   }
 
-  if (currDemo == 1)
+  if (demoIndex == 1)
   {
-    configFilename = "../data/Scenes/SponzaSceneLight.json";
-    geomType = Scene::GeometryTypes::SizedPoints;
-    rendererName = "PointRenderer";
+    demoDesc.configFilename = "../data/Scenes/SponzaSceneLight.json";
+    demoDesc.geomType = Scene::GeometryTypes::SizedPoints;
+    demoDesc.rendererName = "PointRenderer";
   }
 
-  if (currDemo == 2)
+  if (demoIndex == 2)
   {
-    configFilename = "../data/Scenes/SponzaScene.json";
-    geomType = Scene::GeometryTypes::Triangles;
-    rendererName = "SSVGIRenderer";
+    demoDesc.configFilename = "../data/Scenes/SponzaScene.json";
+    demoDesc.geomType = Scene::GeometryTypes::Triangles;
+    demoDesc.rendererName = "SSVGIRenderer";
   }
-  if(currDemo == 3)
+  if(demoIndex == 3)
   {
-    configFilename = "../data/Scenes/DummyScene.json";
-    geomType = Scene::GeometryTypes::Triangles;
-    rendererName = "VolumeRenderer";
+    demoDesc.configFilename = "../data/Scenes/DummyScene.json";
+    demoDesc.geomType = Scene::GeometryTypes::Triangles;
+    demoDesc.rendererName = "VolumeRenderer";
   }
+  return demoDesc;
+}
+
+Json::Value LoadJson(std::string configFilename)
+{
+  Json::Value configRoot;
+  Json::Reader reader;
+
+  std::ifstream fileStream(configFilename);
+  if (!fileStream.is_open())
+    std::cout << "Can't open file " << configFilename << "\n";
+  bool result = reader.parse(fileStream, configRoot);
+  if (result)
+  {
+    std::cout << "File " << configFilename << ", parsing successful\n";
+  }
+  else
+  {
+    std::cout << "Error: File " << configFilename << ", parsing failed with errors: " << reader.getFormattedErrorMessages() << "\n";
+  }
+  return configRoot;
+}
+
+int RunDemo(int currDemo, legit::WindowFactory::Window *window)
+{
+  DemoDesc demoDesc = GetDemoDesc(currDemo);
+  std::string configFilename = demoDesc.configFilename;
+  Scene::GeometryTypes geomType = demoDesc.geomType;
+  std::string rendererName = demoDesc.rendererName;
 
   int nextDemo = currDemo;
   bool isClosed = false;
@@ -134,24 +173,7 @@ int RunDemo(int currDemo, legit::WindowFactory::Window *window)
     ImGuiRenderer imguiRenderer(core.get(), window->glfw_window);
     ImGuiUtils::ProfilersWindow profilersWindow;
 
-    Json::Value configRoot;
-    Json::Reader reader;
-
-
-
-
-    std::ifstream fileStream(configFilename);
-    if (!fileStream.is_open())
-      std::cout << "Can't open scene file";
-    bool result = reader.parse(fileStream, configRoot);
-    if (result)
-    {
-      std::cout << "File " << configFilename << ", parsing successful\n";
-    }
-    else
-    {
-      std::cout << "Error: File " << configFilename << ", parsing failed with errors: " << reader.getFormattedErrorMessages() << "\n";
-    }
+    Json::Value configRoot = LoadJson(configFilename);
     Scene scene(configRoot["scene"], core.get(), geomType);
 
     std::unique_ptr<BaseRenderer> renderer;
@@ -181,6 +203,10 @@ int RunDemo(int currDemo, legit::WindowFactory::Window *window)
 
     glm::f64vec2 prevMousePos = mousePos;
 
+    ProfilerTraceRecorder traceRecorder(2);
+    int traceFramesCount = 60;
+    CameraPathRecorder pathRecorder;
+
     size_t frameIndex = 0;
     while (!(isClosed = glfwWindowShouldClose(window->glfw_window)) && currDemo == nextDemo)
     {
@@ -260,12 +286,15 @@ int RunDemo(int currDemo, legit::WindowFactory::Window *window)
           glfwSetWindowShouldClose(window->glfw_window, GLFW_TRUE);
         }
 
+        pathRecorder.AddFrame(camera, light);
+
         const uint32_t FrameSetIndex = 0;
         const uint32_t PassSetIndex = 1;
         const uint32_t DrawCallSetIndex = 2;
 
         try
         {
+          traceRecorder.BeginFrame();
           auto frameInfo = inFlightQueue->BeginFrame();
           {
             ImGuiScopedFrame scopedFrame;
@@ -273,6 +302,8 @@ int RunDemo(int currDemo, legit::WindowFactory::Window *window)
             auto& gpuProfilerData = inFlightQueue->GetLastFrameGpuProfilerData();
             auto& cpuProfilerData = inFlightQueue->GetLastFrameCpuProfilerData();
 
+            renderer->ProcessGpuProfilerData(gpuProfilerData.data(), gpuProfilerData.size());
+
             {
               auto passCreationTask = inFlightQueue->GetCpuProfiler().StartScopedTask("PassCreation", legit::Colors::orange);
               renderer->RenderFrame(frameInfo, camera, light, &scene, window->glfw_window);
@@ -299,6 +330,28 @@ int RunDemo(int currDemo, legit::WindowFactory::Window *window)
               ImGui::RadioButton("PointRenderer", &nextDemo, 1);
               ImGui::RadioButton("SSVGIRenderer", &nextDemo, 2);
               ImGui::RadioButton("VolumeRenderer", &nextDemo, 3);
+              ImGui::InputInt("Trace frames", &traceFramesCount);
+              if (ImGui::Button(traceRecorder.IsCapturing() ? "Capturing..." : "Capture trace") && !traceRecorder.IsCapturing())
+                traceRecorder.StartCapture(size_t(std::max(traceFramesCount, 1)));
+              if (!pathRecorder.IsRecording() && ImGui::Button("Record benchmark path"))
+                pathRecorder.Start();
+              if (pathRecorder.IsRecording() && ImGui::Button("Stop and save benchmark path"))
+              {
+                pathRecorder.Stop();
+                BenchmarkDesc benchmarkDesc;
+                benchmarkDesc.sceneFilename = configFilename;
+                benchmarkDesc.geomType = geomType;
+                benchmarkDesc.rendererName = rendererName;
+                benchmarkDesc.viewportSize = glm::uvec2(inFlightQueue->GetImageSize().width, inFlightQueue->GetImageSize().height);
+                benchmarkDesc.path = pathRecorder.GetPath();
+                benchmarkDesc.framesCount = benchmarkDesc.path.GetLastFrameIndex() + 1;
+                Json::Value benchmarkRoot;
+                benchmarkRoot["benchmark"] = benchmarkDesc.Save();
+                std::ofstream fileStream("benchmark.json");
+                Json::StyledStreamWriter writer;
+                writer.write(fileStream, benchmarkRoot);
+                std::cout << "Saved benchmark path to benchmark.json\n";
+              }
             }
             ImGui::End();
 
@@ -310,6 +363,9 @@ int RunDemo(int currDemo, legit::WindowFactory::Window *window)
             imguiRenderer.RenderFrame(frameInfo, window->glfw_window, ImGui::GetDrawData());
           }
           inFlightQueue->EndFrame();
+          traceRecorder.EndFrame(inFlightQueue->GetLastFrameCpuProfilerData(), inFlightQueue->GetLastFrameGpuProfilerData());
+          if (traceRecorder.IsCaptureFinished())
+            traceRecorder.SaveTrace("profilerTrace.json");
         }
         catch (vk::OutOfDateKHRError err)
         {
@@ -325,9 +381,230 @@ int RunDemo(int currDemo, legit::WindowFactory::Window *window)
   }
   return isClosed ? -1 : nextDemo;
 }
+
+struct HeadlessSettings
+{
+  glm::uvec2 imageSize = glm::uvec2(1024, 1024);
+  size_t warmupFramesCount = 0;
+  size_t framesCount = 100;
+  //if not 0, profiler data of the last traceFramesCount frames gets saved to traceFilename
+  size_t traceFramesCount = 0;
+  std::string traceFilename = "profilerTrace.json";
+  //if set, the camera and the light follow the path instead of standing still. warmup frames stay at its start
+  const CameraPath *cameraPath = nullptr;
+  //if set, receives timings of all frames after the warmup
+  BenchmarkReport *report = nullptr;
+};
+
+//renders a fixed number of frames without a window or a swapchain, so it works on machines without a display or gpu (e.g. with lavapipe)
+int RunHeadless(DemoDesc demoDesc, HeadlessSettings settings)
+{
+  bool enableDebugging = false;
+  #if defined LEGIT_ENABLE_DEBUGGING
+  enableDebugging = true;
+  #endif
+  //there's no surface to be compatible with, so no window extensions either
+  auto core = std::make_unique<legit::Core>(nullptr, 0, nullptr, enableDebugging);
+
+  //renderers still build their imgui widgets every frame, they just never get drawn
+  ImGuiContext *imguiContext = ImGui::CreateContext();
+  {
+    unsigned char *fontPixels;
+    int fontWidth, fontHeight;
+    ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&fontPixels, &fontWidth, &fontHeight);
+  }
+
+  //some renderers generate random data on the cpu, runs of the same path have to match
+  srand(0);
+
+  {
+    Json::Value configRoot = LoadJson(demoDesc.configFilename);
+    Scene scene(configRoot["scene"], core.get(), demoDesc.geomType);
+
+    std::unique_ptr<BaseRenderer> renderer = CreateRenderer(core.get(), demoDesc.rendererName);
+    renderer->RecreateSceneResources(&scene);
+
+    HeadlessQueue headlessQueue(core.get(), settings.imageSize, 2);
+    renderer->RecreateSwapchainResources(headlessQueue.GetImageSize(), headlessQueue.GetInFlightFramesCount());
+
+    Camera light;
+    light.pos = glm::vec3(0.0f, 5.0f, 0.0f);
+    light.vertAngle = 3.1415f / 2.0f;
+
+    Camera camera;
+    camera.pos = glm::vec3(0.0f, 0.5f, -2.0f);
+
+    size_t inFlightFramesCount = headlessQueue.GetInFlightFramesCount();
+    ProfilerTraceRecorder traceRecorder(inFlightFramesCount);
+    size_t traceFramesCount = std::min(settings.traceFramesCount, settings.framesCount);
+
+    size_t measuredBegin = settings.warmupFramesCount;
+    size_t measuredEnd = measuredBegin + settings.framesCount;
+    //gpu data of a frame arrives inFlightFramesCount frames later, so a few more frames are needed to collect all of it
+    size_t totalFramesCount = measuredEnd + ((settings.report || traceFramesCount > 0) ? inFlightFramesCount : 0);
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto endTime = startTime;
+    for (size_t frameNumber = 0; frameNumber < totalFramesCount; frameNumber++)
+    {
+      if (frameNumber == measuredBegin)
+        startTime = std::chrono::steady_clock::now();
+      if (frameNumber == measuredEnd)
+        endTime = std::chrono::steady_clock::now();
+      if (traceFramesCount > 0 && frameNumber == measuredEnd - traceFramesCount)
+        traceRecorder.StartCapture(traceFramesCount);
+
+      if (settings.cameraPath)
+      {
+        Camera prevCamera = camera;
+        settings.cameraPath->Evaluate(frameNumber < measuredBegin ? 0 : frameNumber - measuredBegin, camera, light);
+        if (camera.pos != prevCamera.pos || camera.horAngle != prevCamera.horAngle || camera.vertAngle != prevCamera.vertAngle)
+          renderer->ChangeView();
+      }
+
+      auto& imguiIO = ImGui::GetIO();
+      imguiIO.DeltaTime = 1.0f / 60.0f;
+      imguiIO.DisplaySize.x = float(headlessQueue.GetImageSize().width);
+      imguiIO.DisplaySize.y = float(headlessQueue.GetImageSize().height);
+
+      traceRecorder.BeginFrame();
+      auto frameInfo = headlessQueue.BeginFrame();
+      {
+        ImGuiScopedFrame scopedFrame;
+
+        auto& gpuProfilerData = headlessQueue.GetLastFrameGpuProfilerData();
+        auto& cpuProfilerData = headlessQueue.GetLastFrameCpuProfilerData();
+        renderer->ProcessGpuProfilerData(gpuProfilerData.data(), gpuProfilerData.size());
+        if (settings.report)
+        {
+          if (frameNumber >= measuredBegin + 1 && frameNumber - 1 < measuredEnd)
+            settings.report->AddCpuFrame(cpuProfilerData.data(), cpuProfilerData.size());
+          if (frameNumber >= measuredBegin + inFlightFramesCount && frameNumber - inFlightFramesCount < measuredEnd)
+            settings.report->AddGpuFrame(gpuProfilerData.data(), gpuProfilerData.size());
+        }
+        {
+          auto passCreationTask = headlessQueue.GetCpuProfiler().StartScopedTask("PassCreation", legit::Colors::orange);
+          renderer->RenderFrame(frameInfo, camera, light, &scene, nullptr);
+        }
+      }
+      headlessQueue.EndFrame();
+      traceRecorder.EndFrame(headlessQueue.GetLastFrameCpuProfilerData(), headlessQueue.GetLastFrameGpuProfilerData());
+    }
+    core->WaitIdle();
+    if (totalFramesCount == measuredEnd)
+      endTime = std::chrono::steady_clock::now();
+    if (traceRecorder.IsCaptureFinished())
+      traceRecorder.SaveTrace(settings.traceFilename);
+
+    float totalTime = std::chrono::duration<float>(endTime - startTime).count();
+    std::cout << "Rendered " << settings.framesCount << " frames of " << demoDesc.rendererName << " at " << settings.imageSize.x << "x" << settings.imageSize.y << " in " << totalTime << "s, " << 1000.0f * totalTime / float(std::max<size_t>(settings.framesCount, 1)) << "ms per frame\n";
+  }
+  ImGui::DestroyContext(imguiContext);
+  return 0;
+}
+
+//replays a benchmark file headlessly and writes per-pass timings to reportFilename. if a baseline report is given,
+//returns 1 when any pass got slower than the baseline by more than relativeThreshold
+int RunBenchmark(std::string benchmarkFilename, std::string reportFilename, std::string baselineFilename, double relativeThreshold)
+{
+  Json::Value benchmarkRoot = LoadJson(benchmarkFilename);
+  if (benchmarkRoot.isNull())
+    return 1;
+  BenchmarkDesc benchmarkDesc = BenchmarkDesc::Load(benchmarkRoot["benchmark"]);
+
+  DemoDesc demoDesc;
+  demoDesc.configFilename = benchmarkDesc.sceneFilename;
+  demoDesc.geomType = benchmarkDesc.geomType;
+  demoDesc.rendererName = benchmarkDesc.rendererName;
+
+  BenchmarkReport report;
+  HeadlessSettings settings;
+  settings.imageSize = benchmarkDesc.viewportSize;
+  settings.warmupFramesCount = benchmarkDesc.warmupFramesCount;
+  settings.framesCount = benchmarkDesc.framesCount;
+  settings.cameraPath = &benchmarkDesc.path;
+  settings.report = &report;
+  RunHeadless(demoDesc, settings);
+
+  report.Print();
+  Json::Value reportValue = report.Save(benchmarkDesc);
+  {
+    std::ofstream fileStream(reportFilename);
+    Json::StyledStreamWriter writer;
+    writer.write(fileStream, reportValue);
+    std::cout << "Saved benchmark report to " << reportFilename << "\n";
+  }
+
+  if (baselineFilename.empty())
+    return 0;
+  Json::Value baselineRoot = LoadJson(baselineFilename);
+  if (baselineRoot.isNull())
+    return 1;
+  //differences below this are timer noise no matter how short the pass is
+  const double minDiffMs = 0.05;
+  auto regressions = report.FindRegressions(baselineRoot, relativeThreshold, minDiffMs);
+  for (const auto &regression : regressions)
+    std::cout << "Regression: " << regression << "\n";
+  std::cout << regressions.size() << " passes regressed by more than " << relativeThreshold * 100.0 << "%\n";
+  return regressions.empty() ? 0 : 1;
+}
+
+//usage:
+//LegitEngine [--demo N]
+//LegitEngine --headless [--demo N] [--frames N] [--size W H] [--trace N [filename]]
+//LegitEngine --benchmark benchmark.json [--report report.json] [--baseline baseline.json] [--threshold 0.1]
+//LegitEngine --check-splat-raster [--size W H]
 int main(int argsCount, char **args)
 {
   int currDemo = 0;
+  bool isHeadless = false;
+  bool isSplatRasterCheck = false;
+  HeadlessSettings headlessSettings;
+  std::string benchmarkFilename;
+  std::string reportFilename = "benchmarkReport.json";
+  std::string baselineFilename;
+  double regressionThreshold = 0.1;
+  for (int argIndex = 1; argIndex < argsCount; argIndex++)
+  {
+    std::string arg = args[argIndex];
+    if (arg == "--headless")
+      isHeadless = true;
+    else if (arg == "--check-splat-raster")
+      isSplatRasterCheck = true;
+    else if (arg == "--demo" && argIndex + 1 < argsCount)
+      currDemo = atoi(args[++argIndex]);
+    else if (arg == "--frames" && argIndex + 1 < argsCount)
+      headlessSettings.framesCount = size_t(atoi(args[++argIndex]));
+    else if (arg == "--size" && argIndex + 2 < argsCount)
+    {
+      headlessSettings.imageSize.x = glm::uint(atoi(args[++argIndex]));
+      headlessSettings.imageSize.y = glm::uint(atoi(args[++argIndex]));
+    }
+    else if (arg == "--trace" && argIndex + 1 < argsCount)
+    {
+      headlessSettings.traceFramesCount = size_t(atoi(args[++argIndex]));
+      if (argIndex + 1 < argsCount && args[argIndex + 1][0] != '-')
+        headlessSettings.traceFilename = args[++argIndex];
+    }
+    else if (arg == "--benchmark" && argIndex + 1 < argsCount)
+      benchmarkFilename = args[++argIndex];
+    else if (arg == "--report" && argIndex + 1 < argsCount)
+      reportFilename = args[++argIndex];
+    else if (arg == "--baseline" && argIndex + 1 < argsCount)
+      baselineFilename = args[++argIndex];
+    else if (arg == "--threshold" && argIndex + 1 < argsCount)
+      regressionThreshold = atof(args[++argIndex]);
+    else
+      std::cout << "Unknown argument: " << arg << "\n";
+  }
+
+  if (isSplatRasterCheck)
+    return RunSplatRasterCheck(headlessSettings.imageSize, size_t(1) << 20);
+  if (!benchmarkFilename.empty())
+    return RunBenchmark(benchmarkFilename, reportFilename, baselineFilename, regressionThreshold);
+  if (isHeadless)
+    return RunHeadless(GetDemoDesc(currDemo), headlessSettings);
+
   auto windowFactory = legit::WindowFactory();
   auto window = windowFactory.Create(1024, 1024, "Legit engine!", nullptr, nullptr);
   while (currDemo != -1)
@@ -0,0 +1,167 @@
+//offline cpu bake of the shrodinger water simulation, does not need vulkan or a gpu. writes one velocity volume per
+//simulated frame that WaterParticleRenderer can play back instead of running the solver.
+//usage: ShrodingerBake [--output path] [--resolution N] [--frames N] [--volume-min X Y Z] [--volume-max X Y Z] [--threads N] [--tracers N]
+//  [--multigrid] [--poisson-tolerance X] [--gauss-seidel N] [--compress] [--wave-function]
+//the pressure is solved spectrally by default, --multigrid and --gauss-seidel switch to the iterative solvers.
+//--compress stores frames with FieldCompression, --wave-function stores the wave function after every velocity frame
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+
+#include "../src/Render/Renderers/WaterRenderer/CpuShrodingerSolver.h"
+#include "../src/Render/Renderers/WaterRenderer/BakedVelocityFrames.h"
+
+//same two spheres WaterParticleRenderer fills with points, advected alongside the bake to catch a blown up simulation early
+std::vector<glm::vec3> GenerateTracers(const CpuShrodingerSolver::Settings &settings, int gridSize)
+{
+  std::vector<glm::vec3> tracers;
+  for (int z = 0; z < gridSize; z++)
+  {
+    for (int y = 0; y < gridSize; y++)
+    {
+      for (int x = 0; x < gridSize; x++)
+      {
+        glm::vec3 normPos = (glm::vec3(x, y, z) + glm::vec3(0.5f)) / float(gridSize);
+        if (glm::length(normPos - glm::vec3(0.3f, 0.5f, 0.5f)) < 0.1f || glm::length(normPos - glm::vec3(0.7f, 0.5f, 0.5f)) < 0.1f)
+          tracers.push_back(settings.volumeMin + normPos * (settings.volumeMax - settings.volumeMin));
+      }
+    }
+  }
+  return tracers;
+}
+
+size_t CountEscapedTracers(const CpuShrodingerSolver::Settings &settings, const std::vector<glm::vec3> &tracers)
+{
+  size_t escapedCount = 0;
+  for (auto tracer : tracers)
+  {
+    if (glm::any(glm::lessThan(tracer, settings.volumeMin)) || glm::any(glm::greaterThan(tracer, settings.volumeMax)))
+      escapedCount++;
+  }
+  return escapedCount;
+}
+
+float GetMaxSpeed(const std::vector<glm::vec4> &velocity)
+{
+  float maxSpeed = 0.0f;
+  for (auto nodeVelocity : velocity)
+    maxSpeed = std::max(maxSpeed, glm::length(glm::vec3(nodeVelocity)));
+  return maxSpeed;
+}
+
+int main(int argc, char **argv)
+{
+  CpuShrodingerSolver::Settings settings;
+  settings.volumeMin = glm::vec3(-2.5f);
+  settings.volumeMax = glm::vec3(2.5f);
+  std::string outputPath = "../data/Bakes/ShrodingerBake.lvel"; //where WaterParticleRenderer looks for it
+  size_t framesCount = 500;
+  int tracersGridSize = 0;
+  uint32_t compression = BakedVelocityHeader::None;
+  uint32_t fieldsCount = 1;
+  for (int argIndex = 1; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    bool hasValue = argIndex + 1 < argc;
+    bool hasVec3 = argIndex + 3 < argc;
+    if (arg == "--output" && hasValue)
+      outputPath = argv[++argIndex];
+    else if (arg == "--resolution" && hasValue)
+      settings.volumeResolution = glm::uvec3(glm::uint(atoi(argv[++argIndex])));
+    else if (arg == "--frames" && hasValue)
+      framesCount = size_t(atoi(argv[++argIndex]));
+    else if ((arg == "--volume-min" || arg == "--volume-max") && hasVec3)
+    {
+      glm::vec3 point;
+      for (int i = 0; i < 3; i++)
+        point[i] = float(atof(argv[++argIndex]));
+      (arg == "--volume-min" ? settings.volumeMin : settings.volumeMax) = point;
+    }
+    else if (arg == "--threads" && hasValue)
+      settings.parallelSettings.threadsCount = size_t(atoi(argv[++argIndex]));
+    else if (arg == "--tracers" && hasValue)
+      tracersGridSize = atoi(argv[++argIndex]);
+    else if (arg == "--multigrid")
+      settings.poissonSolverType = CpuShrodingerSolver::PoissonSolverTypes::Multigrid;
+    else if (arg == "--poisson-tolerance" && hasValue)
+    {
+      settings.poissonSolverType = CpuShrodingerSolver::PoissonSolverTypes::Multigrid;
+      settings.poissonTolerance = float(atof(argv[++argIndex]));
+    }
+    else if (arg == "--gauss-seidel" && hasValue)
+    {
+      settings.poissonSolverType = CpuShrodingerSolver::PoissonSolverTypes::GaussSeidel;
+      settings.poissonIterationsCount = atoi(argv[++argIndex]);
+    }
+    else if (arg == "--compress")
+      compression = BakedVelocityHeader::BrickRans;
+    else if (arg == "--wave-function")
+      fieldsCount = 2;
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--output path] [--resolution N] [--frames N] [--volume-min X Y Z] [--volume-max X Y Z] [--threads N] [--tracers N] [--multigrid] [--poisson-tolerance X] [--gauss-seidel N] [--compress] [--wave-function]\n";
+      return 1;
+    }
+  }
+  glm::uint resolution = settings.volumeResolution.x;
+  if (resolution < 2 || (resolution & (resolution - 1)) != 0)
+  {
+    std::cerr << "resolution has to be a power of 2 for the fft\n";
+    return 1;
+  }
+  if (compression != BakedVelocityHeader::None && resolution < glm::uint(FieldCompression::BrickSize))
+  {
+    std::cerr << "compressed bakes need a resolution of at least " << FieldCompression::BrickSize << "\n";
+    return 1;
+  }
+
+  std::error_code errorCode;
+  std::filesystem::path outputDir = std::filesystem::path(outputPath).parent_path();
+  if (!outputDir.empty())
+    std::filesystem::create_directories(outputDir, errorCode);
+  BakedVelocityWriter writer;
+  if (!writer.Open(outputPath, settings.volumeResolution, settings.volumeMin, settings.volumeMax, settings.timeStep, settings.h, fieldsCount, compression))
+  {
+    std::cerr << "Can't open " << outputPath << "\n";
+    return 1;
+  }
+
+  CpuShrodingerSolver solver(settings);
+  std::vector<glm::vec3> tracers = GenerateTracers(settings, tracersGridSize);
+
+  using Clock = std::chrono::steady_clock;
+  auto bakeStart = Clock::now();
+  size_t bakedSize = 0;
+  solver.Init();
+  for (size_t frameIndex = 0; frameIndex < framesCount; frameIndex++)
+  {
+    auto frameStart = Clock::now();
+    solver.Step();
+    if (!writer.WriteFrame(solver.GetVelocity().data(), solver.GetWaveFunc().data()))
+    {
+      std::cerr << "Can't write frame " << frameIndex << " to " << outputPath << "\n";
+      return 1;
+    }
+    bakedSize += writer.GetLastFrameSize();
+    solver.AdvectParticles(tracers.data(), tracers.size());
+    double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+
+    std::cout << "frame " << frameIndex + 1 << "/" << framesCount << ": " << frameMs << "ms, max speed " << GetMaxSpeed(solver.GetVelocity());
+    std::cout << ", poisson residual " << solver.GetLastPoissonResidual();
+    if (settings.poissonSolverType == CpuShrodingerSolver::PoissonSolverTypes::Multigrid)
+      std::cout << " after " << solver.GetLastPoissonCyclesCount() << " v-cycles";
+    if (!tracers.empty())
+      std::cout << ", escaped tracers " << CountEscapedTracers(settings, tracers) << "/" << tracers.size();
+    std::cout << "\n";
+  }
+  double bakeSeconds = std::chrono::duration<double>(Clock::now() - bakeStart).count();
+  std::cout << "Baked " << framesCount << " frames of " << resolution << "^3 velocity to " << outputPath << " in " << bakeSeconds << "s\n";
+  if (compression != BakedVelocityHeader::None)
+  {
+    size_t rawSize = framesCount * fieldsCount * writer.GetHeader().GetFieldSize();
+    std::cout << "Compressed " << rawSize / (1024 * 1024) << "MB to " << bakedSize / (1024 * 1024) << "MB, ratio " << double(rawSize) / double(std::max<size_t>(bakedSize, 1)) << "\n";
+  }
+  return 0;
+}